@@ -0,0 +1,171 @@
+/**
+ * Saves regions of device memory to a checkpoint file and loads them back,
+ * with each I/O backend, with and without direct I/O; and checks that:
+ *
+ *   - the loaded regions hold what was saved;
+ *   - saving again replaces the checkpoint - rather than overwriting it in
+ *     place - leaving no temporary files behind;
+ *   - a save which fails cleans up after itself;
+ *   - corrupt checkpoints, and mismatched region lists, are rejected.
+ */
+#include <cuda/api/detail/file_system.hpp>
+#include <cuda/io.hpp>
+#include <cuda/runtime_api.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace checkpoint = cuda::io::checkpoint;
+namespace file_system = cuda::detail_::file_system;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+struct regions_t {
+	std::vector<std::vector<char>>                            host;
+	std::vector<cuda::memory::device::unique_ptr<char[]>>     device;
+
+	std::vector<cuda::memory::const_region_t> const_regions() const
+	{
+		std::vector<cuda::memory::const_region_t> regions;
+		for(size_t i = 0; i < host.size(); i++) { regions.push_back({ device[i].get(), host[i].size() }); }
+		return regions;
+	}
+
+	std::vector<cuda::memory::region_t> regions()
+	{
+		std::vector<cuda::memory::region_t> regions;
+		for(size_t i = 0; i < host.size(); i++) { regions.push_back({ device[i].get(), host[i].size() }); }
+		return regions;
+	}
+};
+
+// Sizes straddling the chunk size, as well as an empty region
+regions_t make_regions(const cuda::device_t& device, const std::vector<size_t>& sizes, unsigned seed)
+{
+	regions_t regions;
+	for(auto size : sizes) {
+		std::vector<char> host(size);
+		for(size_t i = 0; i < size; i++) { host[i] = static_cast<char>(i * 131 + size + seed); }
+		regions.device.push_back(cuda::memory::device::make_unique<char[]>(device, size + 1));
+		cuda::memory::copy(regions.device.back().get(), host.data(), size);
+		regions.host.push_back(std::move(host));
+	}
+	return regions;
+}
+
+void check_contents(const regions_t& expected, const regions_t& actual, const std::string& what)
+{
+	for(size_t i = 0; i < expected.host.size(); i++) {
+		std::vector<char> loaded(expected.host[i].size());
+		cuda::memory::copy(loaded.data(), actual.device[i].get(), loaded.size());
+		(loaded == expected.host[i]) or die_(what + ": region " + std::to_string(i) + " was not restored");
+	}
+}
+
+void check_no_temporary_files(const std::string& directory)
+{
+	std::vector<std::string> names;
+	file_system::list_directory(directory, names) or die_("Failed listing " + directory);
+	for(const auto& name : names) {
+		(name.find(".tmp.") == std::string::npos) or die_("A temporary file was left behind: " + name);
+	}
+}
+
+template <typename Exception, typename F>
+void check_throws(F&& f, const std::string& what)
+{
+	try { f(); }
+	catch(Exception&) { return; }
+	die_(what + " was not rejected");
+}
+
+int main()
+{
+	auto device = cuda::device::current::get();
+	auto stream = device.create_stream(cuda::stream::async);
+	const std::vector<size_t> sizes { 100, 0, 3 * 65536 + 5, 65536, 7, 200000 };
+
+	char directory_template[] = "./checkpoint_round_trip.XXXXXX";
+	(::mkdtemp(directory_template) != nullptr) or die_("Failed creating a directory for the checkpoint");
+	std::string directory { directory_template };
+	auto path = directory + "/regions.ckpt";
+
+	auto saved = make_regions(device, sizes, 0);
+	auto loaded = make_regions(device, sizes, 1);
+	for(auto backend : { cuda::io::io_backend_t::thread_pool, cuda::io::io_backend_t::automatic }) {
+		for(bool direct_io : { false, true }) {
+			checkpoint::options_t options;
+			options.chunk_size = 65536;
+			options.num_buffers = 3;
+			options.backend = backend;
+			options.direct_io = direct_io;
+			checkpoint::pipeline_t pipeline(device, options);
+			auto save_statistics = pipeline.save(saved.const_regions(), path, stream);
+			auto load_statistics = pipeline.restore(loaded.regions(), path, stream);
+			stream.synchronize();
+			std::cout << "Saved " << save_statistics << "\nLoaded " << load_statistics << '\n';
+			check_contents(saved, loaded, "Round trip");
+			check_no_temporary_files(directory);
+		}
+	}
+	std::cout << "Round trips: OK\n";
+
+	// Saving again replaces the existing checkpoint file with a new one; whoever
+	// is still reading the old one - e.g. a concurrent load - sees it unchanged
+	auto resaved = make_regions(device, sizes, 2);
+	std::ifstream old_file(path, std::ios::binary);
+	std::vector<char> old_contents { std::istreambuf_iterator<char>(old_file), std::istreambuf_iterator<char>() };
+	cuda::io::save_device_regions(resaved.const_regions(), path, stream);
+	old_file.clear();
+	old_file.seekg(0);
+	std::vector<char> reread_contents { std::istreambuf_iterator<char>(old_file), std::istreambuf_iterator<char>() };
+	(reread_contents == old_contents) or die_("The checkpoint file was overwritten in place");
+	cuda::io::load_device_regions(loaded.regions(), path, stream);
+	stream.synchronize();
+	check_contents(resaved, loaded, "Replacement");
+	check_no_temporary_files(directory);
+	std::cout << "Replacement: OK\n";
+
+	// The data is written before the target is replaced; here, replacing it fails
+	auto directory_in_the_way = directory + "/in_the_way";
+	file_system::make_directory(directory_in_the_way) or die_("Failed creating " + directory_in_the_way);
+	check_throws<std::runtime_error>([&] {
+		cuda::io::save_device_regions(saved.const_regions(), directory_in_the_way, stream);
+	}, "Replacing a directory with a checkpoint");
+	check_no_temporary_files(directory);
+	std::cout << "Failed save: OK\n";
+
+	check_throws<std::invalid_argument>([&] {
+		auto regions = loaded.regions();
+		regions.pop_back();
+		cuda::io::load_device_regions(regions, path, stream);
+	}, "A mismatched region list");
+	{
+		std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+		file.seekp(3 * 4096 + 10);
+		file.put('X');
+	}
+	check_throws<std::runtime_error>([&] {
+		cuda::io::load_device_regions(loaded.regions(), path, stream);
+	}, "A corrupt checkpoint");
+	stream.synchronize();
+	std::cout << "Invalid checkpoints: OK\n";
+
+	::unlink(path.c_str());
+	::rmdir(directory_in_the_way.c_str());
+	::rmdir(directory.c_str());
+	std::cout << "\nSUCCESS\n";
+}
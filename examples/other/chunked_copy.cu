@@ -0,0 +1,152 @@
+/**
+ * Copies buffers to a device in chunks, each signaled by an event of its own,
+ * and checks that:
+ *
+ *   - the chunks cover the buffer exactly, with only the last one possibly
+ *     smaller - for sizes which are multiples of the chunk size, and ones
+ *     which aren't, as well as for copies smaller than a single chunk;
+ *   - each chunk's event occurs once the chunk has arrived, and the chunk
+ *     holds the right data;
+ *   - work enqueued per chunk sees each chunk in order, and kernels launched
+ *     per chunk process exactly its elements;
+ *   - the chunks' events are drawn from, and returned to, their pool.
+ */
+#include <cuda/runtime_api.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using cuda::memory::async::chunked_copy_t;
+using cuda::memory::async::copy_and_signal_chunks;
+
+__global__ void increment(int* data, size_t length, int by)
+{
+	auto i = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+	if (i < length) { data[i] += by; }
+}
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+template <typename Exception, typename F>
+void check_throws(F&& f, const std::string& what)
+{
+	try { f(); }
+	catch(Exception&) { return; }
+	die_(what + " was not rejected");
+}
+
+std::vector<char> device_contents(const void* device_data, size_t num_bytes)
+{
+	std::vector<char> contents(num_bytes);
+	cuda::memory::copy(contents.data(), device_data, num_bytes);
+	return contents;
+}
+
+void check_chunks(const chunked_copy_t& copy, void* destination, size_t num_bytes, size_t chunk_size, const std::string& what)
+{
+	(copy.size() == num_bytes and copy.chunk_size() == chunk_size) or die_(what + ": unexpected sizes");
+	(copy.num_chunks() == (num_bytes + chunk_size - 1) / chunk_size) or die_(what + ": unexpected number of chunks");
+	auto expected_start = static_cast<char*>(destination);
+	for(size_t i = 0; i < copy.num_chunks(); i++) {
+		auto chunk = copy.destination_chunk(i);
+		(chunk.start() == expected_start) or die_(what + ": chunk " + std::to_string(i) + " does not follow the previous one");
+		bool is_last = i + 1 == copy.num_chunks();
+		(chunk.size() == (is_last ? num_bytes - i * chunk_size : chunk_size))
+			or die_(what + ": chunk " + std::to_string(i) + " is of the wrong size");
+		expected_start += chunk.size();
+	}
+	(expected_start == static_cast<char*>(destination) + num_bytes) or die_(what + ": the chunks do not cover the copy");
+	check_throws<std::out_of_range>([&] { copy.destination_chunk(copy.num_chunks()); }, what + ": a chunk past the last");
+	check_throws<std::out_of_range>([&] { copy.chunk_event(copy.num_chunks()); }, what + ": an event past the last chunk");
+}
+
+int main()
+{
+	constexpr size_t chunk_size = 4096;
+	constexpr size_t max_size = 10 * chunk_size + 100;
+
+	auto device = cuda::device::current::get();
+	auto stream = device.create_stream(cuda::stream::async);
+	std::vector<char> source(max_size);
+	for(size_t i = 0; i < max_size; i++) { source[i] = static_cast<char>(i * 7 + i / 4096); }
+	auto destination = cuda::memory::device::make_unique<char[]>(device, max_size);
+	cuda::event_pool_t pool(device);
+
+	for(size_t num_bytes : { max_size, 10 * chunk_size, chunk_size, chunk_size - 1, size_t{1}, size_t{0} }) {
+		auto what = "Copying " + std::to_string(num_bytes) + " bytes";
+		cuda::memory::device::zero(destination.get(), max_size);
+		auto statistics = pool.statistics();
+		auto copy = copy_and_signal_chunks(destination.get(), source.data(), num_bytes, stream, chunk_size, &pool);
+		check_chunks(copy, destination.get(), num_bytes, chunk_size, what);
+		(pool.statistics().acquired - statistics.acquired == copy.num_chunks()) or die_(what + ": unexpected number of events acquired");
+
+		// Once the last chunk has arrived, so have all others
+		if (copy.num_chunks() > 0) { copy.wait_for(copy.num_chunks() - 1); }
+		for(size_t i = 0; i < copy.num_chunks(); i++) {
+			copy.has_arrived(i) or die_(what + ": chunk " + std::to_string(i) + " has not arrived");
+		}
+		auto contents = device_contents(destination.get(), max_size);
+		(std::equal(source.begin(), source.begin() + num_bytes, contents.begin())) or die_(what + ": wrong data");
+		(std::all_of(contents.begin() + num_bytes, contents.end(), [](char c) { return c == 0; }))
+			or die_(what + ": data was copied past the end");
+	}
+	check_throws<std::invalid_argument>([&] {
+		copy_and_signal_chunks(destination.get(), source.data(), max_size, stream, 0, &pool);
+	}, "A zero chunk size");
+	std::cout << "Chunk boundaries: OK\n";
+
+	// The events of destroyed copies are reused
+	auto statistics = pool.statistics();
+	{
+		auto copy = copy_and_signal_chunks(destination.get(), source.data(), 3 * chunk_size, stream, chunk_size, &pool);
+		copy.wait_for(2);
+	}
+	auto copy = copy_and_signal_chunks(destination.get(), source.data(), 3 * chunk_size, stream, chunk_size, &pool);
+	(pool.statistics().created == statistics.created and pool.statistics().reused - statistics.reused == 6)
+		or die_("The events of chunked copies were not reused");
+	// Without a pool specified, the device's default pool is used
+	statistics = cuda::event_pool::default_pool(device).statistics();
+	copy_and_signal_chunks(destination.get(), source.data(), max_size, stream, chunk_size).wait_for(10);
+	(cuda::event_pool::default_pool(device).statistics().acquired - statistics.acquired == 11)
+		or die_("The device's default event pool was not used");
+	std::cout << "Pooling chunk events: OK\n";
+
+	// Consumers see the chunks in order, each after it has arrived
+	auto consumer_stream = device.create_stream(cuda::stream::async);
+	std::vector<size_t> consumed;
+	cuda::memory::async::enqueue_per_chunk(copy, consumer_stream, [&](cuda::stream_t&, size_t index, cuda::memory::region_t chunk) {
+		(chunk.start() == copy.destination_chunk(index).start()) or die_("A consumer was passed the wrong region");
+		consumed.push_back(index);
+	});
+	(consumed == std::vector<size_t>{ 0, 1, 2 }) or die_("Chunks were not consumed in order");
+
+	// Kernels on each chunk - the last of which is smaller - process exactly its elements
+	std::vector<int> values(1000);
+	for(size_t i = 0; i < values.size(); i++) { values[i] = static_cast<int>(i); }
+	auto device_values = cuda::memory::device::make_unique<int[]>(device, values.size());
+	auto int_copy = copy_and_signal_chunks(device_values.get(), values.data(), values.size() * sizeof(int), stream, 256 * sizeof(int), &pool);
+	cuda::memory::async::launch_per_chunk<int>(int_copy, consumer_stream, increment, cuda::make_launch_config(2, 128), 5);
+	consumer_stream.synchronize();
+	std::vector<int> incremented(values.size());
+	cuda::memory::copy(incremented.data(), device_values.get(), values.size() * sizeof(int));
+	for(size_t i = 0; i < values.size(); i++) {
+		(incremented[i] == values[i] + 5) or die_("Element " + std::to_string(i) + " was not processed exactly once");
+	}
+	check_throws<std::invalid_argument>([&] {
+		auto misaligned = copy_and_signal_chunks(device_values.get(), values.data(), 1000, stream, 998, &pool);
+		cuda::memory::async::launch_per_chunk<int>(misaligned, consumer_stream, increment, cuda::make_launch_config(2, 128), 5);
+	}, "Launching on chunks which are not made up of whole elements");
+	std::cout << "Consuming chunks: OK\n";
+
+	stream.synchronize();
+	consumer_stream.synchronize();
+	std::cout << "\nSUCCESS\n";
+}
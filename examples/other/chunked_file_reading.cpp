@@ -0,0 +1,199 @@
+/**
+ * A host-only check of the asynchronous file I/O used for loading files
+ * onto devices: reading files in order through a ring of buffers - with
+ * the io_uring backend (where the kernel permits it) and the thread pool
+ * backend, with and without direct I/O - and the positioned reads and
+ * writes underlying it, including reads cut short by the end of the file.
+ *
+ * No CUDA device is used (or required) by this program.
+ */
+#include <cuda/io/file_reader.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+using cuda::io::chunked_file_reader_t;
+using cuda::io::io_backend_t;
+namespace io_detail = cuda::io::detail_;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+char expected_byte(size_t offset) { return static_cast<char>(offset * 7 + offset / 4096); }
+
+void write_file(const std::string& path, size_t size)
+{
+	std::vector<char> contents(size);
+	for(size_t i = 0; i < size; i++) { contents[i] = expected_byte(i); }
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(contents.data(), static_cast<std::streamsize>(size));
+	file or die_("Failed writing " + path);
+}
+
+// Direct I/O requires block-aligned buffers
+struct buffer_ring_t {
+	char*               memory;
+	size_t              size;
+	std::vector<void*>  buffers;
+
+	buffer_ring_t(size_t num_buffers, size_t buffer_size) : size(num_buffers * buffer_size)
+	{
+		memory = static_cast<char*>(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+		(memory != MAP_FAILED) or die_("Failed mapping buffer memory");
+		for(size_t i = 0; i < num_buffers; i++) { buffers.push_back(memory + i * buffer_size); }
+	}
+	~buffer_ring_t() { munmap(memory, size); }
+};
+
+bool io_uring_usable()
+{
+	try {
+		io_detail::make_async_io(io_backend_t::io_uring, 1, {});
+		return true;
+	}
+	catch(std::system_error& error) {
+		std::cout << "io_uring is unavailable (" << error.what() << "); only the thread pool backend is checked\n";
+		return false;
+	}
+}
+
+void check_reading(
+	const std::string& path, size_t file_size, size_t buffer_size, size_t num_buffers,
+	io_backend_t backend, bool direct_io, unsigned queue_depth)
+{
+	auto what = std::string("Reading ") + std::to_string(file_size) + " bytes using the "
+		+ cuda::io::name(backend) + " backend" + (direct_io ? ", direct I/O" : "")
+		+ ", queue depth " + std::to_string(queue_depth);
+	buffer_ring_t ring(num_buffers, buffer_size);
+	cuda::io::read_options_t options;
+	options.backend = backend;
+	options.direct_io = direct_io;
+	options.queue_depth = queue_depth;
+	chunked_file_reader_t reader(path, ring.buffers, buffer_size, options);
+	(reader.backend() == backend) or die_(what + ": unexpected backend");
+	(reader.file_size() == file_size) or die_(what + ": file size mismatch");
+	(reader.num_chunks() == (file_size + buffer_size - 1) / buffer_size) or die_(what + ": unexpected number of chunks");
+
+	// Chunks are held two at a time, then released in reverse order
+	std::vector<size_t> held;
+	cuda::io::chunk_t chunk;
+	size_t expected_offset = 0;
+	while (reader.next(chunk)) {
+		(chunk.offset == expected_offset) or die_(what + ": chunk delivered out of order");
+		(chunk.size == std::min(buffer_size, file_size - chunk.offset)) or die_(what + ": unexpected chunk size");
+		(chunk.data == ring.buffers[chunk.buffer_index]) or die_(what + ": chunk not in its buffer");
+		auto data = static_cast<const char*>(chunk.data);
+		for(size_t i = 0; i < chunk.size; i++) {
+			(data[i] == expected_byte(chunk.offset + i)) or die_(what + ": wrong data at offset " + std::to_string(chunk.offset + i));
+		}
+		expected_offset += chunk.size;
+		held.push_back(chunk.buffer_index);
+		if (held.size() == 2 or reader.done()) {
+			for(auto it = held.rbegin(); it != held.rend(); ++it) { reader.release(*it); }
+			held.clear();
+		}
+	}
+	reader.done() or die_(what + ": not done after the last chunk");
+	(expected_offset == file_size) or die_(what + ": not all of the file was delivered");
+	(reader.statistics().bytes_read == file_size) or die_(what + ": byte count mismatch");
+	(reader.statistics().reads == reader.num_chunks()) or die_(what + ": read count mismatch");
+	(reader.num_reads_in_flight() == 0) or die_(what + ": reads remain in flight");
+}
+
+void check_all_buffers_held(const std::string& path, size_t buffer_size, io_backend_t backend)
+{
+	buffer_ring_t ring(2, buffer_size);
+	cuda::io::read_options_t options;
+	options.backend = backend;
+	chunked_file_reader_t reader(path, ring.buffers, buffer_size, options);
+	cuda::io::chunk_t chunk;
+	(reader.next(chunk) and reader.next(chunk)) or die_("Failed reading the first chunks");
+	try {
+		reader.next(chunk);
+		die_("Reading with every buffer held was not rejected");
+	}
+	catch(std::logic_error&) { }
+	// The reader may still be destroyed with its buffers unreleased
+}
+
+void check_positioned_io(const std::string& path, io_backend_t backend)
+{
+	enum : size_t { block_size = 4096, num_blocks = 4 };
+	buffer_ring_t ring(2, num_blocks * block_size);
+	auto written = static_cast<char*>(ring.buffers[0]);
+	auto read = static_cast<char*>(ring.buffers[1]);
+	for(size_t i = 0; i < num_blocks * block_size; i++) { written[i] = expected_byte(i + 1); }
+	bool opened_direct;
+	auto fd = io_detail::open_file(path, O_RDWR | O_CREAT | O_TRUNC, false, opened_direct);
+	auto io = io_detail::make_async_io(backend, num_blocks, {});
+	(io->backend() == backend) or die_("Unexpected positioned I/O backend");
+
+	// One write per block, completing in any order
+	for(size_t i = 0; i < num_blocks; i++) {
+		io->submit(io_detail::operation_t::write, fd.get(), written + i * block_size, block_size,
+			static_cast<off_t>(i * block_size), -1, i);
+	}
+	std::vector<bool> completed(num_blocks, false);
+	for(size_t i = 0; i < num_blocks; i++) {
+		auto completion = io->wait();
+		(completion.tag < num_blocks and not completed[completion.tag]) or die_("Unexpected write completion");
+		(completion.result == static_cast<ssize_t>(block_size)) or die_("A write was cut short");
+		completed[completion.tag] = true;
+	}
+
+	// A read extending past the end of the file is cut short
+	io->submit(io_detail::operation_t::read, fd.get(), read, 2 * block_size,
+		static_cast<off_t>((num_blocks - 1) * block_size), -1, 123);
+	auto completion = io->wait();
+	(completion.tag == 123) or die_("Unexpected read completion tag");
+	(completion.result == static_cast<ssize_t>(block_size)) or die_("A read past the end of the file was not cut short");
+	(std::memcmp(read, written + (num_blocks - 1) * block_size, block_size) == 0) or die_("Read data mismatch");
+
+	// Failures are reported as negated error numbers
+	io->submit(io_detail::operation_t::read, -1, read, block_size, 0, -1, 456);
+	completion = io->wait();
+	(completion.tag == 456 and completion.result == -EBADF) or die_("A failed read was not reported");
+}
+
+int main()
+{
+	// Not in /tmp, which is often a tmpfs - not supporting direct I/O
+	std::string path = "./chunked_file_reading." + std::to_string(getpid());
+	enum : size_t { buffer_size = 64 * 1024, num_buffers = 3 };
+
+	std::vector<io_backend_t> backends { io_backend_t::thread_pool };
+	if (io_uring_usable()) { backends.push_back(io_backend_t::io_uring); }
+
+	for(auto backend : backends) {
+		for(size_t file_size : { size_t{0}, size_t{1}, size_t{4096}, size_t{buffer_size}, 7 * size_t{buffer_size} + 123 }) {
+			write_file(path, file_size);
+			for(bool direct_io : { false, true }) {
+				for(unsigned queue_depth : { 0u, 1u }) {
+					check_reading(path, file_size, buffer_size, num_buffers, backend, direct_io, queue_depth);
+				}
+			}
+		}
+		check_all_buffers_held(path, buffer_size, backend);
+		std::cout << "Chunked reading with the " << cuda::io::name(backend) << " backend: OK\n";
+
+		check_positioned_io(path, backend);
+		std::cout << "Positioned reads and writes with the " << cuda::io::name(backend) << " backend: OK\n";
+	}
+
+	unlink(path.c_str());
+	std::cout << "\nSUCCESS\n";
+}
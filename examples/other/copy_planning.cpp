@@ -0,0 +1,256 @@
+/**
+ * Checks the planning of enqueued copies:
+ *
+ *   - the path planned for each combination of memory kinds and copy size,
+ *     including at the thresholds themselves;
+ *   - persisting thresholds, and rejecting incomplete or malformed ones;
+ *   - carrying out copies along each path - with bounce buffers smaller than
+ *     the copies, so that they are reused - and falling back to a direct copy
+ *     where a forced path is infeasible;
+ *   - having @ref cuda::stream_t::enqueue_t::copy() plan its copies once
+ *     planning is enabled.
+ *
+ * Thresholds are set explicitly, so no calibration takes place.
+ */
+#include <cuda/runtime_api.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace copy_planning = cuda::memory::copy_planning;
+using copy_planning::memory_kind_t;
+using copy_planning::path_t;
+using copy_planning::thresholds_t;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+std::string describe(memory_kind_t destination, memory_kind_t source, size_t num_bytes)
+{
+	return std::string("A copy of ") + std::to_string(num_bytes) + " bytes from " + copy_planning::name(source)
+		+ " to " + copy_planning::name(destination) + " memory";
+}
+
+void check_plan(memory_kind_t destination, memory_kind_t source, size_t num_bytes, const thresholds_t& thresholds, path_t expected)
+{
+	auto planned = copy_planning::plan(destination, source, num_bytes, thresholds);
+	(planned == expected) or die_(describe(destination, source, num_bytes) + " was planned as "
+		+ copy_planning::name(planned) + " rather than " + copy_planning::name(expected));
+}
+
+void check_planning()
+{
+	thresholds_t thresholds;
+	thresholds.host_store_max = 1024;
+	thresholds.pinned_bounce_min = 64 * 1024;
+	thresholds.pinned_bounce_max = 1024 * 1024;
+	thresholds.chunked_min = 16 * 1024 * 1024;
+	thresholds.num_chunk_streams = 2;
+
+	auto pageable = memory_kind_t::pageable, pinned = memory_kind_t::pinned;
+	auto device = memory_kind_t::device, managed = memory_kind_t::managed;
+
+	// Host stores, from any host memory into pinned memory, up to their maximum size
+	check_plan(pinned, pageable, 1024, thresholds, path_t::host_store);
+	check_plan(pinned, pinned, 1, thresholds, path_t::host_store);
+	check_plan(pinned, pageable, 1025, thresholds, path_t::direct);
+	check_plan(pageable, pageable, 16, thresholds, path_t::direct);
+	check_plan(pinned, device, 16, thresholds, path_t::direct);
+
+	// Bouncing, between pageable and device memory, within its size range
+	for(auto directions : { std::make_pair(device, pageable), std::make_pair(pageable, device) }) {
+		check_plan(directions.first, directions.second, 64 * 1024 - 1, thresholds, path_t::direct);
+		check_plan(directions.first, directions.second, 64 * 1024, thresholds, path_t::pinned_bounce);
+		check_plan(directions.first, directions.second, 1024 * 1024, thresholds, path_t::pinned_bounce);
+		check_plan(directions.first, directions.second, 1024 * 1024 + 1, thresholds, path_t::direct);
+		// ... and never chunking copies involving pageable memory
+		check_plan(directions.first, directions.second, 64 * 1024 * 1024, thresholds, path_t::direct);
+	}
+	check_plan(managed, pageable, 256 * 1024, thresholds, path_t::direct);
+
+	// Chunking, of large copies between pinned and device memory, or within device memory
+	check_plan(device, pinned, 16 * 1024 * 1024 - 1, thresholds, path_t::direct);
+	check_plan(device, pinned, 16 * 1024 * 1024, thresholds, path_t::chunked);
+	check_plan(pinned, device, 64 * 1024 * 1024, thresholds, path_t::chunked);
+	check_plan(device, device, 64 * 1024 * 1024, thresholds, path_t::chunked);
+	check_plan(pinned, pinned, 64 * 1024 * 1024, thresholds, path_t::direct);
+	check_plan(device, managed, 64 * 1024 * 1024, thresholds, path_t::direct);
+	thresholds.num_chunk_streams = 1;
+	check_plan(device, pinned, 64 * 1024 * 1024, thresholds, path_t::direct);
+
+	// With the defaults, nothing is stored by the host, nor chunked
+	check_plan(pinned, pageable, 1, thresholds_t{}, path_t::direct);
+	check_plan(device, pinned, copy_planning::never - 1, thresholds_t{}, path_t::direct);
+	std::cout << "Planning: OK\n";
+}
+
+void write_file(const std::string& path, const std::string& contents)
+{
+	std::ofstream file(path, std::ios::trunc);
+	file << contents;
+	file or die_("Failed writing " + path);
+}
+
+void check_persistence(const std::string& path)
+{
+	thresholds_t stored;
+	stored.host_store_max = 4096;
+	stored.pinned_bounce_min = 1;
+	stored.pinned_bounce_max = copy_planning::never;
+	stored.chunked_min = 123456789;
+	stored.bounce_buffer_size = 3000;
+	stored.num_bounce_buffers = 5;
+	stored.num_chunk_streams = 4;
+	copy_planning::store(path, stored) or die_("Failed storing thresholds");
+	thresholds_t loaded;
+	(copy_planning::load(path, loaded) and loaded == stored) or die_("Stored thresholds were not loaded back as they were");
+
+	// Failing loads leave the thresholds unchanged
+	auto check_rejected = [&](const std::string& contents, const std::string& what) {
+		write_file(path, contents);
+		thresholds_t unchanged = stored;
+		(not copy_planning::load(path, unchanged) and unchanged == stored) or die_(what + " was not rejected");
+	};
+	auto valid = copy_planning::to_string(stored);
+	check_rejected(valid.substr(0, valid.find("chunked_min")), "An incomplete thresholds file");
+	check_rejected(valid + "pinned_bounce_min=lots\n", "A malformed threshold");
+	check_rejected(valid + "bounce_buffer_size=0\n", "A zero bounce buffer size");
+	check_rejected(valid + "num_bounce_buffers=0\n", "A zero number of bounce buffers");
+	// Unrecognized lines are ignored, while later values replace earlier ones
+	write_file(path, "# a comment\nsome_future_threshold=1\n" + valid + "host_store_max=8\n");
+	(copy_planning::load(path, loaded) and loaded.host_store_max == 8) or die_("A thresholds file with extra lines was rejected");
+	std::remove(path.c_str());
+	(not copy_planning::load(path, loaded)) or die_("Loading from a missing file did not fail");
+	(not copy_planning::store(path + ".missing/thresholds", stored)) or die_("Storing into a missing directory did not fail");
+	std::cout << "Persisting thresholds: OK\n";
+}
+
+std::vector<char> device_contents(const void* device_data, size_t num_bytes)
+{
+	std::vector<char> contents(num_bytes);
+	cuda::memory::copy(contents.data(), device_data, num_bytes);
+	return contents;
+}
+
+void check_copies(cuda::device_t& device)
+{
+	enum : size_t { size = 1000 * 1000 + 7, small_size = 100 };
+	auto stream = device.create_stream(cuda::stream::async);
+	std::vector<char> pageable(size), pageable_copy(size);
+	for(size_t i = 0; i < size; i++) { pageable[i] = static_cast<char>(i * 13 + i / 251); }
+	auto pinned = cuda::memory::host::make_unique<char[]>(size);
+	auto device_buffer = cuda::memory::device::make_unique<char[]>(device, size);
+	(copy_planning::kind_of(pageable.data()) == memory_kind_t::pageable and copy_planning::kind_of(pinned.get()) == memory_kind_t::pinned
+		and copy_planning::kind_of(device_buffer.get()) == memory_kind_t::device) or die_("Memory kinds misidentified");
+
+	// Bounce buffers much smaller than the copies - of a size not dividing them - and fewer than their chunks
+	copy_planning::planner_t planner;
+	thresholds_t thresholds;
+	thresholds.host_store_max = small_size;
+	thresholds.pinned_bounce_min = small_size;
+	thresholds.pinned_bounce_max = copy_planning::never;
+	thresholds.chunked_min = size;
+	thresholds.bounce_buffer_size = 64 * 1024 + 3;
+	thresholds.num_bounce_buffers = 2;
+	thresholds.num_chunk_streams = 3;
+	planner.set_thresholds(device.id(), thresholds);
+	(planner.thresholds(device.id()) == thresholds) or die_("The planner's thresholds were not set");
+
+	(planner.copy(device_buffer.get(), pageable.data(), size, stream) == path_t::pinned_bounce) or die_("Uploading was not bounced");
+	(device_contents(device_buffer.get(), size) == pageable) or die_("Bouncing to the device: the copy is wrong");
+	(planner.copy(pageable_copy.data(), device_buffer.get(), size, stream) == path_t::pinned_bounce and pageable_copy == pageable)
+		or die_("Bouncing from the device: the copy is wrong");
+	(planner.statistics().bytes_via(path_t::pinned_bounce) == 2 * size) or die_("Bounced copies were not counted");
+
+	// Small copies into pinned memory are stored by the host, in stream order
+	(planner.copy(pinned.get(), pageable.data(), small_size, stream) == path_t::host_store) or die_("A small copy was not stored by the host");
+	stream.synchronize();
+	(std::memcmp(pinned.get(), pageable.data(), small_size) == 0) or die_("Storing by the host: the copy is wrong");
+
+	// Large copies between pinned and device memory are chunked - unevenly, as their size is not a multiple of 3
+	std::memcpy(pinned.get(), pageable.data(), size);
+	cuda::memory::device::zero(device_buffer.get(), size);
+	(planner.copy(device_buffer.get(), pinned.get(), size, stream) == path_t::chunked) or die_("A large copy was not chunked");
+	stream.synchronize();
+	(device_contents(device_buffer.get(), size) == pageable) or die_("Chunking: the copy is wrong");
+
+	// Forced paths are taken where feasible
+	planner.force_path(path_t::chunked);
+	path_t forced;
+	(planner.forced_path(forced) and forced == path_t::chunked) or die_("The forced path was not reported");
+	(planner.copy(device_buffer.get(), pinned.get(), small_size, stream) == path_t::chunked) or die_("A forced path was not taken");
+	(planner.copy(pageable_copy.data(), device_buffer.get(), small_size, stream) == path_t::direct)
+		or die_("An infeasible forced path was taken");
+	planner.clear_forced_path();
+	(not planner.forced_path(forced)) or die_("The forced path was not cleared");
+
+	// Changing the thresholds replaces the bounce buffers
+	thresholds.bounce_buffer_size = 1000;
+	planner.set_thresholds(device.id(), thresholds);
+	std::fill(pageable_copy.begin(), pageable_copy.end(), 0);
+	(planner.copy(pageable_copy.data(), device_buffer.get(), size, stream) == path_t::pinned_bounce and pageable_copy == pageable)
+		or die_("Bouncing with resized buffers: the copy is wrong");
+	planner.release_resources();
+	std::cout << "Copying along each path: OK\n";
+}
+
+void check_enabling(cuda::device_t& device)
+{
+	copy_planning::options_t options;
+	options.directory.clear();
+	options.calibrate_if_missing = false;
+	(not copy_planning::is_enabled()) or die_("Copy planning is enabled by default");
+	copy_planning::enable(options);
+	copy_planning::is_enabled() or die_("Copy planning was not enabled");
+	(copy_planning::planner().thresholds(device.id()) == thresholds_t{}) or die_("Uncalibrated devices do not use the default thresholds");
+
+	thresholds_t thresholds;
+	thresholds.pinned_bounce_min = 1;
+	copy_planning::set_thresholds(device, thresholds);
+	auto stream = device.create_stream(cuda::stream::async);
+	std::vector<char> source(4096, 'x'), destination(4096);
+	auto device_buffer = cuda::memory::device::make_unique<char[]>(device, source.size());
+	auto statistics = copy_planning::planner().statistics();
+	stream.enqueue.copy(device_buffer.get(), source.data(), source.size());
+	stream.enqueue.copy(destination.data(), device_buffer.get(), source.size());
+	stream.synchronize();
+	(destination == source) or die_("Planned enqueued copies are wrong");
+	(copy_planning::planner().statistics().copies_via(path_t::pinned_bounce) == statistics.copies_via(path_t::pinned_bounce) + 2)
+		or die_("Enqueued copies were not planned");
+
+	copy_planning::disable();
+	(not copy_planning::is_enabled()) or die_("Copy planning was not disabled");
+	statistics = copy_planning::planner().statistics();
+	stream.enqueue.copy(device_buffer.get(), source.data(), source.size());
+	stream.synchronize();
+	(copy_planning::planner().statistics().copies_via(path_t::pinned_bounce) == statistics.copies_via(path_t::pinned_bounce))
+		or die_("Enqueued copies were planned after disabling planning");
+	copy_planning::planner().release_resources();
+	std::cout << "Enabling and disabling planning: OK\n";
+}
+
+int main()
+{
+	check_planning();
+	check_persistence("./copy_planning." + std::to_string(getpid()) + ".thresholds");
+
+	auto device = cuda::device::current::get();
+	auto file_name = copy_planning::thresholds_file_name(device);
+	(file_name.find('/') == std::string::npos and file_name.find(' ') == std::string::npos)
+		or die_("The thresholds file name " + file_name + " is not sanitized");
+	check_copies(device);
+	check_enabling(device);
+
+	std::cout << "\nSUCCESS\n";
+}
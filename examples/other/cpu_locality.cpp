@@ -0,0 +1,99 @@
+/**
+ * A check of the determination of host CPU locality - the parsing of the
+ * kernel's CPU lists, and the reading of NUMA nodes' and PCI devices' CPU
+ * lists from sysfs - against the fixture directories in sysfs_fixtures/,
+ * which mimic a two-socket machine with a device attached to each socket.
+ *
+ * No CUDA device is used (or required) by this program.
+ *
+ * Usage: cpu_locality [fixtures directory]
+ */
+#include <cuda/runtime_api.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef SYSFS_FIXTURES_DIRECTORY
+#define SYSFS_FIXTURES_DIRECTORY "sysfs_fixtures"
+#endif
+
+namespace numa = cuda::detail_::numa;
+using numa::cpu_list_t;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+std::string to_string(const cpu_list_t& cpus)
+{
+	std::string result;
+	for(auto cpu : cpus) { result += (result.empty() ? "" : " ") + std::to_string(cpu); }
+	return "{" + result + "}";
+}
+
+void check_parsing(const std::string& list, const cpu_list_t& expected)
+{
+	auto parsed = numa::parse_cpu_list(list);
+	(parsed == expected) or die_("Parsing \"" + list + "\" yielded " + to_string(parsed)
+		+ " rather than " + to_string(expected));
+}
+
+void check_parsing_fails(const std::string& list)
+{
+	try {
+		numa::parse_cpu_list(list);
+	}
+	catch(std::invalid_argument&) {
+		return;
+	}
+	die_("Parsing the invalid CPU list \"" + list + "\" succeeded");
+}
+
+int main(int argc, char** argv)
+{
+	std::string fixtures = (argc > 1) ? argv[1] : SYSFS_FIXTURES_DIRECTORY;
+
+	check_parsing("", {});
+	check_parsing("\n", {});
+	check_parsing("5", { 5 });
+	check_parsing("0-3,8,10-11\n", { 0, 1, 2, 3, 8, 10, 11 });
+	check_parsing(" 4 , 1-2 ", { 1, 2, 4 });
+	check_parsing("3,1-3,2", { 1, 2, 3 });
+	check_parsing_fails("1-");
+	check_parsing_fails("-1");
+	check_parsing_fails("3-1");
+	check_parsing_fails("1x");
+	check_parsing_fails("a");
+	check_parsing_fails("1-2-3");
+	std::cout << "CPU list parsing: OK\n";
+
+	// Nodes with no CPUs, or with unparseable CPU lists, are skipped; as are
+	// entries which aren't nodeN directories
+	auto nodes = numa::nodes(fixtures + "/node");
+	(nodes.size() == 2) or die_("Expected 2 NUMA nodes, found " + std::to_string(nodes.size()));
+	(nodes[0].id == 0 and nodes[0].cpus == cpu_list_t{ 0, 1, 2, 3, 8, 9, 10, 11 })
+		or die_("Unexpected CPUs for node 0: " + to_string(nodes[0].cpus));
+	(nodes[1].id == 1 and nodes[1].cpus == cpu_list_t{ 4, 5, 6, 7, 12, 13, 14, 15 })
+		or die_("Unexpected CPUs for node 1: " + to_string(nodes[1].cpus));
+	numa::nodes(fixtures + "/nonexistent").empty() or die_("Nodes found in a nonexistent directory");
+	std::cout << "NUMA nodes: OK\n";
+
+	using cuda::device::pci_location_t;
+	auto first = pci_location_t::parse("0000:3b:00.0");
+	auto second = pci_location_t::parse("0000:af:00.0");
+	(cuda::affinity::sysfs_name(first) == "0000:3b:00.0") or die_("Unexpected sysfs name for a PCI location");
+	(cuda::affinity::local_cpus(first, fixtures + "/pci") == nodes[0].cpus)
+		or die_("Unexpected local CPUs for the first device");
+	(cuda::affinity::local_cpus(second, fixtures + "/pci") == nodes[1].cpus)
+		or die_("Unexpected local CPUs for the second device");
+	cuda::affinity::local_cpus(pci_location_t::parse("0000:01:00.0"), fixtures + "/pci").empty()
+		or die_("Local CPUs found for a device absent from sysfs");
+	std::cout << "Devices' local CPUs: OK\n";
+
+	std::cout << "\nSUCCESS\n";
+}
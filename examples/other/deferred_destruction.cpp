@@ -0,0 +1,136 @@
+/**
+ * Defers the destruction of streams, events, arrays and device memory, and
+ * checks - through the deferral statistics - that:
+ *
+ *   - destroying the wrappers only queues their handles, with the resources
+ *     destroyed in a batch on flush();
+ *   - flushing puts off the destruction of streams with work in progress, and
+ *     of events yet to occur, until a later flush after their work concludes;
+ *   - disabling deferral destroys whatever is still deferred, and later
+ *     destructions are no longer deferred;
+ *   - the reaper thread carries out deferred destructions without any flush.
+ *
+ * Stream work is held in progress by a host function which waits to be released;
+ * so no kernels are compiled or launched.
+ */
+#include <cuda/runtime_api.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace deferred_destruction = cuda::deferred_destruction;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+void check_statistics(
+	const deferred_destruction::statistics_t& before,
+	size_t deferred, size_t destroyed, size_t postponed, size_t batches,
+	const std::string& what)
+{
+	auto after = deferred_destruction::statistics();
+	(after.deferred - before.deferred == deferred) or die_(what + ": unexpected number of deferred destructions");
+	(after.destroyed - before.destroyed == destroyed) or die_(what + ": unexpected number of destructions");
+	(after.postponed - before.postponed == postponed) or die_(what + ": unexpected number of postponed destructions");
+	(after.batches - before.batches == batches) or die_(what + ": unexpected number of batches");
+}
+
+// Work on the stream remains in progress until the returned promise is fulfilled
+std::promise<void> hold(cuda::stream_t& stream)
+{
+	std::promise<void> release;
+	auto released = release.get_future().share();
+	stream.enqueue.host_function_call([released](const cuda::stream_t&) { released.wait(); });
+	return release;
+}
+
+int main()
+{
+	auto device = cuda::device::current::get();
+	deferred_destruction::options_t options;
+	options.use_reaper_thread = false;
+	deferred_destruction::enable(options);
+	deferred_destruction::is_enabled() or die_("Deferral was not enabled");
+
+	// Idle resources are destroyed in a single batch, on flush
+	auto statistics = deferred_destruction::statistics();
+	{
+		auto stream = device.create_stream(cuda::stream::async);
+		auto event = device.create_event();
+		stream.enqueue.event(event);
+		stream.synchronize();
+		auto allocation = cuda::memory::device::make_unique<int[]>(device, 1000);
+		cuda::array_t<float, 2> array(device, { 16, 16 });
+	}
+	check_statistics(statistics, 0, 0, 0, 0, "Destroying the wrappers");
+	deferred_destruction::flush();
+	check_statistics(statistics, 4, 4, 0, 1, "Flushing idle resources");
+	statistics = deferred_destruction::statistics();
+	deferred_destruction::flush();
+	check_statistics(statistics, 0, 0, 0, 0, "Flushing with nothing deferred");
+	std::cout << "Flushing idle resources: OK\n";
+
+	// Busy resources are postponed - again and again - until their work concludes
+	std::promise<void> release;
+	statistics = deferred_destruction::statistics();
+	{
+		auto stream = device.create_stream(cuda::stream::async);
+		auto event = device.create_event();
+		release = hold(stream);
+		stream.enqueue.event(event);
+	}
+	deferred_destruction::flush();
+	check_statistics(statistics, 2, 0, 2, 1, "Flushing busy resources");
+	deferred_destruction::flush();
+	check_statistics(statistics, 2, 0, 4, 2, "Flushing busy resources again");
+	release.set_value();
+	device.synchronize();
+	deferred_destruction::flush();
+	check_statistics(statistics, 2, 2, 4, 3, "Flushing once the work has concluded");
+	std::cout << "Postponing busy resources: OK\n";
+
+	// Disabling deferral destroys even busy resources, and ends deferral
+	statistics = deferred_destruction::statistics();
+	{
+		auto stream = device.create_stream(cuda::stream::async);
+		release = hold(stream);
+	}
+	deferred_destruction::disable();
+	(not deferred_destruction::is_enabled()) or die_("Deferral was not disabled");
+	check_statistics(statistics, 1, 1, 0, 1, "Disabling deferral");
+	release.set_value();
+	device.synchronize();
+	statistics = deferred_destruction::statistics();
+	{
+		auto stream = device.create_stream(cuda::stream::async);
+	}
+	deferred_destruction::flush();
+	check_statistics(statistics, 0, 0, 0, 0, "Destroying with deferral disabled");
+	std::cout << "Disabling deferral: OK\n";
+
+	// The reaper thread destroys resources on its own
+	options.use_reaper_thread = true;
+	options.reaping_interval = std::chrono::microseconds(1000);
+	deferred_destruction::enable(options);
+	statistics = deferred_destruction::statistics();
+	{
+		auto event = device.create_event();
+	}
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (deferred_destruction::statistics().destroyed == statistics.destroyed) {
+		(std::chrono::steady_clock::now() < deadline) or die_("The reaper thread did not destroy a deferred event");
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	check_statistics(statistics, 1, 1, 0, 1, "Reaping");
+	deferred_destruction::disable();
+	std::cout << "Reaping in the background: OK\n";
+
+	std::cout << "\nSUCCESS\n";
+}
@@ -0,0 +1,45 @@
+/**
+ * The part of the device_fill example compiled by the host compiler, rather
+ * than by nvcc - filling device memory using the same functions as the part
+ * compiled by nvcc, which must therefore behave the same in both.
+ */
+#include <cuda/runtime_api.hpp>
+
+#include <cstdint>
+
+namespace filling = cuda::memory::device::filling;
+
+template <typename T>
+void host_compiled_fill(T* start, const T& value, size_t num_elements, const cuda::stream_t& stream)
+{
+	cuda::memory::device::async::fill(start, value, num_elements, stream);
+}
+
+template <typename T>
+void host_compiled_fill_2d(
+	T*                     start,
+	size_t                 pitch_in_bytes,
+	size_t                 width_in_elements,
+	size_t                 height,
+	const T&               value,
+	const cuda::stream_t&  stream)
+{
+	cuda::memory::device::async::fill_2d(start, pitch_in_bytes, width_in_elements, height, value, stream);
+}
+
+template <typename T>
+filling::mechanism_t host_compiled_mechanism_for(const T& value)
+{
+	return filling::mechanism_for(value);
+}
+
+#define INSTANTIATE_FOR(T) \
+	template void host_compiled_fill<T>(T*, const T&, size_t, const cuda::stream_t&); \
+	template void host_compiled_fill_2d<T>(T*, size_t, size_t, size_t, const T&, const cuda::stream_t&); \
+	template filling::mechanism_t host_compiled_mechanism_for<T>(const T&);
+
+INSTANTIATE_FOR(char)
+INSTANTIATE_FOR(int16_t)
+INSTANTIATE_FOR(int32_t)
+INSTANTIATE_FOR(float)
+INSTANTIATE_FOR(uint64_t)
@@ -0,0 +1,127 @@
+/**
+ * A check of filling device memory with wide values: Each fill is compared against
+ * the host-side reference implementation, in contiguous regions and in pitched 2D
+ * regions - where the padding between rows must be left untouched. The fills are
+ * made both by code compiled with nvcc (including the kernel-based fills) and by
+ * code compiled with the host compiler, in host_compiled.cpp .
+ */
+#include <cuda/runtime_api.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace filling = cuda::memory::device::filling;
+namespace async = cuda::memory::device::async;
+
+// Defined in host_compiled.cpp
+
+template <typename T>
+void host_compiled_fill(T* start, const T& value, size_t num_elements, const cuda::stream_t& stream);
+
+template <typename T>
+void host_compiled_fill_2d(
+	T*                     start,
+	size_t                 pitch_in_bytes,
+	size_t                 width_in_elements,
+	size_t                 height,
+	const T&               value,
+	const cuda::stream_t&  stream);
+
+template <typename T>
+filling::mechanism_t host_compiled_mechanism_for(const T& value);
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+/** Bytes not to be filled are set to this value beforehand, and must keep it */
+enum : unsigned char { sentinel = 0xAB };
+
+template <typename T>
+using fill_function_t = void (*)(T*, const T&, size_t, const cuda::stream_t&);
+
+template <typename T>
+using fill_2d_function_t = void (*)(T*, size_t, size_t, size_t, const T&, const cuda::stream_t&);
+
+template <typename T>
+void check_fill(cuda::stream_t& stream, fill_function_t<T> fill, const std::string& fill_name, T value)
+{
+	enum : size_t { trailing_elements = 16 };
+	for(size_t num_elements : { 0, 1, 1000, 100003 }) {
+		auto region_size = (num_elements + trailing_elements) * sizeof(T);
+		auto device_region = cuda::memory::device::make_unique<unsigned char[]>(stream.device(), region_size);
+		std::vector<unsigned char> filled(region_size), expected(region_size, sentinel);
+		stream.enqueue.memset(device_region.get(), sentinel, region_size);
+		fill(reinterpret_cast<T*>(device_region.get()), value, num_elements, stream);
+		stream.enqueue.copy(filled.data(), device_region.get(), region_size);
+		stream.synchronize();
+		filling::reference_fill(reinterpret_cast<T*>(expected.data()), value, num_elements);
+		(filled == expected) or die_(fill_name + " of " + std::to_string(num_elements) + " elements of size "
+			+ std::to_string(sizeof(T)) + " differs from the reference fill");
+	}
+}
+
+template <typename T>
+void check_fill_2d(cuda::stream_t& stream, fill_2d_function_t<T> fill_2d, const std::string& fill_name, T value)
+{
+	struct { size_t width_in_elements, height; } shapes[] = { { 0, 5 }, { 7, 0 }, { 1, 1 }, { 33, 17 }, { 300, 250 } };
+	for(auto shape : shapes) {
+		// A pitch which is a multiple of any fill value's size
+		auto pitch = shape.width_in_elements * sizeof(T) + 24;
+		auto region_size = pitch * shape.height;
+		auto device_region = cuda::memory::device::make_unique<unsigned char[]>(stream.device(), region_size);
+		std::vector<unsigned char> filled(region_size), expected(region_size, sentinel);
+		stream.enqueue.memset(device_region.get(), sentinel, region_size);
+		fill_2d(reinterpret_cast<T*>(device_region.get()), pitch, shape.width_in_elements, shape.height, value, stream);
+		stream.enqueue.copy(filled.data(), device_region.get(), region_size);
+		stream.synchronize();
+		filling::reference_fill_2d(reinterpret_cast<T*>(expected.data()), pitch, shape.width_in_elements,
+			shape.height, value);
+		(filled == expected) or die_(fill_name + " of " + std::to_string(shape.width_in_elements) + " x "
+			+ std::to_string(shape.height) + " elements of size " + std::to_string(sizeof(T))
+			+ " differs from the reference fill");
+	}
+}
+
+template <typename T>
+void check_fills(cuda::stream_t& stream, T value)
+{
+	(filling::mechanism_for(value) == host_compiled_mechanism_for(value))
+		or die_("The fill mechanism differs between code compiled with nvcc and with the host compiler");
+
+	check_fill<T>(stream, async::fill<T>, "fill", value);
+	check_fill<T>(stream, host_compiled_fill<T>, "A host-compiled fill", value);
+	check_fill<T>(stream, async::fill_by_kernel<T>, "fill_by_kernel", value);
+
+	check_fill_2d<T>(stream, async::fill_2d<T>, "fill_2d", value);
+	check_fill_2d<T>(stream, host_compiled_fill_2d<T>, "A host-compiled fill_2d", value);
+	check_fill_2d<T>(stream, async::fill_2d_by_kernel<T>, "fill_2d_by_kernel", value);
+
+	std::cout << "Fills with a value of size " << sizeof(T) << " (" << filling::name(filling::mechanism_for(value))
+		<< "): OK\n";
+}
+
+int main(int argc, char** argv)
+{
+	if (cuda::device::count() == 0) {
+		std::cerr << "No CUDA devices on this system\n";
+		exit(EXIT_FAILURE);
+	}
+	auto device_id = (argc > 1) ? std::stoi(argv[1]) : cuda::device::default_device_id;
+	auto device = cuda::device::get(device_id);
+	auto stream = device.create_stream(cuda::stream::async);
+
+	check_fills<char>(stream, 7);
+	check_fills<int16_t>(stream, 0x1234);
+	check_fills<int32_t>(stream, -1);
+	check_fills<float>(stream, 1.5f);
+	check_fills<uint64_t>(stream, 0x0123456789ABCDEFull);
+
+	std::cout << "\nSUCCESS\n";
+}
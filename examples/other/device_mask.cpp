@@ -0,0 +1,114 @@
+/**
+ * Masks the system's devices by their PCI locations, and checks that:
+ *
+ *   - the mask determines which devices @ref cuda::devices() consists of, and
+ *     in what order, while device ids remain unchanged;
+ *   - locations are matched regardless of whether they specify a PCI domain;
+ *   - invalid masks are rejected, leaving the current one in effect;
+ *   - queries on a masked view only snapshot the visible devices - creating no
+ *     contexts on hidden ones.
+ */
+#include <cuda/runtime_api.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using cuda::device::pci_location_t;
+namespace mask = cuda::device::mask;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+template <typename Exception, typename F>
+void check_throws(F&& f, const std::string& what)
+{
+	try { f(); }
+	catch(Exception&) { return; }
+	die_(what + " was not rejected");
+}
+
+std::vector<cuda::device::id_t> ids_in_view()
+{
+	std::vector<cuda::device::id_t> ids;
+	for(auto device : cuda::devices()) { ids.push_back(device.id()); }
+	return ids;
+}
+
+void check_view(const std::vector<cuda::device::id_t>& expected, const std::string& what)
+{
+	(ids_in_view() == expected and *mask::visible_ids() == expected) or die_(what + ": unexpected devices in view");
+	(cuda::devices().size() == expected.size()) or die_(what + ": unexpected number of devices in view");
+	for(int id = 0; id < cuda::device::count(); id++) {
+		auto logical_index = mask::logical_index(id);
+		bool listed = logical_index >= 0 and expected[static_cast<size_t>(logical_index)] == id;
+		(listed == mask::is_visible(id)) or die_(what + ": wrong logical index for device " + std::to_string(id));
+	}
+}
+
+int main()
+{
+	// Nothing is queried before masking, so that hidden devices are never snapshotted
+	auto num_devices = cuda::device::count();
+	std::vector<cuda::device::id_t> all_ids;
+	std::vector<pci_location_t> locations;
+	for(cuda::device::id_t id = 0; id < num_devices; id++) {
+		all_ids.push_back(id);
+		locations.push_back(cuda::device::get(id).pci_id());
+		(cuda::device::get(locations.back()).id() == id) or die_("A device's PCI location resolved to another device");
+	}
+	(not mask::is_set()) or die_("A device mask is set initially");
+	check_view(all_ids, "Without a mask");
+
+	// The last device is hidden (if there's more than one), and the rest reversed
+	std::vector<cuda::device::id_t> masked_ids(all_ids.rbegin(), all_ids.rend());
+	std::vector<pci_location_t> masked_locations(locations.rbegin(), locations.rend());
+	if (num_devices > 1) {
+		masked_ids.erase(masked_ids.begin());
+		masked_locations.erase(masked_locations.begin());
+	}
+	// ... with the domain left unspecified for one of the devices
+	masked_locations.back().domain = pci_location_t::unused;
+	mask::set(masked_locations);
+	mask::is_set() or die_("A device mask is not reported as set");
+	check_view(masked_ids, "With a mask");
+	(cuda::device::get(masked_ids.front()).id() == masked_ids.front()) or die_("Masking changed device ids");
+	std::cout << "Masking devices: OK\n";
+
+	// Queries consider, and snapshot, only the devices in view
+	auto selection = cuda::devices().where([](const cuda::device::snapshot_t&) { return true; });
+	(selection.ids() == masked_ids) or die_("A query on a masked view considered hidden devices");
+	for(auto id : all_ids) {
+		bool visible = mask::is_visible(id);
+		((*selection.snapshots())[id].is_taken() == visible)
+			or die_("Device " + std::to_string(id) + (visible ? " was not snapshotted" : " was snapshotted while hidden"));
+	}
+	std::cout << "Querying a masked view: OK\n";
+
+	// Invalid masks leave the current one in effect
+	auto duplicated = masked_locations;
+	duplicated.push_back(masked_locations.front());
+	check_throws<std::invalid_argument>([&] { mask::set(duplicated); }, "A mask listing a device twice");
+	auto nonexistent = masked_locations;
+	nonexistent.push_back({ pci_location_t::unused, 0xFF, 0x1F, 0 });
+	check_throws<cuda::runtime_error>([&] { mask::set(nonexistent); }, "A mask listing a nonexistent device");
+	check_view(masked_ids, "After rejected masks");
+	std::cout << "Rejecting invalid masks: OK\n";
+
+	// An empty mask hides all devices; clearing it restores the full view
+	mask::set({});
+	check_view({}, "With all devices masked");
+	cuda::devices().where([](const cuda::device::snapshot_t&) { return true; }).empty()
+		or die_("A query on an empty view selected devices");
+	mask::clear();
+	(not mask::is_set()) or die_("A cleared device mask is reported as set");
+	check_view(all_ids, "After clearing the mask");
+	std::cout << "Clearing the mask: OK\n";
+
+	std::cout << "\nSUCCESS\n";
+}
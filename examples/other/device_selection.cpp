@@ -0,0 +1,113 @@
+/**
+ * Selects devices by their cached snapshots, and checks that:
+ *
+ *   - filtering, by predicate or by capabilities, keeps exactly the devices
+ *     satisfying the criteria - in their original order;
+ *   - sorting is stable, and may be combined with filtering;
+ *   - selections keep using the snapshots they were made from, while
+ *     refreshing the snapshots affects only later selections.
+ */
+#include <cuda/runtime_api.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using cuda::device::snapshot_t;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+template <typename Selection>
+std::vector<cuda::device::id_t> ids_of(const Selection& selection)
+{
+	std::vector<cuda::device::id_t> ids;
+	for(const auto& snapshot : selection) { ids.push_back(snapshot.id); }
+	return ids;
+}
+
+int main()
+{
+	auto devices = cuda::devices();
+	std::vector<cuda::device::id_t> all_ids;
+	for(auto device : devices) { all_ids.push_back(device.id()); }
+	(devices.size() == static_cast<decltype(devices.size())>(cuda::device::count())) or die_("Unexpected number of devices");
+
+	auto all = devices.selection();
+	(ids_of(all) == all_ids and all.ids() == all_ids) or die_("The selection of all devices is incomplete");
+	for(const auto& snapshot : all) {
+		auto what = "The snapshot of device " + std::to_string(snapshot.id);
+		snapshot.is_taken() or die_(what + " was not taken");
+		(snapshot.free_memory <= snapshot.total_memory()) or die_(what + " has more free memory than total memory");
+		(snapshot.compute_capability() == snapshot.device().compute_capability()) or die_(what + " has the wrong compute capability");
+	}
+	std::cout << "Snapshots: OK\n";
+
+	// Filtering keeps the original order
+	auto odd = devices.where([](const snapshot_t& snapshot) { return snapshot.id % 2 == 1; });
+	std::vector<cuda::device::id_t> odd_ids;
+	std::copy_if(all_ids.begin(), all_ids.end(), std::back_inserter(odd_ids), [](cuda::device::id_t id) { return id % 2 == 1; });
+	(odd.ids() == odd_ids) or die_("Filtering by a predicate selected the wrong devices");
+	(devices.where([](const snapshot_t&) { return true; }).ids() == all_ids) or die_("Filtering out nothing changed the selection");
+
+	const auto& weakest = *std::min_element(all.begin(), all.end(), [](const snapshot_t& lhs, const snapshot_t& rhs) {
+		return lhs.compute_capability() < rhs.compute_capability();
+	});
+	auto capable = devices.where(weakest.compute_capability(), weakest.free_memory);
+	for(const auto& snapshot : all) {
+		bool qualifies = not (snapshot.compute_capability() < weakest.compute_capability())
+			and snapshot.free_memory >= weakest.free_memory;
+		bool selected = std::find(capable.ids().begin(), capable.ids().end(), snapshot.id) != capable.ids().end();
+		(qualifies == selected) or die_("Filtering by capabilities misjudged device " + std::to_string(snapshot.id));
+	}
+	(std::find(capable.ids().begin(), capable.ids().end(), weakest.id) != capable.ids().end())
+		or die_("Filtering by capabilities excluded a device meeting them exactly");
+	auto none = devices.where(cuda::device::compute_capability_t::from_combined_number(9999));
+	none.empty() or die_("A device with an impossible compute capability was selected");
+	try {
+		none.front();
+		die_("Obtaining the front of an empty selection was not rejected");
+	}
+	catch(std::out_of_range&) { }
+	std::cout << "Filtering: OK\n";
+
+	// Sorting is stable...
+	auto unchanged = devices.sorted_by([](const snapshot_t&, const snapshot_t&) { return false; });
+	(unchanged.ids() == all_ids) or die_("Sorting by an all-equal key reordered devices");
+	auto reversed = devices.sorted_by([](const snapshot_t& lhs, const snapshot_t& rhs) { return lhs.id > rhs.id; });
+	(reversed.ids() == std::vector<cuda::device::id_t>(all_ids.rbegin(), all_ids.rend())) or die_("Sorting by descending id failed");
+	auto by_free_memory = all.sorted_by([](const snapshot_t& lhs, const snapshot_t& rhs) { return lhs.free_memory > rhs.free_memory; });
+	for(size_t i = 1; i < by_free_memory.size(); i++) {
+		const auto& previous = by_free_memory[i - 1];
+		const auto& current = by_free_memory[i];
+		(previous.free_memory > current.free_memory or (previous.free_memory == current.free_memory and previous.id < current.id))
+			or die_("Sorting by free memory is not stable, or not sorted");
+	}
+	// ... and may follow filtering
+	auto odd_reversed = odd.sorted_by([](const snapshot_t& lhs, const snapshot_t& rhs) { return lhs.id > rhs.id; });
+	(odd_reversed.ids() == std::vector<cuda::device::id_t>(odd_ids.rbegin(), odd_ids.rend())) or die_("Sorting a filtered selection failed");
+	(by_free_memory.devices().size() == all_ids.size() and by_free_memory.devices().front().id() == by_free_memory.front().id)
+		or die_("The devices of a sorted selection are not in its order");
+	std::cout << "Sorting: OK\n";
+
+	// Selections are made from the cached snapshots; refreshing replaces them for later selections only
+	(devices.selection().snapshots() == all.snapshots() and odd.snapshots() == all.snapshots())
+		or die_("Selections did not use the cached snapshots");
+	auto originally_taken_at = all.front().taken_at;
+	auto refreshed = cuda::device::refresh_snapshots();
+	(refreshed != all.snapshots() and devices.selection().snapshots() == refreshed) or die_("Refreshing did not replace the snapshots");
+	for(auto id : all_ids) {
+		not ((*refreshed)[id].taken_at < (*all.snapshots())[id].taken_at) or die_("A refreshed snapshot is older than the original");
+	}
+	(all.front().taken_at == originally_taken_at and ids_of(all) == all_ids) or die_("An earlier selection was affected by refreshing");
+	std::cout << "Refreshing snapshots: OK\n";
+
+	std::cout << "\nSUCCESS\n";
+}
@@ -0,0 +1,140 @@
+/**
+ * A host-only check of dirty page tracking: which pages of a region are
+ * reported as written to, with either tracking method; and the destruction
+ * of write-protection-based trackers while other threads write to their
+ * regions.
+ *
+ * No CUDA device is used (or required) by this program.
+ */
+#include <cuda/api/dirty_page_tracker.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+using cuda::memory::host::dirty_page_tracker_t;
+using cuda::memory::host::page_tracking_method_t;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+size_t total_size(const std::vector<cuda::memory::region_t>& ranges)
+{
+	size_t size = 0;
+	for(const auto& range : ranges) { size += range.size(); }
+	return size;
+}
+
+void check_tracking(char* pages, size_t page_size, size_t num_pages, page_tracking_method_t method)
+{
+	// With soft-dirty bits, part of the first and last pages may be left out of the
+	// tracked region; write protection requires whole pages
+	size_t margin = (method == page_tracking_method_t::soft_dirty) ? 100 : 0;
+	cuda::memory::region_t region { pages + margin, num_pages * page_size - 2 * margin };
+	dirty_page_tracker_t tracker(region, method);
+	(tracker.num_pages() == num_pages) or die_("Unexpected number of tracked pages");
+
+	// Initially, everything is dirty
+	(total_size(tracker.take_dirty_ranges()) == region.size()) or die_("Initially-dirty region mismatch");
+	tracker.dirty_ranges().empty() or die_("Pages dirty right after tracking started afresh");
+
+	pages[0] = 1;                     // In the first page; outside the region, given a margin
+	pages[5 * page_size + 3] = 2;
+	pages[6 * page_size] = 3;         // Adjacent to the previous one
+	pages[40 * page_size + 1] = 4;
+	auto ranges = tracker.dirty_ranges();
+	(ranges.size() == 3) or die_("Expected 3 dirty ranges, got " + std::to_string(ranges.size()));
+	(ranges[0].start() == region.start() and ranges[0].size() == page_size - margin)
+		or die_("The first dirty range is not clipped to the region");
+	(ranges[1].start() == pages + 5 * page_size and ranges[1].size() == 2 * page_size)
+		or die_("Adjacent dirty pages were not coalesced");
+	(ranges[2].start() == pages + 40 * page_size and ranges[2].size() == page_size)
+		or die_("Dirty range mismatch");
+	(total_size(tracker.take_dirty_ranges()) == 4 * page_size - margin) or die_("Dirty size mismatch");
+	tracker.dirty_ranges().empty() or die_("Pages dirty after being taken");
+
+	pages[5 * page_size + 4] = 5;
+	(total_size(tracker.take_dirty_ranges()) == page_size) or die_("A re-dirtied page was not tracked");
+
+	tracker.mark_all_dirty();
+	(total_size(tracker.dirty_ranges()) == region.size()) or die_("Marking all pages dirty failed");
+}
+
+void check_partial_pages_rejected(char* pages, size_t page_size, size_t num_pages)
+{
+	cuda::memory::region_t misaligned[] = {
+		{ pages + 100, (num_pages - 1) * page_size },
+		{ pages, num_pages * page_size - 100 },
+	};
+	for(auto region : misaligned) {
+		try {
+			dirty_page_tracker_t tracker(region, page_tracking_method_t::write_protection);
+			die_("Tracking part of a page using write protection was not rejected");
+		}
+		catch(std::invalid_argument&) { }
+	}
+}
+
+void check_destruction_under_concurrent_writes(char* pages, size_t page_size, size_t num_pages)
+{
+	std::atomic<bool> done { false };
+	std::vector<std::thread> writers;
+	for(size_t i = 0; i < 4; i++) {
+		writers.emplace_back([&, i] {
+			size_t page_index = i;
+			while (not done.load()) {
+				pages[page_index * page_size] = static_cast<char>(page_index);
+				page_index = (page_index + 7) % num_pages;
+			}
+		});
+	}
+	for(size_t i = 0; i < 2000; i++) {
+		dirty_page_tracker_t tracker({ pages, num_pages * page_size });
+		tracker.take_dirty_ranges();
+	}
+	done = true;
+	for(auto& writer : writers) { writer.join(); }
+}
+
+int main()
+{
+	auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	size_t num_pages = 64;
+	auto pages = static_cast<char*>(mmap(nullptr, num_pages * page_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	(pages != MAP_FAILED) or die_("Failed mapping host memory");
+	std::memset(pages, 0, num_pages * page_size);
+
+	check_tracking(pages, page_size, num_pages, page_tracking_method_t::write_protection);
+	check_partial_pages_rejected(pages, page_size, num_pages);
+	std::cout << "Write-protection-based tracking: OK\n";
+
+	try {
+		check_tracking(pages, page_size, num_pages, page_tracking_method_t::soft_dirty);
+		std::cout << "Soft-dirty-bit-based tracking: OK\n";
+	}
+	catch(std::runtime_error& error) {
+		// The kernel may lack soft-dirty support, or the pagemap may be inaccessible
+		std::cout << "Soft-dirty-bit-based tracking unavailable: " << error.what() << "\n";
+	}
+
+	check_destruction_under_concurrent_writes(pages, page_size, num_pages);
+	std::cout << "Destruction while the region is being written to: OK\n";
+
+	// Writes after all trackers are gone must not fault
+	pages[3 * page_size] = 1;
+	std::thread([&] { pages[4 * page_size] = 1; }).join();
+
+	munmap(pages, num_pages * page_size);
+	std::cout << "\nSUCCESS\n";
+}
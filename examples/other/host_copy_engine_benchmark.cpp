@@ -0,0 +1,135 @@
+/**
+ * A host-only benchmark of the parallel host memory engine, comparing
+ * its copy, set and zero operations with plain memcpy() and memset(),
+ * over a range of sizes. Fails if, with its default options, the engine
+ * is slower than the plain C library function at any size it does not
+ * simply hand over to the calling thread. Non-temporal stores, which the
+ * engine only uses when asked to, are timed as well - for reference.
+ *
+ * No CUDA device is used (or required) by this program.
+ *
+ * Usage: host_copy_engine_benchmark [maximum size in MiB] [repetitions] [tolerance in percent]
+ */
+#include <cuda/api/host_copy_engine.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace parallel = cuda::memory::host::parallel;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+template <typename F>
+double time_in_seconds(F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	f();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+struct best_times_t {
+	double baseline { std::numeric_limits<double>::max() };
+	double engine { std::numeric_limits<double>::max() };
+};
+
+// Alternates between the two, so that both are timed under the same conditions
+template <typename Baseline, typename Engine>
+best_times_t best_times_in_seconds(size_t repetitions, Baseline baseline, Engine engine)
+{
+	best_times_t best;
+	for(size_t i = 0; i < repetitions; i++) {
+		best.baseline = std::min(best.baseline, time_in_seconds(baseline));
+		best.engine = std::min(best.engine, time_in_seconds(engine));
+	}
+	return best;
+}
+
+void report(const std::string& what, size_t num_bytes, double seconds)
+{
+	std::cout
+		<< std::left << std::setw(32) << what << std::right
+		<< std::fixed << std::setprecision(2) << std::setw(10) << (num_bytes / seconds / 1e9) << " GB/s\n";
+}
+
+int main(int argc, char** argv)
+{
+	size_t max_size_in_mib = (argc > 1) ? std::stoull(argv[1]) : 1024;
+	size_t repetitions = (argc > 2) ? std::stoull(argv[2]) : 5;
+	double tolerance = ((argc > 3) ? std::stod(argv[3]) : 10.0) / 100.0;
+	auto max_size = max_size_in_mib * 1024 * 1024;
+
+	auto& engine = parallel::default_engine();
+	std::cout
+		<< "Parallel engine: " << engine.num_threads() << " worker threads"
+		<< (engine.is_numa_aware() ? ", NUMA-aware" : "") << "\n"
+		<< "Best of " << repetitions << " repetitions\n";
+
+	std::vector<char> source(max_size), destination(max_size);
+	for(size_t i = 0; i < max_size; i++) { source[i] = static_cast<char>(i * 7); }
+	// Touch the destination, so as not to measure page faulting
+	std::memset(destination.data(), 0, max_size);
+
+	parallel::options_t defaults;
+	parallel::options_t always_non_temporal;
+	always_non_temporal.non_temporal_threshold = 0;
+	size_t num_losses { 0 };
+
+	for(size_t size = 64 * 1024; size <= max_size; size *= 4) {
+		std::cout << "\nSize: " << (size / 1024) << " KiB\n";
+		// Smaller operations are simply performed by the calling thread, like the baseline
+		bool compared = (size >= defaults.serial_threshold);
+		auto compare = [&](const std::string& baseline_name, const std::string& engine_name, best_times_t times) {
+			report(baseline_name, size, times.baseline);
+			report(engine_name, size, times.engine);
+			if (compared and times.engine > times.baseline * (1.0 + tolerance)) {
+				std::cout << "  ^ slower than " << baseline_name << " by "
+					<< std::setprecision(1) << (times.engine / times.baseline - 1.0) * 100.0 << "%\n";
+				num_losses++;
+			}
+		};
+		auto copy_with = [&](const parallel::options_t& options) {
+			return [&] { parallel::copy(destination.data(), source.data(), size, options); };
+		};
+		auto set_with = [&](int byte_value, const parallel::options_t& options) {
+			return [&, byte_value] { parallel::set(destination.data(), byte_value, size, options); };
+		};
+		auto memset_with = [&](int byte_value) {
+			return [&, byte_value] { std::memset(destination.data(), byte_value, size); };
+		};
+		auto memcpy_ = [&] { std::memcpy(destination.data(), source.data(), size); };
+
+		compare("memcpy", "parallel::copy", best_times_in_seconds(repetitions, memcpy_, copy_with(defaults)));
+		(std::memcmp(destination.data(), source.data(), size) == 0) or die_("Parallel copy result mismatch");
+		report("parallel::copy, non-temporal", size,
+			best_times_in_seconds(repetitions, memcpy_, copy_with(always_non_temporal)).engine);
+		(std::memcmp(destination.data(), source.data(), size) == 0) or die_("Non-temporal parallel copy result mismatch");
+
+		compare("memset", "parallel::set", best_times_in_seconds(repetitions, memset_with(0x5A), set_with(0x5A, defaults)));
+		(std::all_of(destination.begin(), destination.begin() + size, [](char c) { return c == 0x5A; }))
+			or die_("Parallel set result mismatch");
+		report("parallel::set, non-temporal", size,
+			best_times_in_seconds(repetitions, memset_with(0x5A), set_with(0x5A, always_non_temporal)).engine);
+
+		compare("memset to zero", "parallel::zero", best_times_in_seconds(repetitions, memset_with(0), [&] {
+			parallel::zero(destination.data(), size, defaults);
+		}));
+		(std::all_of(destination.begin(), destination.begin() + size, [](char c) { return c == 0; }))
+			or die_("Parallel zero result mismatch");
+	}
+
+	(num_losses == 0) or die_("The parallel engine was slower than the C library in "
+		+ std::to_string(num_losses) + " case(s)");
+	std::cout << "\nSUCCESS\n";
+}
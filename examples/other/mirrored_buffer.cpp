@@ -0,0 +1,168 @@
+/**
+ * Modifies ranges of a mirrored buffer on the host and on the device, and
+ * checks that the buffer tracks which blocks each side has modified - so
+ * that making either side current copies exactly the stale blocks, with
+ * runs of adjacent ones coalesced into a single copy - and that the data
+ * on both sides ends up coherent.
+ *
+ * Device-side writes are made with copies into the buffer's device-side
+ * memory, standing in for kernels; so no kernels are compiled or launched.
+ */
+#include <cuda/runtime_api.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using mirrored_buffer_t = cuda::mirrored_buffer_t<int>;
+using cuda::mirrored_buffer::block_state_t;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+// e.g. "SHHD" for a four-block buffer with blocks synchronized, newer on the host twice, and newer on the device
+std::string states(const mirrored_buffer_t& buffer)
+{
+	std::string result;
+	for(size_t i = 0; i < buffer.num_blocks(); i++) {
+		switch(buffer.block_state(i)) {
+		case block_state_t::synchronized:    result += 'S'; break;
+		case block_state_t::host_is_newer:   result += 'H'; break;
+		case block_state_t::device_is_newer: result += 'D'; break;
+		}
+	}
+	return result;
+}
+
+void check_states(const mirrored_buffer_t& buffer, const std::string& expected, const std::string& what)
+{
+	(states(buffer) == expected) or die_(what + ": block states are " + states(buffer) + " rather than " + expected);
+}
+
+void check_copies(
+	const mirrored_buffer_t& buffer, const cuda::mirrored_buffer::statistics_t& before,
+	size_t copies_to_device, size_t elements_to_device, size_t copies_to_host, size_t elements_to_host,
+	const std::string& what)
+{
+	const auto& after = buffer.statistics();
+	(after.copies_to_device - before.copies_to_device == copies_to_device) or die_(what + ": unexpected number of copies to the device");
+	(after.bytes_copied_to_device - before.bytes_copied_to_device == elements_to_device * sizeof(int))
+		or die_(what + ": unexpected number of bytes copied to the device");
+	(after.copies_to_host - before.copies_to_host == copies_to_host) or die_(what + ": unexpected number of copies to the host");
+	(after.bytes_copied_to_host - before.bytes_copied_to_host == elements_to_host * sizeof(int))
+		or die_(what + ": unexpected number of bytes copied to the host");
+}
+
+std::vector<int> device_contents(const mirrored_buffer_t& buffer)
+{
+	std::vector<int> contents(buffer.size());
+	cuda::memory::copy(contents.data(), buffer.raw_device_data(), buffer.size_in_bytes());
+	return contents;
+}
+
+// Stands in for a kernel writing to the device-side copy
+void write_on_device(mirrored_buffer_t& buffer, size_t first, size_t count, int value)
+{
+	std::vector<int> values(count, value);
+	cuda::memory::copy(buffer.raw_device_data() + first, values.data(), count * sizeof(int));
+}
+
+template <typename Exception, typename F>
+void check_throws(F&& f, const std::string& what)
+{
+	try { f(); }
+	catch(Exception&) { return; }
+	die_(what + " was not rejected");
+}
+
+int main()
+{
+	// 10 full blocks of 100 elements, and a partial one of 50
+	constexpr size_t num_elements = 1050;
+	constexpr size_t block_size = 100;
+
+	auto device = cuda::device::current::get();
+	auto stream = device.create_stream(cuda::stream::async);
+
+	std::vector<int> expected(num_elements);
+	std::iota(expected.begin(), expected.end(), 0);
+	mirrored_buffer_t buffer(device, expected.data(), num_elements, block_size);
+	(buffer.num_blocks() == 11) or die_("Unexpected number of blocks");
+	check_states(buffer, "HHHHHHHHHHH", "Initialized on the host");
+
+	// Initial contents reach the device in a single copy, once needed there
+	auto statistics = buffer.statistics();
+	buffer.device_view(stream);
+	stream.synchronize();
+	check_copies(buffer, statistics, 1, num_elements, 0, 0, "First device view");
+	check_states(buffer, "SSSSSSSSSSS", "After the first device view");
+	(device_contents(buffer) == expected) or die_("The device did not receive the initial contents");
+	statistics = buffer.statistics();
+	buffer.device_view(stream);
+	buffer.host_view(stream);
+	check_copies(buffer, statistics, 0, 0, 0, 0, "Views of a coherent buffer");
+	std::cout << "Initial upload: OK\n";
+
+	// Host writes straddling a block boundary mark both blocks; only they are uploaded
+	auto host_data = buffer.host_view_for_writing(stream, 250, 100);
+	check_states(buffer, "SSHHSSSSSSS", "After writing elements 250-349 on the host");
+	for(size_t i = 250; i < 350; i++) { expected[i] = host_data[i] = -static_cast<int>(i); }
+	// ... as is the partial last block, on its own
+	buffer.mark_host_modified(1049, 1);
+	expected[1049] = buffer.raw_host_data()[1049] = 12345;
+	check_states(buffer, "SSHHSSSSSSH", "After marking the last element as modified on the host");
+	statistics = buffer.statistics();
+	buffer.device_view(stream);
+	stream.synchronize();
+	check_copies(buffer, statistics, 2, 2 * block_size + 50, 0, 0, "Uploading host writes");
+	(device_contents(buffer) == expected) or die_("Host writes did not reach the device");
+	std::cout << "Host-side modifications: OK\n";
+
+	// Device writes to separate blocks are downloaded in separate copies; adjacent ones, in one
+	buffer.device_view_for_writing(stream, 0, 50);
+	buffer.mark_device_modified(500, 200);
+	buffer.mark_device_modified(1000, cuda::mirrored_buffer::to_end);
+	check_states(buffer, "DSSSSDDSSSD", "After writes on the device");
+	write_on_device(buffer, 0, 50, 7);
+	write_on_device(buffer, 500, 200, 8);
+	write_on_device(buffer, 1000, 50, 9);
+	std::fill(expected.begin(), expected.begin() + 50, 7);
+	std::fill(expected.begin() + 500, expected.begin() + 700, 8);
+	std::fill(expected.begin() + 1000, expected.end(), 9);
+	statistics = buffer.statistics();
+	auto host_view = buffer.host_view(stream);
+	check_copies(buffer, statistics, 0, 0, 3, block_size + 2 * block_size + 50, "Downloading device writes");
+	check_states(buffer, "SSSSSSSSSSS", "After downloading device writes");
+	(std::vector<int>(host_view, host_view + num_elements) == expected) or die_("Device writes did not reach the host");
+	std::cout << "Device-side modifications: OK\n";
+
+	// Conflicting modifications, and invalid ranges, are rejected; empty ones change nothing
+	buffer.mark_device_modified(150, 10);
+	check_throws<std::logic_error>([&] { buffer.mark_host_modified(100, 100); }, "A conflicting host modification");
+	check_throws<std::out_of_range>([&] { buffer.mark_host_modified(num_elements + 1, 1); }, "A range past the end");
+	buffer.mark_host_modified(300, 0);
+	check_states(buffer, "SDSSSSSSSSS", "After rejected and empty modifications");
+
+	// Synchronizing copies in both directions at once
+	write_on_device(buffer, 150, 10, 10);
+	std::fill(expected.begin() + 150, expected.begin() + 160, 10);
+	buffer.mark_host_modified(900, 10);
+	expected[900] = buffer.raw_host_data()[900] = 11;
+	statistics = buffer.statistics();
+	buffer.synchronize(stream);
+	check_copies(buffer, statistics, 1, block_size, 1, block_size, "Synchronizing");
+	check_states(buffer, "SSSSSSSSSSS", "After synchronizing");
+	(device_contents(buffer) == expected) or die_("Synchronizing left the device-side copy stale");
+	(std::vector<int>(buffer.raw_host_data(), buffer.raw_host_data() + num_elements) == expected)
+		or die_("Synchronizing left the host-side copy stale");
+	std::cout << "Conflicts and synchronization: OK\n";
+
+	std::cout << "\nSUCCESS\n";
+}
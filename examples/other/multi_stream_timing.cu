@@ -0,0 +1,98 @@
+/**
+ * Times kernels running on several streams with a timing collector, and
+ * checks the resulting per-stream timelines: every span is placed, the spans
+ * of each stream follow one another, and the spans are consistent with the
+ * duration of the work they time - even though the collector's epochs are
+ * recorded on whichever stream happens to begin a span, and are chained
+ * across streams.
+ */
+#include <cuda/api/timing_collector.hpp>
+#include <cuda/runtime_api.hpp>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using clock_value_t = long long;
+
+__global__ void spin(clock_value_t sleep_cycles)
+{
+	clock_value_t start = clock64();
+	clock_value_t cycles_elapsed;
+	do { cycles_elapsed = clock64() - start; }
+	while (cycles_elapsed < sleep_cycles);
+}
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+int main()
+{
+	constexpr size_t num_streams = 4;
+	constexpr size_t spans_per_stream = 50;
+	constexpr clock_value_t sleep_cycles = 100000;
+	// Timings are rounded to a resolution of about half a microsecond
+	constexpr double tolerance_seconds = 1e-5;
+
+	auto device = cuda::device::current::get();
+	std::cout << "Using CUDA device " << device.name() << " (having ID " << device.id() << ")\n";
+
+	std::vector<cuda::stream_t> streams;
+	for(size_t i = 0; i < num_streams; i++) {
+		streams.push_back(device.create_stream(cuda::stream::async));
+	}
+
+	cuda::timing::options_t options;
+	// Frequent epochs, so that spans are timed against epochs recorded on other streams
+	options.epoch_interval = std::chrono::milliseconds(1);
+	options.collection_threshold = 64;
+	cuda::timing_collector_t collector(device, options);
+
+	auto launch_config = cuda::make_launch_config(1, 1);
+	for(size_t i = 0; i < spans_per_stream; i++) {
+		for(auto& stream : streams) {
+			collector.time(stream, "spin", [&] {
+				stream.enqueue.kernel_launch(spin, launch_config, sleep_cycles);
+			});
+		}
+	}
+	for(auto& stream : streams) { stream.synchronize(); }
+	collector.collect();
+
+	auto statistics = collector.statistics();
+	(statistics.spans_begun == num_streams * spans_per_stream) or die_("Unexpected number of spans begun");
+	(statistics.spans_resolved == statistics.spans_begun) or die_("Not all completed spans were resolved");
+	(collector.num_pending() == 0) or die_("Spans remain pending after all work has completed");
+	std::cout << statistics.spans_resolved << " spans resolved in " << statistics.sweeps << " sweeps, against "
+		<< statistics.epochs << " epochs\n";
+
+	auto timeline = collector.take_timeline();
+	(timeline.size() == num_streams) or die_("Expected a timeline for each stream");
+	double shortest = 1e9;
+	for(const auto& stream_timeline : timeline) {
+		(stream_timeline.spans.size() == spans_per_stream) or die_("Spans are missing from a stream's timeline");
+		double previous_end = 0.0;
+		for(const auto& span : stream_timeline.spans) {
+			(span.start_seconds >= -tolerance_seconds) or die_("A span begins before the first epoch");
+			(span.seconds() > 0.0) or die_("A span of kernel work has no duration");
+			(span.start_seconds >= previous_end - tolerance_seconds) or die_("Spans on the same stream overlap");
+			previous_end = span.end_seconds;
+			if (span.seconds() < shortest) { shortest = span.seconds(); }
+		}
+		std::cout << "Stream " << stream_timeline.stream << ": " << stream_timeline.spans.size() << " spans, from "
+			<< std::fixed << std::setprecision(6) << stream_timeline.spans.front().start_seconds << " s to "
+			<< stream_timeline.spans.back().end_seconds << " s\n";
+	}
+	(collector.take_timeline().empty()) or die_("Taking the timeline did not clear it");
+
+	auto clock_rate_khz = device.get_attribute(cudaDevAttrClockRate);
+	auto minimum_seconds = static_cast<double>(sleep_cycles) / (clock_rate_khz * 1e3);
+	(shortest >= minimum_seconds - tolerance_seconds) or die_("A span is shorter than the kernel it times");
+
+	std::cout << "\nSUCCESS\n";
+}
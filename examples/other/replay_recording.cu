@@ -0,0 +1,96 @@
+/**
+ * Analyzes, and optionally replays, a recording of API calls made
+ * through the wrappers (see cuda::recording::start()).
+ *
+ * The analysis - a summary of the calls, and the critical path through
+ * them - does not require a CUDA device. Kernel launches are replayed
+ * with an empty stand-in kernel, using the recorded grid and block
+ * dimensions. The device timeline is analyzed using the timings measured
+ * during the replay, or - without replaying - estimated ones; and may be
+ * written out as a trace for viewing with Perfetto.
+ *
+ * Usage: replay_recording <recording directory> [--no-replay] [--trace <trace file>]
+ */
+#include <cuda/recording.hpp>
+#include <cuda/runtime_api.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace recording = cuda::recording;
+
+__global__ void stand_in() { }
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+void launch_stand_in(const cuda::stream_t& stream, const recording::record_t& record)
+{
+	auto launch_configuration = cuda::make_launch_config(
+		cuda::grid::dimensions_t{ record.grid[0], record.grid[1], record.grid[2] },
+		cuda::grid::block_dimensions_t{ record.block[0], record.block[1], record.block[2] });
+	stream.enqueue.kernel_launch(stand_in, launch_configuration);
+}
+
+int main(int argc, char** argv)
+{
+	const char* usage = "Usage: replay_recording <recording directory> [--no-replay] [--trace <trace file>]";
+	if (argc < 2) { die_(usage); }
+	std::string directory { argv[1] };
+	bool should_replay = true;
+	std::string trace_path;
+	for(int i = 2; i < argc; i++) {
+		if (std::strcmp(argv[i], "--no-replay") == 0) { should_replay = false; }
+		else if (std::strcmp(argv[i], "--trace") == 0 and i + 1 < argc) { trace_path = argv[++i]; }
+		else { die_(usage); }
+	}
+
+	auto entries = recording::merge(recording::read_logs(directory));
+	std::cout << entries.size() << " recorded calls\n";
+	for(const auto& operation : recording::summarize(entries)) {
+		std::cout
+			<< std::left << std::setw(20) << recording::name(operation.first) << std::right
+			<< std::setw(10) << operation.second.count << " calls"
+			<< std::setw(16) << operation.second.bytes << " bytes"
+			<< std::setw(14) << std::fixed << std::setprecision(6) << operation.second.host_seconds << " s on the host\n";
+	}
+
+	auto graph = recording::dependencies(entries);
+	auto path = recording::critical_path(graph);
+	std::cout << "\nCritical path: " << path.entries.size() << " calls, an estimated "
+		<< path.seconds << " s\n";
+	for(auto index : path.entries) {
+		const auto& entry = graph.entries[index];
+		std::cout << "  thread " << entry.thread_index << " @ " << (entry.record.start * 1e-9) << " s: "
+			<< recording::name(entry.record.operation);
+		if (entry.record.size > 0) { std::cout << " (" << entry.record.size << " bytes)"; }
+		std::cout << '\n';
+	}
+
+	recording::timings_t timings;
+	if (should_replay) {
+		recording::replayer_t replayer { launch_stand_in };
+		std::cout << "\nReplay: " << replayer.replay(graph.entries, &timings) << "\n\nMeasured ";
+	}
+	else {
+		timings = recording::estimated_timings(graph);
+		std::cout << "\nEstimated ";
+	}
+	auto report = recording::analyze(graph, timings);
+	std::cout << report;
+
+	if (not trace_path.empty()) {
+		std::ofstream trace_file(trace_path);
+		recording::write_perfetto_trace(trace_file, graph, timings, &report);
+		if (not trace_file) { die_("Failed writing the trace to " + trace_path); }
+		std::cout << "\nTrace written to " << trace_path << '\n';
+	}
+	std::cout << "\nSUCCESS\n";
+}
@@ -0,0 +1,126 @@
+/**
+ * A check of the runtime compilation cache's building blocks: the hashing
+ * of compilation inputs into cache keys, and the storing and loading of
+ * cache entries - including concurrent stores of the same entry.
+ *
+ * No CUDA device is used (or required) by this program, nor is anything
+ * actually compiled.
+ */
+#include <cuda/rtc/cache.hpp>
+#include <cuda/rtc/detail/sha256.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+using cuda::rtc::cache_t;
+using cuda::rtc::detail_::sha256_t;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+std::string sha256(const std::string& message)
+{
+	sha256_t hash;
+	hash.update(message);
+	return hash.hex_digest();
+}
+
+void check_hashing()
+{
+	// Test vectors from FIPS 180-4 and NIST's examples
+	(sha256("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855")
+		or die_("SHA-256 mismatch for the empty message");
+	(sha256("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad")
+		or die_("SHA-256 mismatch for \"abc\"");
+	(sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")
+		== "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1")
+		or die_("SHA-256 mismatch for a two-block message");
+	std::string million_as(1000000, 'a');
+	(sha256(million_as) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0")
+		or die_("SHA-256 mismatch for a million a's");
+
+	// Updating piecemeal, across block boundaries
+	sha256_t piecewise;
+	for(size_t offset = 0; offset < million_as.size(); offset += 997) {
+		piecewise.update(million_as.substr(offset, 997));
+	}
+	(piecewise.hex_digest() == sha256(million_as)) or die_("Piecewise hashing mismatch");
+
+	// Keys made of fields must not be confused by moving the boundaries between fields
+	sha256_t first, second;
+	first.update_field("ab");
+	first.update_field("c");
+	second.update_field("a");
+	second.update_field("bc");
+	(first.hex_digest() != second.hex_digest()) or die_("Differently-delimited fields hash the same");
+}
+
+size_t num_files_in(const std::string& directory)
+{
+	size_t count = 0;
+	auto dir = opendir(directory.c_str());
+	(dir != nullptr) or die_("Failed listing " + directory);
+	while (auto entry = readdir(dir)) {
+		if (entry->d_name[0] != '.') { count++; }
+	}
+	closedir(dir);
+	return count;
+}
+
+void check_cache(const std::string& directory)
+{
+	cache_t cache(directory + "/nested/cache");
+	std::string contents;
+	(not cache.load("absent", contents)) or die_("Loaded an absent entry");
+
+	(cache.store("key", "value") and cache.load("key", contents) and contents == "value")
+		or die_("Stored entry could not be loaded back");
+	(cache.store("key", "other value") and cache.load("key", contents) and contents == "other value")
+		or die_("Replacing an entry failed");
+	cache.remove("key");
+	(not cache.load("key", contents)) or die_("Loaded a removed entry");
+
+	// Many threads storing different, large, contents under the same key: Every
+	// load must see one of them in its entirety
+	enum : size_t { num_threads = 8, num_stores = 50, entry_size = 1024 * 1024 };
+	std::vector<std::thread> threads;
+	for(size_t i = 0; i < num_threads; i++) {
+		threads.emplace_back([&cache, i] {
+			std::string thread_contents(entry_size, static_cast<char>('a' + i));
+			std::string loaded;
+			for(size_t j = 0; j < num_stores; j++) {
+				cache.store("contended", thread_contents) or die_("Storing an entry failed");
+				cache.load("contended", loaded) or die_("Loading an entry failed");
+				(loaded.size() == entry_size and loaded.find_first_not_of(loaded[0]) == std::string::npos)
+					or die_("Loaded a corrupt entry");
+			}
+		});
+	}
+	for(auto& thread : threads) { thread.join(); }
+	(num_files_in(cache.directory()) == 1) or die_("Temporary files were left in the cache directory");
+	cache.remove("contended");
+}
+
+int main()
+{
+	check_hashing();
+	std::cout << "Hashing: OK\n";
+
+	char directory_template[] = "/tmp/rtc_cache_example.XXXXXX";
+	auto directory = mkdtemp(directory_template);
+	(directory != nullptr) or die_("Failed creating a temporary directory");
+	check_cache(directory);
+	std::cout << "Cache: OK\n";
+	(system((std::string("rm -rf ") + directory).c_str()) == 0) or die_("Failed removing the cache directory");
+
+	std::cout << "\nSUCCESS\n";
+}
@@ -0,0 +1,115 @@
+/**
+ * Specializes a kernel template at runtime, and checks that:
+ *
+ *   - template arguments are spelled, and combined into name expressions,
+ *     as they would be written in CUDA C++ source;
+ *   - each specialization is compiled once, with later requests for it -
+ *     including those made before its compilation concludes - sharing the result;
+ *   - specializations launch as the template instantiated with their arguments;
+ *   - compilation failures are reported to whoever obtains the specialization.
+ */
+#include <cuda/rtc.hpp>
+#include <cuda/runtime_api.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using cuda::rtc::specializer_t;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+const char* kernel_template_source = R"(
+template <typename T, int Multiplier>
+__global__ void scale(T* data, T value, int length)
+{
+	int i = blockIdx.x * blockDim.x + threadIdx.x;
+	if (i < length) { data[i] = value * Multiplier; }
+}
+)";
+
+void check_spelling(const specializer_t& specializer)
+{
+	(cuda::rtc::type_name<unsigned long long>() == std::string("unsigned long long")) or die_("Unexpected type name");
+	(cuda::rtc::template_argument(-5) == "-5" and cuda::rtc::template_argument(32u) == "32")
+		or die_("Unexpected spelling of integral template arguments");
+	(cuda::rtc::template_argument(true) == "true") or die_("Unexpected spelling of a boolean template argument");
+
+	(specializer.name_expression({ "float", "32" }) == "scale<float, 32>") or die_("Unexpected name expression");
+	(specializer.name_expression({ "int" }) == "scale<int>") or die_("Unexpected single-argument name expression");
+	// Avoiding ">>", which C++03 lexes as a shift
+	(specializer.name_expression({ "int", "pair<int, int>" }) == "scale<int, pair<int, int> >")
+		or die_("Unexpected nested name expression");
+}
+
+template <typename T>
+void check_specialization(
+	specializer_t& specializer, const cuda::stream_t& stream,
+	const std::vector<std::string>& template_arguments, T value, int multiplier)
+{
+	enum : int { length = 1000 };
+	auto what = specializer.name_expression(template_arguments);
+	auto kernel = specializer.get<T*, T, int>(template_arguments);
+	auto data = cuda::memory::device::make_unique<T[]>(stream.device(), length);
+	kernel.enqueue_launch(stream, cuda::make_launch_config(4, 256), data.get(), value, static_cast<int>(length));
+	std::vector<T> results(length);
+	cuda::memory::async::copy(results.data(), data.get(), length * sizeof(T), stream);
+	stream.synchronize();
+	for(const auto& result : results) {
+		(result == value * multiplier) or die_(what + " computed a wrong result");
+	}
+}
+
+int main()
+{
+	auto device = cuda::device::current::get();
+	auto stream = device.create_stream(cuda::stream::async);
+	cuda::rtc::program_t program("scale.cu", kernel_template_source);
+	program.add_option("-std=c++11");
+	specializer_t specializer(program, "scale", device, 2);
+
+	check_spelling(specializer);
+	std::cout << "Template argument spelling: OK\n";
+
+	// Requests made while a specialization is compiling, as well as after, share its compilation
+	specializer.prefetch({ { "float", "3" }, { "int", cuda::rtc::template_argument(7) } });
+	(specializer.num_specializations() == 2) or die_("Prefetching did not request the specializations");
+	auto requested_early = specializer.request({ "float", "3" });
+	auto float_kernel = specializer.get<float*, float, int>({ "float", "3" });
+	auto requested_late = specializer.request({ "float", "3" });
+	(specializer.num_specializations() == 2) or die_("A specialization was compiled more than once");
+	(requested_early.get().handle() == float_kernel.handle() and requested_late.get().handle() == float_kernel.handle()
+		and requested_early.get().module() == requested_late.get().module()) or die_("Requests for a specialization were not memoized");
+	auto int_kernel = specializer.get<int*, int, int>({ "int", "7" });
+	(int_kernel.module() != float_kernel.module()) or die_("Distinct specializations share a module");
+	(int_kernel.mangled_name() != float_kernel.mangled_name()) or die_("Distinct specializations share a name");
+	std::cout << "Memoization: OK\n";
+
+	check_specialization(specializer, stream, { "float", "3" }, 1.5f, 3);
+	check_specialization(specializer, stream, { "int", "7" }, 6, 7);
+	check_specialization(specializer, stream, { "double", "-2" }, 0.25, -2);
+	(specializer.num_specializations() == 3) or die_("Unexpected number of specializations");
+	std::cout << "Launching specializations: OK\n";
+
+	// The second template parameter must be an int
+	auto failed = specializer.request({ "float", "float" });
+	try {
+		failed.get();
+		die_("Compiling an invalid specialization did not fail");
+	}
+	catch(cuda::rtc::compilation_error&) { }
+	// ... and the failure is memoized as well
+	try {
+		specializer.get<float*, float, int>({ "float", "float" });
+		die_("Obtaining a failed specialization again did not fail");
+	}
+	catch(cuda::rtc::compilation_error&) { }
+	std::cout << "Compilation failures: OK\n";
+
+	std::cout << "\nSUCCESS\n";
+}
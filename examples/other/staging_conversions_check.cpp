@@ -0,0 +1,203 @@
+/**
+ * A host-only check of the precision-changing conversions used when staging
+ * transfers: the results of each supported SIMD instruction set level must
+ * match those of the scalar code, bit for bit - for NaNs (quiet and signaling,
+ * with payloads), infinities, zeros, subnormals, overflowing values and
+ * rounding ties, as well as for a broad sample of all other values; and the
+ * scalar code must round and classify these as IEEE 754 prescribes.
+ *
+ * No CUDA device is used (or required) by this program.
+ */
+// This program has no NVCC-compiled translation units, so it may vectorize the conversions
+#define CUDA_API_WRAPPERS_ENABLE_HOST_SIMD
+#include <cuda/api/staging_conversions.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace staging = cuda::memory::staging;
+using staging::simd_level_t;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+const char* level_name(simd_level_t level)
+{
+	switch(level) {
+	case simd_level_t::avx512: return "AVX-512";
+	case simd_level_t::avx2:   return "AVX2";
+	default:                   return "scalar";
+	}
+}
+
+float from_bits(uint32_t bits) { float f; std::memcpy(&f, &bits, sizeof(f)); return f; }
+uint32_t to_bits(float f) { uint32_t bits; std::memcpy(&bits, &f, sizeof(bits)); return bits; }
+
+std::string hex(uint64_t value)
+{
+	std::ostringstream stream;
+	stream << "0x" << std::hex << value;
+	return stream.str();
+}
+
+// Values whose conversion is exact, rounds, overflows, underflows - and everything in between
+std::vector<float> fp32_inputs()
+{
+	std::vector<uint32_t> bits {
+		0x00000000, 0x80000000,                         // zeros
+		0x7F800000, 0xFF800000,                         // infinities
+		0x7FC00000, 0xFFC00000, 0x7FC12345, 0xFFFFFFFF, // quiet NaNs, some with payloads
+		0x7F800001, 0x7FA00000, 0xFF812345, 0x7FBFFFFF, // signaling NaNs
+		0x00000001, 0x807FFFFF, 0x00400000,             // FP32 subnormals
+		0x00800000, 0x7F7FFFFF, 0xFF7FFFFF,             // smallest normal, largest finite FP32 values
+		0x477FE000,                                     // 65504, the largest finite FP16 value
+		0x477FEFFF, 0x477FF000, 0x477FF001,             // just under, at and above where FP16 overflows
+		0x33800000, 0x33000000, 0x33000001, 0x32FFFFFF, // around the smallest FP16 subnormal, and half of it
+		0x387FC000, 0x38800000, 0x387FE000,             // around the largest FP16 subnormal
+		0x3F801000, 0x3F803000, 0x3F801001, 0x3F800FFF, // FP16 ties (to even, both ways), and near-ties
+		0x3F808000, 0x3F818000, 0x3F808001, 0x3F807FFF, // BF16 ties (to even, both ways), and near-ties
+		0x7F7F8000, 0x7F7F7FFF,                         // BF16 ties and near-ties at the top of the range
+		0x33C00000, 0x34200000,                         // ties between FP16 subnormals
+	};
+	// About a million more, spread over all bit patterns
+	for(uint64_t sampled = 3; sampled <= std::numeric_limits<uint32_t>::max(); sampled += 0x1003) {
+		bits.push_back(static_cast<uint32_t>(sampled));
+	}
+	std::vector<float> values;
+	values.reserve(bits.size());
+	for(auto b : bits) { values.push_back(from_bits(b)); }
+	return values;
+}
+
+std::vector<uint16_t> all_16_bit_patterns()
+{
+	std::vector<uint16_t> patterns(1 << 16);
+	for(size_t i = 0; i < patterns.size(); i++) { patterns[i] = static_cast<uint16_t>(i); }
+	return patterns;
+}
+
+template <typename T>
+void check_equal(const std::vector<T>& expected, const std::vector<T>& actual, const std::string& what)
+{
+	for(size_t i = 0; i < expected.size(); i++) {
+		(std::memcmp(&expected[i], &actual[i], sizeof(T)) == 0) or die_(what + ": mismatch at index "
+			+ std::to_string(i) + " - expected " + hex(expected[i]) + ", got " + hex(actual[i]));
+	}
+}
+
+void check_equal(const std::vector<float>& expected, const std::vector<float>& actual, const std::string& what)
+{
+	for(size_t i = 0; i < expected.size(); i++) {
+		(to_bits(expected[i]) == to_bits(actual[i])) or die_(what + ": mismatch at index " + std::to_string(i)
+			+ " - expected " + hex(to_bits(expected[i])) + ", got " + hex(to_bits(actual[i])));
+	}
+}
+
+// Known results of the scalar conversions, for the values where errors are most likely
+void check_scalar_results()
+{
+	struct fp32_to_16_t { uint32_t fp32; uint16_t fp16; uint16_t bf16; };
+	const fp32_to_16_t expected[] = {
+		{ 0x00000000, 0x0000, 0x0000 }, { 0x80000000, 0x8000, 0x8000 },
+		{ 0x7F800000, 0x7C00, 0x7F80 }, { 0xFF800000, 0xFC00, 0xFF80 },
+		{ 0x7FC12345, 0x7E09, 0x7FC1 }, { 0x7F800001, 0x7E00, 0x7FC0 }, // NaNs remain NaNs, and are quieted
+		{ 0x477FE000, 0x7BFF, 0x4780 }, { 0x477FEFFF, 0x7BFF, 0x4780 }, { 0x477FF000, 0x7C00, 0x4780 },
+		{ 0x7F7FFFFF, 0x7C00, 0x7F80 }, // overflowing to infinity
+		{ 0x33000000, 0x0000, 0x3300 }, { 0x33000001, 0x0001, 0x3300 }, // half the smallest FP16 subnormal
+		{ 0x33C00000, 0x0002, 0x33C0 }, { 0x34200000, 0x0002, 0x3420 }, // ties between subnormals, to even
+		{ 0x00000001, 0x0000, 0x0000 }, // FP32 subnormals flush to zero only by rounding
+		{ 0x3F801000, 0x3C00, 0x3F80 }, { 0x3F803000, 0x3C02, 0x3F80 }, { 0x3F801001, 0x3C01, 0x3F80 },
+		{ 0x3F808000, 0x3C04, 0x3F80 }, { 0x3F818000, 0x3C0C, 0x3F82 }, { 0x3F808001, 0x3C04, 0x3F81 },
+		{ 0x7F7F8000, 0x7C00, 0x7F80 }, // a BF16 tie rounding up to infinity
+	};
+	for(const auto& e : expected) {
+		auto fp16 = staging::detail_::fp32_to_fp16(from_bits(e.fp32));
+		auto bf16 = staging::detail_::fp32_to_bf16(from_bits(e.fp32));
+		(fp16 == e.fp16) or die_("FP32 " + hex(e.fp32) + " converted to FP16 " + hex(fp16) + " rather than " + hex(e.fp16));
+		(bf16 == e.bf16) or die_("FP32 " + hex(e.fp32) + " converted to BF16 " + hex(bf16) + " rather than " + hex(e.bf16));
+	}
+	// Widening is exact, apart from quieting signaling NaNs
+	(to_bits(staging::detail_::fp16_to_fp32(0x0001)) == 0x33800000) or die_("FP16 subnormal widened incorrectly");
+	(to_bits(staging::detail_::fp16_to_fp32(0x83FF)) == 0xB87FC000) or die_("FP16 subnormal widened incorrectly");
+	(to_bits(staging::detail_::fp16_to_fp32(0xFC00)) == 0xFF800000) or die_("FP16 infinity widened incorrectly");
+	(to_bits(staging::detail_::fp16_to_fp32(0x7C01)) == 0x7FC02000) or die_("FP16 signaling NaN not quieted");
+	(to_bits(staging::detail_::bf16_to_fp32(0x0001)) == 0x00010000) or die_("BF16 subnormal widened incorrectly");
+	std::cout << "Scalar conversions of special values: OK\n";
+}
+
+// Conversions of whole arrays - of odd lengths, so that the tails left by the SIMD code are checked too
+void check_level(simd_level_t level)
+{
+	auto what = [&](const char* conversion) { return std::string(level_name(level)) + " " + conversion; };
+	auto fp32 = fp32_inputs();
+	auto n = fp32.size();
+
+	std::vector<uint16_t> scalar_16(n), simd_16(n);
+	staging::convert_fp32_to_fp16(scalar_16.data(), fp32.data(), n, simd_level_t::scalar);
+	staging::convert_fp32_to_fp16(simd_16.data(), fp32.data(), n, level);
+	check_equal(scalar_16, simd_16, what("FP32 to FP16"));
+	staging::convert_fp32_to_bf16(scalar_16.data(), fp32.data(), n, simd_level_t::scalar);
+	staging::convert_fp32_to_bf16(simd_16.data(), fp32.data(), n, level);
+	check_equal(scalar_16, simd_16, what("FP32 to BF16"));
+
+	auto patterns = all_16_bit_patterns();
+	patterns.pop_back();
+	std::vector<float> scalar_32(patterns.size()), simd_32(patterns.size());
+	staging::convert_fp16_to_fp32(scalar_32.data(), patterns.data(), patterns.size(), simd_level_t::scalar);
+	staging::convert_fp16_to_fp32(simd_32.data(), patterns.data(), patterns.size(), level);
+	check_equal(scalar_32, simd_32, what("FP16 to FP32"));
+	staging::convert_bf16_to_fp32(scalar_32.data(), patterns.data(), patterns.size(), simd_level_t::scalar);
+	staging::convert_bf16_to_fp32(simd_32.data(), patterns.data(), patterns.size(), level);
+	check_equal(scalar_32, simd_32, what("BF16 to FP32"));
+
+	std::vector<int64_t> int64s;
+	for(int64_t v : { int64_t{0}, int64_t{-1}, int64_t{1} << 31, (int64_t{1} << 31) - 1, -(int64_t{1} << 31),
+		-(int64_t{1} << 31) - 1, std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min() })
+	{
+		int64s.push_back(v);
+	}
+	for(int64_t i = 0; i < 1001; i++) { int64s.push_back((i - 500) * 0x7654321); }
+	std::vector<int32_t> scalar_int32(int64s.size()), simd_int32(int64s.size());
+	staging::convert_int64_to_int32(scalar_int32.data(), int64s.data(), int64s.size(),
+		staging::overflow_handling_t::saturate, simd_level_t::scalar);
+	staging::convert_int64_to_int32(simd_int32.data(), int64s.data(), int64s.size(),
+		staging::overflow_handling_t::saturate, level);
+	check_equal(scalar_int32, simd_int32, what("int64 to int32, saturating"));
+	try {
+		staging::convert_int64_to_int32(simd_int32.data(), int64s.data(), int64s.size(),
+			staging::overflow_handling_t::throw_exception, level);
+		die_(what("int64 to int32") + ": an overflowing value was not rejected");
+	}
+	catch(std::out_of_range&) { }
+
+	std::vector<int64_t> scalar_int64(scalar_int32.size()), simd_int64(scalar_int32.size());
+	staging::convert_int32_to_int64(scalar_int64.data(), scalar_int32.data(), scalar_int32.size(), simd_level_t::scalar);
+	staging::convert_int32_to_int64(simd_int64.data(), scalar_int32.data(), scalar_int32.size(), level);
+	check_equal(scalar_int64, simd_int64, what("int32 to int64"));
+
+	std::cout << level_name(level) << " conversions match the scalar ones: OK\n";
+}
+
+int main()
+{
+	check_scalar_results();
+	auto supported = staging::supported_simd_level();
+	if (supported == simd_level_t::scalar) {
+		std::cout << "No SIMD instruction set is supported (or enabled); only the scalar conversions are checked\n";
+	}
+	for(auto level : { simd_level_t::avx2, simd_level_t::avx512 }) {
+		if (level <= supported) { check_level(level); }
+	}
+	std::cout << "\nSUCCESS\n";
+}
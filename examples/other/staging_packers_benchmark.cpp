@@ -0,0 +1,186 @@
+/**
+ * A host-only benchmark of the staging packers: strided, indexed
+ * and AoS-to-SoA packing, each compared against a naive scalar loop
+ * and with each supported SIMD instruction set level.
+ *
+ * No CUDA device is used (or required) by this program.
+ *
+ * Usage: staging_packers_benchmark [number of elements] [repetitions]
+ */
+// This program has no NVCC-compiled translation units, so it may vectorize the packers
+#define CUDA_API_WRAPPERS_ENABLE_HOST_SIMD
+#include <cuda/api/staging.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using cuda::memory::staging::simd_level_t;
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+const char* level_name(simd_level_t level)
+{
+	switch(level) {
+	case simd_level_t::avx512: return "AVX-512";
+	case simd_level_t::avx2:   return "AVX2";
+	default:                   return "scalar";
+	}
+}
+
+template <typename F>
+double best_time_in_seconds(size_t repetitions, F f)
+{
+	double best = std::numeric_limits<double>::max();
+	for(size_t i = 0; i < repetitions; i++) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+void report(const std::string& what, size_t output_bytes, double seconds)
+{
+	std::cout
+		<< std::left << std::setw(40) << what << std::right
+		<< std::fixed << std::setprecision(2) << std::setw(10) << (output_bytes / seconds / 1e9) << " GB/s"
+		<< std::setw(12) << std::setprecision(3) << (seconds * 1e3) << " ms\n";
+}
+
+std::vector<simd_level_t> levels_to_try()
+{
+	std::vector<simd_level_t> levels { simd_level_t::scalar };
+	auto supported = cuda::memory::staging::supported_simd_level();
+	if (supported >= simd_level_t::avx2)   { levels.push_back(simd_level_t::avx2); }
+	if (supported >= simd_level_t::avx512) { levels.push_back(simd_level_t::avx512); }
+	return levels;
+}
+
+struct particle_t {
+	float     position[3];
+	float     mass;
+	double    charge;
+	uint32_t  id;
+	uint32_t  flags;
+};
+
+int main(int argc, char** argv)
+{
+	size_t num_elements = (argc > 1) ? std::stoull(argv[1]) : (size_t{1} << 24);
+	size_t repetitions = (argc > 2) ? std::stoull(argv[2]) : 5;
+
+	std::cout << "Packing " << num_elements << " elements; best of " << repetitions << " repetitions\n\n";
+
+	std::vector<particle_t> particles(num_elements);
+	std::mt19937_64 generator(12345);
+	for(size_t i = 0; i < num_elements; i++) {
+		auto& p = particles[i];
+		p.position[0] = p.position[1] = p.position[2] = static_cast<float>(i);
+		p.mass = static_cast<float>(i) / 2;
+		p.charge = static_cast<double>(generator() % 1000);
+		p.id = static_cast<uint32_t>(i);
+		p.flags = static_cast<uint32_t>(generator());
+	}
+	std::vector<uint32_t> indices(num_elements);
+	for(auto& index : indices) { index = static_cast<uint32_t>(generator() % num_elements); }
+
+	std::vector<float> masses(num_elements), expected_masses(num_elements);
+	std::vector<double> charges(num_elements), expected_charges(num_elements);
+	std::vector<particle_t> gathered(num_elements), expected_gathered(num_elements);
+
+	// Strided packing: the mass field (4 bytes) and the charge field (8 bytes)
+
+	report("strided, 4-byte, naive loop", num_elements * sizeof(float),
+		best_time_in_seconds(repetitions, [&] {
+			for(size_t i = 0; i < num_elements; i++) { expected_masses[i] = particles[i].mass; }
+		}));
+	for(auto level : levels_to_try()) {
+		report(std::string("strided, 4-byte, ") + level_name(level), num_elements * sizeof(float),
+			best_time_in_seconds(repetitions, [&] {
+				cuda::memory::staging::pack_strided(masses.data(), &particles[0].mass,
+					sizeof(float), sizeof(particle_t), num_elements, level);
+			}));
+		(masses == expected_masses) or die_(std::string("Strided 4-byte packing mismatch with ") + level_name(level));
+	}
+
+	report("strided, 8-byte, naive loop", num_elements * sizeof(double),
+		best_time_in_seconds(repetitions, [&] {
+			for(size_t i = 0; i < num_elements; i++) { expected_charges[i] = particles[i].charge; }
+		}));
+	for(auto level : levels_to_try()) {
+		report(std::string("strided, 8-byte, ") + level_name(level), num_elements * sizeof(double),
+			best_time_in_seconds(repetitions, [&] {
+				cuda::memory::staging::pack_strided(charges.data(), &particles[0].charge,
+					sizeof(double), sizeof(particle_t), num_elements, level);
+			}));
+		(charges == expected_charges) or die_(std::string("Strided 8-byte packing mismatch with ") + level_name(level));
+	}
+
+	// Indexed packing: 4-byte rows and whole structures
+
+	std::vector<float> source_masses(num_elements);
+	for(size_t i = 0; i < num_elements; i++) { source_masses[i] = particles[i].mass; }
+	report("indexed, 4-byte rows, naive loop", num_elements * sizeof(float),
+		best_time_in_seconds(repetitions, [&] {
+			for(size_t i = 0; i < num_elements; i++) { expected_masses[i] = source_masses[indices[i]]; }
+		}));
+	for(auto level : levels_to_try()) {
+		report(std::string("indexed, 4-byte rows, ") + level_name(level), num_elements * sizeof(float),
+			best_time_in_seconds(repetitions, [&] {
+				cuda::memory::staging::pack_indexed(masses.data(), source_masses.data(),
+					sizeof(float), indices.data(), num_elements, level);
+			}));
+		(masses == expected_masses) or die_(std::string("Indexed packing mismatch with ") + level_name(level));
+	}
+
+	report("indexed, struct rows, naive loop", num_elements * sizeof(particle_t),
+		best_time_in_seconds(repetitions, [&] {
+			for(size_t i = 0; i < num_elements; i++) { expected_gathered[i] = particles[indices[i]]; }
+		}));
+	report("indexed, struct rows, packer", num_elements * sizeof(particle_t),
+		best_time_in_seconds(repetitions, [&] {
+			cuda::memory::staging::pack_indexed(gathered.data(), particles.data(),
+				sizeof(particle_t), indices.data(), num_elements);
+		}));
+	(std::memcmp(gathered.data(), expected_gathered.data(), num_elements * sizeof(particle_t)) == 0)
+		or die_("Indexed packing of structures mismatch");
+
+	// AoS-to-SoA: all fields other than the position
+
+	std::vector<cuda::memory::staging::field_t> fields {
+		{ offsetof(particle_t, mass),   sizeof(float)    },
+		{ offsetof(particle_t, charge), sizeof(double)   },
+		{ offsetof(particle_t, id),     sizeof(uint32_t) },
+		{ offsetof(particle_t, flags),  sizeof(uint32_t) },
+	};
+	std::vector<uint32_t> ids(num_elements), flags(num_elements);
+	std::vector<void*> destinations { masses.data(), charges.data(), ids.data(), flags.data() };
+	size_t soa_bytes = num_elements * (sizeof(float) + sizeof(double) + 2 * sizeof(uint32_t));
+	for(auto level : levels_to_try()) {
+		report(std::string("AoS-to-SoA, 4 fields, ") + level_name(level), soa_bytes,
+			best_time_in_seconds(repetitions, [&] {
+				cuda::memory::staging::pack_aos_to_soa(destinations, particles.data(),
+					sizeof(particle_t), num_elements, fields, level);
+			}));
+		for(size_t i = 0; i < num_elements; i++) {
+			(ids[i] == particles[i].id and flags[i] == particles[i].flags and charges[i] == particles[i].charge)
+				or die_(std::string("AoS-to-SoA packing mismatch with ") + level_name(level));
+		}
+	}
+
+	std::cout << "\nSUCCESS\n";
+}
@@ -0,0 +1,108 @@
+/**
+ * Warms up CUDA devices in the background, and checks that:
+ *
+ *   - results are reported for each of the requested devices, in the order
+ *     in which they were requested;
+ *   - the streams and events asked for are created, on their own devices;
+ *   - reserving memory in a device's default memory pool raises the pool's
+ *     release threshold to the reservation - but never lowers it.
+ */
+#include <cuda/runtime_api.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+#if CUDART_VERSION >= 11020
+uint64_t release_threshold(const cuda::device_t& device)
+{
+	cudaMemPool_t pool;
+	cuda::throw_if_error(cudaDeviceGetDefaultMemPool(&pool, device.id()), "Failed obtaining a default memory pool");
+	uint64_t threshold;
+	cuda::throw_if_error(cudaMemPoolGetAttribute(pool, cudaMemPoolAttrReleaseThreshold, &threshold),
+		"Failed obtaining a memory pool's release threshold");
+	return threshold;
+}
+
+void set_release_threshold(const cuda::device_t& device, uint64_t threshold)
+{
+	cudaMemPool_t pool;
+	cuda::throw_if_error(cudaDeviceGetDefaultMemPool(&pool, device.id()), "Failed obtaining a default memory pool");
+	cuda::throw_if_error(cudaMemPoolSetAttribute(pool, cudaMemPoolAttrReleaseThreshold, &threshold),
+		"Failed setting a memory pool's release threshold");
+}
+#endif
+
+void check_warmed_up(
+	const std::vector<cuda::device_t>& devices, const std::vector<cuda::warmed_up_device_t>& warmed_up,
+	const cuda::warm_up_options_t& options)
+{
+	(warmed_up.size() == devices.size()) or die_("Unexpected number of warmed-up devices");
+	for(size_t i = 0; i < devices.size(); i++) {
+		const auto& result = warmed_up[i];
+		auto what = "Warming up device " + std::to_string(devices[i].id());
+		(result.device_id == devices[i].id()) or die_(what + ": reported out of order");
+		(result.streams.size() == options.streams_per_device) or die_(what + ": unexpected number of streams");
+		(result.events.size() == options.events_per_device) or die_(what + ": unexpected number of events");
+		for(const auto& stream : result.streams) {
+			(stream.device().id() == result.device_id) or die_(what + ": a stream was created on another device");
+		}
+		for(const auto& event : result.events) {
+			(event.device_id() == result.device_id) or die_(what + ": an event was created on another device");
+		}
+		(result.context_creation_seconds >= 0 and result.context_creation_seconds <= result.total_seconds)
+			or die_(what + ": inconsistent timings");
+		std::cout << result << '\n';
+	}
+}
+
+int main()
+{
+	std::vector<cuda::device_t> all_devices;
+	for(auto device : cuda::devices()) { all_devices.push_back(device); }
+
+	// With no resources requested, only the contexts are created
+	auto warming_up_all = cuda::warm_up();
+	check_warmed_up(all_devices, warming_up_all.get(), {});
+	std::cout << "Warming up all devices: OK\n";
+
+	// Devices may be warmed up again, in any order, with resources created on them
+	std::vector<cuda::device_t> reversed(all_devices.rbegin(), all_devices.rend());
+	cuda::warm_up_options_t options;
+	options.streams_per_device = 3;
+	options.events_per_device = 2;
+	options.events_record_timings = cuda::event::do_record_timings;
+	options.memory_pool_reservation = 1 << 20;
+	auto warming_up = cuda::warm_up(reversed, options);
+	auto warmed_up = warming_up.get();
+	check_warmed_up(reversed, warmed_up, options);
+	// The resources are the caller's to use
+	for(auto& result : warmed_up) {
+		result.events.front().record(result.streams.back());
+		result.events.front().synchronize();
+	}
+	std::cout << "Creating streams and events: OK\n";
+
+#if CUDART_VERSION >= 11020
+	for(const auto& device : all_devices) {
+		(release_threshold(device) >= options.memory_pool_reservation)
+			or die_("The release threshold of device " + std::to_string(device.id()) + " was not raised");
+	}
+	// A higher threshold, set beforehand, is kept
+	const uint64_t higher_threshold = 4 * options.memory_pool_reservation;
+	set_release_threshold(all_devices.front(), higher_threshold);
+	cuda::warm_up({ all_devices.front() }, options).get();
+	(release_threshold(all_devices.front()) == higher_threshold) or die_("A higher release threshold was lowered");
+	std::cout << "Reserving memory pool memory: OK\n";
+#endif
+
+	std::cout << "\nSUCCESS\n";
+}
@@ -0,0 +1,114 @@
+/**
+ * Acquires buffers from a zeroing pool, writes to them with a kernel, and
+ * checks that:
+ *
+ *   - re-zeroing a buffer with memory::device::zero() after a kernel has written
+ *     to it - without reporting the write - actually zeroes it;
+ *   - re-acquiring a buffer known to be zero skips zeroing it, and this is
+ *     reflected in the tracker's statistics;
+ *   - explicitly zeroing only where needed zeroes exactly the parts reported
+ *     as written;
+ *   - buffers released as written by kernels are zeroed in full when re-acquired.
+ */
+#include <cuda/runtime_api.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace zero_tracking = cuda::memory::zero_tracking;
+
+__global__ void fill_with_ones(char* buffer, size_t num_bytes)
+{
+	auto i = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+	if (i < num_bytes) { buffer[i] = 1; }
+}
+
+[[noreturn]] bool die_(const std::string& message)
+{
+	std::cerr << message << "\n";
+	exit(EXIT_FAILURE);
+}
+
+void write_ones(cuda::stream_t& stream, void* start, size_t num_bytes)
+{
+	const unsigned threads_per_block = 256;
+	auto num_blocks = static_cast<unsigned>((num_bytes + threads_per_block - 1) / threads_per_block);
+	stream.enqueue.kernel_launch(fill_with_ones, cuda::make_launch_config(num_blocks, threads_per_block),
+		static_cast<char*>(start), num_bytes);
+}
+
+void check_zero(const cuda::stream_t& stream, cuda::memory::region_t buffer, const std::string& what)
+{
+	std::vector<char> contents(buffer.size(), 1);
+	stream.synchronize();
+	cuda::memory::copy(contents.data(), buffer.start(), buffer.size());
+	(std::all_of(contents.begin(), contents.end(), [](char c) { return c == 0; })) or die_(what + ": buffer is not all-zero");
+}
+
+int main()
+{
+	constexpr size_t buffer_size = 1 << 20;
+	constexpr size_t written_size = 4096;
+
+	auto device = cuda::device::current::get();
+	std::cout << "Using CUDA device " << device.name() << " (having ID " << device.id() << ")\n";
+	auto stream = device.create_stream(cuda::stream::async);
+	auto& tracker = zero_tracking::tracker();
+	cuda::memory::zeroing_pool_t pool(device);
+	zero_tracking::is_enabled() or die_("Zero tracking is not enabled while a zeroing pool exists");
+
+	// A new buffer is zeroed in full
+	tracker.reset_statistics();
+	auto buffer = pool.acquire(buffer_size, stream);
+	check_zero(stream, buffer, "A new buffer");
+	auto statistics = tracker.statistics();
+	(statistics.zeroing_requests == 1 and statistics.bytes_requested == buffer_size and statistics.bytes_avoided == 0)
+		or die_("Unexpected statistics for the acquisition of a new buffer");
+	tracker.is_zero(buffer.start(), buffer.size()) or die_("A new buffer is not known to be zero");
+
+	// The kernel's write is not reported; zeroing the buffer through the wrappers must not be skipped
+	write_ones(stream, buffer.start(), buffer_size);
+	cuda::memory::device::zero(buffer);
+	check_zero(stream, buffer, "A buffer re-zeroed after a kernel's write");
+	(tracker.statistics().zeroing_requests == 1) or die_("Plain zeroing consulted the zero tracker");
+	std::cout << "Zeroing after a kernel's write: OK\n";
+
+	// ... which leaves it known to be zero, so that re-acquiring it skips zeroing
+	pool.release(buffer, false);
+	tracker.reset_statistics();
+	auto reacquired = pool.acquire(buffer_size, stream);
+	(reacquired.start() == buffer.start()) or die_("The released buffer was not reused");
+	statistics = tracker.statistics();
+	(statistics.zeroing_requests == 1 and statistics.memsets_avoided == 1 and statistics.bytes_avoided == buffer_size)
+		or die_("Re-acquiring a buffer known to be zero did not skip zeroing it");
+	check_zero(stream, reacquired, "A re-acquired buffer");
+	std::cout << "Skipped zeroing: OK\n";
+
+	// Reported writes are zeroed where needed - and only there
+	write_ones(stream, reacquired.start(), written_size);
+	tracker.mark_written(reacquired.start(), written_size);
+	tracker.reset_statistics();
+	zero_tracking::zero_where_needed(reacquired, stream);
+	check_zero(stream, reacquired, "A buffer zeroed where needed");
+	statistics = tracker.statistics();
+	(statistics.bytes_requested == buffer_size and statistics.bytes_avoided == buffer_size - written_size
+		and statistics.memsets_avoided == 0) or die_("Zeroing where needed did not skip the parts known to be zero");
+	std::cout << "Zeroing where needed: OK\n";
+
+	// By default, released buffers are assumed to have been written by kernels
+	write_ones(stream, reacquired.start(), buffer_size);
+	pool.release(reacquired);
+	tracker.reset_statistics();
+	auto written = pool.acquire(buffer_size, stream);
+	check_zero(stream, written, "A buffer released after a kernel's write");
+	(tracker.statistics().bytes_avoided == 0) or die_("Zeroing a buffer written by a kernel was skipped");
+	std::cout << "Re-acquiring a written buffer: OK\n";
+
+	pool.release(written);
+	pool.trim();
+	(pool.num_allocations() == 0) or die_("Trimming the pool left allocations behind");
+	std::cout << "\nSUCCESS\n";
+}
@@ -0,0 +1,135 @@
+/**
+ * @file affinity.hpp
+ *
+ * @brief Binding host threads to the CPUs close to a CUDA device - those on the
+ * same socket / NUMA node as the device's PCIe root - as a thread feeding a device
+ * from a remote socket suffers lower copy bandwidth and higher latency.
+ *
+ * @note The CPUs local to each device are determined from Linux sysfs; on other
+ * platforms (or if the information is unavailable), binding has no effect.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_AFFINITY_HPP_
+#define CUDA_API_WRAPPERS_AFFINITY_HPP_
+
+#include <cuda/api/detail/numa.hpp>
+#include <cuda/api/device.hpp>
+#include <cuda/api/miscellany.hpp>
+#include <cuda/api/pci_id.hpp>
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cuda {
+namespace affinity {
+
+using cpu_list_t = cuda::detail_::numa::cpu_list_t;
+
+constexpr const char* default_sysfs_pci_device_directory = "/sys/bus/pci/devices";
+
+/**
+ * @return the name of a PCI device's sysfs directory, e.g. "0000:3b:00.0"
+ */
+inline ::std::string sysfs_name(const device::pci_location_t& pci_id)
+{
+	auto or_zero = [](int field) { return field == device::pci_location_t::unused ? 0 : field; };
+	char name[sizeof("dddd:bb:dd.f") + 8];
+	::std::snprintf(name, sizeof(name), "%04x:%02x:%02x.%x",
+		or_zero(pci_id.domain), or_zero(pci_id.bus), or_zero(pci_id.device), or_zero(pci_id.function));
+	return name;
+}
+
+/**
+ * Determines the CPUs local to the PCI device at a given location
+ *
+ * @param sysfs_pci_device_directory where to look for the `<pci id>/local_cpulist`
+ * files; may be overridden, e.g. with a directory of test fixtures
+ * @return the device's local CPUs; empty if the information is unavailable
+ */
+inline cpu_list_t local_cpus(
+	const device::pci_location_t&  pci_id,
+	const ::std::string&           sysfs_pci_device_directory = default_sysfs_pci_device_directory)
+{
+	auto cpu_list = cuda::detail_::numa::read_file(
+		sysfs_pci_device_directory + '/' + sysfs_name(pci_id) + "/local_cpulist");
+	try { return cuda::detail_::numa::parse_cpu_list(cpu_list); }
+	catch(::std::invalid_argument&) { return {}; }
+}
+
+///@cond
+namespace detail_ {
+
+class local_cpus_table_t {
+public:
+	const cpu_list_t& get(device::id_t device_id)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		if (entries_.empty()) { entries_.resize(static_cast<size_t>(device::count())); }
+		if (device_id < 0 or static_cast<size_t>(device_id) >= entries_.size()) {
+			throw cuda::runtime_error(status::invalid_device, "No CUDA device with id " + ::std::to_string(device_id));
+		}
+		auto& entry = entries_[device_id];
+		if (not entry) {
+			entry.reset(new cpu_list_t(local_cpus(device::detail_::pci_table().location_of(device_id))));
+		}
+		return *entry;
+	}
+
+protected:
+	::std::mutex                                 mutex_;
+	// Entries never move once created, so references to them remain valid
+	::std::vector<::std::unique_ptr<cpu_list_t>> entries_;
+};
+
+inline local_cpus_table_t& local_cpus_table()
+{
+	static local_cpus_table_t table;
+	return table;
+}
+
+} // namespace detail_
+///@endcond
+
+/**
+ * @return the CPUs local to @p device ; empty if the information is unavailable
+ *
+ * @note Determined once per device, then cached
+ */
+inline const cpu_list_t& local_cpus(const device_t& device)
+{
+	return detail_::local_cpus_table().get(device.id());
+}
+
+/**
+ * @brief Restrict the calling thread to the CPUs local to a device (among
+ * those it may already run on).
+ *
+ * @return true on success; false if the device's local CPUs are unknown,
+ * or the thread could not be bound to them (e.g. as none of them are
+ * available to the process)
+ */
+inline bool bind_this_thread_near(const device_t& device)
+{
+	return cuda::detail_::numa::bind_this_thread(local_cpus(device));
+}
+
+/**
+ * @copydoc bind_this_thread_near(const device_t&)
+ *
+ * @param sysfs_pci_device_directory see @ref local_cpus(const device::pci_location_t&, const ::std::string&)
+ */
+inline bool bind_this_thread_near(
+	const device::pci_location_t&  pci_id,
+	const ::std::string&           sysfs_pci_device_directory = default_sysfs_pci_device_directory)
+{
+	return cuda::detail_::numa::bind_this_thread(local_cpus(pci_id, sysfs_pci_device_directory));
+}
+
+} // namespace affinity
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_AFFINITY_HPP_
@@ -10,6 +10,7 @@
 #define CUDA_API_WRAPPERS_ARRAY_HPP_
 
 #include <cuda/api/current_device.hpp>
+#include <cuda/api/detail/deferred_destruction.hpp>
 #include <cuda/api/error.hpp>
 
 #include <cuda_runtime.h>
@@ -100,7 +101,7 @@ public:
 
 	~array_t() noexcept
 	{
-		if (raw_array_) {
+		if (raw_array_ and not cuda::detail_::defer_destruction(cuda::detail_::destroyable_t::array, raw_array_, -1)) {
 			auto status = cudaFreeArray(raw_array_);
 			// Note: Throwing in a noexcept destructor; if the free'ing fails, the program
 			// will likely terminate
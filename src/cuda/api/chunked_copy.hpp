@@ -0,0 +1,184 @@
+/**
+ * @file chunked_copy.hpp
+ *
+ * @brief Copying a large buffer in chunks, each of which is signaled by an event of
+ * its own as it arrives - so that work consuming the buffer can begin on its first
+ * chunks while the later ones are still being transferred, rather than only once
+ * the entire copy has concluded.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_CHUNKED_COPY_HPP_
+#define CUDA_API_WRAPPERS_CHUNKED_COPY_HPP_
+
+#include <cuda/api/event.hpp>
+#include <cuda/api/event_pool.hpp>
+#include <cuda/api/kernel_launch.hpp>
+#include <cuda/api/memory.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/stream.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cuda {
+namespace memory {
+namespace async {
+
+/**
+ * @brief A copy enqueued in chunks, with an event marking the arrival of each
+ *
+ * @note Holds on to the chunks' events, which return to their pool on destruction;
+ * waits already enqueued on them are not affected by that.
+ */
+class chunked_copy_t {
+public: // getters
+	size_t num_chunks() const noexcept { return chunk_events_.size(); }
+	size_t chunk_size() const noexcept { return chunk_size_; }
+	size_t size() const noexcept { return size_; }
+
+	region_t destination_chunk(size_t chunk_index) const
+	{
+		check_index(chunk_index);
+		auto offset = chunk_index * chunk_size_;
+		return { static_cast<char*>(destination_) + offset, ::std::min(chunk_size_, size_ - offset) };
+	}
+
+	/**
+	 * @return the event which occurs once the chunk has arrived in full
+	 */
+	const event_t& chunk_event(size_t chunk_index) const
+	{
+		check_index(chunk_index);
+		return chunk_events_[chunk_index].get();
+	}
+
+	bool has_arrived(size_t chunk_index) const { return chunk_event(chunk_index).has_occurred(); }
+
+public: // mutators
+	/**
+	 * @brief Block until a chunk has arrived in full
+	 */
+	void wait_for(size_t chunk_index) const { cuda::synchronize(chunk_event(chunk_index)); }
+
+	/**
+	 * @brief Have work enqueued on @p stream from now on wait for a chunk to arrive
+	 */
+	void enqueue_wait_for(stream_t stream, size_t chunk_index) const
+	{
+		stream.enqueue.wait(chunk_event(chunk_index));
+	}
+
+public: // constructors and destructor
+	chunked_copy_t(void* destination, size_t size, size_t chunk_size) :
+		destination_(destination), size_(size), chunk_size_(chunk_size) { }
+
+	chunked_copy_t(chunked_copy_t&&) = default;
+	chunked_copy_t(const chunked_copy_t&) = delete;
+
+public: // operators
+	chunked_copy_t& operator=(const chunked_copy_t&) = delete;
+
+protected: // non-mutators
+	void check_index(size_t chunk_index) const
+	{
+		if (chunk_index >= chunk_events_.size()) {
+			throw ::std::out_of_range("No chunk " + ::std::to_string(chunk_index) + " in a copy of "
+				+ ::std::to_string(chunk_events_.size()) + " chunks");
+		}
+	}
+
+protected: // data members
+	void*                                         destination_;
+	size_t                                        size_;
+	size_t                                        chunk_size_;
+	::std::vector<event_pool::pooled_event_t>     chunk_events_;
+
+	friend chunked_copy_t copy_and_signal_chunks(
+		void*, const void*, size_t, const stream_t&, size_t, event_pool_t*);
+};
+
+/**
+ * @brief Enqueue a copy on a stream, chunk by chunk, recording an event after each chunk
+ *
+ * @param chunk_size in bytes; the last chunk may be smaller
+ * @param pool the pool from which to draw the chunks' events; if null, the default
+ * pool of the stream's device
+ */
+inline chunked_copy_t copy_and_signal_chunks(
+	void*            destination,
+	const void*      source,
+	size_t           num_bytes,
+	const stream_t&  stream,
+	size_t           chunk_size,
+	event_pool_t*    pool = nullptr)
+{
+	if (chunk_size == 0) {
+		throw ::std::invalid_argument("Chunked copies require a non-zero chunk size");
+	}
+	auto device = stream.device();
+	auto& pool_ = (pool != nullptr) ? *pool : event_pool::default_pool(device);
+	chunked_copy_t copy { destination, num_bytes, chunk_size };
+	auto num_chunks = (num_bytes + chunk_size - 1) / chunk_size;
+	copy.chunk_events_.reserve(num_chunks);
+	for(size_t offset = 0; offset < num_bytes; offset += chunk_size) {
+		detail_::copy(static_cast<char*>(destination) + offset, static_cast<const char*>(source) + offset,
+			::std::min(chunk_size, num_bytes - offset), stream.id());
+		auto event = pool_.acquire();
+		stream_t(stream).enqueue.event(event.get());
+		copy.chunk_events_.push_back(::std::move(event));
+	}
+	return copy;
+}
+
+/**
+ * @brief Enqueue work on each chunk of a chunked copy, as soon as that chunk has arrived
+ *
+ * @param enqueue_consumer invoked, for each chunk in order, with @p consumer_stream,
+ * the chunk's index and its region in the destination - after @p consumer_stream
+ * has been made to wait for the chunk
+ */
+template <typename F>
+void enqueue_per_chunk(const chunked_copy_t& copy, stream_t consumer_stream, F&& enqueue_consumer)
+{
+	for(size_t i = 0; i < copy.num_chunks(); i++) {
+		consumer_stream.enqueue.wait(copy.chunk_event(i));
+		enqueue_consumer(consumer_stream, i, copy.destination_chunk(i));
+	}
+}
+
+/**
+ * @brief Launch a kernel on each chunk of a chunked copy, as soon as that chunk has arrived
+ *
+ * The kernel is passed the chunk, as a `T*`, and its number of elements, followed by
+ * @p parameters ; as the last chunk may be smaller than the others, the kernel must
+ * not rely on the launch configuration to determine the number of elements.
+ *
+ * @throws ::std::invalid_argument if the chunks are not made up of whole `T`'s
+ */
+template <typename T, typename KernelFunction, typename... KernelParameters>
+void launch_per_chunk(
+	const chunked_copy_t&   copy,
+	stream_t                consumer_stream,
+	const KernelFunction&   kernel_function,
+	launch_configuration_t  launch_configuration,
+	KernelParameters...     parameters)
+{
+	if (copy.chunk_size() % sizeof(T) != 0 or copy.size() % sizeof(T) != 0) {
+		throw ::std::invalid_argument("Chunks of a copy of " + ::std::to_string(copy.size())
+			+ " bytes, in chunks of " + ::std::to_string(copy.chunk_size()) + " bytes, are not made up of whole "
+			+ ::std::to_string(sizeof(T)) + "-byte elements");
+	}
+	enqueue_per_chunk(copy, ::std::move(consumer_stream),
+		[&](stream_t& stream, size_t, region_t chunk) {
+			stream.enqueue.kernel_launch(kernel_function, launch_configuration,
+				static_cast<T*>(chunk.start()), chunk.size() / sizeof(T), parameters...);
+		});
+}
+
+} // namespace async
+} // namespace memory
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_CHUNKED_COPY_HPP_
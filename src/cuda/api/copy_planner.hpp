@@ -0,0 +1,819 @@
+/**
+ * @file copy_planner.hpp
+ *
+ * @brief Choosing, for each copy enqueued on a stream, the fastest of several ways
+ * of carrying it out - depending on the kinds of memory involved and on the copy's
+ * size - rather than always making a single `cudaMemcpyAsync()` call:
+ *
+ *  - Tiny copies into mapped (pinned) host memory are stored by a host function
+ *    enqueued on the stream, avoiding the fixed cost of a DMA transfer.
+ *  - Medium-sized copies between pageable host memory and the device are bounced
+ *    through a ring of pinned buffers, overlapping the host-side copying with the
+ *    transfers.
+ *  - Huge copies are split into chunks, enqueued on several auxiliary streams,
+ *    so as to occupy more than one copy engine where the device has them.
+ *
+ * The size thresholds are calibrated by a short microbenchmark, once per machine and
+ * device, and persisted; they may also be set explicitly, as may a specific path.
+ *
+ * @note Planning is opt-in: Until @ref copy_planning::enable() is called, @ref
+ * stream_t::enqueue_t::copy() makes plain `cudaMemcpyAsync()` calls.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_COPY_PLANNER_HPP_
+#define CUDA_API_WRAPPERS_COPY_PLANNER_HPP_
+
+#include <cuda/api/detail/file_system.hpp>
+#include <cuda/api/device.hpp>
+#include <cuda/api/event.hpp>
+#include <cuda/api/host_copy_engine.hpp>
+#include <cuda/api/memory.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/pointer.hpp>
+#include <cuda/api/stream.hpp>
+#include <cuda/api/unique_ptr.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace cuda {
+namespace memory {
+namespace copy_planning {
+
+enum class memory_kind_t {
+	pageable,
+	/** Page-locked host memory, possibly mapped into the device's address space */
+	pinned,
+	device,
+	managed
+};
+
+inline const char* name(memory_kind_t kind) noexcept
+{
+	switch(kind) {
+	case memory_kind_t::pageable: return "pageable";
+	case memory_kind_t::pinned:   return "pinned";
+	case memory_kind_t::device:   return "device";
+	case memory_kind_t::managed:  return "managed";
+	}
+	return "unknown";
+}
+
+inline memory_kind_t kind_of(const void* ptr)
+{
+	cudaPointerAttributes attributes;
+	auto status = cudaPointerGetAttributes(&attributes, ptr);
+	if (status != cudaSuccess) {
+		// Before CUDA 11, pageable memory is reported as an invalid value;
+		// clearing the error, so as to not have it surface elsewhere
+		cudaGetLastError();
+		return memory_kind_t::pageable;
+	}
+	switch(static_cast<const pointer::attributes_t&>(attributes).memory_type()) {
+	case host_memory:    return memory_kind_t::pinned;
+	case device_memory:  return memory_kind_t::device;
+	case managed_memory: return memory_kind_t::managed;
+	default:             return memory_kind_t::pageable;
+	}
+}
+
+enum class path_t {
+	/** A single `cudaMemcpyAsync()` call */
+	direct,
+	/** A host function on the stream, storing into mapped memory */
+	host_store,
+	/** Through a ring of pinned buffers */
+	pinned_bounce,
+	/** Split across several streams */
+	chunked
+};
+
+inline const char* name(path_t path) noexcept
+{
+	switch(path) {
+	case path_t::direct:        return "direct";
+	case path_t::host_store:    return "host_store";
+	case path_t::pinned_bounce: return "pinned_bounce";
+	case path_t::chunked:       return "chunked";
+	}
+	return "unknown";
+}
+
+enum : size_t { never = ::std::numeric_limits<size_t>::max() };
+
+/**
+ * The sizes at which each of the paths becomes the fastest; the defaults are
+ * conservative, and only used until the thresholds have been calibrated
+ */
+struct thresholds_t {
+	/** Copies into pinned memory of up to this size are stored by the host */
+	size_t host_store_max      { 0 };
+	/** Copies between pageable memory and the device, in this size range, are bounced */
+	size_t pinned_bounce_min   { 256 * 1024 };
+	size_t pinned_bounce_max   { 64 * 1024 * 1024 };
+	/** Copies of at least this size between pinned or device memory and the device are chunked */
+	size_t chunked_min         { never };
+	size_t bounce_buffer_size  { 2 * 1024 * 1024 };
+	size_t num_bounce_buffers  { 3 };
+	size_t num_chunk_streams   { 2 };
+};
+
+inline bool operator==(const thresholds_t& lhs, const thresholds_t& rhs) noexcept
+{
+	return lhs.host_store_max == rhs.host_store_max
+		and lhs.pinned_bounce_min == rhs.pinned_bounce_min
+		and lhs.pinned_bounce_max == rhs.pinned_bounce_max
+		and lhs.chunked_min == rhs.chunked_min
+		and lhs.bounce_buffer_size == rhs.bounce_buffer_size
+		and lhs.num_bounce_buffers == rhs.num_bounce_buffers
+		and lhs.num_chunk_streams == rhs.num_chunk_streams;
+}
+
+/**
+ * @brief Choose how to carry out a copy
+ */
+inline path_t plan(
+	memory_kind_t        destination,
+	memory_kind_t        source,
+	size_t               num_bytes,
+	const thresholds_t&  thresholds) noexcept
+{
+	auto is_host = [](memory_kind_t kind) {
+		return kind == memory_kind_t::pageable or kind == memory_kind_t::pinned;
+	};
+	if (destination == memory_kind_t::pinned and is_host(source) and num_bytes <= thresholds.host_store_max) {
+		return path_t::host_store;
+	}
+	bool pageable_and_device =
+		(source == memory_kind_t::pageable and destination == memory_kind_t::device) or
+		(source == memory_kind_t::device and destination == memory_kind_t::pageable);
+	if (pageable_and_device) {
+		return (num_bytes >= thresholds.pinned_bounce_min and num_bytes <= thresholds.pinned_bounce_max) ?
+			path_t::pinned_bounce : path_t::direct;
+	}
+	bool dma_capable = (source == memory_kind_t::pinned or source == memory_kind_t::device)
+		and (destination == memory_kind_t::pinned or destination == memory_kind_t::device)
+		and (source == memory_kind_t::device or destination == memory_kind_t::device);
+	if (dma_capable and num_bytes >= thresholds.chunked_min and thresholds.num_chunk_streams > 1) {
+		return path_t::chunked;
+	}
+	return path_t::direct;
+}
+
+/**
+ * @name Persisting thresholds
+ *
+ * Thresholds are stored as a small text file, of `key=value` lines
+ */
+///@{
+inline ::std::string to_string(const thresholds_t& thresholds)
+{
+	::std::ostringstream os;
+	os  << "host_store_max=" << thresholds.host_store_max << '\n'
+		<< "pinned_bounce_min=" << thresholds.pinned_bounce_min << '\n'
+		<< "pinned_bounce_max=" << thresholds.pinned_bounce_max << '\n'
+		<< "chunked_min=" << thresholds.chunked_min << '\n'
+		<< "bounce_buffer_size=" << thresholds.bounce_buffer_size << '\n'
+		<< "num_bounce_buffers=" << thresholds.num_bounce_buffers << '\n'
+		<< "num_chunk_streams=" << thresholds.num_chunk_streams << '\n';
+	return os.str();
+}
+
+/**
+ * @return true if all thresholds were loaded; otherwise, @p thresholds is left unchanged
+ */
+inline bool load(const ::std::string& path, thresholds_t& thresholds)
+{
+	::std::ifstream file(path);
+	if (not file) { return false; }
+	::std::map<::std::string, size_t> values;
+	::std::string line;
+	while (::std::getline(file, line)) {
+		auto equals_pos = line.find('=');
+		if (equals_pos == ::std::string::npos) { continue; }
+		try { values[line.substr(0, equals_pos)] = ::std::stoull(line.substr(equals_pos + 1)); }
+		catch(::std::exception&) { return false; }
+	}
+	thresholds_t loaded;
+	struct { const char* key; size_t* value; } fields[] = {
+		{ "host_store_max",     &loaded.host_store_max },
+		{ "pinned_bounce_min",  &loaded.pinned_bounce_min },
+		{ "pinned_bounce_max",  &loaded.pinned_bounce_max },
+		{ "chunked_min",        &loaded.chunked_min },
+		{ "bounce_buffer_size", &loaded.bounce_buffer_size },
+		{ "num_bounce_buffers", &loaded.num_bounce_buffers },
+		{ "num_chunk_streams",  &loaded.num_chunk_streams },
+	};
+	for(const auto& field : fields) {
+		auto it = values.find(field.key);
+		if (it == values.end()) { return false; }
+		*field.value = it->second;
+	}
+	if (loaded.bounce_buffer_size == 0 or loaded.num_bounce_buffers == 0) { return false; }
+	thresholds = loaded;
+	return true;
+}
+
+/**
+ * @return true if the thresholds were stored; failing to store them is not an error
+ */
+inline bool store(const ::std::string& path, const thresholds_t& thresholds) noexcept
+{
+	auto temporary_path = cuda::detail_::file_system::unique_temporary_path(path);
+	{
+		::std::ofstream file(temporary_path, ::std::ios::trunc);
+		if (not file) { return false; }
+		file << to_string(thresholds);
+		if (not file) { ::std::remove(temporary_path.c_str()); return false; }
+	}
+	if (::std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+		::std::remove(temporary_path.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * The directory in which thresholds are persisted by default: the value of the
+ * `CUDA_API_WRAPPERS_COPY_PLANNER_DIR` environment variable, if set; otherwise,
+ * a subdirectory of the user's cache directory
+ */
+inline ::std::string default_directory()
+{
+	auto get_env = [](const char* name) -> ::std::string {
+		auto value = ::std::getenv(name);
+		return value == nullptr ? ::std::string{} : value;
+	};
+	auto directory = get_env("CUDA_API_WRAPPERS_COPY_PLANNER_DIR");
+	if (not directory.empty()) { return directory; }
+	auto user_cache_directory = get_env("XDG_CACHE_HOME");
+	if (user_cache_directory.empty()) {
+		auto home = get_env("HOME");
+		user_cache_directory = home.empty() ? "/tmp" : home + "/.cache";
+	}
+	return user_cache_directory + "/cuda-api-wrappers/copy-planner";
+}
+
+/**
+ * @return the name of the file holding a device's thresholds - specific to the
+ * machine (by host name) and to the device (by its name and PCI location)
+ */
+inline ::std::string thresholds_file_name(const device_t& device)
+{
+	auto host_name = cuda::detail_::file_system::host_name();
+	if (host_name.empty()) { host_name = "unknown-host"; }
+	auto pci_id = device.pci_id();
+	::std::string name = host_name + '-' + device.name() + '-'
+		+ ::std::to_string(pci_id.domain) + '-' + ::std::to_string(pci_id.bus) + '-' + ::std::to_string(pci_id.device);
+	for(auto& c : name) {
+		if (not (::std::isalnum(static_cast<unsigned char>(c)) or c == '-' or c == '.')) { c = '_'; }
+	}
+	return name + ".thresholds";
+}
+///@}
+
+struct statistics_t {
+	size_t copies[4]     { 0, 0, 0, 0 };
+	size_t bytes[4]      { 0, 0, 0, 0 };
+
+	size_t copies_via(path_t path) const noexcept { return copies[static_cast<int>(path)]; }
+	size_t bytes_via(path_t path) const noexcept { return bytes[static_cast<int>(path)]; }
+};
+
+/**
+ * @brief Carries out copies enqueued on streams, along the path planned for each
+ */
+class planner_t {
+public: // non-mutators
+	statistics_t statistics() const
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		return statistics_;
+	}
+
+	/**
+	 * @return the thresholds used for copies on streams of @p device_id, or
+	 * the defaults if none have been set
+	 */
+	thresholds_t thresholds(cuda::device::id_t device_id) const
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto it = devices_.find(device_id);
+		return (it == devices_.end()) ? thresholds_t{} : it->second.thresholds;
+	}
+
+	/**
+	 * @return true if a path has been forced, in @p path
+	 */
+	bool forced_path(path_t& path) const
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		path = forced_path_;
+		return is_path_forced_;
+	}
+
+public: // mutators
+	void set_thresholds(cuda::device::id_t device_id, const thresholds_t& thresholds)
+	{
+		// Freed once the lock is released
+		::std::vector<bounce_buffer_ptr> freed;
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto& state = devices_[device_id];
+		if (not (state.thresholds == thresholds)) {
+			// Bounce buffers are sized by the thresholds; but copies may still be using
+			// the existing ones, which are only freed once they're done with them
+			retire_bounce_buffers(state);
+			state.generation++;
+			free_retired_bounce_buffers(state, freed);
+		}
+		state.thresholds = thresholds;
+	}
+
+	/**
+	 * @brief Use the specified path for all copies, regardless of their size
+	 * and the kinds of memory involved, where possible
+	 */
+	void force_path(path_t path)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		forced_path_ = path;
+		is_path_forced_ = true;
+	}
+
+	void clear_forced_path()
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		is_path_forced_ = false;
+	}
+
+	/**
+	 * @return the path actually taken
+	 */
+	path_t copy(void* destination, const void* source, size_t num_bytes, const stream_t& stream)
+	{
+		auto destination_kind = kind_of(destination);
+		auto source_kind = kind_of(source);
+		auto device_id = stream.device().id();
+		path_t path;
+		{
+			::std::lock_guard<::std::mutex> lock(mutex_);
+			path = is_path_forced_ ? forced_path_ :
+				plan(destination_kind, source_kind, num_bytes, devices_[device_id].thresholds);
+		}
+		path = feasible(path, destination_kind, source_kind);
+		switch(path) {
+		case path_t::host_store:    host_store(destination, source, num_bytes, source_kind, stream); break;
+		case path_t::pinned_bounce: bounce(destination, source, num_bytes, source_kind, stream); break;
+		case path_t::chunked:       chunked(destination, source, num_bytes, stream); break;
+		default:                    async::detail_::copy(destination, source, num_bytes, stream.id());
+		}
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		statistics_.copies[static_cast<int>(path)]++;
+		statistics_.bytes[static_cast<int>(path)] += num_bytes;
+		return path;
+	}
+
+	/**
+	 * @brief Free the buffers and streams used for copying, once all copies using them have concluded
+	 */
+	void release_resources()
+	{
+		::std::vector<bounce_buffer_ptr> released;
+		{
+			::std::lock_guard<::std::mutex> lock(mutex_);
+			for(auto& device : devices_) {
+				auto& state = device.second;
+				retire_bounce_buffers(state);
+				// Buffers still used by a copy are freed when that copy is done with them
+				auto& retired = state.retired_bounce_buffers;
+				auto unused_end = ::std::stable_partition(retired.begin(), retired.end(),
+					[](const bounce_buffer_ptr& buffer) { return not buffer->busy; });
+				::std::move(retired.begin(), unused_end, ::std::back_inserter(released));
+				retired.erase(retired.begin(), unused_end);
+				state.chunk_streams.clear();
+			}
+		}
+		for(auto& buffer : released) {
+			if (buffer->in_flight) { cuda::synchronize(buffer->done); }
+		}
+	}
+
+public: // constructors and destructor
+	planner_t() = default;
+	planner_t(const planner_t&) = delete;
+
+protected: // types
+	struct bounce_buffer_t {
+		host::unique_ptr<char[]>  data;
+		size_t                    size;
+		event_t                   done;
+		/** Which of the device's thresholds the buffer was allocated for */
+		size_t                    generation;
+		/** Held by a single copy, which has exclusive use of the buffer until releasing it */
+		bool                      busy { true };
+		/** Whether @ref done must occur before the buffer may be reused */
+		bool                      in_flight { false };
+		size_t                    last_used { 0 };
+
+		bounce_buffer_t(host::unique_ptr<char[]>&& data_, size_t size_, event_t&& done_, size_t generation_) :
+			data(::std::move(data_)), size(size_), done(::std::move(done_)), generation(generation_) { }
+	};
+
+	// Buffers are held by address while in use, so they must not move
+	using bounce_buffer_ptr = ::std::unique_ptr<bounce_buffer_t>;
+
+	struct device_state_t {
+		thresholds_t                       thresholds;
+		size_t                             generation { 0 };
+		::std::vector<bounce_buffer_ptr>   bounce_buffers;
+		/** No longer handed out; freed once no copy uses them */
+		::std::vector<bounce_buffer_ptr>   retired_bounce_buffers;
+		size_t                             num_bounce_buffer_uses { 0 };
+		::std::vector<stream_t>            chunk_streams;
+	};
+
+protected: // non-mutators
+	static path_t feasible(path_t path, memory_kind_t destination, memory_kind_t source) noexcept
+	{
+		auto is_host = [](memory_kind_t kind) {
+			return kind == memory_kind_t::pageable or kind == memory_kind_t::pinned;
+		};
+		switch(path) {
+		case path_t::host_store:
+			return (destination == memory_kind_t::pinned and is_host(source)) ? path : path_t::direct;
+		case path_t::pinned_bounce:
+			return ((source == memory_kind_t::pageable and destination == memory_kind_t::device)
+				or (source == memory_kind_t::device and destination == memory_kind_t::pageable)) ? path : path_t::direct;
+		case path_t::chunked:
+			return (source != memory_kind_t::pageable and destination != memory_kind_t::pageable) ? path : path_t::direct;
+		default:
+			return path_t::direct;
+		}
+	}
+
+protected: // mutators
+	static void host_store(void* destination, const void* source, size_t num_bytes, memory_kind_t source_kind, const stream_t& stream)
+	{
+		// Pageable memory is consumed by the time an enqueued copy returns; pinned memory
+		// is only read when the stream reaches the copy
+		::std::shared_ptr<::std::vector<char>> source_copy;
+		if (source_kind == memory_kind_t::pageable) {
+			auto begin = static_cast<const char*>(source);
+			source_copy = ::std::make_shared<::std::vector<char>>(begin, begin + num_bytes);
+			source = source_copy->data();
+		}
+		stream_t(stream).enqueue.host_function_call([=](const stream_t&) {
+			::std::memcpy(destination, source, num_bytes);
+			(void) source_copy;
+		});
+	}
+
+	static void retire_bounce_buffers(device_state_t& state)
+	{
+		::std::move(state.bounce_buffers.begin(), state.bounce_buffers.end(),
+			::std::back_inserter(state.retired_bounce_buffers));
+		state.bounce_buffers.clear();
+	}
+
+	/**
+	 * Moves the retired buffers which are no longer in use into @p freed - so that
+	 * they may be freed without holding the lock
+	 */
+	static void free_retired_bounce_buffers(device_state_t& state, ::std::vector<bounce_buffer_ptr>& freed)
+	{
+		auto& retired = state.retired_bounce_buffers;
+		auto unused_end = ::std::stable_partition(retired.begin(), retired.end(),
+			[](const bounce_buffer_ptr& buffer) {
+				return not buffer->busy and (not buffer->in_flight or buffer->done.has_occurred());
+			});
+		::std::move(retired.begin(), unused_end, ::std::back_inserter(freed));
+		retired.erase(retired.begin(), unused_end);
+	}
+
+	/**
+	 * @return a buffer for the exclusive use of the caller - until it is passed to
+	 * @ref release_bounce_buffer() - and which no enqueued transfer still uses
+	 */
+	bounce_buffer_t& acquire_bounce_buffer(cuda::device::id_t device_id)
+	{
+		size_t buffer_size, generation;
+		{
+			::std::unique_lock<::std::mutex> lock(mutex_);
+			auto& state = devices_[device_id];
+			// The least-recently used of the free buffers is the likeliest to be done
+			bounce_buffer_t* least_recently_used = nullptr;
+			for(auto& buffer : state.bounce_buffers) {
+				if (not buffer->busy and (least_recently_used == nullptr or buffer->last_used < least_recently_used->last_used)) {
+					least_recently_used = buffer.get();
+				}
+			}
+			bool ring_is_full = state.bounce_buffers.size() >= state.thresholds.num_bounce_buffers;
+			if (least_recently_used != nullptr and (ring_is_full or not least_recently_used->in_flight)) {
+				least_recently_used->busy = true;
+				lock.unlock();
+				if (least_recently_used->in_flight) {
+					cuda::synchronize(least_recently_used->done);
+					least_recently_used->in_flight = false;
+				}
+				return *least_recently_used;
+			}
+			// With all buffers held by other copies, the ring grows beyond its nominal size,
+			// rather than having copies wait for each other
+			buffer_size = state.thresholds.bounce_buffer_size;
+			generation = state.generation;
+		}
+		auto device = cuda::device::get(device_id);
+		bounce_buffer_ptr buffer { new bounce_buffer_t(
+			host::make_unique<char[]>(buffer_size), buffer_size,
+			device.create_event(event::sync_by_blocking, event::dont_record_timings), generation) };
+		auto& acquired = *buffer;
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto& state = devices_[device_id];
+		// The thresholds may have changed while allocating
+		auto& buffers = (generation == state.generation) ? state.bounce_buffers : state.retired_bounce_buffers;
+		buffers.push_back(::std::move(buffer));
+		return acquired;
+	}
+
+	/**
+	 * @param in_flight whether the buffer's event has been recorded after a transfer
+	 * using it was enqueued - so that the buffer may only be reused once the event occurs
+	 */
+	void release_bounce_buffer(cuda::device::id_t device_id, bounce_buffer_t& buffer, bool in_flight)
+	{
+		::std::vector<bounce_buffer_ptr> freed;
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto& state = devices_[device_id];
+		buffer.busy = false;
+		buffer.in_flight = in_flight;
+		buffer.last_used = ++state.num_bounce_buffer_uses;
+		free_retired_bounce_buffers(state, freed);
+	}
+
+	void bounce(void* destination, const void* source, size_t num_bytes, memory_kind_t source_kind, const stream_t& stream)
+	{
+		auto device_id = stream.device().id();
+		auto destination_ = static_cast<char*>(destination);
+		auto source_ = static_cast<const char*>(source);
+		// Buffers held by this copy, and not yet released
+		bounce_buffer_t* current = nullptr;
+		bounce_buffer_t* previous = nullptr;
+		try {
+			if (source_kind == memory_kind_t::pageable) {
+				// Host-to-device: each chunk is copied into a free pinned buffer, then transferred;
+				// the buffer is released once its event is recorded
+				for(size_t offset = 0; offset < num_bytes; ) {
+					current = &acquire_bounce_buffer(device_id);
+					auto chunk_size = ::std::min(current->size, num_bytes - offset);
+					host::parallel::copy(current->data.get(), source_ + offset, chunk_size);
+					async::detail_::copy(destination_ + offset, current->data.get(), chunk_size, stream.id());
+					stream_t(stream).enqueue.event(current->done);
+					release_bounce_buffer(device_id, *current, true);
+					current = nullptr;
+					offset += chunk_size;
+				}
+				return;
+			}
+			// Device-to-host: transferring each chunk while copying out the previous one. As
+			// with copies into pageable memory generally, the copy has concluded when this returns;
+			// and each buffer is released once its data has been copied out.
+			size_t previous_offset = 0, previous_size = 0;
+			auto copy_out_previous = [&]() {
+				if (previous == nullptr) { return; }
+				cuda::synchronize(previous->done);
+				host::parallel::copy(destination_ + previous_offset, previous->data.get(), previous_size);
+				auto copied_out = previous;
+				previous = nullptr;
+				release_bounce_buffer(device_id, *copied_out, false);
+			};
+			for(size_t offset = 0; offset < num_bytes; ) {
+				current = &acquire_bounce_buffer(device_id);
+				auto chunk_size = ::std::min(current->size, num_bytes - offset);
+				async::detail_::copy(current->data.get(), source_ + offset, chunk_size, stream.id());
+				stream_t(stream).enqueue.event(current->done);
+				copy_out_previous();
+				previous = current;
+				current = nullptr;
+				previous_offset = offset;
+				previous_size = chunk_size;
+				offset += chunk_size;
+			}
+			copy_out_previous();
+		}
+		catch(...) {
+			// Transfers involving the held buffers may have been enqueued without their events
+			// being recorded; so the buffers are only released once the stream is done with them
+			if (current != nullptr or previous != nullptr) {
+				try { stream.synchronize(); }
+				catch(...) {
+					// The buffers can't be safely reused, and are left held
+					throw;
+				}
+				if (current != nullptr) { release_bounce_buffer(device_id, *current, false); }
+				if (previous != nullptr) { release_bounce_buffer(device_id, *previous, false); }
+			}
+			throw;
+		}
+	}
+
+	void chunked(void* destination, const void* source, size_t num_bytes, const stream_t& stream)
+	{
+		auto device = stream.device();
+		::std::vector<stream_t> chunk_streams;
+		{
+			::std::lock_guard<::std::mutex> lock(mutex_);
+			auto& state = devices_[device.id()];
+			while (state.chunk_streams.size() < state.thresholds.num_chunk_streams) {
+				state.chunk_streams.push_back(device.create_stream(stream::async));
+			}
+			// Non-owning copies, for use outside the lock
+			for(const auto& chunk_stream : state.chunk_streams) { chunk_streams.emplace_back(chunk_stream); }
+		}
+		// Forking from the stream, and joining back into it, keeps the copy stream-ordered
+		auto fork = device.create_event(event::sync_by_blocking, event::dont_record_timings);
+		stream_t(stream).enqueue.event(fork);
+		auto num_chunks = chunk_streams.size();
+		auto chunk_size = (num_bytes + num_chunks - 1) / num_chunks;
+		for(size_t i = 0; i < num_chunks and i * chunk_size < num_bytes; i++) {
+			auto offset = i * chunk_size;
+			auto& chunk_stream = chunk_streams[i];
+			chunk_stream.enqueue.wait(fork);
+			async::detail_::copy(static_cast<char*>(destination) + offset, static_cast<const char*>(source) + offset,
+				::std::min(chunk_size, num_bytes - offset), chunk_stream.id());
+			auto join = device.create_event(event::sync_by_blocking, event::dont_record_timings);
+			chunk_stream.enqueue.event(join);
+			stream_t(stream).enqueue.wait(join);
+		}
+	}
+
+protected: // data members
+	mutable ::std::mutex                        mutex_;
+	::std::map<cuda::device::id_t, device_state_t>    devices_;
+	path_t                                      forced_path_ { path_t::direct };
+	bool                                        is_path_forced_ { false };
+	statistics_t                                statistics_;
+};
+
+/**
+ * The planner used by @ref stream_t::enqueue_t::copy() once planning is enabled
+ */
+inline planner_t& planner()
+{
+	static planner_t planner_;
+	return planner_;
+}
+
+struct calibration_options_t {
+	size_t repetitions        { 5 };
+	/** The largest size the microbenchmark copies; it allocates this much pinned, pageable and device memory */
+	size_t max_size           { 256 * 1024 * 1024 };
+	/** How much faster than the direct path another path must be, to be chosen */
+	double minimum_speedup    { 1.1 };
+};
+
+/**
+ * @brief Measure, on a device, at which sizes each path is faster than plain copies
+ *
+ * @note Takes on the order of a second
+ */
+inline thresholds_t calibrate(device_t device, calibration_options_t options = {})
+{
+	thresholds_t thresholds;
+	auto stream = device.create_stream(stream::async);
+	auto device_buffer = device::make_unique<char[]>(device, options.max_size);
+	auto pinned_buffer = host::make_unique<char[]>(options.max_size);
+	::std::unique_ptr<char[]> pageable_buffer { new char[options.max_size] };
+	::std::memset(pageable_buffer.get(), 0, options.max_size);
+
+	// Each path is timed on its own planner, with the path forced, so as to not
+	// affect the planner in use
+	auto seconds_per_copy = [&](path_t path, void* destination, const void* source, size_t num_bytes) {
+		planner_t timing_planner;
+		timing_planner.set_thresholds(device.id(), thresholds);
+		timing_planner.force_path(path);
+		timing_planner.copy(destination, source, num_bytes, stream);
+		stream.synchronize();
+		auto started = ::std::chrono::steady_clock::now();
+		for(size_t i = 0; i < options.repetitions; i++) {
+			timing_planner.copy(destination, source, num_bytes, stream);
+		}
+		stream.synchronize();
+		return ::std::chrono::duration<double>(::std::chrono::steady_clock::now() - started).count()
+			/ static_cast<double>(options.repetitions);
+	};
+	auto is_faster = [&](double seconds, double direct_seconds) {
+		return seconds * options.minimum_speedup < direct_seconds;
+	};
+
+	thresholds.host_store_max = 0;
+	for(size_t size = 8; size <= 64 * 1024 and size <= options.max_size; size *= 4) {
+		auto direct = seconds_per_copy(path_t::direct, pinned_buffer.get(), pageable_buffer.get(), size);
+		if (not is_faster(seconds_per_copy(path_t::host_store, pinned_buffer.get(), pageable_buffer.get(), size), direct)) { break; }
+		thresholds.host_store_max = size;
+	}
+
+	thresholds.pinned_bounce_min = never;
+	thresholds.pinned_bounce_max = 0;
+	for(size_t size = 64 * 1024; size <= options.max_size; size *= 4) {
+		auto direct = seconds_per_copy(path_t::direct, device_buffer.get(), pageable_buffer.get(), size);
+		if (is_faster(seconds_per_copy(path_t::pinned_bounce, device_buffer.get(), pageable_buffer.get(), size), direct)) {
+			thresholds.pinned_bounce_min = ::std::min(thresholds.pinned_bounce_min, size);
+			thresholds.pinned_bounce_max = size;
+		}
+	}
+	if (thresholds.pinned_bounce_min != never and thresholds.pinned_bounce_max >= options.max_size / 4) {
+		// Bouncing still won at the largest size tried; it most likely does beyond it as well
+		thresholds.pinned_bounce_max = never;
+	}
+
+	thresholds.chunked_min = never;
+	for(size_t size = 16 * 1024 * 1024; size <= options.max_size; size *= 4) {
+		auto direct = seconds_per_copy(path_t::direct, device_buffer.get(), pinned_buffer.get(), size);
+		if (is_faster(seconds_per_copy(path_t::chunked, device_buffer.get(), pinned_buffer.get(), size), direct)) {
+			thresholds.chunked_min = size;
+			break;
+		}
+	}
+	return thresholds;
+}
+
+struct options_t {
+	/** Where thresholds are persisted; empty for not persisting them at all */
+	::std::string directory { default_directory() };
+	/** Devices without persisted thresholds are calibrated; otherwise, they use the defaults */
+	bool calibrate_if_missing { true };
+	calibration_options_t calibration;
+};
+
+///@cond
+namespace detail_ {
+
+inline void planned_copy(void* destination, const void* source, size_t num_bytes, const stream_t& stream)
+{
+	planner().copy(destination, source, num_bytes, stream);
+}
+
+} // namespace detail_
+///@endcond
+
+/**
+ * @brief Have @ref stream_t::enqueue_t::copy() plan its copies, with each device's
+ * thresholds loaded from where they were persisted - or calibrated and persisted,
+ * which may take a while.
+ */
+inline void enable(const options_t& options = {})
+{
+	if (not options.directory.empty()) {
+		// Failing to persist thresholds is not an error; storing them will simply fail
+		try { cuda::detail_::file_system::create_directories(options.directory, "the copy planner's directory"); }
+		catch(::std::system_error&) { }
+	}
+	for(auto device : cuda::devices()) {
+		thresholds_t thresholds;
+		auto path = options.directory + '/' + thresholds_file_name(device);
+		if (options.directory.empty() or not load(path, thresholds)) {
+			if (options.calibrate_if_missing) {
+				thresholds = calibrate(device, options.calibration);
+				if (not options.directory.empty()) { store(path, thresholds); }
+			}
+		}
+		planner().set_thresholds(device.id(), thresholds);
+	}
+	async::detail_::copy_hook().store(&detail_::planned_copy);
+}
+
+inline void disable() { async::detail_::copy_hook().store(nullptr); }
+
+inline bool is_enabled() noexcept { return async::detail_::copy_hook().load() == &detail_::planned_copy; }
+
+/**
+ * @name Overrides
+ */
+///@{
+inline void set_thresholds(const device_t& device, const thresholds_t& thresholds)
+{
+	planner().set_thresholds(device.id(), thresholds);
+}
+
+inline void force_path(path_t path) { planner().force_path(path); }
+
+inline void clear_forced_path() { planner().clear_forced_path(); }
+///@}
+
+} // namespace copy_planning
+} // namespace memory
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_COPY_PLANNER_HPP_
@@ -0,0 +1,244 @@
+/**
+ * @file deferred_destruction.hpp
+ *
+ * @brief Taking the destruction of streams, events, arrays and device memory
+ * allocations off the threads which release them: Once deferral is enabled, the
+ * destructors of owning @ref stream_t's, @ref event_t's and @ref array_t's, and the
+ * deleter of device-memory unique pointers, only queue their handles (without locking);
+ * these are then destroyed in batches - by a background "reaper" thread, or on an
+ * explicit @ref deferred_destruction::flush() - once the work involving them has concluded.
+ *
+ * @note Deferral is opt-in; it helps latency-critical threads, for which the CUDA
+ * calls releasing resources may block on in-flight work or on driver-wide locks.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_DEFERRED_DESTRUCTION_HPP_
+#define CUDA_API_WRAPPERS_DEFERRED_DESTRUCTION_HPP_
+
+#include <cuda/api/current_device.hpp>
+#include <cuda/api/detail/deferred_destruction.hpp>
+#include <cuda/api/memory.hpp>
+
+#include <cuda_runtime_api.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cuda {
+namespace deferred_destruction {
+
+struct options_t {
+	/**
+	 * If false, deferred destructions are only carried out by @ref flush() ,
+	 * by @ref disable() , and on exit
+	 */
+	bool use_reaper_thread { true };
+	/** How often the reaper thread checks for deferred destructions */
+	::std::chrono::microseconds reaping_interval { 2000 };
+};
+
+struct statistics_t {
+	size_t deferred      { 0 };
+	size_t destroyed     { 0 };
+	/**
+	 * Destructions of streams with work still in progress, or of events yet to
+	 * occur, put off until a later batch
+	 */
+	size_t postponed     { 0 };
+	size_t batches       { 0 };
+};
+
+///@cond
+namespace detail_ {
+
+using cuda::detail_::destroyable_t;
+using cuda::detail_::destruction_request_t;
+
+class reaper_t {
+public: // getters
+	statistics_t statistics() const
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		return statistics_;
+	}
+
+public: // mutators
+	/**
+	 * @param wait_for_work if false, streams with work in progress and events yet to
+	 * occur are left for a later batch; if true, they are destroyed as well (and CUDA
+	 * releases them once their work has concluded)
+	 */
+	void reap(bool wait_for_work)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto request = cuda::detail_::deferred_destructions().exchange(nullptr, ::std::memory_order_acquire);
+		auto num_previously_postponed = postponed_.size();
+		while (request != nullptr) {
+			auto next = request->next;
+			postponed_.push_back(*request);
+			delete request;
+			request = next;
+			statistics_.deferred++;
+		}
+		// The queue is last-in, first-out; destroying in the order of deferral
+		::std::reverse(postponed_.begin() + static_cast<::std::ptrdiff_t>(num_previously_postponed), postponed_.end());
+
+		if (postponed_.empty()) { return; }
+		::std::vector<destruction_request_t> still_postponed;
+		for(const auto& request_ : postponed_) {
+			if (not wait_for_work and is_busy(request_)) {
+				still_postponed.push_back(request_);
+				statistics_.postponed++;
+				continue;
+			}
+			destroy(request_);
+			statistics_.destroyed++;
+		}
+		postponed_.swap(still_postponed);
+		statistics_.batches++;
+	}
+
+	void start(options_t options)
+	{
+		::std::lock_guard<::std::mutex> lock(thread_mutex_);
+		stop_thread();
+		if (not options.use_reaper_thread) { return; }
+		should_stop_ = false;
+		thread_ = ::std::thread([this, options]() {
+			::std::unique_lock<::std::mutex> lock(stop_mutex_);
+			while (not should_stop_) {
+				stopped_.wait_for(lock, options.reaping_interval);
+				lock.unlock();
+				reap(false);
+				lock.lock();
+			}
+		});
+	}
+
+	void stop()
+	{
+		::std::lock_guard<::std::mutex> lock(thread_mutex_);
+		stop_thread();
+	}
+
+public: // constructors and destructor
+	reaper_t() = default;
+	reaper_t(const reaper_t&) = delete;
+
+	~reaper_t()
+	{
+		stop();
+		reap(true);
+	}
+
+protected: // non-mutators
+	static bool is_busy(const destruction_request_t& request)
+	{
+		switch(request.kind) {
+		case destroyable_t::stream: {
+			device::current::detail_::scoped_override_t set_device_for_this_scope(request.device_id);
+			return cudaStreamQuery(static_cast<stream::id_t>(request.handle)) == cudaErrorNotReady;
+		}
+		case destroyable_t::event:
+			return cudaEventQuery(static_cast<event::id_t>(request.handle)) == cudaErrorNotReady;
+		default:
+			// Freeing memory and arrays synchronizes with the work using them
+			return false;
+		}
+	}
+
+protected: // mutators
+	/**
+	 * @note As with the destructors on whose behalf destruction takes place,
+	 * failures are ignored
+	 */
+	static void destroy(const destruction_request_t& request) noexcept
+	{
+		switch(request.kind) {
+		case destroyable_t::stream: {
+			device::current::detail_::scoped_override_t set_device_for_this_scope(request.device_id);
+			cudaStreamDestroy(static_cast<stream::id_t>(request.handle));
+			break;
+		}
+		case destroyable_t::event:
+			cudaEventDestroy(static_cast<event::id_t>(request.handle));
+			break;
+		case destroyable_t::array:
+			cudaFreeArray(static_cast<cudaArray_t>(request.handle));
+			break;
+		case destroyable_t::device_memory:
+			try { memory::device::free(request.handle); }
+			catch(...) { }
+			break;
+		}
+	}
+
+	void stop_thread()
+	{
+		if (not thread_.joinable()) { return; }
+		{
+			::std::lock_guard<::std::mutex> lock(stop_mutex_);
+			should_stop_ = true;
+		}
+		stopped_.notify_all();
+		thread_.join();
+	}
+
+protected: // data members
+	mutable ::std::mutex                       mutex_;
+	::std::vector<destruction_request_t>       postponed_;
+	statistics_t                               statistics_;
+
+	::std::mutex                               thread_mutex_;
+	::std::thread                              thread_;
+	::std::mutex                               stop_mutex_;
+	::std::condition_variable                  stopped_;
+	bool                                       should_stop_ { false };
+};
+
+inline reaper_t& reaper()
+{
+	static reaper_t reaper_;
+	return reaper_;
+}
+
+} // namespace detail_
+///@endcond
+
+/**
+ * @brief Carry out the deferred destructions of resources no longer involved in any work
+ */
+inline void flush() { detail_::reaper().reap(false); }
+
+/**
+ * @brief Have destructions deferred from now on
+ */
+inline void enable(options_t options = {})
+{
+	detail_::reaper().start(options);
+	cuda::detail_::destruction_is_deferred().store(true);
+}
+
+/**
+ * @brief Stop deferring destructions, and carry out all of those already deferred
+ */
+inline void disable()
+{
+	cuda::detail_::destruction_is_deferred().store(false);
+	detail_::reaper().stop();
+	detail_::reaper().reap(true);
+}
+
+inline bool is_enabled() noexcept { return cuda::detail_::destruction_is_deferred().load(); }
+
+inline statistics_t statistics() { return detail_::reaper().statistics(); }
+
+} // namespace deferred_destruction
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_DEFERRED_DESTRUCTION_HPP_
@@ -0,0 +1,70 @@
+/**
+ * @file detail/deferred_destruction.hpp
+ *
+ * @brief The lock-free queue onto which the destructors of owning wrappers push
+ * their handles, when destruction is deferred (see cuda/api/deferred_destruction.hpp)
+ * rather than carried out right away.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_DETAIL_DEFERRED_DESTRUCTION_HPP_
+#define CUDA_API_WRAPPERS_DETAIL_DEFERRED_DESTRUCTION_HPP_
+
+#include <atomic>
+#include <new>
+
+///@cond
+
+namespace cuda {
+namespace detail_ {
+
+enum class destroyable_t {
+	stream,
+	event,
+	array,
+	device_memory
+};
+
+struct destruction_request_t {
+	destroyable_t            kind;
+	void*                    handle;
+	int                      device_id;
+	destruction_request_t*   next;
+};
+
+inline ::std::atomic<bool>& destruction_is_deferred() noexcept
+{
+	static ::std::atomic<bool> is_deferred { false };
+	return is_deferred;
+}
+
+/**
+ * The most recently pushed request; each request points to the one pushed before it
+ */
+inline ::std::atomic<destruction_request_t*>& deferred_destructions() noexcept
+{
+	static ::std::atomic<destruction_request_t*> head { nullptr };
+	return head;
+}
+
+/**
+ * @return true if the destruction has been deferred; false if the caller
+ * should carry it out itself
+ */
+inline bool defer_destruction(destroyable_t kind, void* handle, int device_id) noexcept
+{
+	if (not destruction_is_deferred().load(::std::memory_order_relaxed)) { return false; }
+	auto request = new (::std::nothrow) destruction_request_t{ kind, handle, device_id, nullptr };
+	if (request == nullptr) { return false; }
+	auto& head = deferred_destructions();
+	request->next = head.load(::std::memory_order_relaxed);
+	while (not head.compare_exchange_weak(request->next, request,
+		::std::memory_order_release, ::std::memory_order_relaxed)) { }
+	return true;
+}
+
+} // namespace detail_
+} // namespace cuda
+
+///@endcond
+
+#endif // CUDA_API_WRAPPERS_DETAIL_DEFERRED_DESTRUCTION_HPP_
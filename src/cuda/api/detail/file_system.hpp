@@ -0,0 +1,129 @@
+/**
+ * @file detail/file_system.hpp
+ *
+ * @brief The few process and file-system facilities the library's own log and
+ * settings files require, for both POSIX systems and Windows - so that headers
+ * included by the core wrappers do not depend on POSIX-only headers.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_DETAIL_FILE_SYSTEM_HPP_
+#define CUDA_API_WRAPPERS_DETAIL_FILE_SYSTEM_HPP_
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+///@cond
+
+namespace cuda {
+namespace detail_ {
+namespace file_system {
+
+inline uint64_t process_id() noexcept
+{
+#if defined(_WIN32)
+	return static_cast<uint64_t>(::_getpid());
+#else
+	return static_cast<uint64_t>(::getpid());
+#endif
+}
+
+/**
+ * @return the name of the host, or an empty string if it can't be determined
+ */
+inline ::std::string host_name()
+{
+#if defined(_WIN32)
+	auto name = ::std::getenv("COMPUTERNAME");
+	return (name == nullptr) ? ::std::string{} : ::std::string{name};
+#else
+	char name[256] = { };
+	::gethostname(name, sizeof(name) - 1);
+	return name;
+#endif
+}
+
+/**
+ * @return true if the directory was created or already exists; otherwise,
+ * errno indicates the failure
+ */
+inline bool make_directory(const ::std::string& path) noexcept
+{
+#if defined(_WIN32)
+	return ::_mkdir(path.c_str()) == 0 or errno == EEXIST;
+#else
+	return ::mkdir(path.c_str(), 0755) == 0 or errno == EEXIST;
+#endif
+}
+
+/**
+ * Creates a directory, along with any of its parents which are missing
+ *
+ * @param what describes the directory, for the exception thrown on failure
+ */
+inline void create_directories(const ::std::string& path, const ::std::string& what)
+{
+	// Failing to create a parent (e.g. a drive, or an existing directory which
+	// may not be listed) only matters if creating the directory itself then fails
+	for(auto pos = path.find_first_of("/\\", 1); pos != ::std::string::npos; pos = path.find_first_of("/\\", pos + 1)) {
+		make_directory(path.substr(0, pos));
+	}
+	if (not make_directory(path)) {
+		throw ::std::system_error(errno, ::std::system_category(), "Failed creating " + what + ' ' + path);
+	}
+}
+
+/**
+ * @param[out] names the names of the directory's entries
+ * @return false if the directory can't be read
+ */
+inline bool list_directory(const ::std::string& path, ::std::vector<::std::string>& names)
+{
+	names.clear();
+#if defined(_WIN32)
+	::_finddata_t entry;
+	auto handle = ::_findfirst((path + "/*").c_str(), &entry);
+	if (handle == -1) { return false; }
+	do { names.emplace_back(entry.name); } while (::_findnext(handle, &entry) == 0);
+	::_findclose(handle);
+#else
+	auto dir = ::opendir(path.c_str());
+	if (dir == nullptr) { return false; }
+	while (auto entry = ::readdir(dir)) { names.emplace_back(entry->d_name); }
+	::closedir(dir);
+#endif
+	return true;
+}
+
+/**
+ * @return a name for a temporary file alongside @p path, unique among all threads of
+ * all processes - so that concurrent writers of @p path never share a temporary file
+ */
+inline ::std::string unique_temporary_path(const ::std::string& path)
+{
+	static ::std::atomic<uint64_t> num_generated { 0 };
+	return path + ".tmp." + ::std::to_string(process_id()) + '.' + ::std::to_string(num_generated++);
+}
+
+} // namespace file_system
+} // namespace detail_
+} // namespace cuda
+
+///@endcond
+
+#endif // CUDA_API_WRAPPERS_DETAIL_FILE_SYSTEM_HPP_
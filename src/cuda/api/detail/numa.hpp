@@ -0,0 +1,182 @@
+/**
+ * @file detail/numa.hpp
+ *
+ * @brief Host NUMA topology discovery (from Linux sysfs), CPU list parsing,
+ * and thread-to-CPU binding, for the library's multi-threaded host-side utilities.
+ *
+ * @note On platforms other than Linux, the topology appears to consist of a single
+ * node, and binding threads has no effect.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_DETAIL_NUMA_HPP_
+#define CUDA_API_WRAPPERS_DETAIL_NUMA_HPP_
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+///@cond
+
+namespace cuda {
+namespace detail_ {
+namespace numa {
+
+using cpu_list_t = ::std::vector<unsigned>;
+
+struct node_t {
+	int         id;
+	cpu_list_t  cpus;
+};
+
+/**
+ * Parses the kernel's CPU list format, e.g. "0-3,8,10-11" (possibly with
+ * a trailing newline); the result is sorted and free of duplicates.
+ */
+inline cpu_list_t parse_cpu_list(const ::std::string& list)
+{
+	cpu_list_t cpus;
+	::std::istringstream stream(list);
+	::std::string range;
+	while (::std::getline(stream, range, ',')) {
+		range.erase(::std::remove_if(range.begin(), range.end(), [](char c) { return ::std::isspace(c); }), range.end());
+		if (range.empty()) { continue; }
+		auto dash_pos = range.find('-');
+		try {
+			size_t num_parsed;
+			auto first = ::std::stoul(range.substr(0, dash_pos), &num_parsed);
+			if (num_parsed != (dash_pos == ::std::string::npos ? range.size() : dash_pos)) { throw ::std::invalid_argument(""); }
+			auto last = first;
+			if (dash_pos != ::std::string::npos) {
+				last = ::std::stoul(range.substr(dash_pos + 1), &num_parsed);
+				if (num_parsed != range.size() - dash_pos - 1 or last < first) { throw ::std::invalid_argument(""); }
+			}
+			for(auto cpu = first; cpu <= last; cpu++) { cpus.push_back(static_cast<unsigned>(cpu)); }
+		}
+		catch(::std::logic_error&) {
+			throw ::std::invalid_argument("Invalid CPU list entry \"" + range + "\"");
+		}
+	}
+	::std::sort(cpus.begin(), cpus.end());
+	cpus.erase(::std::unique(cpus.begin(), cpus.end()), cpus.end());
+	return cpus;
+}
+
+/**
+ * @return the file's entire contents, or an empty string if it can't be read
+ */
+inline ::std::string read_file(const ::std::string& path)
+{
+	::std::ifstream file(path);
+	if (not file) { return {}; }
+	return ::std::string(::std::istreambuf_iterator<char>(file), ::std::istreambuf_iterator<char>());
+}
+
+constexpr const char* default_sysfs_node_directory = "/sys/devices/system/node";
+
+/**
+ * Lists the host's NUMA nodes, and the CPUs of each.
+ *
+ * @param sysfs_node_directory where to look for the `nodeN/cpulist` files; may
+ * be overridden, e.g. with a directory of test fixtures
+ * @return the nodes with at least one CPU, sorted by ID; empty if the information
+ * is unavailable
+ */
+inline ::std::vector<node_t> nodes(const ::std::string& sysfs_node_directory = default_sysfs_node_directory)
+{
+	::std::vector<node_t> result;
+#if defined(__linux__)
+	auto dir = opendir(sysfs_node_directory.c_str());
+	if (dir == nullptr) { return result; }
+	while (auto entry = readdir(dir)) {
+		::std::string name { entry->d_name };
+		if (name.compare(0, 4, "node") != 0 or name.size() == 4
+			or name.find_first_not_of("0123456789", 4) != ::std::string::npos) { continue; }
+		auto cpu_list = read_file(sysfs_node_directory + '/' + name + "/cpulist");
+		node_t node { ::std::stoi(name.substr(4)), {} };
+		try { node.cpus = parse_cpu_list(cpu_list); }
+		catch(::std::invalid_argument&) { continue; }
+		if (not node.cpus.empty()) { result.push_back(::std::move(node)); }
+	}
+	closedir(dir);
+	::std::sort(result.begin(), result.end(), [](const node_t& lhs, const node_t& rhs) { return lhs.id < rhs.id; });
+#else
+	(void) sysfs_node_directory;
+#endif
+	return result;
+}
+
+/**
+ * Restricts the calling thread to run only on those of the specified CPUs
+ * which it may already run on - so that restrictions imposed on the process
+ * (e.g. by `taskset`, or by a container's CPU set) are respected
+ *
+ * @return true on success; false if unsupported, or if none of the CPUs is usable
+ * (in which case the thread's affinity is left unchanged)
+ */
+inline bool bind_this_thread(const cpu_list_t& cpus) noexcept
+{
+#if defined(__linux__)
+	if (cpus.empty()) { return false; }
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed) != 0) { return false; }
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	for(auto cpu : cpus) {
+		if (cpu < CPU_SETSIZE and CPU_ISSET(cpu, &allowed)) { CPU_SET(cpu, &cpu_set); }
+	}
+	if (CPU_COUNT(&cpu_set) == 0) { return false; }
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+	(void) cpus;
+	return false;
+#endif
+}
+
+enum : int { unknown_node = -1 };
+
+/**
+ * Determines the NUMA node on which each of a sequence of addresses' pages resides
+ *
+ * @param node_ids filled with node IDs, or @ref unknown_node for pages which
+ * are not (yet) backed by physical memory, or if the information is unavailable
+ */
+inline void nodes_of(const void* const* addresses, size_t num_addresses, int* node_ids)
+{
+	::std::fill_n(node_ids, num_addresses, static_cast<int>(unknown_node));
+#if defined(__linux__) && defined(SYS_move_pages)
+	// With no target nodes, move_pages() only reports where pages currently reside
+	::std::vector<int> status(num_addresses);
+	auto result = syscall(SYS_move_pages, 0, num_addresses, const_cast<const void**>(addresses),
+		nullptr, status.data(), 0);
+	if (result != 0) { return; }
+	for(size_t i = 0; i < num_addresses; i++) {
+		if (status[i] >= 0) { node_ids[i] = status[i]; }
+	}
+#else
+	(void) addresses;
+#endif
+}
+
+} // namespace numa
+} // namespace detail_
+} // namespace cuda
+
+///@endcond
+
+#endif // CUDA_API_WRAPPERS_DETAIL_NUMA_HPP_
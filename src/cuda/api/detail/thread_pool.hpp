@@ -0,0 +1,199 @@
+/**
+ * @file detail/thread_pool.hpp
+ *
+ * @brief A simple pool of host threads, used by the library's host-side
+ * utilities which parallelize work (e.g. packing data for staging).
+ *
+ * @note No thread is started unless such a utility is actually used.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_DETAIL_THREAD_POOL_HPP_
+#define CUDA_API_WRAPPERS_DETAIL_THREAD_POOL_HPP_
+
+#include <cuda/api/detail/numa.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+///@cond
+
+namespace cuda {
+namespace detail_ {
+
+class thread_pool_t {
+public: // types
+	using task_t = ::std::function<void()>;
+
+public: // getters
+	size_t size() const noexcept { return threads_.size(); }
+
+	static size_t default_size() noexcept
+	{
+		auto num_hardware_threads = ::std::thread::hardware_concurrency();
+		return num_hardware_threads == 0 ? 1 : num_hardware_threads;
+	}
+
+public: // mutators
+
+	/**
+	 * Schedule a function for execution on one of the pool's threads
+	 *
+	 * @return a future for the function's result (or exception)
+	 */
+	template <typename F>
+	::std::future<typename ::std::result_of<F()>::type> submit(F f)
+	{
+		using result_type = typename ::std::result_of<F()>::type;
+		auto packaged = ::std::make_shared<::std::packaged_task<result_type()>>(::std::move(f));
+		auto result = packaged->get_future();
+		enqueue([packaged]() { (*packaged)(); });
+		return result;
+	}
+
+	/**
+	 * Invoke @p f(i) for every i in [0, num_tasks), using the pool's threads as
+	 * well as the calling thread; returns once all invocations have concluded.
+	 *
+	 * @note If any of the invocations throws, one of the exceptions is rethrown
+	 * (after all invocations have concluded or been skipped).
+	 */
+	template <typename F>
+	void parallel_for(size_t num_tasks, F f)
+	{
+		if (num_tasks == 0) { return; }
+		if (num_tasks == 1 or size() == 0 or on_pool_thread()) {
+			for(size_t i = 0; i < num_tasks; i++) { f(i); }
+			return;
+		}
+		struct shared_state_t {
+			::std::atomic<size_t>      next_task { 0 };
+			::std::atomic<bool>        failed { false };
+			::std::exception_ptr       exception;
+			::std::mutex               mutex;
+			::std::condition_variable  all_done;
+			size_t                     num_running_helpers { 0 };
+		};
+		auto state = ::std::make_shared<shared_state_t>();
+		auto work = [state, num_tasks, &f]() {
+			for(auto i = state->next_task++; i < num_tasks; i = state->next_task++) {
+				if (state->failed) { continue; }
+				try { f(i); }
+				catch(...) {
+					::std::lock_guard<::std::mutex> lock(state->mutex);
+					if (not state->failed.exchange(true)) { state->exception = ::std::current_exception(); }
+				}
+			}
+		};
+		auto num_helpers = ::std::min(size(), num_tasks - 1);
+		state->num_running_helpers = num_helpers;
+		for(size_t i = 0; i < num_helpers; i++) {
+			enqueue([state, work]() {
+				work();
+				::std::lock_guard<::std::mutex> lock(state->mutex);
+				if (--state->num_running_helpers == 0) { state->all_done.notify_one(); }
+			});
+		}
+		work();
+		::std::unique_lock<::std::mutex> lock(state->mutex);
+		state->all_done.wait(lock, [&state] { return state->num_running_helpers == 0; });
+		if (state->exception) { ::std::rethrow_exception(state->exception); }
+	}
+
+protected:
+	void enqueue(task_t task)
+	{
+		{
+			::std::lock_guard<::std::mutex> lock(mutex_);
+			tasks_.emplace_back(::std::move(task));
+		}
+		task_available_.notify_one();
+	}
+
+	static bool& is_pool_thread() noexcept
+	{
+		static thread_local bool is_pool_thread_ { false };
+		return is_pool_thread_;
+	}
+
+	// Tasks running on the pool don't wait for other tasks, to avoid deadlocks
+	static bool on_pool_thread() noexcept { return is_pool_thread(); }
+
+	void worker_loop(const numa::cpu_list_t& cpus)
+	{
+		is_pool_thread() = true;
+		if (not cpus.empty()) { numa::bind_this_thread(cpus); }
+		while(true) {
+			task_t task;
+			{
+				::std::unique_lock<::std::mutex> lock(mutex_);
+				task_available_.wait(lock, [this] { return stopping_ or not tasks_.empty(); });
+				if (tasks_.empty()) { return; }
+				task = ::std::move(tasks_.front());
+				tasks_.pop_front();
+			}
+			task();
+		}
+	}
+
+public: // constructors and destructor
+	/**
+	 * @param cpus if non-empty, the pool's threads are bound to these CPUs
+	 * (e.g. those close to the device the pool's work is for)
+	 */
+	explicit thread_pool_t(size_t num_threads = default_size(), numa::cpu_list_t cpus = {})
+	{
+		threads_.reserve(num_threads);
+		for(size_t i = 0; i < num_threads; i++) {
+			threads_.emplace_back([this, cpus] { worker_loop(cpus); });
+		}
+	}
+
+	thread_pool_t(const thread_pool_t&) = delete;
+
+	~thread_pool_t()
+	{
+		{
+			::std::lock_guard<::std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		task_available_.notify_all();
+		for(auto& thread : threads_) { thread.join(); }
+	}
+
+public: // operators
+	thread_pool_t& operator=(const thread_pool_t&) = delete;
+
+protected: // data members
+	::std::vector<::std::thread>  threads_;
+	::std::deque<task_t>          tasks_;
+	::std::mutex                  mutex_;
+	::std::condition_variable     task_available_;
+	bool                          stopping_ { false };
+};
+
+/**
+ * The pool used by the library's own parallelized host-side utilities;
+ * created on first use.
+ */
+inline thread_pool_t& default_thread_pool()
+{
+	static thread_pool_t pool;
+	return pool;
+}
+
+} // namespace detail_
+} // namespace cuda
+
+///@endcond
+
+#endif // CUDA_API_WRAPPERS_DETAIL_THREAD_POOL_HPP_
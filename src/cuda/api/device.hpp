@@ -13,6 +13,7 @@
 #include <cuda/api/device_properties.hpp>
 #include <cuda/api/memory.hpp>
 #include <cuda/api/pci_id.hpp>
+#include <cuda/api/recording.hpp>
 #include <cuda/common/types.hpp>
 
 #include <cuda_runtime_api.h>
@@ -389,10 +390,7 @@ public:
 	 */
 	device::pci_location_t pci_id() const
 	{
-		auto pci_domain_id = get_attribute(cudaDevAttrPciDomainId);
-		auto pci_bus_id = get_attribute(cudaDevAttrPciBusId);
-		auto pci_device_id = get_attribute(cudaDevAttrPciDeviceId);
-		return {pci_domain_id, pci_bus_id, pci_device_id};
+		return device::detail_::pci_table().location_of(id_);
 	}
 
 	/**
@@ -798,8 +796,11 @@ inline void synchronize(device_t& device)
 {
 	auto device_id = device.id();
 	device::current::detail_::scoped_override_t set_device_for_this_scope(device_id);
+	auto recording_start = recording::detail_::begin();
 	auto status = cudaDeviceSynchronize();
 	throw_if_error(status, "Failed synchronizing " + ::std::to_string(device_id));
+	recording::detail_::end(recording_start, recording::detail_::make_record(
+		recording::operation_t::synchronize_device, nullptr, nullptr, nullptr, nullptr, 0, device_id));
 }
 
 
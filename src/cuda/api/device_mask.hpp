@@ -0,0 +1,148 @@
+/**
+ * @file device_mask.hpp
+ *
+ * @brief A process-wide logical view of the system's CUDA devices, which hides
+ * and/or reorders them by their PCI location - much like the `CUDA_VISIBLE_DEVICES`
+ * environment variable, but settable (and changeable) at any time by the program
+ * itself, e.g. to pin a job to some of the GPUs.
+ *
+ * @note The mask does not affect the CUDA runtime, nor device ids: a device's
+ * id remains its runtime ordinal. It determines which devices the @ref cuda::devices()
+ * range, and queries on it, consist of, and in what order.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_DEVICE_MASK_HPP_
+#define CUDA_API_WRAPPERS_DEVICE_MASK_HPP_
+
+#include <cuda/api/miscellany.hpp>
+#include <cuda/api/pci_id.hpp>
+
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cuda {
+namespace device {
+
+/**
+ * Device ids, in the order of a logical view of the devices
+ */
+using id_list_t = ::std::shared_ptr<const ::std::vector<id_t>>;
+
+///@cond
+namespace detail_ {
+
+class visibility_mask_t {
+public:
+	id_list_t get()
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		if (not visible_) { visible_ = all(); }
+		return visible_;
+	}
+
+	void set(id_list_t visible)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		visible_ = ::std::move(visible);
+		is_set_ = true;
+	}
+
+	void clear()
+	{
+		auto unmasked = all();
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		visible_ = unmasked;
+		is_set_ = false;
+	}
+
+	bool is_set()
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		return is_set_;
+	}
+
+protected:
+	static id_list_t all()
+	{
+		::std::vector<id_t> ids(static_cast<size_t>(device::count()));
+		for(size_t i = 0; i < ids.size(); i++) { ids[i] = static_cast<id_t>(i); }
+		return ::std::make_shared<const ::std::vector<id_t>>(::std::move(ids));
+	}
+
+	::std::mutex  mutex_;
+	id_list_t     visible_;
+	bool          is_set_ { false };
+};
+
+inline visibility_mask_t& visibility_mask()
+{
+	static visibility_mask_t mask;
+	return mask;
+}
+
+} // namespace detail_
+///@endcond
+
+namespace mask {
+
+/**
+ * @brief Make only the devices at the specified PCI locations visible, in the specified order
+ *
+ * @throws cuda::runtime_error if there is no device at one of the locations
+ * @throws ::std::invalid_argument if a device is listed more than once
+ */
+inline void set(const ::std::vector<pci_location_t>& visible_devices)
+{
+	::std::vector<id_t> ids;
+	ids.reserve(visible_devices.size());
+	for(const auto& pci_id : visible_devices) {
+		auto device_id = detail_::resolve_id(pci_id);
+		for(auto listed_id : ids) {
+			if (listed_id == device_id) {
+				throw ::std::invalid_argument("CUDA device " + ::std::to_string(device_id)
+					+ " is listed more than once in a device mask");
+			}
+		}
+		ids.push_back(device_id);
+	}
+	detail_::visibility_mask().set(::std::make_shared<const ::std::vector<id_t>>(::std::move(ids)));
+}
+
+/**
+ * @brief Make all devices visible again, in the order of their ids
+ */
+inline void clear() { detail_::visibility_mask().clear(); }
+
+/**
+ * @return true if a mask has been set (and not cleared since)
+ */
+inline bool is_set() { return detail_::visibility_mask().is_set(); }
+
+/**
+ * @return the ids of the visible devices, in their logical order
+ */
+inline id_list_t visible_ids() { return detail_::visibility_mask().get(); }
+
+/**
+ * @return the position of a device in the logical order, or -1 if it is hidden
+ */
+inline int logical_index(id_t device_id)
+{
+	auto visible = visible_ids();
+	for(size_t i = 0; i < visible->size(); i++) {
+		if ((*visible)[i] == device_id) { return static_cast<int>(i); }
+	}
+	return -1;
+}
+
+inline bool is_visible(id_t device_id) { return logical_index(device_id) >= 0; }
+
+} // namespace mask
+
+} // namespace device
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_DEVICE_MASK_HPP_
@@ -8,14 +8,273 @@
 #define CUDA_API_WRAPPERS_DEVICES_HPP_
 
 #include <cuda/api/device.hpp>
+#include <cuda/api/device_mask.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace cuda {
 
+namespace device {
+
+/**
+ * @brief A record of a device's properties, and of its (changing) state at some
+ * point in time - so that choosing among devices need not involve any runtime calls.
+ */
+struct snapshot_t {
+	id_t                                   id;
+	properties_t                           properties;
+	size_t                                 free_memory;
+	/**
+	 * When the device's state (e.g. its free memory) was recorded
+	 */
+	::std::chrono::steady_clock::time_point taken_at;
+
+	/**
+	 * @return false for the entries of devices which have not been snapshotted
+	 * (e.g. devices hidden by the device mask)
+	 */
+	bool is_taken() const noexcept { return taken_at != ::std::chrono::steady_clock::time_point{}; }
+
+	compute_capability_t compute_capability() const noexcept { return properties.compute_capability(); }
+	size_t total_memory() const noexcept { return properties.global_memory_size(); }
+	bool supports_managed_memory() const noexcept { return properties.managedMemory != 0; }
+	device_t device() const noexcept { return device::get(id); }
+};
+
+using snapshots_t = ::std::shared_ptr<const ::std::vector<snapshot_t>>;
+
+///@cond
 namespace detail_ {
 
+inline snapshot_t take_snapshot(id_t device_id, const properties_t& properties)
+{
+	return { device_id, properties, device::get(device_id).memory().amount_free(), ::std::chrono::steady_clock::now() };
+}
+
+inline snapshot_t take_snapshot(id_t device_id)
+{
+	return take_snapshot(device_id, device::get(device_id).properties());
+}
+
+/**
+ * Snapshots are taken lazily, per device: Snapshotting a device creates its
+ * primary context, which must not happen for devices which are never used -
+ * e.g. those hidden by the device mask, which may be in use by other jobs
+ */
+class snapshot_table_t {
+public:
+	snapshots_t get(const ::std::vector<id_t>& device_ids)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		if (not covers(snapshots_, device_ids)) { snapshots_ = take(snapshots_, device_ids, false); }
+		return snapshots_;
+	}
+
+	snapshots_t refresh(const ::std::vector<id_t>& device_ids)
+	{
+		auto previous = get(device_ids);
+		// Taking the snapshots outside the lock lets readers proceed meanwhile
+		auto refreshed = take(previous, device_ids, true);
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		// Other devices may have been snapshotted in the mean time
+		auto merged = *snapshots_;
+		for(auto device_id : device_ids) { merged[device_id] = (*refreshed)[device_id]; }
+		snapshots_ = ::std::make_shared<const ::std::vector<snapshot_t>>(::std::move(merged));
+		return snapshots_;
+	}
+
+protected:
+	static bool covers(const snapshots_t& snapshots, const ::std::vector<id_t>& device_ids) noexcept
+	{
+		if (not snapshots) { return false; }
+		for(auto device_id : device_ids) {
+			if (not (*snapshots)[device_id].is_taken()) { return false; }
+		}
+		return true;
+	}
+
+	static snapshots_t take(const snapshots_t& previous, const ::std::vector<id_t>& device_ids, bool retake)
+	{
+		auto snapshots = previous ? *previous : ::std::vector<snapshot_t>(static_cast<size_t>(device::count()));
+		for(auto device_id : device_ids) {
+			auto& snapshot = snapshots[device_id];
+			if (snapshot.is_taken() and not retake) { continue; }
+			// A device's properties never change, so they need only be obtained once
+			snapshot = snapshot.is_taken() ?
+				take_snapshot(device_id, snapshot.properties) : take_snapshot(device_id);
+		}
+		return ::std::make_shared<const ::std::vector<snapshot_t>>(::std::move(snapshots));
+	}
+
+	::std::mutex  mutex_;
+	snapshots_t   snapshots_;
+};
+
+inline snapshot_table_t& snapshot_table()
+{
+	static snapshot_table_t table;
+	return table;
+}
+
+} // namespace detail_
+///@endcond
+
+/**
+ * @brief Obtain the cached snapshots of the specified devices, within a table
+ * of all devices on the system indexed by device id.
+ *
+ * @note A device's first snapshot involves creating its context (to determine
+ * its free memory); later calls make no runtime calls at all. Entries of devices
+ * not snapshotted yet are not valid (see @ref snapshot_t::is_taken()).
+ */
+inline snapshots_t snapshots(const ::std::vector<id_t>& device_ids)
+{
+	return detail_::snapshot_table().get(device_ids);
+}
+
+/**
+ * @brief Obtain the cached snapshots of the devices visible through the device mask
+ * (i.e. of all devices, if no mask is set), indexed by device id.
+ */
+inline snapshots_t snapshots() { return snapshots(*mask::visible_ids()); }
+
+/**
+ * @brief Re-take the snapshots of the specified devices, e.g. periodically or
+ * after large allocations, so that later queries reflect their current state
+ */
+inline snapshots_t refresh_snapshots(const ::std::vector<id_t>& device_ids)
+{
+	return detail_::snapshot_table().refresh(device_ids);
+}
+
+/**
+ * @brief Re-take the snapshots of the devices visible through the device mask
+ */
+inline snapshots_t refresh_snapshots() { return refresh_snapshots(*mask::visible_ids()); }
+
+} // namespace device
+
+namespace detail_ {
+
+/**
+ * @brief A subset of the system's devices, in some order - based on a single
+ * set of cached device snapshots.
+ */
+class device_selection_t {
+public: // types
+	class const_iterator {
+	public:
+		using difference_type = ::std::ptrdiff_t;
+		using value_type = device::snapshot_t;
+		using pointer = const value_type*;
+		using reference = const value_type&;
+		using iterator_category = ::std::random_access_iterator_tag;
+
+		const_iterator(const device::snapshots_t& snapshots, ::std::vector<device::id_t>::const_iterator position) :
+			snapshots_(&snapshots), position_(position) { }
+
+		reference operator*() const { return (**snapshots_)[*position_]; }
+		pointer operator->() const { return &**this; }
+		const_iterator& operator++() { ++position_; return *this; }
+		const_iterator operator++(int) { auto previous = *this; ++position_; return previous; }
+		bool operator==(const const_iterator& other) const { return position_ == other.position_; }
+		bool operator!=(const const_iterator& other) const { return position_ != other.position_; }
+
+	protected:
+		const device::snapshots_t*                   snapshots_;
+		::std::vector<device::id_t>::const_iterator  position_;
+	};
+
+public: // getters
+	size_t size() const noexcept { return ids_.size(); }
+	bool empty() const noexcept { return ids_.empty(); }
+	const ::std::vector<device::id_t>& ids() const noexcept { return ids_; }
+	const device::snapshots_t& snapshots() const noexcept { return snapshots_; }
+
+	const_iterator begin() const { return const_iterator(snapshots_, ids_.cbegin()); }
+	const_iterator end() const { return const_iterator(snapshots_, ids_.cend()); }
+
+	const device::snapshot_t& operator[](size_t n) const { return (*snapshots_)[ids_[n]]; }
+
+	const device::snapshot_t& front() const
+	{
+		if (empty()) { throw ::std::out_of_range("No device matches the selection criteria"); }
+		return (*this)[0];
+	}
+
+	::std::vector<device_t> devices() const
+	{
+		::std::vector<device_t> result;
+		result.reserve(ids_.size());
+		for(auto id : ids_) { result.push_back(device::get(id)); }
+		return result;
+	}
+
+public: // non-mutators
+
+	/**
+	 * @return the selected devices satisfying @p predicate, which takes a
+	 * `const device::snapshot_t&`
+	 */
+	template <typename Predicate>
+	device_selection_t where(Predicate predicate) const
+	{
+		::std::vector<device::id_t> ids;
+		for(auto id : ids_) {
+			if (predicate((*snapshots_)[id])) { ids.push_back(id); }
+		}
+		return { snapshots_, ::std::move(ids) };
+	}
+
+	/**
+	 * @return the selected devices which have (at least) the specified capabilities
+	 * and amount of free memory (as of when the snapshots were taken)
+	 */
+	device_selection_t where(
+		device::compute_capability_t  min_compute_capability,
+		size_t                        min_free_memory = 0,
+		bool                          must_support_managed_memory = false) const
+	{
+		return where([&](const device::snapshot_t& snapshot) {
+			return not (snapshot.compute_capability() < min_compute_capability)
+				and snapshot.free_memory >= min_free_memory
+				and (snapshot.supports_managed_memory() or not must_support_managed_memory);
+		});
+	}
+
+	/**
+	 * @return the selected devices, (stably) sorted by @p less, a comparator of
+	 * `const device::snapshot_t&`'s - e.g. for most free memory first:
+	 * `[](const snapshot_t& lhs, const snapshot_t& rhs) { return lhs.free_memory > rhs.free_memory; }`
+	 */
+	template <typename Compare>
+	device_selection_t sorted_by(Compare less) const
+	{
+		auto ids = ids_;
+		const auto& snapshots = *snapshots_;
+		::std::stable_sort(ids.begin(), ids.end(), [&](device::id_t lhs, device::id_t rhs) {
+			return less(snapshots[lhs], snapshots[rhs]);
+		});
+		return { snapshots_, ::std::move(ids) };
+	}
+
+public: // constructors
+	device_selection_t(device::snapshots_t snapshots, ::std::vector<device::id_t> ids) :
+		snapshots_(::std::move(snapshots)), ids_(::std::move(ids)) { }
+
+protected: // data members
+	device::snapshots_t          snapshots_;
+	::std::vector<device::id_t>  ids_;
+};
+
 // Note that while nothing constrains you from instantiating
 // this class many times, all instances are the same (as CUDA
-// devices aren't hot-pluggable).
+// devices aren't hot-pluggable) - unless the device mask is
+// changed in between (see @ref device::mask::set()).
 class all_devices {
 public:
 	using value_type = cuda::device_t;
@@ -39,18 +298,20 @@ public:
 
 		// something about the traits
 
-		index_based_iterator(size_type num_devices, size_type index)
-			: num_devices_(num_devices), index_(index)
+		// Note: @p ids maps indices to device ids; if it is null, they're the same
+
+		index_based_iterator(size_type num_devices, size_type index, const device::id_t* ids = nullptr)
+			: num_devices_(num_devices), index_(index), ids_(ids)
 		{
 			if (index_ > num_devices_) { throw ::std::logic_error("Out of range"); }
 		}
 
 		index_based_iterator(const index_based_iterator& it)
-			: index_based_iterator(it.num_devices_, it.index_) { }
+			: index_based_iterator(it.num_devices_, it.index_, it.ids_) { }
 
 		// Forward iterator requirements
 
-		reference operator*() const { return device::get(index_); }
+		reference operator*() const { return device::get(device_id(index_)); }
 
 		index_based_iterator&  operator++()
 		{
@@ -62,7 +323,7 @@ public:
 		index_based_iterator operator++(int)
 		{
 			if (index_== num_devices_) { throw ::std::logic_error("Out of range"); }
-			return index_based_iterator(num_devices_, index_++);
+			return index_based_iterator(num_devices_, index_++, ids_);
 		}
 
 		// Bidirectional iterator requirements
@@ -76,13 +337,13 @@ public:
 		index_based_iterator operator--(int)
 		{
 			if (index_ == 0) { throw ::std::logic_error("Out of range"); }
-			return index_based_iterator(num_devices_, index_--);
+			return index_based_iterator(num_devices_, index_--, ids_);
 		}
 
 		// Random access iterator requirements
 		reference operator[](difference_type n) const
 		{
-			return device::get(index_ + n);
+			return device::get(device_id(index_ + n));
 		}
 
 		index_based_iterator& operator+=(difference_type n)
@@ -97,7 +358,7 @@ public:
 			if (n + index_ > num_devices_) {
 				throw ::std::logic_error("Out of range");
 			}
-			return index_based_iterator(num_devices_, index_ + n);
+			return index_based_iterator(num_devices_, index_ + n, ids_);
 		}
 
 		index_based_iterator& operator-=(difference_type n)
@@ -114,15 +375,18 @@ public:
 			if (n > index_) {
 				throw ::std::logic_error("Out of range");
 			}
-			return index_based_iterator(num_devices_, index_ - n);
+			return index_based_iterator(num_devices_, index_ - n, ids_);
 		}
 
 		size_type index() const { return index_; }
 		size_type num_devices() const { return num_devices_; }
 
 	protected:
+		device::id_t device_id(size_type index) const noexcept { return ids_ == nullptr ? index : ids_[index]; }
+
 		size_type num_devices_;
 		size_type index_;
+		const device::id_t* ids_;
 	}; // class index_based_iterator
 
 	using iterator = index_based_iterator;
@@ -131,28 +395,34 @@ public:
 	using const_reverse_iterator = ::std::reverse_iterator<const_iterator>;
 
 
-	all_devices() : num_devices_(device::count()) { }
+	all_devices() :
+		visible_(device::mask::visible_ids()),
+		num_devices_(static_cast<size_type>(visible_->size())) { }
 	~all_devices() = default;
 	all_devices(const all_devices&) = default;
 	all_devices(all_devices&&) = default;
-	all_devices& operator=(const all_devices&) { return *this; };
-	all_devices& operator=(all_devices&&) { return *this; };
+	all_devices& operator=(const all_devices&) = default;
+	all_devices& operator=(all_devices&&) = default;
 
 	// void fill(const value_type& u);
-	void swap(all_devices&) noexcept { } // all instances are basically the same
+	void swap(all_devices& other) noexcept
+	{
+		::std::swap(visible_, other.visible_);
+		::std::swap(num_devices_, other.num_devices_);
+	}
 
 	// Iterators
 
-	iterator begin() noexcept { return iterator(num_devices_, 0); }
-	const_iterator begin() const noexcept { return const_iterator(num_devices_, 0); }
-	iterator end() noexcept { return iterator(num_devices_, num_devices_); }
-	const_iterator end() const noexcept { return const_iterator(num_devices_, num_devices_); }
+	iterator begin() noexcept { return iterator(num_devices_, 0, visible_->data()); }
+	const_iterator begin() const noexcept { return const_iterator(num_devices_, 0, visible_->data()); }
+	iterator end() noexcept { return iterator(num_devices_, num_devices_, visible_->data()); }
+	const_iterator end() const noexcept { return const_iterator(num_devices_, num_devices_, visible_->data()); }
 	reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
 	const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
 	reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
 	const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
-	const_iterator cbegin() const noexcept	{ return const_iterator(num_devices_, 0); }
-	const_iterator cend() const noexcept { return const_iterator(num_devices_, num_devices_); }
+	const_iterator cbegin() const noexcept	{ return begin(); }
+	const_iterator cend() const noexcept { return end(); }
 	const_reverse_iterator crbegin() const noexcept { return const_reverse_iterator(end()); }
 	const_reverse_iterator crend() const noexcept { return const_reverse_iterator(begin()); }
 
@@ -167,8 +437,8 @@ public:
 	// reference at(size_type n);
 	const_reference at(size_type n) const
 	{
-		// Note; this getter will throw if the device index is out-of-range
-		return device::get(n);
+		if (n < 0 or n >= num_devices_) { throw ::std::out_of_range("Device index out of range"); }
+		return device::get((*visible_)[n]);
 	}
 
 	//	reference operator[](size_type i);
@@ -181,7 +451,27 @@ public:
 	const_reference back() const noexcept { return num_devices_ ? *(end() - 1) : *end(); }
 	// reference back() noexcept;
 
+	// Queries, answered from cached device snapshots; see @ref device::snapshots()
+
+	// Only the devices in view are snapshotted
+	device_selection_t selection() const { return { device::snapshots(*visible_), *visible_ }; }
+
+	template <typename Predicate>
+	device_selection_t where(Predicate predicate) const { return selection().where(predicate); }
+
+	device_selection_t where(
+		device::compute_capability_t  min_compute_capability,
+		size_t                        min_free_memory = 0,
+		bool                          must_support_managed_memory = false) const
+	{
+		return selection().where(min_compute_capability, min_free_memory, must_support_managed_memory);
+	}
+
+	template <typename Compare>
+	device_selection_t sorted_by(Compare less) const { return selection().sorted_by(less); }
+
 protected:
+	device::id_list_t visible_;
 	size_type num_devices_;
 };
 
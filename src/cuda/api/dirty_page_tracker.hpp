@@ -0,0 +1,593 @@
+/**
+ * @file dirty_page_tracker.hpp
+ *
+ * @brief Tracking of which pages of a host memory region have been written
+ * to since it was last uploaded to the device, so that re-uploading it only
+ * needs to transfer the modified pages.
+ *
+ * @note This facility is only available on Linux, and is opt-in: Nothing
+ * else in the library tracks or write-protects host memory.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_DIRTY_PAGE_TRACKER_HPP_
+#define CUDA_API_WRAPPERS_DIRTY_PAGE_TRACKER_HPP_
+
+#if defined(__linux__)
+
+#include <cuda/api/memory.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/stream.hpp>
+
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+namespace cuda {
+namespace memory {
+namespace host {
+
+/**
+ * The mechanism a @ref dirty_page_tracker_t uses to detect writes
+ */
+enum class page_tracking_method_t {
+	/**
+	 * Clean pages are write-protected with `mprotect()`; the first write to
+	 * such a page triggers a fault, which is handled by marking the page
+	 * as dirty and lifting its protection. Works for any number of trackers,
+	 * and is safe to use while other threads write to the region.
+	 *
+	 * @note Regions tracked this way must consist of whole pages - e.g. be
+	 * allocated with `mmap()` or `aligned_alloc()` - as any other data on
+	 * the protected pages, which may include the tracker's own, would fault
+	 * when written.
+	 *
+	 * @note The kernel does not fault on writes it makes itself: System calls
+	 * writing into a clean page of the region - `read()`, `recv()`, io_uring
+	 * reads (including those of @ref io::chunked_file_reader_t), etc. - fail
+	 * with `EFAULT` instead. Either have such calls write elsewhere and copy,
+	 * or use @ref soft_dirty tracking for regions filled this way.
+	 */
+	write_protection,
+	/**
+	 * The kernel's per-page soft-dirty bits are read from `/proc/self/pagemap`,
+	 * and cleared by way of `/proc/self/clear_refs`. Requires a kernel built
+	 * with `CONFIG_MEM_SOFT_DIRTY`. As clearing is process-wide, only a single
+	 * soft-dirty tracker may exist at a time, and the region must not be written
+	 * to while its dirty pages are being uploaded.
+	 */
+	soft_dirty,
+};
+
+namespace dirty_page_tracker {
+
+/**
+ * Counters of the work a @ref dirty_page_tracker_t has done, and avoided doing
+ */
+struct statistics_t {
+	size_t uploads        { 0 };
+	size_t copies         { 0 };
+	size_t bytes_uploaded { 0 };
+	/** bytes of the tracked region which were clean, hence not uploaded */
+	size_t bytes_avoided  { 0 };
+};
+
+namespace detail_ {
+
+inline ::std::system_error os_error(const char* what)
+{
+	return ::std::system_error(errno, ::std::system_category(), what);
+}
+
+inline size_t page_size()
+{
+	static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return size;
+}
+
+/**
+ * The part of a write-protection-based tracker accessed from the fault handler
+ */
+struct protected_range_t {
+	char*                                          start;
+	size_t                                         num_pages;
+	::std::unique_ptr<::std::atomic<uint8_t>[]>    dirty;
+	::std::atomic_flag                             lock;
+};
+
+enum : size_t { max_protected_ranges = 64 };
+
+/**
+ * A fixed-size registry, so that the fault handler can scan it without
+ * allocating or taking any (non-spin) locks
+ */
+inline ::std::atomic<protected_range_t*>* registry()
+{
+	static ::std::atomic<protected_range_t*> ranges[max_protected_ranges];
+	return ranges;
+}
+
+/**
+ * The number of fault handler invocations currently scanning the registry;
+ * a range descriptor is only freed once none of them may still be using it
+ */
+inline ::std::atomic<unsigned>& handlers_running() noexcept
+{
+	static ::std::atomic<unsigned> count { 0 };
+	return count;
+}
+
+/**
+ * The number of ranges being unregistered: A write which faulted before its
+ * range's protection was lifted may be handled after the range has been removed
+ * from the registry; while this is non-zero, such faults are retried rather than
+ * passed on
+ */
+inline ::std::atomic<unsigned>& ranges_being_released() noexcept
+{
+	static ::std::atomic<unsigned> count { 0 };
+	return count;
+}
+
+inline struct sigaction& previous_fault_action()
+{
+	static struct sigaction action;
+	return action;
+}
+
+inline void spin_lock(::std::atomic_flag& flag) noexcept
+{
+	while (flag.test_and_set(::std::memory_order_acquire)) { }
+}
+
+inline void unlock(::std::atomic_flag& flag) noexcept { flag.clear(::std::memory_order_release); }
+
+inline bool handle_tracked_write(void* faulting_address) noexcept
+{
+	auto address = static_cast<char*>(faulting_address);
+	auto page_size_ = page_size();
+	bool handled { false };
+	handlers_running().fetch_add(1);
+	for(size_t i = 0; i < max_protected_ranges; i++) {
+		auto range = registry()[i].load();
+		if (range == nullptr or address < range->start
+			or address >= range->start + range->num_pages * page_size_) { continue; }
+		auto page_index = static_cast<size_t>(address - range->start) / page_size_;
+		spin_lock(range->lock);
+		range->dirty[page_index].store(1, ::std::memory_order_relaxed);
+		handled = (mprotect(range->start + page_index * page_size_, page_size_, PROT_READ | PROT_WRITE) == 0);
+		unlock(range->lock);
+		break;
+	}
+	handled = handled or ranges_being_released().load() > 0;
+	handlers_running().fetch_sub(1);
+	return handled;
+}
+
+inline void wait_for_running_handlers() noexcept
+{
+	while (handlers_running().load() > 0) { sched_yield(); }
+}
+
+inline void handle_fault(int signal_number, siginfo_t* info, void* context)
+{
+	if (handle_tracked_write(info->si_addr)) { return; }
+	// Not ours - defer to whatever was handling faults before us
+	auto& previous = previous_fault_action();
+	if (previous.sa_flags & SA_SIGINFO) {
+		previous.sa_sigaction(signal_number, info, context);
+	}
+	else if (previous.sa_handler == SIG_DFL or previous.sa_handler == SIG_IGN) {
+		// Returning will re-trigger the fault, this time with the default disposition
+		signal(signal_number, SIG_DFL);
+	}
+	else {
+		previous.sa_handler(signal_number);
+	}
+}
+
+inline void install_fault_handler()
+{
+	static ::std::once_flag installed;
+	::std::call_once(installed, [] {
+		struct sigaction action {};
+		action.sa_sigaction = handle_fault;
+		action.sa_flags = SA_SIGINFO | SA_RESTART | SA_NODEFER;
+		sigemptyset(&action.sa_mask);
+		if (sigaction(SIGSEGV, &action, &previous_fault_action()) != 0) {
+			throw os_error("Failed installing a write-fault handler for dirty page tracking");
+		}
+	});
+}
+
+enum : uint64_t { soft_dirty_bit = uint64_t{1} << 55 };
+
+inline ::std::vector<uint64_t> read_pagemap(const char* start, size_t num_pages)
+{
+	::std::vector<uint64_t> entries(num_pages);
+	auto offset = static_cast<off_t>(reinterpret_cast<uintptr_t>(start) / page_size() * sizeof(uint64_t));
+	int fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+	if (fd < 0) { throw os_error("Failed opening /proc/self/pagemap"); }
+	auto bytes_to_read = num_pages * sizeof(uint64_t);
+	auto bytes_read = pread(fd, entries.data(), bytes_to_read, offset);
+	close(fd);
+	if (bytes_read != static_cast<ssize_t>(bytes_to_read)) {
+		throw os_error("Failed reading page map entries");
+	}
+	return entries;
+}
+
+inline void clear_soft_dirty_bits()
+{
+	int fd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+	if (fd < 0) { throw os_error("Failed opening /proc/self/clear_refs"); }
+	auto bytes_written = write(fd, "4", 1);
+	close(fd);
+	if (bytes_written != 1) {
+		throw os_error("Failed clearing soft-dirty bits");
+	}
+}
+
+/**
+ * Kernels built without soft-dirty support never set the bit; check
+ * by writing to a scratch page after clearing it
+ */
+inline bool soft_dirty_bits_supported()
+{
+	auto page = static_cast<char*>(mmap(nullptr, page_size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	if (page == MAP_FAILED) { throw os_error("Failed mapping a scratch page"); }
+	bool supported { false };
+	try {
+		*reinterpret_cast<volatile char*>(page) = 1;
+		clear_soft_dirty_bits();
+		*reinterpret_cast<volatile char*>(page) = 2;
+		supported = (read_pagemap(page, 1)[0] & soft_dirty_bit) != 0;
+	}
+	catch(...) {
+		munmap(page, page_size());
+		throw;
+	}
+	munmap(page, page_size());
+	return supported;
+}
+
+inline ::std::atomic<bool>& soft_dirty_tracker_exists()
+{
+	static ::std::atomic<bool> exists { false };
+	return exists;
+}
+
+} // namespace detail_
+
+} // namespace dirty_page_tracker
+
+/**
+ * @brief Tracks writes to a host memory region, at page granularity, so that
+ * only the pages modified since the last upload are copied to the device.
+ *
+ * Tracking is performed on all pages overlapping the region; uploads are
+ * clipped to the region itself. With @ref page_tracking_method_t::write_protection ,
+ * the region must be page-aligned, and a whole number of pages. Initially, the
+ * entire region is considered dirty, i.e. the first upload copies all of it.
+ *
+ * @note Only writes by the CPU are detected; data the device copies into the
+ * region (or otherwise writes to it via mapped memory) is not considered to
+ * make it dirty.
+ *
+ * @note Write-protecting pinned memory allocated by CUDA itself (e.g. with
+ * @ref memory::host::allocate) is not supported by all drivers; host memory
+ * allocated normally and then registered with @ref memory::host::register_
+ * works with both tracking methods.
+ */
+class dirty_page_tracker_t {
+public: // types
+	using statistics_t = dirty_page_tracker::statistics_t;
+
+public: // getters
+	region_t region() const noexcept { return region_; }
+	page_tracking_method_t method() const noexcept { return method_; }
+	size_t num_pages() const noexcept { return num_pages_; }
+	const statistics_t& statistics() const noexcept { return statistics_; }
+
+	/**
+	 * @brief The ranges of the region currently known to have been written to,
+	 * with consecutive dirty pages coalesced. Does not reset any tracking state.
+	 */
+	::std::vector<region_t> dirty_ranges() const
+	{
+		return coalesce(peek_dirty_pages());
+	}
+
+public: // mutators
+
+	/**
+	 * @brief Consider the entire region as modified, e.g. after the device-side
+	 * copy has been overwritten.
+	 */
+	void mark_all_dirty()
+	{
+		all_dirty_ = true;
+	}
+
+	/**
+	 * @brief The ranges of the region written to since tracking last started,
+	 * with consecutive dirty pages coalesced; tracking then starts afresh.
+	 *
+	 * @note Use this for transferring dirty ranges by other means than
+	 * @ref upload_dirty_pages() ; the caller is responsible for all of them.
+	 */
+	::std::vector<region_t> take_dirty_ranges()
+	{
+		return coalesce(take_dirty_pages());
+	}
+
+	/**
+	 * @brief Enqueue copies of all pages modified since the last upload,
+	 * and start tracking afresh.
+	 *
+	 * @param destination the device-side copy of the region, of the same size
+	 * @param stream the stream on which to enqueue the copies
+	 * @return the number of bytes enqueued for copying
+	 */
+	size_t upload_dirty_pages(region_t destination, const stream_t& stream)
+	{
+		if (destination.size() < region_.size()) {
+			throw ::std::invalid_argument("Destination region is smaller than the tracked host region");
+		}
+		auto ranges = take_dirty_ranges();
+		// At this point, later writes are being tracked again; and since the copies
+		// follow, any write which went untracked will be included in them
+		size_t num_bytes { 0 };
+		for(const auto& range : ranges) {
+			auto offset = static_cast<char*>(range.start()) - static_cast<char*>(region_.start());
+			memory::async::copy(static_cast<char*>(destination.start()) + offset, range.start(), range.size(), stream);
+			num_bytes += range.size();
+		}
+		statistics_.uploads++;
+		statistics_.copies += ranges.size();
+		statistics_.bytes_uploaded += num_bytes;
+		statistics_.bytes_avoided += region_.size() - num_bytes;
+		return num_bytes;
+	}
+
+protected: // non-mutators
+
+	char* tracked_start() const noexcept
+	{
+		auto page_size = dirty_page_tracker::detail_::page_size();
+		auto address = reinterpret_cast<uintptr_t>(region_.start());
+		return reinterpret_cast<char*>(address - address % page_size);
+	}
+
+	/**
+	 * Coalesces consecutive dirty pages into ranges, clipped to the tracked region
+	 */
+	::std::vector<region_t> coalesce(const ::std::vector<bool>& dirty) const
+	{
+		::std::vector<region_t> ranges;
+		auto page_size = dirty_page_tracker::detail_::page_size();
+		auto region_start = static_cast<char*>(region_.start());
+		auto region_end = region_start + region_.size();
+		size_t page_index = 0;
+		while (page_index < num_pages_) {
+			if (not dirty[page_index]) { page_index++; continue; }
+			auto run_start = page_index;
+			while (page_index < num_pages_ and dirty[page_index]) { page_index++; }
+			auto start = ::std::max(tracked_start() + run_start * page_size, region_start);
+			auto end = ::std::min(tracked_start() + page_index * page_size, region_end);
+			ranges.emplace_back(start, static_cast<size_t>(end - start));
+		}
+		return ranges;
+	}
+
+	::std::vector<bool> peek_dirty_pages() const
+	{
+		if (all_dirty_) { return ::std::vector<bool>(num_pages_, true); }
+		::std::vector<bool> dirty(num_pages_);
+		if (method_ == page_tracking_method_t::soft_dirty) {
+			using dirty_page_tracker::detail_::soft_dirty_bit;
+			auto entries = read_pagemap();
+			for(size_t i = 0; i < num_pages_; i++) { dirty[i] = (entries[i] & soft_dirty_bit) != 0; }
+			return dirty;
+		}
+		for(size_t i = 0; i < num_pages_; i++) {
+			dirty[i] = protected_range_->dirty[i].load(::std::memory_order_relaxed) != 0;
+		}
+		return dirty;
+	}
+
+	::std::vector<uint64_t> read_pagemap() const
+	{
+		return dirty_page_tracker::detail_::read_pagemap(tracked_start(), num_pages_);
+	}
+
+	static void clear_soft_dirty_bits() { dirty_page_tracker::detail_::clear_soft_dirty_bits(); }
+
+protected: // mutators
+
+	/**
+	 * @return 0 on success, or the error number otherwise - as this is used while
+	 * holding the range's lock, when an exception must not be constructed
+	 */
+	int protect_noexcept(size_t first_page, size_t num_pages, int protection) noexcept
+	{
+		auto page_size = dirty_page_tracker::detail_::page_size();
+		return (mprotect(tracked_start() + first_page * page_size, num_pages * page_size, protection) == 0) ? 0 : errno;
+	}
+
+	::std::vector<bool> take_dirty_pages()
+	{
+		if (all_dirty_) {
+			reset_all();
+			return ::std::vector<bool>(num_pages_, true);
+		}
+		::std::vector<bool> dirty(num_pages_);
+		if (method_ == page_tracking_method_t::soft_dirty) {
+			dirty = peek_dirty_pages();
+			clear_soft_dirty_bits();
+			return dirty;
+		}
+		auto& range = *protected_range_;
+		auto taken = taken_pages_.get();
+		// Clearing the mark before re-protecting the page means a write in between
+		// is missed by the tracking - but not by the copy which follows. While the lock
+		// is held, a write to a protected page would have the fault handler wait for
+		// the lock forever; so only the marks and the preallocated buffer are written to,
+		// with the result filled in after unlocking.
+		dirty_page_tracker::detail_::spin_lock(range.lock);
+		int protection_error = 0;
+		for(size_t i = 0; i < num_pages_; i++) {
+			taken[i] = range.dirty[i].exchange(0, ::std::memory_order_relaxed);
+		}
+		for(size_t page_index = 0; page_index < num_pages_ and protection_error == 0; ) {
+			if (taken[page_index] == 0) { page_index++; continue; }
+			auto run_start = page_index;
+			while (page_index < num_pages_ and taken[page_index] != 0) { page_index++; }
+			protection_error = protect_noexcept(run_start, page_index - run_start, PROT_READ);
+		}
+		dirty_page_tracker::detail_::unlock(range.lock);
+		if (protection_error != 0) {
+			errno = protection_error;
+			throw dirty_page_tracker::detail_::os_error("Failed changing the protection of tracked host pages");
+		}
+		for(size_t i = 0; i < num_pages_; i++) { dirty[i] = (taken[i] != 0); }
+		return dirty;
+	}
+
+	void reset_all()
+	{
+		all_dirty_ = false;
+		if (method_ == page_tracking_method_t::soft_dirty) {
+			clear_soft_dirty_bits();
+			return;
+		}
+		auto& range = *protected_range_;
+		dirty_page_tracker::detail_::spin_lock(range.lock);
+		for(size_t i = 0; i < num_pages_; i++) { range.dirty[i].store(0, ::std::memory_order_relaxed); }
+		auto protection_error = protect_noexcept(0, num_pages_, PROT_READ);
+		dirty_page_tracker::detail_::unlock(range.lock);
+		if (protection_error != 0) {
+			errno = protection_error;
+			throw dirty_page_tracker::detail_::os_error("Failed changing the protection of tracked host pages");
+		}
+	}
+
+	void register_protected_range()
+	{
+		namespace detail_ = dirty_page_tracker::detail_;
+		auto& range = *protected_range_;
+		range.start = tracked_start();
+		range.num_pages = num_pages_;
+		range.dirty.reset(new ::std::atomic<uint8_t>[num_pages_]);
+		for(size_t i = 0; i < num_pages_; i++) { range.dirty[i].store(0, ::std::memory_order_relaxed); }
+		range.lock.clear();
+		detail_::install_fault_handler();
+		for(size_t i = 0; i < detail_::max_protected_ranges; i++) {
+			detail_::protected_range_t* expected = nullptr;
+			if (detail_::registry()[i].compare_exchange_strong(expected, protected_range_.get())) { return; }
+		}
+		throw ::std::runtime_error("Too many host regions are being tracked using write protection");
+	}
+
+	/**
+	 * @note Once this returns, no fault handler is using the range descriptor,
+	 * and it may be freed
+	 */
+	void unregister_protected_range() noexcept
+	{
+		namespace detail_ = dirty_page_tracker::detail_;
+		detail_::ranges_being_released().fetch_add(1);
+		// Lifting the protection first, so that no further writes fault; those
+		// which already have, are either handled using the range or retried
+		auto page_size = detail_::page_size();
+		mprotect(tracked_start(), num_pages_ * page_size, PROT_READ | PROT_WRITE);
+		for(size_t i = 0; i < detail_::max_protected_ranges; i++) {
+			detail_::protected_range_t* expected = protected_range_.get();
+			if (detail_::registry()[i].compare_exchange_strong(expected, nullptr)) { break; }
+		}
+		detail_::wait_for_running_handlers();
+		detail_::ranges_being_released().fetch_sub(1);
+	}
+
+public: // constructors and destructor
+
+	/**
+	 * @param region the host memory to track; the pages it overlaps must
+	 * be readable and writable, and not shared with another tracker
+	 * @param method the mechanism to use for detecting writes
+	 *
+	 * @throws ::std::invalid_argument if tracking using write protection, and
+	 * @p region does not consist of whole pages
+	 */
+	dirty_page_tracker_t(
+		region_t                region,
+		page_tracking_method_t  method = page_tracking_method_t::write_protection)
+	:
+		region_(region),
+		method_(method)
+	{
+		auto page_size = dirty_page_tracker::detail_::page_size();
+		auto region_end = reinterpret_cast<uintptr_t>(region.start()) + region.size();
+		auto tracked_end = (region_end + page_size - 1) / page_size * page_size;
+		num_pages_ = (tracked_end - reinterpret_cast<uintptr_t>(tracked_start())) / page_size;
+		if (method == page_tracking_method_t::soft_dirty) {
+			if (dirty_page_tracker::detail_::soft_dirty_tracker_exists().exchange(true)) {
+				throw ::std::logic_error("Only a single soft-dirty-bit-based page tracker can exist at a time");
+			}
+			if (not dirty_page_tracker::detail_::soft_dirty_bits_supported()) {
+				dirty_page_tracker::detail_::soft_dirty_tracker_exists() = false;
+				throw ::std::runtime_error("The kernel does not support soft-dirty page bits");
+			}
+			return;
+		}
+		if (reinterpret_cast<uintptr_t>(region.start()) % page_size != 0 or region.size() % page_size != 0) {
+			throw ::std::invalid_argument(
+				"A host region tracked using write protection must be page-aligned, and consist of whole pages");
+		}
+		taken_pages_.reset(new uint8_t[num_pages_]);
+		protected_range_.reset(new dirty_page_tracker::detail_::protected_range_t);
+		register_protected_range();
+	}
+
+	dirty_page_tracker_t(const dirty_page_tracker_t&) = delete;
+
+	~dirty_page_tracker_t()
+	{
+		if (method_ == page_tracking_method_t::soft_dirty) {
+			dirty_page_tracker::detail_::soft_dirty_tracker_exists() = false;
+			return;
+		}
+		unregister_protected_range();
+	}
+
+public: // operators
+	dirty_page_tracker_t& operator=(const dirty_page_tracker_t&) = delete;
+
+protected: // data members
+	region_t                                                          region_;
+	page_tracking_method_t                                            method_;
+	size_t                                                            num_pages_;
+	bool                                                              all_dirty_ { true };
+	::std::unique_ptr<dirty_page_tracker::detail_::protected_range_t> protected_range_;
+	/** Filled while holding the range's lock, so allocated in advance */
+	::std::unique_ptr<uint8_t[]>                                      taken_pages_;
+	statistics_t                                                      statistics_;
+};
+
+} // namespace host
+} // namespace memory
+} // namespace cuda
+
+#endif // defined(__linux__)
+
+#endif // CUDA_API_WRAPPERS_DIRTY_PAGE_TRACKER_HPP_
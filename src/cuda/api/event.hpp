@@ -11,8 +11,10 @@
 
 #include <cuda/api/constants.hpp>
 #include <cuda/api/current_device.hpp>
+#include <cuda/api/detail/deferred_destruction.hpp>
 #include <cuda/api/error.hpp>
 #include <cuda/api/ipc.hpp>
+#include <cuda/api/recording.hpp>
 #include <cuda/common/types.hpp>
 
 #include <cuda_runtime_api.h>
@@ -38,10 +40,13 @@ namespace detail_ {
  * @param event_id Event to be made to occur on stream @ref stream_id
  */
 inline void enqueue(stream::id_t stream_id, id_t event_id) {
+	auto recording_start = recording::detail_::begin();
 	auto status = cudaEventRecord(event_id, stream_id);
 	cuda::throw_if_error(status,
 		"Failed recording event " + cuda::detail_::ptr_as_hex(event_id)
 		+ " on stream " + cuda::detail_::ptr_as_hex(stream_id));
+	recording::detail_::end(recording_start,
+		recording::detail_::make_record(recording::operation_t::record_event, stream_id, event_id));
 }
 
 constexpr unsigned inline make_flags(bool uses_blocking_sync, bool records_timing, bool interprocess)
@@ -209,7 +214,9 @@ public: // constructors and destructor
 
 	~event_t()
 	{
-		if (owning) { cudaEventDestroy(id_); }
+		if (owning and not cuda::detail_::defer_destruction(cuda::detail_::destroyable_t::event, id_, device_id_)) {
+			cudaEventDestroy(id_);
+		}
 	}
 
 public: // operators
@@ -345,9 +352,12 @@ inline void synchronize(const event_t& event)
 	auto device_id = event.device_id();
 	auto event_id = event.id();
 	device::current::detail_::scoped_override_t device_for_this_scope(device_id);
+	auto recording_start = recording::detail_::begin();
 	auto status = cudaEventSynchronize(event_id);
 	throw_if_error(status, "Failed synchronizing the event with id "
 		+ cuda::detail_::ptr_as_hex(event_id) + " on   " + ::std::to_string(device_id));
+	recording::detail_::end(recording_start, recording::detail_::make_record(
+		recording::operation_t::synchronize_event, nullptr, event_id, nullptr, nullptr, 0, device_id));
 }
 
 } // namespace cuda
@@ -0,0 +1,178 @@
+/**
+ * @file event_pool.hpp
+ *
+ * @brief Recycling CUDA events, rather than creating and destroying one for every
+ * point in a stream which needs marking - as code signaling many fine-grained
+ * completions (e.g. per chunk of a large copy) would otherwise do.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_EVENT_POOL_HPP_
+#define CUDA_API_WRAPPERS_EVENT_POOL_HPP_
+
+#include <cuda/api/device.hpp>
+#include <cuda/api/event.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace cuda {
+
+namespace event_pool {
+
+struct statistics_t {
+	size_t created   { 0 };
+	size_t acquired  { 0 };
+	/** Acquisitions satisfied by an event returned to the pool */
+	size_t reused    { 0 };
+};
+
+///@cond
+namespace detail_ {
+
+struct free_list_t {
+	::std::mutex              mutex;
+	::std::vector<event_t>    events;
+	statistics_t              statistics;
+};
+
+} // namespace detail_
+///@endcond
+
+/**
+ * @brief An event drawn from an @ref event_pool_t, which returns to it on destruction
+ *
+ * @note Returning an event to the pool while work enqueued before its recording
+ * is still in progress is safe: CUDA waits on the state of an event as of when the
+ * wait was enqueued, and later re-recordings of the event do not affect it.
+ */
+class pooled_event_t {
+public: // getters
+	const event_t& get() const noexcept { return event_; }
+	event_t& get() noexcept { return event_; }
+
+public: // constructors and destructor
+	pooled_event_t(event_t&& event, ::std::shared_ptr<detail_::free_list_t> free_list) noexcept :
+		event_(::std::move(event)), free_list_(::std::move(free_list)) { }
+
+	pooled_event_t(pooled_event_t&& other) noexcept = default;
+	pooled_event_t(const pooled_event_t&) = delete;
+
+	~pooled_event_t()
+	{
+		if (not free_list_) { return; }
+		::std::lock_guard<::std::mutex> lock(free_list_->mutex);
+		free_list_->events.push_back(::std::move(event_));
+	}
+
+public: // operators
+	operator const event_t&() const noexcept { return event_; }
+	operator event_t&() noexcept { return event_; }
+	const event_t* operator->() const noexcept { return &event_; }
+	event_t* operator->() noexcept { return &event_; }
+
+	pooled_event_t& operator=(const pooled_event_t&) = delete;
+
+protected: // data members
+	event_t                                    event_;
+	/** Shared, so that pooled events may outlive their pool */
+	::std::shared_ptr<detail_::free_list_t>    free_list_;
+};
+
+} // namespace event_pool
+
+/**
+ * @brief A pool of events, on a single device and with the same flags
+ */
+class event_pool_t {
+public: // types
+	using statistics_t = event_pool::statistics_t;
+
+public: // getters
+	device::id_t device_id() const noexcept { return device_id_; }
+
+	statistics_t statistics() const
+	{
+		::std::lock_guard<::std::mutex> lock(free_list_->mutex);
+		return free_list_->statistics;
+	}
+
+public: // mutators
+	event_pool::pooled_event_t acquire()
+	{
+		{
+			::std::lock_guard<::std::mutex> lock(free_list_->mutex);
+			free_list_->statistics.acquired++;
+			if (not free_list_->events.empty()) {
+				auto event = ::std::move(free_list_->events.back());
+				free_list_->events.pop_back();
+				free_list_->statistics.reused++;
+				return event_pool::pooled_event_t{ ::std::move(event), free_list_ };
+			}
+			free_list_->statistics.created++;
+		}
+		return event_pool::pooled_event_t{
+			event::detail_::create(device_id_, uses_blocking_sync_, records_timing_, event::not_interprocess),
+			free_list_ };
+	}
+
+	/**
+	 * @brief Create events ahead of time, so that the next @p num_events
+	 * acquisitions do not create any
+	 */
+	void reserve(size_t num_events)
+	{
+		::std::lock_guard<::std::mutex> lock(free_list_->mutex);
+		while (free_list_->events.size() < num_events) {
+			free_list_->events.push_back(
+				event::detail_::create(device_id_, uses_blocking_sync_, records_timing_, event::not_interprocess));
+			free_list_->statistics.created++;
+		}
+	}
+
+public: // constructors and destructor
+	explicit event_pool_t(
+		device_t  device,
+		bool      uses_blocking_sync = event::sync_by_blocking,
+		bool      records_timing     = event::dont_record_timings)
+	:
+		device_id_(device.id()),
+		uses_blocking_sync_(uses_blocking_sync),
+		records_timing_(records_timing),
+		free_list_(::std::make_shared<event_pool::detail_::free_list_t>()) { }
+
+	event_pool_t(const event_pool_t&) = delete;
+
+public: // operators
+	event_pool_t& operator=(const event_pool_t&) = delete;
+
+protected: // data members
+	device::id_t                                          device_id_;
+	bool                                                  uses_blocking_sync_;
+	bool                                                  records_timing_;
+	::std::shared_ptr<event_pool::detail_::free_list_t>   free_list_;
+};
+
+namespace event_pool {
+
+/**
+ * @return a process-wide pool of blocking-sync, non-timing events on @p device
+ */
+inline event_pool_t& default_pool(const device_t& device)
+{
+	static ::std::mutex mutex;
+	static ::std::map<device::id_t, ::std::unique_ptr<event_pool_t>> pools;
+	::std::lock_guard<::std::mutex> lock(mutex);
+	auto& pool = pools[device.id()];
+	if (not pool) { pool.reset(new event_pool_t(device)); }
+	return *pool;
+}
+
+} // namespace event_pool
+
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_EVENT_POOL_HPP_
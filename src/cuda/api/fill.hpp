@@ -0,0 +1,365 @@
+/**
+ * @file fill.hpp
+ *
+ * @brief Filling device memory with a repeated 16-, 32- or 64-bit value - e.g. a
+ * float constant, or -1 indices - rather than just a single byte value, as with
+ * @ref memory::device::set(); in contiguous or in pitched 2D regions.
+ *
+ * A plain memset is used if all bytes of the value are the same; otherwise - the runtime
+ * API having no wide memset - the value is copied into the region once, then the filled
+ * part is repeatedly copied over the unfilled part, doubling it each time. Code compiled
+ * with nvcc may instead use @ref async::fill_by_kernel() and @ref async::fill_2d_by_kernel(),
+ * which launch a fill kernel.
+ *
+ * @note The kernel-based fills have names of their own, rather than being chosen by
+ * @ref async::fill() when compiling with nvcc, so that all translation units - compiled
+ * with nvcc or otherwise - share the same definitions of the other functions.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_FILL_HPP_
+#define CUDA_API_WRAPPERS_FILL_HPP_
+
+#include <cuda/api/error.hpp>
+#include <cuda/api/memory.hpp>
+#include <cuda/common/types.hpp>
+
+#include <cuda_runtime_api.h>
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace cuda {
+
+///@cond
+class stream_t;
+///@endcond
+
+namespace memory {
+namespace device {
+
+namespace filling {
+
+enum class mechanism_t {
+	byte_memset,
+	kernel,
+	copy_doubling
+};
+
+inline const char* name(mechanism_t mechanism) noexcept
+{
+	switch(mechanism) {
+	case mechanism_t::byte_memset:   return "byte_memset";
+	case mechanism_t::kernel:        return "kernel";
+	case mechanism_t::copy_doubling: return "copy_doubling";
+	}
+	return "unknown";
+}
+
+/**
+ * @return true if all bytes of the value are the same, in which case @p byte_value is set to it
+ */
+inline bool is_byte_pattern(const void* value, size_t value_size, unsigned char& byte_value) noexcept
+{
+	auto bytes = static_cast<const unsigned char*>(value);
+	for(size_t i = 1; i < value_size; i++) {
+		if (bytes[i] != bytes[0]) { return false; }
+	}
+	byte_value = bytes[0];
+	return true;
+}
+
+/**
+ * @return the mechanism with which @ref async::fill() fills a region with @p value
+ *
+ * @note @ref async::fill_by_kernel() uses @ref mechanism_t::kernel instead of
+ * @ref mechanism_t::copy_doubling
+ */
+template <typename T>
+mechanism_t mechanism_for(const T& value) noexcept
+{
+	unsigned char byte_value;
+	return is_byte_pattern(&value, sizeof(T), byte_value) ? mechanism_t::byte_memset : mechanism_t::copy_doubling;
+}
+
+/**
+ * @name Host-side reference implementations, e.g. for checking device-side fills against
+ */
+///@{
+template <typename T>
+void reference_fill(T* start, const T& value, size_t num_elements)
+{
+	::std::fill(start, start + num_elements, value);
+}
+
+template <typename T>
+void reference_fill_2d(T* start, size_t pitch_in_bytes, size_t width_in_elements, size_t height, const T& value)
+{
+	for(size_t row = 0; row < height; row++) {
+		auto row_start = reinterpret_cast<T*>(reinterpret_cast<char*>(start) + row * pitch_in_bytes);
+		::std::fill(row_start, row_start + width_in_elements, value);
+	}
+}
+///@}
+
+///@cond
+namespace detail_ {
+
+template <typename T>
+struct is_fill_value : ::std::integral_constant<bool,
+	::std::is_trivially_copyable<T>::value and
+	(sizeof(T) == 1 or sizeof(T) == 2 or sizeof(T) == 4 or sizeof(T) == 8)> { };
+
+/**
+ * Reports the memsetting of a 2D region to the zero tracker - with only the rows,
+ * and not the padding between them, having been zeroed
+ */
+inline void report_2d_set(void* start, size_t pitch, size_t width_in_bytes, size_t height, unsigned char byte_value)
+{
+	if (height == 0) { return; }
+	if (byte_value != 0 or pitch == width_in_bytes) {
+		// Considering the padding as written is merely conservative
+		memory::detail_::report_set(start, byte_value, pitch * (height - 1) + width_in_bytes);
+		return;
+	}
+	if (memory::detail_::zero_state_tracker().load(::std::memory_order_relaxed) == nullptr) { return; }
+	for(size_t row = 0; row < height; row++) {
+		memory::detail_::report_set(static_cast<char*>(start) + row * pitch, 0, width_in_bytes);
+	}
+}
+
+/** Copies of at most this size, from the host, start the doubling */
+enum : size_t { doubling_seed_size = 64 * 1024 };
+
+inline void fill_by_doubling(void* start, const void* value, size_t value_size, size_t num_bytes, stream::id_t stream_id)
+{
+	if (num_bytes == 0) { return; }
+	auto seed_size = ::std::min(num_bytes, doubling_seed_size / value_size * value_size);
+	::std::vector<unsigned char> seed(seed_size);
+	for(size_t offset = 0; offset < seed_size; offset += value_size) {
+		::std::memcpy(seed.data() + offset, value, value_size);
+	}
+	// The seed is pageable; the copy has consumed it by the time it returns
+	memory::async::detail_::copy(start, seed.data(), seed_size, stream_id);
+	auto bytes = static_cast<char*>(start);
+	for(size_t filled = seed_size; filled < num_bytes; ) {
+		auto copy_size = ::std::min(filled, num_bytes - filled);
+		memory::async::detail_::copy(bytes + filled, bytes, copy_size, stream_id);
+		filled += copy_size;
+	}
+}
+
+inline void fill_2d_by_doubling(
+	void*         start,
+	size_t        pitch,
+	size_t        width_in_bytes,
+	size_t        height,
+	const void*   value,
+	size_t        value_size,
+	stream::id_t  stream_id)
+{
+	if (height == 0) { return; }
+	fill_by_doubling(start, value, value_size, width_in_bytes, stream_id);
+	auto bytes = static_cast<char*>(start);
+	for(size_t filled_rows = 1; filled_rows < height; ) {
+		auto num_rows = ::std::min(filled_rows, height - filled_rows);
+		auto result = cudaMemcpy2DAsync(bytes + filled_rows * pitch, pitch, bytes, pitch,
+			width_in_bytes, num_rows, cudaMemcpyDeviceToDevice, stream_id);
+		throw_if_error(result, "Scheduling the copying of rows of a 2D region being filled");
+		filled_rows += num_rows;
+	}
+	memory::detail_::report_written(start, pitch * (height - 1) + width_in_bytes);
+}
+
+#if defined(__CUDACC__)
+
+enum : unsigned { fill_block_size = 256, max_fill_grid_size = 4096 };
+
+template <typename T>
+__global__ void fill_kernel(T* start, T value, size_t num_elements)
+{
+	auto stride = static_cast<size_t>(gridDim.x) * blockDim.x;
+	for(auto i = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x; i < num_elements; i += stride) {
+		start[i] = value;
+	}
+}
+
+template <typename T>
+__global__ void fill_2d_kernel(char* start, size_t pitch, size_t width_in_elements, size_t height, T value)
+{
+	auto stride = static_cast<size_t>(gridDim.x) * blockDim.x;
+	auto num_elements = width_in_elements * height;
+	for(auto i = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x; i < num_elements; i += stride) {
+		reinterpret_cast<T*>(start + (i / width_in_elements) * pitch)[i % width_in_elements] = value;
+	}
+}
+
+inline unsigned fill_grid_size(size_t num_elements) noexcept
+{
+	return static_cast<unsigned>(::std::min<size_t>(
+		(num_elements + fill_block_size - 1) / fill_block_size, max_fill_grid_size));
+}
+
+#endif // defined(__CUDACC__)
+
+} // namespace detail_
+///@endcond
+
+} // namespace filling
+
+namespace async {
+
+namespace detail_ {
+
+template <typename T>
+void fill(T* start, const T& value, size_t num_elements, stream::id_t stream_id)
+{
+	static_assert(filling::detail_::is_fill_value<T>::value,
+		"Fill values must be trivially-copyable, and of size 1, 2, 4 or 8 bytes");
+	unsigned char byte_value;
+	if (filling::is_byte_pattern(&value, sizeof(T), byte_value)) {
+		set(start, byte_value, num_elements * sizeof(T), stream_id);
+		return;
+	}
+	filling::detail_::fill_by_doubling(start, &value, sizeof(T), num_elements * sizeof(T), stream_id);
+}
+
+template <typename T>
+void fill_2d(
+	T*            start,
+	size_t        pitch_in_bytes,
+	size_t        width_in_elements,
+	size_t        height,
+	const T&      value,
+	stream::id_t  stream_id)
+{
+	static_assert(filling::detail_::is_fill_value<T>::value,
+		"Fill values must be trivially-copyable, and of size 1, 2, 4 or 8 bytes");
+	unsigned char byte_value;
+	if (filling::is_byte_pattern(&value, sizeof(T), byte_value)) {
+		auto result = cudaMemset2DAsync(start, pitch_in_bytes, byte_value, width_in_elements * sizeof(T), height, stream_id);
+		throw_if_error(result, "Scheduling the memsetting of a 2D region of device memory");
+		filling::detail_::report_2d_set(start, pitch_in_bytes, width_in_elements * sizeof(T), height, byte_value);
+		return;
+	}
+	if (width_in_elements == 0) { return; }
+	filling::detail_::fill_2d_by_doubling(start, pitch_in_bytes, width_in_elements * sizeof(T), height,
+		&value, sizeof(T), stream_id);
+}
+
+#if defined(__CUDACC__)
+
+/**
+ * @note Kernels are launched on the current device, which must be the stream's
+ */
+template <typename T>
+void fill_by_kernel(T* start, const T& value, size_t num_elements, stream::id_t stream_id)
+{
+	static_assert(filling::detail_::is_fill_value<T>::value,
+		"Fill values must be trivially-copyable, and of size 1, 2, 4 or 8 bytes");
+	unsigned char byte_value;
+	if (filling::is_byte_pattern(&value, sizeof(T), byte_value)) {
+		set(start, byte_value, num_elements * sizeof(T), stream_id);
+		return;
+	}
+	if (num_elements == 0) { return; }
+	filling::detail_::fill_kernel<T>
+		<<< filling::detail_::fill_grid_size(num_elements), filling::detail_::fill_block_size, 0, stream_id >>>
+		(start, value, num_elements);
+	throw_if_error(cudaGetLastError(), "Launching a kernel filling device memory");
+	memory::detail_::report_written(start, num_elements * sizeof(T));
+}
+
+/**
+ * @note Kernels are launched on the current device, which must be the stream's
+ */
+template <typename T>
+void fill_2d_by_kernel(
+	T*            start,
+	size_t        pitch_in_bytes,
+	size_t        width_in_elements,
+	size_t        height,
+	const T&      value,
+	stream::id_t  stream_id)
+{
+	static_assert(filling::detail_::is_fill_value<T>::value,
+		"Fill values must be trivially-copyable, and of size 1, 2, 4 or 8 bytes");
+	unsigned char byte_value;
+	if (filling::is_byte_pattern(&value, sizeof(T), byte_value)) {
+		fill_2d(start, pitch_in_bytes, width_in_elements, height, value, stream_id);
+		return;
+	}
+	if (width_in_elements == 0 or height == 0) { return; }
+	filling::detail_::fill_2d_kernel<T>
+		<<< filling::detail_::fill_grid_size(width_in_elements * height), filling::detail_::fill_block_size, 0, stream_id >>>
+		(reinterpret_cast<char*>(start), pitch_in_bytes, width_in_elements, height, value);
+	throw_if_error(cudaGetLastError(), "Launching a kernel filling a 2D region of device memory");
+	memory::detail_::report_written(start, pitch_in_bytes * (height - 1) + width_in_elements * sizeof(T));
+}
+
+#endif // defined(__CUDACC__)
+
+} // namespace detail_
+
+/**
+ * @brief Asynchronously set each element of an array in device memory to the same value
+ *
+ * @note The wide-value counterpart of @ref set()
+ *
+ * @tparam T a trivially-copyable type of size 1, 2, 4 or 8 bytes
+ */
+template <typename T>
+void fill(T* start, const T& value, size_t num_elements, const stream_t& stream);
+
+/**
+ * @brief Asynchronously set each element of a pitched 2D array in device memory
+ * to the same value
+ *
+ * @param pitch_in_bytes the distance between the starts of consecutive rows
+ * @param width_in_elements the number of elements to fill in each row
+ */
+template <typename T>
+void fill_2d(
+	T*               start,
+	size_t           pitch_in_bytes,
+	size_t           width_in_elements,
+	size_t           height,
+	const T&         value,
+	const stream_t&  stream);
+
+#if defined(__CUDACC__)
+
+/**
+ * @brief As @ref fill(), but with a kernel, rather than with copies, where the
+ * value's bytes differ
+ *
+ * @note Only available when compiling with nvcc
+ */
+template <typename T>
+void fill_by_kernel(T* start, const T& value, size_t num_elements, const stream_t& stream);
+
+/**
+ * @brief As @ref fill_2d(), but with a kernel, rather than with copies, where the
+ * value's bytes differ
+ *
+ * @note Only available when compiling with nvcc
+ */
+template <typename T>
+void fill_2d_by_kernel(
+	T*               start,
+	size_t           pitch_in_bytes,
+	size_t           width_in_elements,
+	size_t           height,
+	const T&         value,
+	const stream_t&  stream);
+
+#endif // defined(__CUDACC__)
+
+} // namespace async
+
+} // namespace device
+} // namespace memory
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_FILL_HPP_
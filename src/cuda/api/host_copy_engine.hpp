@@ -0,0 +1,423 @@
+/**
+ * @file host_copy_engine.hpp
+ *
+ * @brief Multi-threaded copying, setting and zeroing of host memory, e.g. for
+ * filling large pinned staging buffers from pageable memory - which a single
+ * thread often cannot do at the rate the host-device interconnect transfers data.
+ *
+ * Large operations are split into pieces and executed by a set of worker
+ * threads; on multi-node (NUMA) hosts, each worker is bound to the CPUs of one
+ * node, and pieces are preferably handled by workers on the node where the
+ * destination memory resides. Small operations are simply performed on the
+ * calling thread. Very large ones may optionally use non-temporal stores, so as
+ * not to evict the entire cache contents in favor of data which will not be
+ * read back.
+ *
+ * @note Unlike @ref memory::host::set and its ilk, which are always performed
+ * by the calling thread, these functions start worker threads on first use.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_HOST_COPY_ENGINE_HPP_
+#define CUDA_API_WRAPPERS_HOST_COPY_ENGINE_HPP_
+
+#include <cuda/api/detail/numa.hpp>
+#include <cuda/api/memory.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if !defined(CUDA_API_WRAPPERS_DISABLE_HOST_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define CUDA_API_WRAPPERS_HOST_STREAMING_STORES 1
+#include <emmintrin.h>
+#endif
+
+namespace cuda {
+namespace memory {
+namespace host {
+namespace parallel {
+
+/**
+ * Size-based choices of how to carry out a host memory operation
+ */
+struct options_t {
+	/**
+	 * Operations on fewer bytes than this are performed by the calling thread alone
+	 */
+	size_t serial_threshold { 4 * 1024 * 1024 };
+	/**
+	 * Operations on at least this many bytes write the destination with
+	 * non-temporal (cache-bypassing) stores, where supported. By default, they
+	 * are never used: the C library's own memcpy() and memset() already switch to
+	 * such stores at sizes tuned for the CPU, and the ones used here are often
+	 * slower. Lower this only after measuring an improvement on the target host
+	 * (e.g. with the `host_copy_engine_benchmark` example program).
+	 */
+	size_t non_temporal_threshold { ::std::numeric_limits<size_t>::max() };
+};
+
+namespace detail_ {
+
+enum : size_t {
+	min_piece_size = 256 * 1024,
+	piece_alignment = 64 * 1024,
+	pieces_per_thread = 4
+};
+
+#ifdef CUDA_API_WRAPPERS_HOST_STREAMING_STORES
+
+inline size_t bytes_to_alignment(const char* address, size_t num_bytes) noexcept
+{
+	auto misalignment = reinterpret_cast<uintptr_t>(address) % sizeof(__m128i);
+	return ::std::min(num_bytes, misalignment == 0 ? 0 : sizeof(__m128i) - misalignment);
+}
+
+inline void copy_non_temporal(char* destination, const char* source, size_t num_bytes) noexcept
+{
+	auto head = bytes_to_alignment(destination, num_bytes);
+	::std::memcpy(destination, source, head);
+	destination += head; source += head; num_bytes -= head;
+	for(; num_bytes >= 4 * sizeof(__m128i); num_bytes -= 4 * sizeof(__m128i)) {
+		auto d = reinterpret_cast<__m128i*>(destination);
+		auto s = reinterpret_cast<const __m128i*>(source);
+		auto v0 = _mm_loadu_si128(s);
+		auto v1 = _mm_loadu_si128(s + 1);
+		auto v2 = _mm_loadu_si128(s + 2);
+		auto v3 = _mm_loadu_si128(s + 3);
+		_mm_stream_si128(d, v0);
+		_mm_stream_si128(d + 1, v1);
+		_mm_stream_si128(d + 2, v2);
+		_mm_stream_si128(d + 3, v3);
+		destination += 4 * sizeof(__m128i);
+		source += 4 * sizeof(__m128i);
+	}
+	::std::memcpy(destination, source, num_bytes);
+	// Streaming stores are weakly-ordered; make them visible before reporting completion
+	_mm_sfence();
+}
+
+inline void set_non_temporal(char* destination, int byte_value, size_t num_bytes) noexcept
+{
+	auto head = bytes_to_alignment(destination, num_bytes);
+	::std::memset(destination, byte_value, head);
+	destination += head; num_bytes -= head;
+	const __m128i value = _mm_set1_epi8(static_cast<char>(byte_value));
+	for(; num_bytes >= 4 * sizeof(__m128i); num_bytes -= 4 * sizeof(__m128i)) {
+		auto d = reinterpret_cast<__m128i*>(destination);
+		_mm_stream_si128(d, value);
+		_mm_stream_si128(d + 1, value);
+		_mm_stream_si128(d + 2, value);
+		_mm_stream_si128(d + 3, value);
+		destination += 4 * sizeof(__m128i);
+	}
+	::std::memset(destination, byte_value, num_bytes);
+	_mm_sfence();
+}
+
+#else
+
+inline void copy_non_temporal(char* destination, const char* source, size_t num_bytes) noexcept
+{
+	::std::memcpy(destination, source, num_bytes);
+}
+
+inline void set_non_temporal(char* destination, int byte_value, size_t num_bytes) noexcept
+{
+	::std::memset(destination, byte_value, num_bytes);
+}
+
+#endif // CUDA_API_WRAPPERS_HOST_STREAMING_STORES
+
+} // namespace detail_
+
+/**
+ * @brief A set of worker threads for parallel host memory operations.
+ *
+ * Only one operation is carried out at a time; concurrent calls from
+ * multiple threads are serialized.
+ */
+class engine_t {
+public: // getters
+	size_t num_threads() const noexcept { return workers_.size(); }
+
+	/**
+	 * @return true if workers have been bound to distinct NUMA nodes
+	 */
+	bool is_numa_aware() const noexcept { return numa_aware_; }
+
+public: // operations
+
+	/**
+	 * @brief Copy between non-overlapping host memory areas
+	 */
+	void copy(void* destination, const void* source, size_t num_bytes, const options_t& options = {})
+	{
+		auto destination_ = static_cast<char*>(destination);
+		auto source_ = static_cast<const char*>(source);
+		bool non_temporal = num_bytes >= options.non_temporal_threshold;
+		run(destination_, num_bytes, options, [=](size_t offset, size_t size) {
+			if (non_temporal) { detail_::copy_non_temporal(destination_ + offset, source_ + offset, size); }
+			else { ::std::memcpy(destination_ + offset, source_ + offset, size); }
+		});
+	}
+
+	void copy(region_t destination, const_region_t source, const options_t& options = {})
+	{
+		if (destination.size() < source.size()) {
+			throw ::std::invalid_argument("Attempt to copy a region into a smaller one");
+		}
+		copy(destination.start(), source.start(), source.size(), options);
+	}
+
+	/**
+	 * @brief Set every byte in a host memory area to the same value
+	 */
+	void set(void* start, int byte_value, size_t num_bytes, const options_t& options = {})
+	{
+		auto start_ = static_cast<char*>(start);
+		bool non_temporal = num_bytes >= options.non_temporal_threshold;
+		run(start_, num_bytes, options, [=](size_t offset, size_t size) {
+			if (non_temporal) { detail_::set_non_temporal(start_ + offset, byte_value, size); }
+			else { ::std::memset(start_ + offset, byte_value, size); }
+		});
+	}
+
+	void set(region_t region, int byte_value, const options_t& options = {})
+	{
+		set(region.start(), byte_value, region.size(), options);
+	}
+
+	void zero(void* start, size_t num_bytes, const options_t& options = {})
+	{
+		set(start, 0, num_bytes, options);
+	}
+
+	void zero(region_t region, const options_t& options = {})
+	{
+		set(region.start(), 0, region.size(), options);
+	}
+
+protected: // types
+	using piece_operation_t = ::std::function<void(size_t offset, size_t size)>;
+
+	struct piece_t {
+		size_t  offset;
+		size_t  size;
+		int     node;
+	};
+
+	struct job_t {
+		::std::vector<piece_t>                     pieces;
+		::std::unique_ptr<::std::atomic<bool>[]>   claimed;
+		piece_operation_t                          operation;
+		::std::atomic<size_t>                      num_completed { 0 };
+		::std::mutex                               mutex;
+		::std::condition_variable                  all_completed;
+	};
+
+protected: // non-mutators
+
+	::std::vector<piece_t> make_pieces(const char* destination, size_t num_bytes) const
+	{
+		auto target_piece_size = num_bytes / ((num_threads() + 1) * detail_::pieces_per_thread);
+		auto piece_size = ::std::max<size_t>(detail_::min_piece_size,
+			(target_piece_size + detail_::piece_alignment - 1) / detail_::piece_alignment * detail_::piece_alignment);
+		::std::vector<piece_t> pieces;
+		for(size_t offset = 0; offset < num_bytes; offset += piece_size) {
+			pieces.push_back({ offset, ::std::min(piece_size, num_bytes - offset), cuda::detail_::numa::unknown_node });
+		}
+		if (numa_aware_) {
+			::std::vector<const void*> addresses(pieces.size());
+			::std::vector<int> nodes(pieces.size());
+			for(size_t i = 0; i < pieces.size(); i++) { addresses[i] = destination + pieces[i].offset; }
+			cuda::detail_::numa::nodes_of(addresses.data(), addresses.size(), nodes.data());
+			for(size_t i = 0; i < pieces.size(); i++) { pieces[i].node = nodes[i]; }
+		}
+		return pieces;
+	}
+
+	/**
+	 * Claims and performs pieces of a job - first those on the specified node, then any others
+	 */
+	static void work_on(job_t& job, int node)
+	{
+		auto num_pieces = job.pieces.size();
+		for(int pass = (node == cuda::detail_::numa::unknown_node) ? 1 : 0; pass < 2; pass++) {
+			for(size_t i = 0; i < num_pieces; i++) {
+				const auto& piece = job.pieces[i];
+				if (pass == 0 and piece.node != node) { continue; }
+				if (job.claimed[i].exchange(true)) { continue; }
+				job.operation(piece.offset, piece.size);
+				if (++job.num_completed == num_pieces) {
+					::std::lock_guard<::std::mutex> lock(job.mutex);
+					job.all_completed.notify_all();
+				}
+			}
+		}
+	}
+
+protected: // mutators
+
+	void run(char* destination, size_t num_bytes, const options_t& options, piece_operation_t operation)
+	{
+		if (num_bytes == 0) { return; }
+		if (num_bytes < options.serial_threshold or workers_.empty()) {
+			operation(0, num_bytes);
+			return;
+		}
+		::std::lock_guard<::std::mutex> call_lock(call_mutex_);
+		auto job = ::std::make_shared<job_t>();
+		job->pieces = make_pieces(destination, num_bytes);
+		job->claimed.reset(new ::std::atomic<bool>[job->pieces.size()]);
+		for(size_t i = 0; i < job->pieces.size(); i++) { job->claimed[i] = false; }
+		job->operation = ::std::move(operation);
+		{
+			::std::lock_guard<::std::mutex> lock(mutex_);
+			current_job_ = job;
+			job_generation_++;
+		}
+		job_posted_.notify_all();
+		work_on(*job, cuda::detail_::numa::unknown_node);
+		{
+			::std::unique_lock<::std::mutex> lock(job->mutex);
+			job->all_completed.wait(lock, [&job] { return job->num_completed == job->pieces.size(); });
+		}
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		current_job_.reset();
+	}
+
+	void worker_loop(int node, cuda::detail_::numa::cpu_list_t cpus)
+	{
+		if (not cpus.empty()) { cuda::detail_::numa::bind_this_thread(cpus); }
+		size_t last_generation { 0 };
+		while(true) {
+			::std::shared_ptr<job_t> job;
+			{
+				::std::unique_lock<::std::mutex> lock(mutex_);
+				job_posted_.wait(lock, [&] { return stopping_ or job_generation_ != last_generation; });
+				if (stopping_) { return; }
+				last_generation = job_generation_;
+				job = current_job_;
+			}
+			if (job) { work_on(*job, node); }
+		}
+	}
+
+public: // constructors and destructor
+
+	/**
+	 * @param num_threads number of worker threads; if 0, one less than the
+	 * number of hardware threads (as the calling thread also participates)
+	 * @param numa_aware if true, and the host has multiple NUMA nodes, workers
+	 * are distributed among the nodes and bound to their CPUs
+	 */
+	explicit engine_t(size_t num_threads = 0, bool numa_aware = true)
+	{
+		if (num_threads == 0) {
+			auto num_hardware_threads = ::std::thread::hardware_concurrency();
+			num_threads = (num_hardware_threads > 1) ? num_hardware_threads - 1 : 0;
+		}
+		auto nodes = numa_aware ? cuda::detail_::numa::nodes() : ::std::vector<cuda::detail_::numa::node_t>{};
+		numa_aware_ = (nodes.size() > 1);
+		workers_.reserve(num_threads);
+		for(size_t i = 0; i < num_threads; i++) {
+			if (numa_aware_) {
+				const auto& node = nodes[i % nodes.size()];
+				workers_.emplace_back(&engine_t::worker_loop, this, node.id, node.cpus);
+			}
+			else {
+				workers_.emplace_back(&engine_t::worker_loop, this,
+					static_cast<int>(cuda::detail_::numa::unknown_node), cuda::detail_::numa::cpu_list_t{});
+			}
+		}
+	}
+
+	engine_t(const engine_t&) = delete;
+
+	~engine_t()
+	{
+		{
+			::std::lock_guard<::std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		job_posted_.notify_all();
+		for(auto& worker : workers_) { worker.join(); }
+	}
+
+public: // operators
+	engine_t& operator=(const engine_t&) = delete;
+
+protected: // data members
+	bool                           numa_aware_ { false };
+	::std::vector<::std::thread>   workers_;
+	::std::mutex                   call_mutex_;
+	::std::mutex                   mutex_;
+	::std::condition_variable      job_posted_;
+	::std::shared_ptr<job_t>       current_job_;
+	size_t                         job_generation_ { 0 };
+	bool                           stopping_ { false };
+};
+
+/**
+ * The engine used by the free-standing functions of this namespace
+ * (and by the library's staging utilities); created on first use.
+ */
+inline engine_t& default_engine()
+{
+	static engine_t engine;
+	return engine;
+}
+
+/**
+ * @brief Copy between non-overlapping host memory areas, using multiple threads if worthwhile
+ */
+inline void copy(void* destination, const void* source, size_t num_bytes, const options_t& options = {})
+{
+	default_engine().copy(destination, source, num_bytes, options);
+}
+
+inline void copy(region_t destination, const_region_t source, const options_t& options = {})
+{
+	default_engine().copy(destination, source, options);
+}
+
+/**
+ * @brief Set every byte in a host memory area, using multiple threads if worthwhile
+ */
+inline void set(void* start, int byte_value, size_t num_bytes, const options_t& options = {})
+{
+	default_engine().set(start, byte_value, num_bytes, options);
+}
+
+inline void set(region_t region, int byte_value, const options_t& options = {})
+{
+	default_engine().set(region, byte_value, options);
+}
+
+/**
+ * @brief Zero a host memory area, using multiple threads if worthwhile
+ */
+inline void zero(void* start, size_t num_bytes, const options_t& options = {})
+{
+	default_engine().zero(start, num_bytes, options);
+}
+
+inline void zero(region_t region, const options_t& options = {})
+{
+	default_engine().zero(region, options);
+}
+
+} // namespace parallel
+} // namespace host
+} // namespace memory
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_HOST_COPY_ENGINE_HPP_
@@ -44,6 +44,7 @@
 
 #include <cuda/api/constants.hpp>
 #include <cuda/api/kernel.hpp>
+#include <cuda/api/recording.hpp>
 #include <cuda/common/types.hpp>
 
 #if (__CUDACC_VER_MAJOR__ >= 9)
@@ -116,6 +117,7 @@ inline void enqueue_launch(
 	    "Only a bona fide function can be a CUDA kernel and be launched; "
 	    "you were attempting to enqueue a launch of something other than a function");
 
+	auto recording_start = recording::detail_::begin();
 	if (thread_block_cooperation == thread_blocks_may_not_cooperate) {
 		// regular plain vanilla launch
 		kernel_function <<<
@@ -158,6 +160,11 @@ inline void enqueue_launch(
 			"Only CUDA versions 9.0 and later support launching kernels \"cooperatively\"");
 #endif
 	}
+	recording::detail_::end(recording_start, recording::detail_::make_launch_record(
+		stream_id, (const void*) kernel_function,
+		launch_configuration.grid_dimensions,
+		launch_configuration.block_dimensions,
+		launch_configuration.dynamic_shared_memory_size));
 }
 #endif
 
@@ -0,0 +1,472 @@
+/**
+ * @file load_balancing.hpp
+ *
+ * @brief Choosing a device for each piece of work based on the devices' current
+ * state - their free memory, the work already assigned to them, the rate at which
+ * they have been getting through work, and their proximity to the calling thread -
+ * rather than on their static properties alone (as @ref device_t::choose_best_match
+ * does).
+ *
+ * The choice itself is made by a pluggable policy; least-loaded, bin-packing and
+ * power-of-two-choices policies are provided.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_LOAD_BALANCING_HPP_
+#define CUDA_API_WRAPPERS_LOAD_BALANCING_HPP_
+
+#include <cuda/api/affinity.hpp>
+#include <cuda/api/device.hpp>
+#include <cuda/api/devices.hpp>
+#include <cuda/api/event.hpp>
+#include <cuda/api/event_pool.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace cuda {
+namespace load_balancing {
+
+/**
+ * What a piece of work requires of the device it is assigned to
+ */
+struct requirements_t {
+	/** The amount of free global memory the work needs */
+	size_t memory;
+	/**
+	 * The amount of work, in arbitrary units (e.g. bytes processed, or a
+	 * cost estimate) - as long as all work assigned through a selector uses the same units
+	 */
+	double work_units;
+
+	constexpr requirements_t(size_t required_memory = 0, double units = 1) noexcept :
+		memory(required_memory), work_units(units) { }
+};
+
+/**
+ * A device's state, as seen by a selection policy
+ */
+struct device_load_t {
+	device::id_t  device_id;
+	size_t        free_memory;
+	size_t        total_memory;
+	/** Work units assigned to the device which have not yet been completed */
+	double        outstanding_work;
+	/**
+	 * Recent rate of execution, in work units per second - not counting time
+	 * work spent waiting for earlier work to conclude, which @ref outstanding_work
+	 * accounts for; if it has not yet been measured for the device, the average
+	 * over the other devices
+	 */
+	double        throughput;
+	/** Whether the calling thread runs on one of the device's local CPUs (or that's unknown) */
+	bool          is_local;
+};
+
+/**
+ * A selection policy: chooses one of several eligible devices (all having
+ * enough free memory for the work), by returning its index
+ */
+using policy_t = ::std::function<size_t(
+	const ::std::vector<device_load_t>&  eligible,
+	const requirements_t&                requirements,
+	::std::mt19937&                      random_engine)>;
+
+namespace policies {
+
+/**
+ * @return the time the device is expected to take to complete its outstanding work
+ * along with the new work - inflated by @p remote_penalty if the calling thread
+ * is not near the device
+ */
+inline double expected_completion_time(const device_load_t& load, const requirements_t& requirements, double remote_penalty)
+{
+	auto time = (load.outstanding_work + requirements.work_units) / load.throughput;
+	return load.is_local ? time : time * (1 + remote_penalty);
+}
+
+///@cond
+namespace detail_ {
+
+inline bool less_loaded(const device_load_t& lhs, const device_load_t& rhs, const requirements_t& requirements, double remote_penalty)
+{
+	auto lhs_time = expected_completion_time(lhs, requirements, remote_penalty);
+	auto rhs_time = expected_completion_time(rhs, requirements, remote_penalty);
+	return lhs_time < rhs_time or (lhs_time == rhs_time and lhs.free_memory > rhs.free_memory);
+}
+
+} // namespace detail_
+///@endcond
+
+/**
+ * Choose the device expected to complete the work soonest
+ *
+ * @param remote_penalty the relative slowdown assumed for devices which are
+ * not near the calling thread
+ */
+inline policy_t least_loaded(double remote_penalty = 0.25)
+{
+	return [remote_penalty](const ::std::vector<device_load_t>& eligible, const requirements_t& requirements, ::std::mt19937&) {
+		size_t best = 0;
+		for(size_t i = 1; i < eligible.size(); i++) {
+			if (detail_::less_loaded(eligible[i], eligible[best], requirements, remote_penalty)) { best = i; }
+		}
+		return best;
+	};
+}
+
+/**
+ * Choose the device with the least free memory which still suffices for the
+ * work (best fit) - keeping other devices free for work with large memory
+ * requirements
+ */
+inline policy_t bin_packing()
+{
+	return [](const ::std::vector<device_load_t>& eligible, const requirements_t&, ::std::mt19937&) {
+		size_t best = 0;
+		for(size_t i = 1; i < eligible.size(); i++) {
+			if (eligible[i].free_memory < eligible[best].free_memory) { best = i; }
+		}
+		return best;
+	};
+}
+
+/**
+ * Choose the less loaded of two devices picked at random. This spreads the work
+ * almost as well as @ref least_loaded , while avoiding a herd of concurrent
+ * selections - based on the same, slightly stale, state - all choosing the same device.
+ */
+inline policy_t power_of_two_choices(double remote_penalty = 0.25)
+{
+	return [remote_penalty](const ::std::vector<device_load_t>& eligible, const requirements_t& requirements, ::std::mt19937& random_engine) {
+		if (eligible.size() == 1) { return size_t{0}; }
+		::std::uniform_int_distribution<size_t> distribution(0, eligible.size() - 1);
+		auto first = distribution(random_engine);
+		auto second = distribution(random_engine);
+		while (second == first) { second = distribution(random_engine); }
+		return detail_::less_loaded(eligible[second], eligible[first], requirements, remote_penalty) ? second : first;
+	};
+}
+
+} // namespace policies
+
+struct selector_options_t {
+	/** How long the devices' amounts of free memory may be reused before being re-obtained */
+	::std::chrono::milliseconds free_memory_refresh_interval { 100 };
+	/** The weight of each new measurement in the devices' (exponentially-averaged) throughput */
+	double throughput_smoothing { 0.2 };
+};
+
+class device_selector_t;
+
+/**
+ * Work assigned to a device by a @ref device_selector_t ; the work counts
+ * towards the device's load until it is retired.
+ */
+class assignment_t {
+public: // getters
+	device_t device() const noexcept { return device::get(device_id_); }
+	const requirements_t& requirements() const noexcept { return requirements_; }
+
+protected: // constructors
+	friend class device_selector_t;
+
+	assignment_t(device::id_t device_id, requirements_t requirements) :
+		device_id_(device_id), requirements_(requirements), start_(::std::chrono::steady_clock::now()) { }
+
+protected: // data members
+	device::id_t                                         device_id_;
+	requirements_t                                       requirements_;
+	::std::chrono::steady_clock::time_point              start_;
+	/**
+	 * Marks where the work begins on the stream it is enqueued on, if @ref device_selector_t::begin
+	 * was used; shared, as assignments are copied
+	 */
+	::std::shared_ptr<event_pool::pooled_event_t>        started_;
+};
+
+/**
+ * @brief Assigns work to devices according to their current load, using a pluggable policy.
+ *
+ * Work is assigned with @ref assign() ; once it is complete - or once it has been
+ * enqueued - it is retired with @ref retire() or @ref retire_when() respectively.
+ * The duration of each piece of work determines its device's throughput. Only the
+ * work's own execution is timed - not any time spent waiting for work enqueued
+ * before it, which is instead accounted for by the device's outstanding work:
+ *
+ *   - work performed right after being assigned, e.g. synchronously, is timed
+ *     from its assignment to its retirement with @ref retire() ;
+ *   - work enqueued on a stream is timed on the device itself, from the point
+ *     marked with @ref begin() to its conclusion - regardless of when the selector
+ *     happens to notice it has concluded. Such work not marked with @ref begin()
+ *     is retired without being timed.
+ *
+ * @note Thread-safe.
+ */
+class device_selector_t {
+public: // getters
+	const ::std::vector<device_t>& devices() const noexcept { return devices_; }
+
+public: // mutators
+
+	/**
+	 * @brief Choose a device for a piece of work, and count the work towards its load
+	 *
+	 * @throws ::std::runtime_error if no device has enough free memory for the work
+	 */
+	assignment_t assign(requirements_t requirements = {})
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		retire_occurred_events();
+		auto loads = current_loads();
+		::std::vector<device_load_t> eligible;
+		::std::vector<size_t> state_indices;
+		for(size_t i = 0; i < loads.size(); i++) {
+			if (loads[i].free_memory >= requirements.memory) {
+				eligible.push_back(loads[i]);
+				state_indices.push_back(i);
+			}
+		}
+		if (eligible.empty()) {
+			throw ::std::runtime_error("No device has " + ::std::to_string(requirements.memory)
+				+ " bytes of free memory for the work to be assigned");
+		}
+		auto chosen = policy_(eligible, requirements, random_engine_);
+		if (chosen >= eligible.size()) {
+			throw ::std::logic_error("A device selection policy chose an invalid device index");
+		}
+		auto& state = states_[state_indices[chosen]];
+		state.outstanding_work += requirements.work_units;
+		// Until the free memory is re-obtained, assume the work will use what it requires
+		state.free_memory -= ::std::min(state.free_memory, requirements.memory);
+		return { eligible[chosen].device_id, requirements };
+	}
+
+	/**
+	 * @brief Mark where the assigned work begins on @p stream , so that its
+	 * execution may be timed on the device
+	 *
+	 * @note To be called right before enqueueing the work - after any earlier work on
+	 * the stream, whose duration would otherwise be counted as this work's.
+	 */
+	void begin(assignment_t& assignment, const stream_t& stream)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto started = ::std::make_shared<event_pool::pooled_event_t>(
+			state_of(assignment.device_id_).timing_events->acquire());
+		started->get().record(stream);
+		assignment.started_ = ::std::move(started);
+	}
+
+	/**
+	 * @brief Retire work which has been completed - timing it from its assignment
+	 */
+	void retire(const assignment_t& assignment)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		retire(assignment, ::std::chrono::duration<double>(clock_t::now() - assignment.start_).count());
+	}
+
+	/**
+	 * @brief Retire work once @p event - recorded after the work - occurs
+	 *
+	 * @note The work is only timed if it was marked with @ref begin() and
+	 * @p event records timings; prefer the overload taking a stream.
+	 */
+	void retire_when(const assignment_t& assignment, event_t event)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		pending_.push_back({ assignment, event_pool::pooled_event_t{ ::std::move(event), nullptr } });
+	}
+
+	/**
+	 * @brief Retire work - enqueued on @p stream - once the stream gets through it
+	 */
+	void retire_when(const assignment_t& assignment, const stream_t& stream)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto completed = state_of(assignment.device_id_).timing_events->acquire();
+		completed->record(stream);
+		pending_.push_back({ assignment, ::std::move(completed) });
+	}
+
+	/**
+	 * @return the current loads of all devices, e.g. for monitoring
+	 */
+	::std::vector<device_load_t> loads()
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		retire_occurred_events();
+		return current_loads();
+	}
+
+	void set_policy(policy_t policy)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		policy_ = ::std::move(policy);
+	}
+
+public: // constructors
+	/**
+	 * @param devices the devices to choose among
+	 */
+	explicit device_selector_t(
+		::std::vector<device_t>  devices,
+		policy_t                 policy = policies::least_loaded(),
+		selector_options_t       options = {})
+	:
+		devices_(::std::move(devices)),
+		policy_(::std::move(policy)),
+		options_(options),
+		random_engine_(::std::random_device{}())
+	{
+		if (devices_.empty()) { throw ::std::invalid_argument("A device selector needs at least one device"); }
+		for(const auto& device : devices_) {
+			state_t state;
+			state.device_id = device.id();
+			state.total_memory = device::get(device.id()).properties().global_memory_size();
+			state.timing_events = ::std::make_shared<event_pool_t>(device, event::sync_by_blocking, event::do_record_timings);
+			states_.push_back(::std::move(state));
+		}
+	}
+
+	/**
+	 * Choose among all (visible) devices
+	 */
+	explicit device_selector_t(policy_t policy = policies::least_loaded(), selector_options_t options = {}) :
+		device_selector_t(cuda::devices().selection().devices(), ::std::move(policy), options) { }
+
+protected: // types
+	using clock_t = ::std::chrono::steady_clock;
+
+	struct state_t {
+		device::id_t       device_id;
+		size_t             total_memory { 0 };
+		size_t             free_memory { 0 };
+		clock_t::time_point free_memory_obtained_at { };
+		bool               has_free_memory { false };
+		double             outstanding_work { 0 };
+		double             throughput { 0 };
+		/** For marking the beginnings and ends of work on the device's streams */
+		::std::shared_ptr<event_pool_t> timing_events;
+	};
+
+	struct pending_retirement_t {
+		assignment_t                 assignment;
+		event_pool::pooled_event_t   event;
+	};
+
+protected: // non-mutators
+	/**
+	 * @return the time the work took to execute, as measured by the device - or 0
+	 * if it can't be measured
+	 */
+	static double seconds_taken(const pending_retirement_t& pending)
+	{
+		if (not pending.assignment.started_) { return 0; }
+		try {
+			return ::std::chrono::duration<double>(
+				event::time_elapsed_between(pending.assignment.started_->get(), pending.event.get())).count();
+		}
+		catch(cuda::runtime_error&) {
+			// The event does not record timings
+			return 0;
+		}
+	}
+
+	static int current_cpu() noexcept
+	{
+#if defined(__linux__)
+		return sched_getcpu();
+#else
+		return -1;
+#endif
+	}
+
+protected: // mutators
+	state_t& state_of(device::id_t device_id)
+	{
+		for(auto& state : states_) {
+			if (state.device_id == device_id) { return state; }
+		}
+		throw ::std::invalid_argument("Work was not assigned by this device selector");
+	}
+
+	void retire(const assignment_t& assignment, double seconds)
+	{
+		auto& state = state_of(assignment.device_id_);
+		auto work_units = assignment.requirements_.work_units;
+		state.outstanding_work = ::std::max(0.0, state.outstanding_work - work_units);
+		if (seconds <= 0 or work_units <= 0) { return; }
+		auto measured = work_units / seconds;
+		state.throughput = (state.throughput == 0) ? measured :
+			(1 - options_.throughput_smoothing) * state.throughput + options_.throughput_smoothing * measured;
+	}
+
+	void retire_occurred_events()
+	{
+		if (pending_.empty()) { return; }
+		// (events can't be assigned, so they're moved into a new vector)
+		::std::vector<pending_retirement_t> still_pending;
+		for(auto& pending : pending_) {
+			if (pending.event->has_occurred()) { retire(pending.assignment, seconds_taken(pending)); }
+			else { still_pending.push_back(::std::move(pending)); }
+		}
+		pending_.swap(still_pending);
+	}
+
+	::std::vector<device_load_t> current_loads()
+	{
+		auto now = clock_t::now();
+		auto cpu = current_cpu();
+		double throughput_sum = 0;
+		size_t num_measured = 0;
+		for(auto& state : states_) {
+			if (not state.has_free_memory or now - state.free_memory_obtained_at >= options_.free_memory_refresh_interval) {
+				state.free_memory = device::get(state.device_id).memory().amount_free();
+				state.free_memory_obtained_at = now;
+				state.has_free_memory = true;
+			}
+			if (state.throughput > 0) {
+				throughput_sum += state.throughput;
+				num_measured++;
+			}
+		}
+		auto default_throughput = (num_measured == 0) ? 1.0 : throughput_sum / num_measured;
+		::std::vector<device_load_t> loads;
+		loads.reserve(states_.size());
+		for(const auto& state : states_) {
+			const auto& local_cpus = affinity::local_cpus(device::get(state.device_id));
+			bool is_local = cpu < 0 or local_cpus.empty() or
+				::std::binary_search(local_cpus.begin(), local_cpus.end(), static_cast<unsigned>(cpu));
+			loads.push_back({ state.device_id, state.free_memory, state.total_memory, state.outstanding_work,
+				state.throughput > 0 ? state.throughput : default_throughput, is_local });
+		}
+		return loads;
+	}
+
+protected: // data members
+	::std::vector<device_t>              devices_;
+	policy_t                             policy_;
+	selector_options_t                   options_;
+	::std::mt19937                       random_engine_;
+	::std::mutex                         mutex_;
+	::std::vector<state_t>               states_;
+	::std::vector<pending_retirement_t>  pending_;
+};
+
+} // namespace load_balancing
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_LOAD_BALANCING_HPP_
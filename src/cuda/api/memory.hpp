@@ -29,10 +29,13 @@
 #include <cuda/api/array.hpp>
 #include <cuda/api/constants.hpp>
 #include <cuda/api/current_device.hpp>
+#include <cuda/api/detail/deferred_destruction.hpp>
 #include <cuda/api/error.hpp>
 #include <cuda/api/pointer.hpp>
+#include <cuda/api/recording.hpp>
 #include <cuda_runtime.h> // needed, rather than cuda_runtime_api.h, e.g. for cudaMalloc
 
+#include <atomic>
 #include <memory>
 #include <cstring> // for ::std::memset
 #include <vector>
@@ -131,6 +134,39 @@ inline unsigned make_cuda_host_alloc_flags(allocation_options options)
 		(options.write_combining == cpu_write_combining::with_wc             ? cudaHostAllocWriteCombined : 0);
 }
 
+/**
+ * Keeps track of which device memory is known to be all-zero, so that zeroing it
+ * again can be skipped where that is explicitly requested; see zero_tracker.hpp.
+ * The functions here which write to device memory report to it, when one is set.
+ */
+class zero_state_tracker_t {
+public:
+	virtual void zeroed(void* start, size_t num_bytes) = 0;
+	virtual void written(void* start, size_t num_bytes) = 0;
+	virtual void freed(void* start) = 0;
+	virtual ~zero_state_tracker_t() = default;
+};
+
+inline ::std::atomic<zero_state_tracker_t*>& zero_state_tracker() noexcept
+{
+	static ::std::atomic<zero_state_tracker_t*> tracker { nullptr };
+	return tracker;
+}
+
+inline void report_written(void* start, size_t num_bytes)
+{
+	auto tracker = zero_state_tracker().load(::std::memory_order_relaxed);
+	if (tracker != nullptr) { tracker->written(start, num_bytes); }
+}
+
+inline void report_set(void* start, int byte_value, size_t num_bytes)
+{
+	auto tracker = zero_state_tracker().load(::std::memory_order_relaxed);
+	if (tracker == nullptr) { return; }
+	if (byte_value == 0) { tracker->zeroed(start, num_bytes); }
+	else { tracker->written(start, num_bytes); }
+}
+
 } // namespace detail_
 
 /**
@@ -181,6 +217,7 @@ namespace detail_ {
 inline region_t allocate(size_t num_bytes)
 {
 	void* allocated = nullptr;
+	auto recording_start = recording::detail_::begin();
 	// Note: the typed cudaMalloc also takes its size in bytes, apparently,
 	// not in number of elements
 	auto status = cudaMalloc(&allocated, num_bytes);
@@ -192,6 +229,8 @@ inline region_t allocate(size_t num_bytes)
 		"Failed allocating " + ::std::to_string(num_bytes) +
 		" bytes of global memory on CUDA device " +
 		::std::to_string(cuda::device::current::detail_::get_id()));
+	recording::detail_::end(recording_start, recording::detail_::make_record(
+		recording::operation_t::allocate, nullptr, nullptr, allocated, nullptr, num_bytes));
 	return {allocated, num_bytes};
 }
 
@@ -218,6 +257,7 @@ inline region_t allocate(
 {
 #if CUDART_VERSION >= 11020
 	void* allocated = nullptr;
+	auto recording_start = recording::detail_::begin();
 	// Note: the typed cudaMalloc also takes its size in bytes, apparently,
 	// not in number of elements
 	auto status = cudaMallocAsync(&allocated, num_bytes, stream_id);
@@ -230,6 +270,8 @@ inline region_t allocate(
 		" bytes of global memory "
 		+ " on stream " + cuda::detail_::ptr_as_hex(stream_id)
 		+ " on CUDA device " + ::std::to_string(device_id));
+	recording::detail_::end(recording_start, recording::detail_::make_record(
+		recording::operation_t::allocate_async, stream_id, nullptr, allocated, nullptr, num_bytes, device_id));
 	return {allocated, num_bytes};
 #else
 	(void) device_id;
@@ -266,8 +308,13 @@ inline region_t allocate(const cuda::stream_t& stream, size_t size_in_bytes);
 ///@{
 inline void free(void* ptr)
 {
+	auto recording_start = recording::detail_::begin();
 	auto result = cudaFree(ptr);
 	throw_if_error(result, "Freeing device memory at 0x" + cuda::detail_::ptr_as_hex(ptr));
+	auto tracker = memory::detail_::zero_state_tracker().load(::std::memory_order_relaxed);
+	if (tracker != nullptr) { tracker->freed(ptr); }
+	recording::detail_::end(recording_start,
+		recording::detail_::make_record(recording::operation_t::free, nullptr, nullptr, ptr));
 }
 inline void free(region_t region) { free(region.start()); }
 ///@}
@@ -292,7 +339,12 @@ struct allocator {
 	void* operator()(size_t num_bytes) const { return detail_::allocate(num_bytes).start(); }
 };
 struct deleter {
-	void operator()(void* ptr) const { cuda::memory::device::free(ptr); }
+	void operator()(void* ptr) const
+	{
+		if (not cuda::detail_::defer_destruction(cuda::detail_::destroyable_t::device_memory, ptr, -1)) {
+			cuda::memory::device::free(ptr);
+		}
+	}
 };
 } // namespace detail_
 
@@ -311,8 +363,12 @@ struct deleter {
  */
 inline void set(void* start, int byte_value, size_t num_bytes)
 {
+	auto recording_start = recording::detail_::begin();
 	auto result = cudaMemset(start, byte_value, num_bytes);
 	throw_if_error(result, "memsetting an on-device buffer");
+	memory::detail_::report_set(start, byte_value, num_bytes);
+	recording::detail_::end(recording_start, recording::detail_::make_record(
+		recording::operation_t::set, nullptr, nullptr, start, nullptr, num_bytes));
 }
 
 /**
@@ -379,10 +435,14 @@ inline void zero(T* ptr)
  */
 inline void copy(void *destination, const void *source, size_t num_bytes)
 {
+	auto recording_start = recording::detail_::begin();
 	auto result = cudaMemcpy(destination, source, num_bytes, cudaMemcpyDefault);
 	// TODO: Determine whether it was from host to device, device to host etc and
 	// add this information to the error string
 	throw_if_error(result, "Synchronously copying data");
+	memory::detail_::report_written(destination, num_bytes);
+	recording::detail_::end(recording_start, recording::detail_::make_record(
+		recording::operation_t::copy, nullptr, nullptr, destination, source, num_bytes));
 }
 
 /**
@@ -554,6 +614,7 @@ inline void copy(T *destination, const array_t<T, 2>& source)
 		dimensions.height,
 		cudaMemcpyDefault);
 	throw_if_error(result, "Synchronously copying out of a 2D CUDA array");
+	memory::detail_::report_written(destination, source.size_bytes());
 }
 
 template <typename T>
@@ -562,6 +623,7 @@ inline void copy(T* destination, const array_t<T, 3>& source)
 	const auto copy_params = detail_::copy_params_t(destination, source);
 	auto result = cudaMemcpy3D(&copy_params);
 	throw_if_error(result, "Synchronously copying from a 3-dimensional CUDA array");
+	memory::detail_::report_written(destination, source.size_bytes());
 }
 
 } // namespace detail_
@@ -617,6 +679,19 @@ namespace async {
 
 namespace detail_ {
 
+/**
+ * A replacement for how copies enqueued via @ref stream_t::enqueue_t::copy() are
+ * carried out - e.g. by choosing among several ways of copying (see copy_planner.hpp);
+ * when not set, they are plain `cudaMemcpyAsync()` calls.
+ */
+using copy_hook_t = void (*)(void* destination, const void* source, size_t num_bytes, const stream_t& stream);
+
+inline ::std::atomic<copy_hook_t>& copy_hook() noexcept
+{
+	static ::std::atomic<copy_hook_t> hook { nullptr };
+	return hook;
+}
+
 /**
  * Asynchronously copies data between memory spaces or within a memory space.
  *
@@ -639,11 +714,15 @@ namespace detail_ {
 */
 inline void copy(void* destination, const void* source, size_t num_bytes, stream::id_t stream_id)
 {
+	auto recording_start = recording::detail_::begin();
 	auto result = cudaMemcpyAsync(destination, source, num_bytes, cudaMemcpyDefault, stream_id);
 
 	// TODO: Determine whether it was from host to device, device to host etc and
 	// add this information to the error string
 	throw_if_error(result, "Scheduling a memory copy on stream " + cuda::detail_::ptr_as_hex(stream_id));
+	memory::detail_::report_written(destination, num_bytes);
+	recording::detail_::end(recording_start, recording::detail_::make_record(
+		recording::operation_t::copy_async, stream_id, nullptr, destination, source, num_bytes));
 }
 
 template<typename T>
@@ -660,6 +739,7 @@ void copy(T* destination, const array_t<T, 3>& source, stream::id_t stream_id)
 	const auto copy_params = memory::detail_::copy_params_t(destination, source);
 	auto result = cudaMemcpy3DAsync(&copy_params, stream_id);
 	throw_if_error(result, "Scheduling a memory copy out of a 3D CUDA array on stream " + cuda::detail_::ptr_as_hex(stream_id));
+	memory::detail_::report_written(destination, source.size_bytes());
 }
 
 template<typename T>
@@ -700,6 +780,7 @@ void copy(T* destination, const array_t<T, 2>& source, cuda::stream::id_t stream
 		cudaMemcpyDefault,
 		stream_id);
 	throw_if_error(result, "Scheduling a memory copy out of a 3D CUDA array on stream " + cuda::detail_::ptr_as_hex(stream_id));
+	memory::detail_::report_written(destination, source.size_bytes());
 }
 
 /**
@@ -846,8 +927,12 @@ namespace detail_ {
 inline void set(void* start, int byte_value, size_t num_bytes, stream::id_t stream_id)
 {
 	// TODO: Double-check that this call doesn't require setting the current device
+	auto recording_start = recording::detail_::begin();
 	auto result = cudaMemsetAsync(start, byte_value, num_bytes, stream_id);
 	throw_if_error(result, "asynchronously memsetting an on-device buffer");
+	memory::detail_::report_set(start, byte_value, num_bytes);
+	recording::detail_::end(recording_start, recording::detail_::make_record(
+		recording::operation_t::set_async, stream_id, nullptr, start, nullptr, num_bytes));
 }
 
 inline void set(region_t region, int byte_value, stream::id_t stream_id)
@@ -0,0 +1,404 @@
+/**
+ * @file mirrored_buffer.hpp
+ *
+ * @brief A buffer with a (pinned) host-side copy and a device-side copy,
+ * kept coherent lazily - with data only being copied to a side when it is
+ * actually accessed there, and only for those blocks which the other side
+ * has modified.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_MIRRORED_BUFFER_HPP_
+#define CUDA_API_WRAPPERS_MIRRORED_BUFFER_HPP_
+
+#include <cuda/api/device.hpp>
+#include <cuda/api/event.hpp>
+#include <cuda/api/memory.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/stream.hpp>
+#include <cuda/api/unique_ptr.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace cuda {
+
+namespace mirrored_buffer {
+
+/**
+ * The coherence state of a single block of a @ref mirrored_buffer_t
+ */
+enum class block_state_t : unsigned char {
+	/** Both sides hold the same data (or neither has been written to yet) */
+	synchronized,
+	/** The host-side copy was modified; the device-side copy is stale */
+	host_is_newer,
+	/** The device-side copy was modified; the host-side copy is stale */
+	device_is_newer,
+};
+
+/**
+ * The default granularity of coherence tracking, in bytes; rounded down
+ * to a whole number of elements.
+ */
+enum : size_t { default_block_size_in_bytes = 64 * 1024 };
+
+/**
+ * Indicates a range extending to the end of a buffer
+ */
+enum : size_t { to_end = ::std::numeric_limits<size_t>::max() };
+
+/**
+ * Counters of the copying a @ref mirrored_buffer_t has actually performed
+ */
+struct statistics_t {
+	size_t bytes_copied_to_device { 0 };
+	size_t bytes_copied_to_host   { 0 };
+	size_t copies_to_device       { 0 };
+	size_t copies_to_host         { 0 };
+};
+
+} // namespace mirrored_buffer
+
+/**
+ * @brief A pair of equally-sized buffers, one in pinned host memory and
+ * one in a CUDA device's global memory, with lazy coherence between them.
+ *
+ * The buffer is split into fixed-size blocks, and each block is tracked as
+ * being either in-sync, newer on the host or newer on the device. Requesting
+ * a view of either side enqueues copies only for those blocks the other
+ * side has modified since the last synchronization, with runs of consecutive
+ * stale blocks coalesced into a single copy.
+ *
+ * @note Modifications are only known to the buffer if they are declared: Either
+ * by obtaining a view "for writing", or by explicitly marking a range as
+ * modified on one of the sides.
+ *
+ * @note Device-side views are stream-ordered: the copies they require are
+ * enqueued on the specified stream, and it is up to the user to order work
+ * on other streams after them. Host-side views, on the other hand, are only
+ * returned after the data has actually arrived.
+ *
+ * @tparam T the element type; must be trivially copyable, as elements are
+ * moved between the host and the device by raw memory copies.
+ */
+template <typename T>
+class mirrored_buffer_t {
+	static_assert(::std::is_trivially_copyable<T>::value,
+		"Only trivially-copyable element types can be mirrored between host and device memory");
+
+public: // types
+	using value_type = T;
+	using block_state_t = mirrored_buffer::block_state_t;
+	using statistics_t = mirrored_buffer::statistics_t;
+
+public: // getters
+	size_t size() const noexcept { return size_; }
+	size_t size_in_bytes() const noexcept { return size_ * sizeof(T); }
+	size_t block_size() const noexcept { return block_size_; }
+	size_t num_blocks() const noexcept { return block_states_.size(); }
+	device_t device() const noexcept { return device::get(device_id_); }
+	const statistics_t& statistics() const noexcept { return statistics_; }
+
+	block_state_t block_state(size_t block_index) const { return block_states_.at(block_index); }
+
+	/**
+	 * @brief Obtain the raw host-side pointer, without any coherence actions
+	 */
+	T* raw_host_data() const noexcept { return host_data_.get(); }
+
+	/**
+	 * @brief Obtain the raw device-side pointer, without any coherence actions
+	 */
+	T* raw_device_data() const noexcept { return device_data_.get(); }
+
+public: // views
+
+	/**
+	 * @brief Obtain an up-to-date host-side copy of the entire buffer for reading.
+	 *
+	 * @param stream the stream on which to enqueue device-to-host copies of blocks
+	 * which are newer on the device; the method returns after these have concluded.
+	 */
+	const T* host_view(const stream_t& stream)
+	{
+		make_host_current(stream, 0, num_blocks());
+		return host_data_.get();
+	}
+
+	/**
+	 * @brief Same as @ref host_view(const stream_t&), copying on the device's default stream.
+	 */
+	const T* host_view() { return host_view(device().default_stream()); }
+
+	/**
+	 * @brief Obtain an up-to-date host-side copy of (part of) the buffer, for writing.
+	 *
+	 * Blocks overlapping the specified range become newer on the host.
+	 *
+	 * @param stream the stream on which to enqueue device-to-host copies, if any are necessary
+	 * @param first index of the first element the caller intends to modify
+	 * @param count number of elements the caller intends to modify
+	 * @return the beginning of the (entire) host-side buffer
+	 */
+	T* host_view_for_writing(const stream_t& stream, size_t first = 0, size_t count = mirrored_buffer::to_end)
+	{
+		auto blocks = block_range(first, count);
+		make_host_current(stream, blocks.first, blocks.second);
+		// The host is about to be written to - so earlier uploads from it must have concluded
+		await_pending_upload();
+		set_states(blocks.first, blocks.second, block_state_t::host_is_newer);
+		return host_data_.get();
+	}
+
+	/**
+	 * @brief Obtain an up-to-date device-side copy of the entire buffer for reading.
+	 *
+	 * @param stream the stream on which to enqueue host-to-device copies of blocks
+	 * which are newer on the host; the device-side data may only be used by work
+	 * ordered after these copies.
+	 */
+	const T* device_view(const stream_t& stream)
+	{
+		make_device_current(stream, 0, num_blocks());
+		return device_data_.get();
+	}
+
+	/**
+	 * @brief Obtain an up-to-date device-side copy of (part of) the buffer, for writing.
+	 *
+	 * Blocks overlapping the specified range become newer on the device.
+	 *
+	 * @param stream the stream on which to enqueue host-to-device copies, if any are necessary
+	 * @param first index of the first element the caller intends to modify
+	 * @param count number of elements the caller intends to modify
+	 * @return the beginning of the (entire) device-side buffer
+	 */
+	T* device_view_for_writing(const stream_t& stream, size_t first = 0, size_t count = mirrored_buffer::to_end)
+	{
+		auto blocks = block_range(first, count);
+		make_device_current(stream, blocks.first, blocks.second);
+		set_states(blocks.first, blocks.second, block_state_t::device_is_newer);
+		return device_data_.get();
+	}
+
+public: // explicit state changes
+
+	/**
+	 * @brief Declare that a range of elements has been modified via the host-side pointer
+	 *
+	 * @throws ::std::logic_error if any of the affected blocks is newer on the
+	 * device, as the modification would then conflict with the device's.
+	 */
+	void mark_host_modified(size_t first = 0, size_t count = mirrored_buffer::to_end)
+	{
+		auto blocks = block_range(first, count);
+		ensure_no_conflict(blocks, block_state_t::device_is_newer, "host");
+		await_pending_upload();
+		set_states(blocks.first, blocks.second, block_state_t::host_is_newer);
+	}
+
+	/**
+	 * @brief Declare that a range of elements has been modified via the device-side pointer
+	 *
+	 * @throws ::std::logic_error if any of the affected blocks is newer on the
+	 * host, as the modification would then conflict with the host's.
+	 */
+	void mark_device_modified(size_t first = 0, size_t count = mirrored_buffer::to_end)
+	{
+		auto blocks = block_range(first, count);
+		ensure_no_conflict(blocks, block_state_t::host_is_newer, "device");
+		set_states(blocks.first, blocks.second, block_state_t::device_is_newer);
+	}
+
+	/**
+	 * @brief Make both sides coherent, copying in whichever direction each block requires.
+	 *
+	 * @note returns after all copies have concluded.
+	 */
+	void synchronize(const stream_t& stream)
+	{
+		make_device_current(stream, 0, num_blocks());
+		make_host_current(stream, 0, num_blocks());
+		await_pending_upload();
+	}
+
+protected: // non-mutators
+
+	using block_range_t = ::std::pair<size_t, size_t>; // [first, last) block indices
+
+	block_range_t block_range(size_t first, size_t count) const
+	{
+		if (first > size_) {
+			throw ::std::out_of_range("Element index " + ::std::to_string(first)
+				+ " is past the end of a mirrored buffer of size " + ::std::to_string(size_));
+		}
+		auto end = (count == mirrored_buffer::to_end or count > size_ - first) ? size_ : first + count;
+		if (first == end) { return { 0, 0 }; }
+		return { first / block_size_, (end - 1) / block_size_ + 1 };
+	}
+
+	void ensure_no_conflict(block_range_t blocks, block_state_t conflicting_state, const char* modifier) const
+	{
+		auto begin = block_states_.cbegin();
+		if (::std::find(begin + blocks.first, begin + blocks.second, conflicting_state) != begin + blocks.second) {
+			throw ::std::logic_error(::std::string("Attempt to mark a mirrored buffer range as modified on the ")
+				+ modifier + " while it has unsynchronized modifications on the other side");
+		}
+	}
+
+protected: // mutators
+
+	void set_states(size_t first_block, size_t end_block, block_state_t new_state)
+	{
+		::std::fill(block_states_.begin() + first_block, block_states_.begin() + end_block, new_state);
+	}
+
+	/**
+	 * Enqueues a copy for each maximal run of consecutive blocks within
+	 * [first_block, end_block) in the specified state, marking them synchronized
+	 *
+	 * @return the number of copies enqueued
+	 */
+	template <typename CopyRun>
+	size_t for_each_stale_run(size_t first_block, size_t end_block, block_state_t stale_state, CopyRun copy_run)
+	{
+		size_t num_copies { 0 };
+		auto block_index = first_block;
+		while (block_index < end_block) {
+			if (block_states_[block_index] != stale_state) { block_index++; continue; }
+			auto run_start = block_index;
+			while (block_index < end_block and block_states_[block_index] == stale_state) {
+				block_states_[block_index++] = block_state_t::synchronized;
+			}
+			auto first_element = run_start * block_size_;
+			auto num_elements = ::std::min(block_index * block_size_, size_) - first_element;
+			copy_run(first_element, num_elements * sizeof(T));
+			num_copies++;
+		}
+		return num_copies;
+	}
+
+	void make_host_current(const stream_t& stream, size_t first_block, size_t end_block)
+	{
+		auto num_copies = for_each_stale_run(first_block, end_block, block_state_t::device_is_newer,
+			[&](size_t first_element, size_t num_bytes) {
+				memory::async::copy(host_data_.get() + first_element, device_data_.get() + first_element, num_bytes, stream);
+				statistics_.bytes_copied_to_host += num_bytes;
+			});
+		if (num_copies == 0) { return; }
+		statistics_.copies_to_host += num_copies;
+		stream.synchronize();
+	}
+
+	void make_device_current(const stream_t& stream, size_t first_block, size_t end_block)
+	{
+		auto num_copies = for_each_stale_run(first_block, end_block, block_state_t::host_is_newer,
+			[&](size_t first_element, size_t num_bytes) {
+				memory::async::copy(device_data_.get() + first_element, host_data_.get() + first_element, num_bytes, stream);
+				statistics_.bytes_copied_to_device += num_bytes;
+			});
+		if (num_copies == 0) { return; }
+		statistics_.copies_to_device += num_copies;
+		upload_completion_.record(stream);
+		upload_pending_ = true;
+	}
+
+	/**
+	 * The host-side buffer must not be written to while it's still being
+	 * copied from, asynchronously, onto the device.
+	 */
+	void await_pending_upload()
+	{
+		if (not upload_pending_) { return; }
+		upload_completion_.synchronize();
+		upload_pending_ = false;
+	}
+
+public: // constructors and destructor
+
+	/**
+	 * @brief Allocates a mirrored buffer, with unspecified (but coherent) initial contents.
+	 *
+	 * @param device the device on which to allocate the device-side copy
+	 * @param num_elements number of elements of type T in the buffer
+	 * @param elements_per_block granularity of coherence tracking
+	 */
+	mirrored_buffer_t(
+		device_t  device,
+		size_t    num_elements,
+		size_t    elements_per_block = ::std::max<size_t>(1, mirrored_buffer::default_block_size_in_bytes / sizeof(T)))
+	:
+		device_id_(device.id()),
+		size_(num_elements),
+		block_size_(elements_per_block),
+		host_data_(memory::host::make_unique<T[]>(num_elements)),
+		device_data_(memory::device::make_unique<T[]>(device, num_elements)),
+		block_states_(
+			elements_per_block == 0 ? 0 : (num_elements + elements_per_block - 1) / elements_per_block,
+			block_state_t::synchronized),
+		upload_completion_(device.create_event(event::sync_by_blocking, event::dont_record_timings))
+	{
+		if (elements_per_block == 0) {
+			throw ::std::invalid_argument("A mirrored buffer's blocks cannot be empty");
+		}
+	}
+
+	/**
+	 * @brief Allocates a mirrored buffer, initializing its host-side copy
+	 * with existing data (which will only be copied to the device once needed there).
+	 */
+	mirrored_buffer_t(
+		device_t  device,
+		const T*  initial_contents,
+		size_t    num_elements,
+		size_t    elements_per_block = ::std::max<size_t>(1, mirrored_buffer::default_block_size_in_bytes / sizeof(T)))
+	: mirrored_buffer_t(device, num_elements, elements_per_block)
+	{
+		::std::copy(initial_contents, initial_contents + num_elements, host_data_.get());
+		set_states(0, num_blocks(), block_state_t::host_is_newer);
+	}
+
+	mirrored_buffer_t(const mirrored_buffer_t&) = delete;
+	mirrored_buffer_t(mirrored_buffer_t&& other) :
+		device_id_(other.device_id_),
+		size_(other.size_),
+		block_size_(other.block_size_),
+		host_data_(::std::move(other.host_data_)),
+		device_data_(::std::move(other.device_data_)),
+		block_states_(::std::move(other.block_states_)),
+		upload_completion_(::std::move(other.upload_completion_)),
+		upload_pending_(other.upload_pending_),
+		statistics_(other.statistics_)
+	{
+		other.upload_pending_ = false;
+	}
+
+	~mirrored_buffer_t()
+	{
+		// The host-side buffer is about to be freed; it must not be in use
+		if (upload_pending_) { upload_completion_.synchronize(); }
+	}
+
+public: // operators
+	mirrored_buffer_t& operator=(const mirrored_buffer_t&) = delete;
+	mirrored_buffer_t& operator=(mirrored_buffer_t&&) = delete;
+
+protected: // data members
+	device::id_t                      device_id_;
+	size_t                            size_;
+	size_t                            block_size_;
+	memory::host::unique_ptr<T[]>     host_data_;
+	memory::device::unique_ptr<T[]>   device_data_;
+	::std::vector<block_state_t>      block_states_;
+	event_t                           upload_completion_;
+	bool                              upload_pending_ { false };
+	statistics_t                      statistics_;
+};
+
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_MIRRORED_BUFFER_HPP_
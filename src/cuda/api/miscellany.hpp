@@ -34,6 +34,28 @@ void force_runtime_initialization()
 
 namespace device {
 
+///@cond
+namespace detail_ {
+
+inline device::id_t uncached_count()
+{
+	int device_count = 0; // Initializing, just to be on the safe side
+	status_t result = cudaGetDeviceCount(&device_count);
+	if (result == status::no_device) {
+		return 0;
+	}
+	else {
+		throw_if_error(result, "Failed obtaining the number of CUDA devices on the system");
+	}
+	if (device_count < 0) {
+		throw ::std::logic_error("cudaGetDeviceCount() reports an invalid number of CUDA devices");
+	}
+	return device_count;
+}
+
+} // namespace detail_
+///@endcond
+
 /**
  * Get the number of CUDA devices usable on the system (with the current CUDA
  * library and kernel driver)
@@ -43,22 +65,16 @@ namespace device {
  * change in the future). So... the returned type is the same as in cudaGetDeviceCount,
  * a signed integer.
  *
+ * @note CUDA devices aren't hot-pluggable, and the set of devices visible to a
+ * process is fixed once the runtime initializes; so the count is only obtained
+ * from the runtime on the first call (which succeeds).
+ *
  * @return the number of CUDA devices on this system
  * @throws cuda::error if the device count could not be obtained
  */
 inline device::id_t  count()
 {
-	int device_count = 0; // Initializing, just to be on the safe side
-	status_t result = cudaGetDeviceCount(&device_count);
-	if (result == status::no_device) {
-		return 0;
-	}
-	else {
-		throw_if_error(result, "Failed obtaining the number of CUDA devices on the system");
-	}
-	if (device_count < 0) {
-		throw ::std::logic_error("cudaGetDeviceCount() reports an invalid number of CUDA devices");
-	}
+	static const device::id_t device_count = detail_::uncached_count();
 	return device_count;
 }
 
@@ -14,6 +14,7 @@
 #include <cuda/api/event.hpp>
 #include <cuda/api/kernel_launch.hpp>
 #include <cuda/api/pointer.hpp>
+#include <cuda/api/recording.hpp>
 #include <cuda/api/stream.hpp>
 #include <cuda/api/unique_ptr.hpp>
 #include <cuda_runtime.h>
@@ -165,11 +166,14 @@ inline void stream_t::enqueue_t::wait(const event_t& event_)
 	// Required by the CUDA runtime API; the flags value is currently unused
 	constexpr const unsigned int flags = 0;
 
+	auto recording_start = recording::detail_::begin();
 	auto status = cudaStreamWaitEvent(associated_stream.id_, event_.id(), flags);
 	throw_if_error(status,
 		::std::string("Failed scheduling a wait for event ") + cuda::detail_::ptr_as_hex(event_.id())
 		+ " on stream " + cuda::detail_::ptr_as_hex(associated_stream.id_)
 		+ " on CUDA device " + ::std::to_string(device_id));
+	recording::detail_::end(recording_start, recording::detail_::make_record(
+		recording::operation_t::wait_event, associated_stream.id_, event_.id(), nullptr, nullptr, 0, device_id));
 
 }
 
@@ -259,6 +263,50 @@ inline void zero(void* start, size_t num_bytes, const stream_t& stream)
 	detail_::zero(start, num_bytes, stream.id());
 }
 
+template <typename T>
+void fill(T* start, const T& value, size_t num_elements, const stream_t& stream)
+{
+	cuda::device::current::detail_::scoped_override_t set_device_for_this_scope(stream.device().id());
+	detail_::fill(start, value, num_elements, stream.id());
+}
+
+template <typename T>
+void fill_2d(
+	T*               start,
+	size_t           pitch_in_bytes,
+	size_t           width_in_elements,
+	size_t           height,
+	const T&         value,
+	const stream_t&  stream)
+{
+	cuda::device::current::detail_::scoped_override_t set_device_for_this_scope(stream.device().id());
+	detail_::fill_2d(start, pitch_in_bytes, width_in_elements, height, value, stream.id());
+}
+
+#if defined(__CUDACC__)
+
+template <typename T>
+void fill_by_kernel(T* start, const T& value, size_t num_elements, const stream_t& stream)
+{
+	cuda::device::current::detail_::scoped_override_t set_device_for_this_scope(stream.device().id());
+	detail_::fill_by_kernel(start, value, num_elements, stream.id());
+}
+
+template <typename T>
+void fill_2d_by_kernel(
+	T*               start,
+	size_t           pitch_in_bytes,
+	size_t           width_in_elements,
+	size_t           height,
+	const T&         value,
+	const stream_t&  stream)
+{
+	cuda::device::current::detail_::scoped_override_t set_device_for_this_scope(stream.device().id());
+	detail_::fill_2d_by_kernel(start, pitch_in_bytes, width_in_elements, height, value, stream.id());
+}
+
+#endif // defined(__CUDACC__)
+
 } // namespace async
 
 /**
@@ -548,11 +596,14 @@ namespace detail_ {
 
 inline void record_event_on_current_device(device::id_t device_id, stream::id_t stream_id, event::id_t event_id)
 {
+	auto recording_start = recording::detail_::begin();
 	auto status = cudaEventRecord(event_id, stream_id);
 	throw_if_error(status,
 		"Failed scheduling event " + cuda::detail_::ptr_as_hex(event_id) + " to occur"
 		+ " on stream " + cuda::detail_::ptr_as_hex(stream_id)
 		+ " on CUDA device " + ::std::to_string(device_id));
+	recording::detail_::end(recording_start, recording::detail_::make_record(
+		recording::operation_t::record_event, stream_id, event_id, nullptr, nullptr, 0, device_id));
 }
 } // namespace detail_
 
@@ -9,11 +9,13 @@
 #define CUDA_API_WRAPPERS_PCI_ID_CUH_
 
 #include <cuda/api/error.hpp>
+#include <cuda/api/miscellany.hpp>
 #include <cuda/common/types.hpp>
 
 #include <cuda_runtime_api.h>
 
 #include <string>
+#include <vector>
 
 namespace cuda {
 namespace device {
@@ -42,20 +44,91 @@ public:
 
 namespace detail_ {
 
+/**
+ * @return true if both locations are of the same device; the function is
+ * ignored (CUDA devices only use function 0), as is the domain if either
+ * location leaves it unspecified
+ */
+inline bool same_device(const pci_location_t& lhs, const pci_location_t& rhs) noexcept
+{
+	return lhs.bus == rhs.bus and lhs.device == rhs.device and
+		(lhs.domain == rhs.domain or lhs.domain == pci_location_t::unused or rhs.domain == pci_location_t::unused);
+}
+
+/**
+ * The PCI locations of all devices on the system, indexed by device id;
+ * since devices aren't hot-pluggable, this is only determined once.
+ */
+class pci_table_t {
+public:
+	id_t num_devices() const noexcept { return static_cast<id_t>(locations_.size()); }
+
+	const pci_location_t& location_of(id_t device_id) const
+	{
+		if (device_id < 0 or device_id >= num_devices()) {
+			throw cuda::runtime_error(status::invalid_device,
+				"No CUDA device with id " + ::std::to_string(device_id));
+		}
+		return locations_[device_id];
+	}
+
+	/**
+	 * @return the id of the device at @p pci_id , or cudaInvalidDeviceId if there is none
+	 */
+	id_t find(const pci_location_t& pci_id) const noexcept
+	{
+		// There are at most a few dozen devices, so a linear search is fastest
+		for(id_t device_id = 0; device_id < num_devices(); device_id++) {
+			if (same_device(locations_[device_id], pci_id)) { return device_id; }
+		}
+		return cudaInvalidDeviceId;
+	}
+
+	pci_table_t()
+	{
+		auto get_attribute = [](cudaDeviceAttr attribute, id_t device_id) {
+			int value;
+			auto status = cudaDeviceGetAttribute(&value, attribute, device_id);
+			throw_if_error(status, "Failed obtaining the PCI location of CUDA device " + ::std::to_string(device_id));
+			return value;
+		};
+		auto num_devices = device::count();
+		locations_.reserve(num_devices);
+		for(id_t device_id = 0; device_id < num_devices; device_id++) {
+			locations_.push_back({
+				get_attribute(cudaDevAttrPciDomainId, device_id),
+				get_attribute(cudaDevAttrPciBusId, device_id),
+				get_attribute(cudaDevAttrPciDeviceId, device_id),
+				0 });
+		}
+	}
+
+protected:
+	::std::vector<pci_location_t> locations_;
+};
+
+inline const pci_table_t& pci_table()
+{
+	static const pci_table_t table;
+	return table;
+}
+
 /**
  * Obtain a CUDA device id for a PCIe bus device
  *
  * @param pci_id the location on (one of) the PCI bus(es) of
  * the device of interest
+ *
+ * @note Answered from a table built on first use, rather than by the CUDA runtime
  */
 inline id_t resolve_id(pci_location_t pci_id)
 {
-	::std::string as_string { pci_id };
-	id_t cuda_device_id;
-	auto result = cudaDeviceGetByPCIBusId(&cuda_device_id, as_string.c_str());
-	throw_if_error(result,
-		"Failed obtaining a CUDA device ID corresponding to PCI id " + as_string);
-	return cuda_device_id;
+	auto device_id = pci_table().find(pci_id);
+	if (device_id == cudaInvalidDeviceId) {
+		throw cuda::runtime_error(status::invalid_device,
+			"Failed obtaining a CUDA device ID corresponding to PCI id " + ::std::string{pci_id});
+	}
+	return device_id;
 }
 
 } // namespace detail_
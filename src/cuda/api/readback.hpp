@@ -0,0 +1,429 @@
+/**
+ * @file readback.hpp
+ *
+ * @brief Batching the reading back of many small device-side values - flags,
+ * counters and the like - so that each batch costs a single device-to-host
+ * transfer and a single synchronization, rather than one of each per value.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_READBACK_HPP_
+#define CUDA_API_WRAPPERS_READBACK_HPP_
+
+#include <cuda/api/device.hpp>
+#include <cuda/api/event.hpp>
+#include <cuda/api/memory.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/stream.hpp>
+#include <cuda/api/unique_ptr.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace cuda {
+
+namespace readback {
+
+/**
+ * Where the scalars made by a @ref readback_collector_t reside
+ */
+enum class staging_kind_t {
+	/**
+	 * In device global memory; each flush copies the range of them being
+	 * read to the host, in a single transfer
+	 */
+	device_memory,
+	/**
+	 * In mapped pinned host memory, which the device accesses over the
+	 * interconnect; flushes involve no transfer at all, but device-side
+	 * accesses to the scalars are slower
+	 */
+	mapped_memory
+};
+
+struct statistics_t {
+	size_t flushes            { 0 };
+	size_t values_read        { 0 };
+	/** Values read as part of a contiguous transfer of the staging area */
+	size_t gathered_values    { 0 };
+	/** Values outside the staging area, each of which requires a transfer of its own */
+	size_t individual_values  { 0 };
+	size_t transfers          { 0 };
+};
+
+} // namespace readback
+
+/**
+ * @brief Collects requests to read back scalars from device memory, and satisfies
+ * them all together, with a single transfer, when flushed.
+ *
+ * Scalars made with @ref make_scalar() reside in a contiguous staging area, so that
+ * whichever of them are read are copied to the host in one transfer. Other device-side
+ * values may be read as well, but each of those requires a transfer of its own.
+ *
+ * Typical use, in a control loop:
+ *
+ *   auto done = collector.make_scalar<int>();   // once
+ *   ...
+ *   my_kernel<<<..., stream>>>(done, ...);
+ *   auto is_done = collector.read(done);
+ *   auto count = collector.read(some_counter);
+ *   collector.flush(stream);
+ *   if (is_done.get()) { ... }
+ *
+ * @note Reads are only carried out once flushed; their values are those the scalars
+ * have once the work enqueued on the flushing stream before the flush has concluded.
+ */
+class readback_collector_t {
+public: // types
+	using staging_kind_t = readback::staging_kind_t;
+	using statistics_t = readback::statistics_t;
+
+public: // getters
+	device_t device() const noexcept { return device::get(device_id_); }
+	size_t staging_area_size() const noexcept { return staging_size_; }
+	size_t staging_area_used() const noexcept { return staging_used_; }
+	staging_kind_t staging_kind() const noexcept { return staging_kind_; }
+
+	statistics_t statistics() const
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		return statistics_;
+	}
+
+public: // mutators
+	/**
+	 * @brief Allocate a scalar in the staging area, for device-side code to write to.
+	 *
+	 * @return a device-accessible pointer to the scalar, valid as long as the collector is
+	 * @throws ::std::length_error if the staging area has no room left for the scalar
+	 */
+	template <typename T>
+	T* make_scalar()
+	{
+		static_assert(::std::is_trivially_copyable<T>::value,
+			"Only trivially-copyable values can be read back from device memory");
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto offset = (staging_used_ + alignof(T) - 1) / alignof(T) * alignof(T);
+		if (offset + sizeof(T) > staging_size_) {
+			throw ::std::length_error("No room left for another scalar in a readback staging area of "
+				+ ::std::to_string(staging_size_) + " bytes");
+		}
+		staging_used_ = offset + sizeof(T);
+		return reinterpret_cast<T*>(device_staging_ + offset);
+	}
+
+	/**
+	 * @brief Request reading back a device-side value with the next flush.
+	 *
+	 * @param device_scalar a device-accessible address; preferably made with
+	 * @ref make_scalar(), so as to not require a transfer of its own
+	 * @return the value, once the flush has concluded
+	 */
+	template <typename T>
+	::std::future<T> read(const T* device_scalar)
+	{
+		static_assert(::std::is_trivially_copyable<T>::value,
+			"Only trivially-copyable values can be read back from device memory");
+		auto promise = ::std::make_shared<::std::promise<T>>();
+		auto future = promise->get_future();
+		auto resolve = [promise](const unsigned char* host_copy) {
+			T value;
+			::std::memcpy(&value, host_copy, sizeof(T));
+			promise->set_value(value);
+		};
+		auto address = reinterpret_cast<const unsigned char*>(device_scalar);
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		if (address >= device_staging_ and address + sizeof(T) <= device_staging_ + staging_used_) {
+			pending_.push_back(request_t{ static_cast<size_t>(address - device_staging_), nullptr, sizeof(T), resolve });
+		}
+		else {
+			pending_.push_back(request_t{ 0, address, sizeof(T), resolve });
+		}
+		return future;
+	}
+
+	/**
+	 * @brief Carry out all pending reads, once the work enqueued on @p stream
+	 * so far has concluded.
+	 *
+	 * @note Does not block; the values become available through the futures
+	 * returned by @ref read()
+	 */
+	void flush(const stream_t& stream)
+	{
+		::std::unique_ptr<batch_t> batch;
+		{
+			::std::lock_guard<::std::mutex> lock(mutex_);
+			if (pending_.empty()) { return; }
+			if (free_batches_.empty()) {
+				batch.reset(new batch_t(device().create_event(event::sync_by_blocking, event::dont_record_timings)));
+			}
+			else {
+				batch = ::std::move(free_batches_.back());
+				free_batches_.pop_back();
+			}
+			batch->requests.swap(pending_);
+			outstanding_batches_++;
+		}
+
+		// Until the stream takes the batch over, any failure must return the batch - so that
+		// the destructor does not wait for it forever; but not before the stream is done with
+		// any copies already enqueued into its host buffer
+		struct handover_guard_t {
+			readback_collector_t&         collector;
+			::std::unique_ptr<batch_t>&   batch;
+			const stream_t&               stream;
+			bool                          copies_enqueued;
+
+			~handover_guard_t()
+			{
+				if (not batch) { return; }
+				if (copies_enqueued) {
+					try { stream.synchronize(); }
+					catch(...) {
+						// The copies may still be in progress, so the buffer can neither be freed
+						// nor reused; it is deliberately leaked
+						batch->host_buffer.release();
+						batch->host_buffer_size = 0;
+					}
+				}
+				// The requests' promises are broken, rather than left unsatisfied
+				batch->requests.clear();
+				collector.recycle(::std::move(batch));
+			}
+		} guard { *this, batch, stream, false };
+
+		// The gathered range is placed at its offsets within the staging area,
+		// followed by the individually-copied values
+		size_t gathered_begin = staging_size_, gathered_end = 0, individual_size = 0;
+		for(auto& request : batch->requests) {
+			if (request.individual_source == nullptr) {
+				gathered_begin = ::std::min(gathered_begin, request.offset);
+				gathered_end = ::std::max(gathered_end, request.offset + request.size);
+			}
+			else {
+				request.offset = staging_size_ + individual_size;
+				individual_size += request.size;
+			}
+		}
+		auto required_size = staging_size_ + individual_size;
+		if (batch->host_buffer_size < required_size) {
+			batch->host_buffer = memory::host::make_unique<unsigned char[]>(required_size);
+			batch->host_buffer_size = required_size;
+		}
+
+		// Once the stream has taken the batch over, it may already be recycled
+		size_t num_values = batch->requests.size();
+		size_t num_individual_values = 0;
+		size_t num_transfers = 0;
+		bool gathers = gathered_begin < gathered_end;
+		if (gathers and staging_kind_ == staging_kind_t::device_memory) {
+			memory::async::copy(batch->host_buffer.get() + gathered_begin, device_staging_ + gathered_begin,
+				gathered_end - gathered_begin, stream);
+			guard.copies_enqueued = true;
+			num_transfers++;
+		}
+		for(const auto& request : batch->requests) {
+			if (request.individual_source != nullptr) {
+				memory::async::copy(batch->host_buffer.get() + request.offset, request.individual_source, request.size, stream);
+				guard.copies_enqueued = true;
+				num_transfers++;
+				num_individual_values++;
+			}
+		}
+
+		// Mapped scalars are read directly, once the stream reaches this point
+		const unsigned char* gathered_source = (staging_kind_ == staging_kind_t::mapped_memory) ?
+			host_staging_ : batch->host_buffer.get();
+		auto raw_batch = batch.get();
+		auto resolve = [this, raw_batch, gathered_source](const stream_t&) {
+			for(auto& request : raw_batch->requests) {
+				request.resolve((request.individual_source == nullptr ? gathered_source : raw_batch->host_buffer.get())
+					+ request.offset);
+			}
+			raw_batch->requests.clear();
+			::std::lock_guard<::std::mutex> lock(mutex_);
+			raw_batch->resolved = true;
+			if (raw_batch->handed_over) { recycle_handed_over(raw_batch); }
+		};
+		stream_t(stream).enqueue.host_function_call(resolve);
+		// The stream now owns the batch: it is returned by the host function - unless the
+		// stream fails before reaching it, in which case the function never runs. The event
+		// following the function tells these cases apart, e.g. on the collector's destruction
+		batch.release();
+		::std::exception_ptr recording_failure;
+		try { raw_batch->resolution.record(stream); }
+		catch(...) {
+			recording_failure = ::std::current_exception();
+			// Tell the cases apart right away, instead
+			try { stream.synchronize(); } catch(...) { }
+		}
+
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		raw_batch->handed_over = true;
+		if (raw_batch->resolved) { recycle_handed_over(raw_batch); }
+		else if (recording_failure) { reclaim(raw_batch); }
+		else { in_flight_.push_back(raw_batch); }
+		if (recording_failure) { ::std::rethrow_exception(recording_failure); }
+		statistics_.flushes++;
+		statistics_.values_read += num_values;
+		statistics_.transfers += num_transfers;
+		statistics_.gathered_values += num_values - num_individual_values;
+		statistics_.individual_values += num_individual_values;
+	}
+
+public: // constructors and destructor
+	/**
+	 * @param staging_area_size in bytes; limits the total size of the scalars
+	 * made by the collector
+	 */
+	readback_collector_t(
+		device_t        device,
+		size_t          staging_area_size = 4096,
+		staging_kind_t  staging_kind = staging_kind_t::device_memory)
+	:
+		device_id_(device.id()),
+		staging_size_(staging_area_size),
+		staging_kind_(staging_kind)
+	{
+		if (staging_kind == staging_kind_t::device_memory) {
+			device_staging_owner_ = memory::device::make_unique<unsigned char[]>(device, staging_area_size);
+			device_staging_ = device_staging_owner_.get();
+		}
+		else {
+			mapped_staging_ = memory::mapped::allocate(device, staging_area_size);
+			host_staging_ = static_cast<unsigned char*>(mapped_staging_.host_side);
+			device_staging_ = static_cast<unsigned char*>(mapped_staging_.device_side);
+		}
+	}
+
+	readback_collector_t(const readback_collector_t&) = delete;
+
+	~readback_collector_t()
+	{
+		// In-flight batches still refer to the collector, and to the staging area. Once the
+		// event following a batch's host function concludes, so has the function; if the
+		// event fails instead, the stream has failed, and the function will never run
+		::std::unique_lock<::std::mutex> lock(mutex_);
+		auto in_flight = in_flight_;
+		lock.unlock();
+		for(auto batch : in_flight) {
+			try { cuda::synchronize(batch->resolution); }
+			catch(...) {
+				lock.lock();
+				if (::std::find(in_flight_.begin(), in_flight_.end(), batch) != in_flight_.end()) { reclaim(batch); }
+				lock.unlock();
+			}
+		}
+		lock.lock();
+		batch_returned_.wait(lock, [this]() { return outstanding_batches_ == 0; });
+		lock.unlock();
+		if (staging_kind_ == staging_kind_t::mapped_memory) {
+			memory::mapped::free(mapped_staging_);
+		}
+	}
+
+public: // operators
+	readback_collector_t& operator=(const readback_collector_t&) = delete;
+
+protected: // types
+	struct request_t {
+		/** Within the staging area, for gathered values; within the host buffer, otherwise */
+		size_t                                        offset;
+		/** Only set for values outside the staging area */
+		const unsigned char*                          individual_source;
+		size_t                                        size;
+		::std::function<void(const unsigned char*)>   resolve;
+	};
+
+	struct batch_t {
+		::std::vector<request_t>                  requests;
+		memory::host::unique_ptr<unsigned char[]> host_buffer;
+		size_t                                    host_buffer_size { 0 };
+		/** Recorded on the flushing stream right after the batch's host function */
+		event_t                                   resolution;
+		/** Set by the host function, once the requests have been resolved */
+		bool                                      resolved { false };
+		/** Set once the flush is done with the batch; it is returned once both flags are set */
+		bool                                      handed_over { false };
+
+		explicit batch_t(event_t&& resolution_) : resolution(::std::move(resolution_)) { }
+	};
+
+protected: // mutators
+	void recycle(::std::unique_ptr<batch_t> batch)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		recycle_locked(::std::move(batch));
+	}
+
+	void recycle_locked(::std::unique_ptr<batch_t> batch)
+	{
+		batch->resolved = false;
+		batch->handed_over = false;
+		free_batches_.push_back(::std::move(batch));
+		outstanding_batches_--;
+		batch_returned_.notify_all();
+	}
+
+	/**
+	 * Returns a batch which a stream has taken over, once its host function has run
+	 *
+	 * @note The collector's mutex must be held
+	 */
+	void recycle_handed_over(batch_t* batch)
+	{
+		in_flight_.erase(::std::remove(in_flight_.begin(), in_flight_.end(), batch), in_flight_.end());
+		recycle_locked(::std::unique_ptr<batch_t>(batch));
+	}
+
+	/**
+	 * Discards a batch taken over by a failed stream, whose host function will never run;
+	 * the requests' promises are broken, rather than left unsatisfied
+	 *
+	 * @note The collector's mutex must be held
+	 */
+	void reclaim(batch_t* batch)
+	{
+		in_flight_.erase(::std::remove(in_flight_.begin(), in_flight_.end(), batch), in_flight_.end());
+		::std::unique_ptr<batch_t> owned { batch };
+		owned->requests.clear();
+		// Freeing pinned memory in a failed context may itself fail; the buffer is leaked instead
+		owned->host_buffer.release();
+		outstanding_batches_--;
+		batch_returned_.notify_all();
+	}
+
+protected: // data members
+	device::id_t                                  device_id_;
+	size_t                                        staging_size_;
+	staging_kind_t                                staging_kind_;
+	size_t                                        staging_used_ { 0 };
+	memory::device::unique_ptr<unsigned char[]>   device_staging_owner_;
+	memory::mapped::region_pair                   mapped_staging_ { nullptr, nullptr, 0 };
+	unsigned char*                                device_staging_ { nullptr };
+	unsigned char*                                host_staging_ { nullptr };
+
+	mutable ::std::mutex                          mutex_;
+	::std::condition_variable                     batch_returned_;
+	::std::vector<request_t>                      pending_;
+	::std::vector<::std::unique_ptr<batch_t>>     free_batches_;
+	/** Taken over by streams, and awaiting their host functions */
+	::std::vector<batch_t*>                       in_flight_;
+	size_t                                        outstanding_batches_ { 0 };
+	statistics_t                                  statistics_;
+};
+
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_READBACK_HPP_
@@ -0,0 +1,286 @@
+/**
+ * @file recording.hpp
+ *
+ * @brief Recording the API calls made through the wrappers - allocations, copies,
+ * memsets, kernel launches, event records and waits, and synchronizations - for
+ * later replay or offline analysis (see @ref recording/analysis.hpp and
+ * @ref recording/replay.hpp).
+ *
+ * While recording, each thread appends compact binary records to a log file of
+ * its own, in a directory specified when the recording starts; there is no
+ * synchronization among the threads, other than when a thread first records a call.
+ * When not recording, the cost of each wrapped call is a single relaxed atomic load.
+ *
+ * @note Only calls made through the wrappers are recorded - not direct calls
+ * to the CUDA Runtime API.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_RECORDING_HPP_
+#define CUDA_API_WRAPPERS_RECORDING_HPP_
+
+#include <cuda/recording/format.hpp>
+#include <cuda/api/detail/file_system.hpp>
+#include <cuda/common/types.hpp>
+
+#include <cuda_runtime_api.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace cuda {
+namespace recording {
+
+struct options_t {
+	/** The number of records each thread accumulates before writing them to its log */
+	size_t records_per_write { 4096 };
+};
+
+///@cond
+namespace detail_ {
+
+enum : int32_t { unknown_device = -1 };
+
+inline uint64_t steady_now() noexcept
+{
+	return static_cast<uint64_t>(::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+		::std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+class thread_log_t {
+public:
+	void append(const record_t& record) noexcept
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		if (file_ == nullptr) { return; }
+		buffer_.push_back(record);
+		if (buffer_.size() == buffer_.capacity()) { flush(); }
+	}
+
+	void close() noexcept
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		if (file_ == nullptr) { return; }
+		flush();
+		::std::fclose(file_);
+		file_ = nullptr;
+	}
+
+	thread_log_t(const ::std::string& path, const log_header_t& header, size_t records_per_write) :
+		file_(::std::fopen(path.c_str(), "wb"))
+	{
+		if (file_ == nullptr) {
+			throw ::std::system_error(errno, ::std::system_category(), "Failed creating API call log " + path);
+		}
+		buffer_.reserve(records_per_write == 0 ? 1 : records_per_write);
+		// The stdio buffer would only add another copy
+		::std::setvbuf(file_, nullptr, _IONBF, 0);
+		::std::fwrite(&header, sizeof(header), 1, file_);
+	}
+
+	thread_log_t(const thread_log_t&) = delete;
+
+	~thread_log_t() { close(); }
+
+protected:
+	void flush() noexcept
+	{
+		// Failing to write is not reported, as recording must not interfere with the program
+		::std::fwrite(buffer_.data(), sizeof(record_t), buffer_.size(), file_);
+		buffer_.clear();
+	}
+
+	::std::mutex            mutex_;
+	::std::FILE*            file_;
+	::std::vector<record_t> buffer_;
+};
+
+class recorder_t {
+public:
+	bool is_active() const noexcept { return active_.load(::std::memory_order_relaxed); }
+
+	void start(const ::std::string& directory, options_t options)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		if (is_active()) { throw ::std::logic_error("API call recording has already started"); }
+		cuda::detail_::file_system::create_directories(directory, "API call recording directory");
+		directory_ = directory;
+		options_ = options;
+		num_threads_ = 0;
+		logs_.clear();
+		began_at_unix_ = static_cast<uint64_t>(::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+			::std::chrono::system_clock::now().time_since_epoch()).count());
+		began_at_.store(steady_now(), ::std::memory_order_relaxed);
+		session_id_.fetch_add(1, ::std::memory_order_release);
+		active_.store(true, ::std::memory_order_release);
+	}
+
+	void stop() noexcept
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		active_.store(false, ::std::memory_order_release);
+		for(auto& weak_log : logs_) {
+			if (auto log = weak_log.lock()) { log->close(); }
+		}
+		logs_.clear();
+	}
+
+	void append(uint64_t call_start, uint64_t call_end, record_t record) noexcept
+	{
+		if (not is_active()) { return; }
+		auto began_at = began_at_.load(::std::memory_order_relaxed);
+		// A call which started before the recording did is not part of it
+		if (call_start < began_at) { return; }
+		record.start = call_start - began_at;
+		record.duration = call_end - call_start;
+		if (record.device_id == unknown_device) {
+			int device_id;
+			if (cudaGetDevice(&device_id) == cudaSuccess) { record.device_id = device_id; }
+		}
+		auto& log = log_for_this_thread();
+		if (log) { log->append(record); }
+	}
+
+	~recorder_t() { stop(); }
+
+protected:
+	struct thread_state_t {
+		uint64_t                         session_id { 0 };
+		::std::shared_ptr<thread_log_t>  log;
+	};
+
+	::std::shared_ptr<thread_log_t>& log_for_this_thread() noexcept
+	{
+		static thread_local thread_state_t state;
+		auto session_id = session_id_.load(::std::memory_order_acquire);
+		if (state.session_id == session_id) { return state.log; }
+		state.session_id = session_id;
+		state.log.reset();
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		if (not is_active()) { return state.log; }
+		log_header_t header;
+		::std::memcpy(header.magic, recording::detail_::magic(), sizeof(header.magic));
+		header.version = format_version;
+		header.thread_index = num_threads_++;
+		header.process_id = cuda::detail_::file_system::process_id();
+		header.began_at = began_at_unix_;
+		auto path = directory_ + "/thread-" + ::std::to_string(header.process_id) + '-'
+			+ ::std::to_string(header.thread_index) + log_file_suffix;
+		try {
+			state.log = ::std::make_shared<thread_log_t>(path, header, options_.records_per_write);
+			logs_.push_back(state.log);
+		}
+		catch(::std::exception&) {
+			// This thread's calls will not be recorded; again, recording must not interfere
+			state.log.reset();
+		}
+		return state.log;
+	}
+
+	::std::atomic<bool>                           active_ { false };
+	::std::atomic<uint64_t>                       session_id_ { 0 };
+	::std::atomic<uint64_t>                       began_at_ { 0 };
+	::std::mutex                                  mutex_;
+	::std::string                                 directory_;
+	options_t                                     options_;
+	uint64_t                                      began_at_unix_ { 0 };
+	uint32_t                                      num_threads_ { 0 };
+	::std::vector<::std::weak_ptr<thread_log_t>>  logs_;
+};
+
+inline recorder_t& recorder()
+{
+	static recorder_t recorder_;
+	return recorder_;
+}
+
+/**
+ * @return the time a wrapped call begins, if it is being recorded; 0 otherwise
+ */
+inline uint64_t begin() noexcept
+{
+	return recorder().is_active() ? steady_now() : 0;
+}
+
+/**
+ * Records a wrapped call which has concluded successfully
+ *
+ * @param call_start as obtained from @ref begin() before the call
+ */
+inline void end(uint64_t call_start, const record_t& record) noexcept
+{
+	if (call_start == 0) { return; }
+	recorder().append(call_start, steady_now(), record);
+}
+
+inline uint64_t as_handle(const void* ptr) noexcept { return reinterpret_cast<uintptr_t>(ptr); }
+
+inline record_t make_record(
+	operation_t    operation,
+	stream::id_t   stream_id = nullptr,
+	event::id_t    event_id = nullptr,
+	const void*    destination = nullptr,
+	const void*    source = nullptr,
+	size_t         size = 0,
+	device::id_t   device_id = unknown_device) noexcept
+{
+	record_t record {};
+	record.operation = operation;
+	record.device_id = device_id;
+	record.stream = as_handle(stream_id);
+	record.event = as_handle(event_id);
+	record.destination = as_handle(destination);
+	record.source = as_handle(source);
+	record.size = size;
+	return record;
+}
+
+inline record_t make_launch_record(
+	stream::id_t  stream_id,
+	const void*   kernel,
+	dim3          grid_dimensions,
+	dim3          block_dimensions,
+	size_t        dynamic_shared_memory_size) noexcept
+{
+	auto record = make_record(operation_t::launch, stream_id, nullptr, nullptr, kernel, dynamic_shared_memory_size);
+	record.grid[0] = grid_dimensions.x;
+	record.grid[1] = grid_dimensions.y;
+	record.grid[2] = grid_dimensions.z;
+	record.block[0] = block_dimensions.x;
+	record.block[1] = block_dimensions.y;
+	record.block[2] = block_dimensions.z;
+	return record;
+}
+
+} // namespace detail_
+///@endcond
+
+/**
+ * @brief Begin recording the API calls made through the wrappers, by all threads
+ *
+ * @param directory where to place the per-thread logs; created if necessary
+ * @throws ::std::logic_error if a recording is already in progress
+ */
+inline void start(const ::std::string& directory, options_t options = {})
+{
+	detail_::recorder().start(directory, options);
+}
+
+/**
+ * @brief Stop recording, and write out all records to the logs
+ */
+inline void stop() noexcept { detail_::recorder().stop(); }
+
+inline bool is_active() noexcept { return detail_::recorder().is_active(); }
+
+} // namespace recording
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_RECORDING_HPP_
@@ -0,0 +1,755 @@
+/**
+ * @file staging.hpp
+ *
+ * @brief Host-side packing of non-contiguous data (strided fields, index-selected
+ * rows, arrays-of-structures) into contiguous buffers, and pipelined uploading
+ * of such data to the device through pinned staging buffers.
+ *
+ * @note Packing is vectorized with AVX2 or AVX-512 gathers when the CPU supports
+ * them - if `CUDA_API_WRAPPERS_ENABLE_HOST_SIMD` is defined, and the host compiler
+ * is GCC or clang on x86_64 - and is otherwise performed by scalar code. Large packing jobs are split across a pool of host threads;
+ * contiguous data is copied using the parallel host copy engine.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_STAGING_HPP_
+#define CUDA_API_WRAPPERS_STAGING_HPP_
+
+#include <cuda/api/detail/thread_pool.hpp>
+#include <cuda/api/device.hpp>
+#include <cuda/api/event.hpp>
+#include <cuda/api/host_copy_engine.hpp>
+#include <cuda/api/memory.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/stream.hpp>
+#include <cuda/api/unique_ptr.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// The vectorized packers rely on target-specific function attributes, which are not
+// reliably supported when compiling through NVCC's front-end. Since the packers are
+// inline functions, their definitions must not differ between translation units -
+// so vectorization is not enabled just for the host-compiled ones, but on request,
+// for programs none of whose NVCC-compiled translation units include this header.
+#if defined(CUDA_API_WRAPPERS_ENABLE_HOST_SIMD) && !defined(CUDA_API_WRAPPERS_DISABLE_HOST_SIMD)
+#if defined(__CUDACC__)
+#error "CUDA_API_WRAPPERS_ENABLE_HOST_SIMD must not be defined in translation units compiled by NVCC which use the staging packers"
+#endif
+#if (defined(__x86_64__) || defined(__amd64__)) && (defined(__GNUC__) || defined(__clang__))
+#define CUDA_API_WRAPPERS_HOST_SIMD 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace cuda {
+namespace memory {
+namespace staging {
+
+/**
+ * Host CPU vector instruction set levels usable for packing
+ */
+enum class simd_level_t {
+	scalar,
+	avx2,
+	avx512
+};
+
+/**
+ * @return the most capable SIMD instruction set level supported both by
+ * the host CPU and by this compilation of the library
+ */
+inline simd_level_t supported_simd_level() noexcept
+{
+#ifdef CUDA_API_WRAPPERS_HOST_SIMD
+	static const simd_level_t level =
+		__builtin_cpu_supports("avx512f") ? simd_level_t::avx512 :
+		__builtin_cpu_supports("avx2")    ? simd_level_t::avx2   :
+		simd_level_t::scalar;
+	return level;
+#else
+	return simd_level_t::scalar;
+#endif
+}
+
+/**
+ * Location and size of a field within a structure, for AoS-to-SoA packing
+ */
+struct field_t {
+	size_t offset;
+	size_t size;
+};
+
+namespace detail_ {
+
+/**
+ * Packing jobs smaller than this (in bytes of output) are not worth
+ * splitting between threads
+ */
+enum : size_t { min_bytes_per_task = 256 * 1024 };
+
+inline simd_level_t effective_level(simd_level_t requested) noexcept
+{
+	return ::std::min(requested, supported_simd_level());
+}
+
+template <size_t ElementSize>
+inline void pack_strided_fixed(char* destination, const char* source, size_t stride, size_t num_elements) noexcept
+{
+	for(size_t i = 0; i < num_elements; i++) {
+		::std::memcpy(destination + i * ElementSize, source + i * stride, ElementSize);
+	}
+}
+
+inline void pack_strided_scalar(
+	char* destination, const char* source, size_t element_size, size_t stride, size_t num_elements) noexcept
+{
+	switch(element_size) {
+	case 1:  return pack_strided_fixed<1>(destination, source, stride, num_elements);
+	case 2:  return pack_strided_fixed<2>(destination, source, stride, num_elements);
+	case 4:  return pack_strided_fixed<4>(destination, source, stride, num_elements);
+	case 8:  return pack_strided_fixed<8>(destination, source, stride, num_elements);
+	case 12: return pack_strided_fixed<12>(destination, source, stride, num_elements);
+	case 16: return pack_strided_fixed<16>(destination, source, stride, num_elements);
+	default:
+		for(size_t i = 0; i < num_elements; i++) {
+			::std::memcpy(destination + i * element_size, source + i * stride, element_size);
+		}
+	}
+}
+
+template <typename Index>
+inline void pack_indexed_scalar(
+	char* destination, const char* source, size_t row_size, const Index* indices, size_t num_rows) noexcept
+{
+	for(size_t i = 0; i < num_rows; i++) {
+		::std::memcpy(destination + i * row_size, source + static_cast<size_t>(indices[i]) * row_size, row_size);
+	}
+}
+
+#ifdef CUDA_API_WRAPPERS_HOST_SIMD
+
+#if defined(__GNUC__) && !defined(__clang__)
+// GCC's AVX-512 intrinsics trigger spurious warnings about their own "undefined" values
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// Gathers use 32-bit signed lane offsets for 4-byte elements, which limits the stride
+inline bool fits_32_bit_lane_offsets(size_t stride, size_t num_lanes) noexcept
+{
+	return stride <= static_cast<size_t>(::std::numeric_limits<int32_t>::max()) / num_lanes;
+}
+
+__attribute__((target("avx2")))
+inline size_t pack_strided_avx2(char* destination, const char* source, size_t element_size, size_t stride, size_t num_elements) noexcept
+{
+	size_t i = 0;
+	if (element_size == 4 and fits_32_bit_lane_offsets(stride, 8)) {
+		auto s = static_cast<int>(stride);
+		const __m256i offsets = _mm256_setr_epi32(0, s, 2*s, 3*s, 4*s, 5*s, 6*s, 7*s);
+		for(; i + 8 <= num_elements; i += 8) {
+			auto gathered = _mm256_i32gather_epi32(reinterpret_cast<const int*>(source + i * stride), offsets, 1);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), gathered);
+		}
+	}
+	else if (element_size == 8) {
+		auto s = static_cast<long long>(stride);
+		const __m256i offsets = _mm256_setr_epi64x(0, s, 2*s, 3*s);
+		for(; i + 4 <= num_elements; i += 4) {
+			auto gathered = _mm256_i64gather_epi64(reinterpret_cast<const long long*>(source + i * stride), offsets, 1);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 8), gathered);
+		}
+	}
+	return i;
+}
+
+__attribute__((target("avx512f")))
+inline size_t pack_strided_avx512(char* destination, const char* source, size_t element_size, size_t stride, size_t num_elements) noexcept
+{
+	size_t i = 0;
+	if (element_size == 4 and fits_32_bit_lane_offsets(stride, 16)) {
+		auto s = static_cast<int>(stride);
+		const __m512i offsets = _mm512_setr_epi32(
+			0, s, 2*s, 3*s, 4*s, 5*s, 6*s, 7*s, 8*s, 9*s, 10*s, 11*s, 12*s, 13*s, 14*s, 15*s);
+		for(; i + 16 <= num_elements; i += 16) {
+			auto gathered = _mm512_i32gather_epi32(offsets, source + i * stride, 1);
+			_mm512_storeu_si512(destination + i * 4, gathered);
+		}
+	}
+	else if (element_size == 8) {
+		auto s = static_cast<long long>(stride);
+		const __m512i offsets = _mm512_setr_epi64(0, s, 2*s, 3*s, 4*s, 5*s, 6*s, 7*s);
+		for(; i + 8 <= num_elements; i += 8) {
+			auto gathered = _mm512_i64gather_epi64(offsets, source + i * stride, 1);
+			_mm512_storeu_si512(destination + i * 8, gathered);
+		}
+	}
+	return i;
+}
+
+// Loads 4 indices, widened to 64 bits (so that unsigned 32-bit indices are handled correctly)
+template <typename Index>
+__attribute__((target("avx2")))
+inline __m256i load_4_indices(const Index* indices) noexcept
+{
+	static_assert(sizeof(Index) == 4 or sizeof(Index) == 8, "Unsupported index size");
+	return (sizeof(Index) == 8) ?
+		_mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices)) :
+		(::std::is_signed<Index>::value ?
+			_mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(indices))) :
+			_mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(indices))));
+}
+
+template <typename Index>
+__attribute__((target("avx512f")))
+inline __m512i load_8_indices(const Index* indices) noexcept
+{
+	static_assert(sizeof(Index) == 4 or sizeof(Index) == 8, "Unsupported index size");
+	return (sizeof(Index) == 8) ?
+		_mm512_loadu_si512(indices) :
+		(::std::is_signed<Index>::value ?
+			_mm512_cvtepi32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices))) :
+			_mm512_cvtepu32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices))));
+}
+
+template <typename Index>
+__attribute__((target("avx2")))
+inline size_t pack_indexed_avx2(char* destination, const char* source, size_t row_size, const Index* indices, size_t num_rows) noexcept
+{
+	size_t i = 0;
+	if (row_size == 4) {
+		for(; i + 4 <= num_rows; i += 4) {
+			auto gathered = _mm256_i64gather_epi32(reinterpret_cast<const int*>(source), load_4_indices(indices + i), 4);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), gathered);
+		}
+	}
+	else if (row_size == 8) {
+		for(; i + 4 <= num_rows; i += 4) {
+			auto gathered = _mm256_i64gather_epi64(reinterpret_cast<const long long*>(source), load_4_indices(indices + i), 8);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 8), gathered);
+		}
+	}
+	return i;
+}
+
+template <typename Index>
+__attribute__((target("avx512f")))
+inline size_t pack_indexed_avx512(char* destination, const char* source, size_t row_size, const Index* indices, size_t num_rows) noexcept
+{
+	size_t i = 0;
+	if (row_size == 4) {
+		for(; i + 8 <= num_rows; i += 8) {
+			auto gathered = _mm512_i64gather_epi32(load_8_indices(indices + i), source, 4);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), gathered);
+		}
+	}
+	else if (row_size == 8) {
+		for(; i + 8 <= num_rows; i += 8) {
+			auto gathered = _mm512_i64gather_epi64(load_8_indices(indices + i), source, 8);
+			_mm512_storeu_si512(destination + i * 8, gathered);
+		}
+	}
+	return i;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // CUDA_API_WRAPPERS_HOST_SIMD
+
+/**
+ * Single-threaded strided packing, using the specified instruction set
+ * for as many elements as possible and scalar code for the rest
+ */
+inline void pack_strided(
+	char* destination, const char* source, size_t element_size, size_t stride,
+	size_t num_elements, simd_level_t level) noexcept
+{
+	if (stride == element_size) {
+		::std::memcpy(destination, source, element_size * num_elements);
+		return;
+	}
+	size_t num_packed = 0;
+#ifdef CUDA_API_WRAPPERS_HOST_SIMD
+	switch(level) {
+	case simd_level_t::avx512: num_packed = pack_strided_avx512(destination, source, element_size, stride, num_elements); break;
+	case simd_level_t::avx2:   num_packed = pack_strided_avx2(destination, source, element_size, stride, num_elements); break;
+	default: break;
+	}
+#else
+	(void) level;
+#endif
+	pack_strided_scalar(destination + num_packed * element_size, source + num_packed * stride,
+		element_size, stride, num_elements - num_packed);
+}
+
+template <typename Index>
+inline void pack_indexed(
+	char* destination, const char* source, size_t row_size, const Index* indices,
+	size_t num_rows, simd_level_t level) noexcept
+{
+	size_t num_packed = 0;
+#ifdef CUDA_API_WRAPPERS_HOST_SIMD
+	switch(level) {
+	case simd_level_t::avx512: num_packed = pack_indexed_avx512(destination, source, row_size, indices, num_rows); break;
+	case simd_level_t::avx2:   num_packed = pack_indexed_avx2(destination, source, row_size, indices, num_rows); break;
+	default: break;
+	}
+#else
+	(void) level;
+#endif
+	pack_indexed_scalar(destination + num_packed * row_size, source, row_size, indices + num_packed, num_rows - num_packed);
+}
+
+/**
+ * Splits [0, num_items) into contiguous ranges and processes them on the
+ * default thread pool - unless the job is too small to be worth it
+ */
+template <typename ProcessRange>
+inline void parallelize(size_t num_items, size_t output_bytes_per_item, ProcessRange process_range)
+{
+	auto total_bytes = num_items * output_bytes_per_item;
+	auto& pool = cuda::detail_::default_thread_pool();
+	auto max_tasks = total_bytes / min_bytes_per_task;
+	auto num_tasks = ::std::max<size_t>(1, ::std::min(max_tasks, pool.size() + 1));
+	if (num_tasks == 1) {
+		process_range(size_t{0}, num_items);
+		return;
+	}
+	auto items_per_task = (num_items + num_tasks - 1) / num_tasks;
+	pool.parallel_for(num_tasks, [&](size_t task_index) {
+		auto first = task_index * items_per_task;
+		if (first >= num_items) { return; }
+		process_range(first, ::std::min(items_per_task, num_items - first));
+	});
+}
+
+} // namespace detail_
+
+/**
+ * @brief Copy equally-spaced elements into a contiguous buffer.
+ *
+ * @param destination buffer of at least @p element_size * @p num_elements bytes
+ * @param source address of the first element
+ * @param element_size size in bytes of each element
+ * @param stride distance in bytes between the starts of consecutive elements
+ * @param num_elements number of elements to pack
+ * @param max_simd_level the most capable instruction set to use (if supported);
+ * useful mostly for benchmarking
+ */
+inline void pack_strided(
+	void*         destination,
+	const void*   source,
+	size_t        element_size,
+	size_t        stride,
+	size_t        num_elements,
+	simd_level_t  max_simd_level = simd_level_t::avx512)
+{
+	if (stride == element_size) {
+		host::parallel::copy(destination, source, element_size * num_elements);
+		return;
+	}
+	auto level = detail_::effective_level(max_simd_level);
+	auto destination_ = static_cast<char*>(destination);
+	auto source_ = static_cast<const char*>(source);
+	detail_::parallelize(num_elements, element_size, [&](size_t first, size_t count) {
+		detail_::pack_strided(destination_ + first * element_size, source_ + first * stride,
+			element_size, stride, count, level);
+	});
+}
+
+/**
+ * @brief Copy rows selected by index into a contiguous buffer.
+ *
+ * @param destination buffer of at least @p row_size * @p num_rows bytes
+ * @param source start of an array of rows, each of @p row_size bytes
+ * @param row_size size in bytes of each row
+ * @param indices the indices of the rows to pack, in order
+ * @param num_rows number of indices
+ * @param max_simd_level the most capable instruction set to use (if supported)
+ */
+template <typename Index>
+inline void pack_indexed(
+	void*         destination,
+	const void*   source,
+	size_t        row_size,
+	const Index*  indices,
+	size_t        num_rows,
+	simd_level_t  max_simd_level = simd_level_t::avx512)
+{
+	static_assert(::std::is_integral<Index>::value and (sizeof(Index) == 4 or sizeof(Index) == 8),
+		"Row indices must be 32-bit or 64-bit integers");
+	auto level = detail_::effective_level(max_simd_level);
+	auto destination_ = static_cast<char*>(destination);
+	auto source_ = static_cast<const char*>(source);
+	detail_::parallelize(num_rows, row_size, [&](size_t first, size_t count) {
+		detail_::pack_indexed(destination_ + first * row_size, source_, row_size, indices + first, count, level);
+	});
+}
+
+/**
+ * @brief Split an array of structures into separate contiguous arrays, one per field.
+ *
+ * @param destinations one buffer per field, each of at least the field's size
+ * times @p num_structs bytes
+ * @param source the array of structures
+ * @param struct_size size in bytes of each structure (including padding)
+ * @param num_structs number of structures in the array
+ * @param fields the fields to extract
+ * @param max_simd_level the most capable instruction set to use (if supported)
+ */
+inline void pack_aos_to_soa(
+	const ::std::vector<void*>&    destinations,
+	const void*                    source,
+	size_t                         struct_size,
+	size_t                         num_structs,
+	const ::std::vector<field_t>&  fields,
+	simd_level_t                   max_simd_level = simd_level_t::avx512)
+{
+	if (destinations.size() != fields.size()) {
+		throw ::std::invalid_argument("The number of destinations and fields for AoS-to-SoA packing differs");
+	}
+	size_t packed_struct_size { 0 };
+	for(const auto& field : fields) { packed_struct_size += field.size; }
+	auto level = detail_::effective_level(max_simd_level);
+	auto source_ = static_cast<const char*>(source);
+	detail_::parallelize(num_structs, packed_struct_size, [&](size_t first, size_t count) {
+		for(size_t f = 0; f < fields.size(); f++) {
+			detail_::pack_strided(static_cast<char*>(destinations[f]) + first * fields[f].size,
+				source_ + first * struct_size + fields[f].offset, fields[f].size, struct_size, count, level);
+		}
+	});
+}
+
+/**
+ * @brief A ring of equally-sized pinned host memory slots, through which data
+ * can be staged for transfer to (or from) a device.
+ *
+ * Each slot is associated with an event marking the completion of the last
+ * transfer involving it; acquiring a slot waits for that transfer to conclude,
+ * so that with two or more slots, filling one slot overlaps the transfer
+ * of data staged in previous ones.
+ */
+class staging_buffer_t {
+public: // getters
+	size_t slot_size() const noexcept { return slot_size_; }
+	size_t num_slots() const noexcept { return events_.size(); }
+	device_t device() const noexcept { return cuda::device::get(device_id_); }
+
+public: // mutators
+
+	/**
+	 * @brief Obtain the next slot in the ring, once it is no longer in use
+	 * by a previously-enqueued transfer.
+	 */
+	region_t acquire()
+	{
+		auto slot_index = next_slot_;
+		if (in_use_[slot_index]) {
+			events_[slot_index].synchronize();
+			in_use_[slot_index] = false;
+		}
+		return { buffer_.get() + slot_index * slot_size_, slot_size_ };
+	}
+
+	/**
+	 * @brief Mark the last-acquired slot as being in use by transfers enqueued
+	 * on @p stream, and advance to the next slot.
+	 */
+	void release(const stream_t& stream)
+	{
+		events_[next_slot_].record(stream);
+		in_use_[next_slot_] = true;
+		next_slot_ = (next_slot_ + 1) % num_slots();
+	}
+
+	/**
+	 * @brief Advance past the last-acquired slot, without marking it as in use
+	 * (e.g. after its contents, transferred from the device, have been consumed).
+	 */
+	void release()
+	{
+		next_slot_ = (next_slot_ + 1) % num_slots();
+	}
+
+	/**
+	 * @brief Wait for all transfers involving any of the slots to conclude.
+	 */
+	void synchronize()
+	{
+		for(size_t i = 0; i < num_slots(); i++) {
+			if (in_use_[i]) { events_[i].synchronize(); in_use_[i] = false; }
+		}
+	}
+
+public: // constructors and destructor
+
+	/**
+	 * @param device the device with whose streams the buffer will be used
+	 * @param slot_size size in bytes of each slot
+	 * @param num_slots number of slots; two suffice for overlapping
+	 * packing with transfer
+	 */
+	staging_buffer_t(device_t device, size_t slot_size, size_t num_slots = 2) :
+		device_id_(device.id()),
+		slot_size_(slot_size),
+		buffer_(memory::host::make_unique<char[]>(slot_size * num_slots)),
+		in_use_(num_slots, false)
+	{
+		if (slot_size == 0 or num_slots == 0) {
+			throw ::std::invalid_argument("A staging buffer must have at least one non-empty slot");
+		}
+		events_.reserve(num_slots);
+		for(size_t i = 0; i < num_slots; i++) {
+			events_.emplace_back(device.create_event(event::sync_by_blocking, event::dont_record_timings));
+		}
+	}
+
+	staging_buffer_t(const staging_buffer_t&) = delete;
+	staging_buffer_t(staging_buffer_t&&) = default;
+
+	~staging_buffer_t()
+	{
+		// The pinned memory must not be freed while transfers still use it
+		for(size_t i = 0; i < in_use_.size(); i++) {
+			if (in_use_[i]) { events_[i].synchronize(); }
+		}
+	}
+
+public: // operators
+	staging_buffer_t& operator=(const staging_buffer_t&) = delete;
+	staging_buffer_t& operator=(staging_buffer_t&&) = delete;
+
+protected: // data members
+	cuda::device::id_t               device_id_;
+	size_t                           slot_size_;
+	memory::host::unique_ptr<char[]> buffer_;
+	::std::vector<event_t>           events_;
+	::std::vector<bool>              in_use_;
+	size_t                           next_slot_ { 0 };
+};
+
+namespace detail_ {
+
+/**
+ * Packs the input in chunks which fit in a staging slot, enqueueing the
+ * transfer of each chunk before packing the next one
+ *
+ * @param pack_chunk packs the elements [first, first + count) into a slot
+ * @param copy_chunk enqueues the copy of a packed slot to its final destination
+ */
+template <typename PackChunk, typename CopyChunk>
+inline void pipelined_upload(
+	staging_buffer_t&  staging,
+	const stream_t&    stream,
+	size_t             num_elements,
+	size_t             packed_element_size,
+	PackChunk          pack_chunk,
+	CopyChunk          copy_chunk)
+{
+	if (packed_element_size == 0 or num_elements == 0) { return; }
+	auto elements_per_chunk = staging.slot_size() / packed_element_size;
+	if (elements_per_chunk == 0) {
+		throw ::std::invalid_argument("Staging buffer slots are too small to hold a single packed element");
+	}
+	for(size_t first = 0; first < num_elements; first += elements_per_chunk) {
+		auto count = ::std::min(elements_per_chunk, num_elements - first);
+		auto slot = staging.acquire();
+		pack_chunk(static_cast<char*>(slot.start()), first, count);
+		copy_chunk(static_cast<char*>(slot.start()), first, count);
+		staging.release(stream);
+	}
+}
+
+/**
+ * Transfers the input in chunks which fit in a staging slot, keeping all of the
+ * slots' transfers in flight while earlier chunks are unpacked; returns once
+ * all chunks have been unpacked.
+ *
+ * @param copy_chunk enqueues the copy of elements [first, first + count) into a slot
+ * @param unpack_chunk unpacks a slot's elements once they have arrived
+ */
+template <typename CopyChunk, typename UnpackChunk>
+inline void pipelined_download(
+	staging_buffer_t&  staging,
+	const stream_t&    stream,
+	size_t             num_elements,
+	size_t             packed_element_size,
+	CopyChunk          copy_chunk,
+	UnpackChunk        unpack_chunk)
+{
+	if (packed_element_size == 0 or num_elements == 0) { return; }
+	auto elements_per_chunk = staging.slot_size() / packed_element_size;
+	if (elements_per_chunk == 0) {
+		throw ::std::invalid_argument("Staging buffer slots are too small to hold a single packed element");
+	}
+	struct chunk_t { size_t first; size_t count; };
+	// In-flight chunks occupy consecutive slots, the oldest of them being the next to be acquired
+	::std::deque<chunk_t> in_flight;
+	auto unpack_oldest = [&](char* slot) {
+		unpack_chunk(slot, in_flight.front().first, in_flight.front().count);
+		in_flight.pop_front();
+	};
+	for(size_t first = 0; first < num_elements; first += elements_per_chunk) {
+		auto count = ::std::min(elements_per_chunk, num_elements - first);
+		auto slot = static_cast<char*>(staging.acquire().start());
+		if (in_flight.size() == staging.num_slots()) { unpack_oldest(slot); }
+		copy_chunk(slot, first, count);
+		staging.release(stream);
+		in_flight.push_back({ first, count });
+	}
+	while (not in_flight.empty()) {
+		unpack_oldest(static_cast<char*>(staging.acquire().start()));
+		staging.release();
+	}
+}
+
+inline void ensure_fits(region_t destination, size_t required_size)
+{
+	if (destination.size() < required_size) {
+		throw ::std::invalid_argument("Upload destination region of size " + ::std::to_string(destination.size())
+			+ " is too small for " + ::std::to_string(required_size) + " bytes of packed data");
+	}
+}
+
+} // namespace detail_
+
+/**
+ * @brief Upload contiguous data from pageable host memory, copying it into
+ * the staging buffer's pinned slots with multiple threads.
+ *
+ * Each chunk's transfer is enqueued on @p stream before the next chunk is staged.
+ *
+ * @note Returns once all transfers have been enqueued; the staging buffer's
+ * slots may still be in use at that point.
+ */
+inline void upload(
+	region_t           destination,
+	const void*        source,
+	size_t             num_bytes,
+	staging_buffer_t&  staging,
+	const stream_t&    stream)
+{
+	detail_::ensure_fits(destination, num_bytes);
+	auto source_ = static_cast<const char*>(source);
+	auto destination_ = static_cast<char*>(destination.start());
+	detail_::pipelined_upload(staging, stream, num_bytes, 1,
+		[&](char* slot, size_t first, size_t count) {
+			host::parallel::copy(slot, source_ + first, count);
+		},
+		[&](char* slot, size_t first, size_t count) {
+			memory::async::copy(destination_ + first, slot, count, stream);
+		});
+}
+
+/**
+ * @brief Pack strided elements and upload them, contiguously, to device memory.
+ *
+ * Packing is done in chunks, into slots of @p staging; each chunk's transfer
+ * is enqueued on @p stream before the next chunk is packed.
+ *
+ * @note Returns once all transfers have been enqueued; the staging buffer's
+ * slots may still be in use at that point.
+ */
+inline void upload_strided(
+	region_t           destination,
+	const void*        source,
+	size_t             element_size,
+	size_t             stride,
+	size_t             num_elements,
+	staging_buffer_t&  staging,
+	const stream_t&    stream)
+{
+	detail_::ensure_fits(destination, element_size * num_elements);
+	auto source_ = static_cast<const char*>(source);
+	auto destination_ = static_cast<char*>(destination.start());
+	detail_::pipelined_upload(staging, stream, num_elements, element_size,
+		[&](char* slot, size_t first, size_t count) {
+			pack_strided(slot, source_ + first * stride, element_size, stride, count);
+		},
+		[&](char* slot, size_t first, size_t count) {
+			memory::async::copy(destination_ + first * element_size, slot, count * element_size, stream);
+		});
+}
+
+/**
+ * @brief Pack rows selected by index and upload them, contiguously, to device memory.
+ *
+ * @copydetails upload_strided
+ */
+template <typename Index>
+inline void upload_indexed(
+	region_t           destination,
+	const void*        source,
+	size_t             row_size,
+	const Index*       indices,
+	size_t             num_rows,
+	staging_buffer_t&  staging,
+	const stream_t&    stream)
+{
+	detail_::ensure_fits(destination, row_size * num_rows);
+	auto destination_ = static_cast<char*>(destination.start());
+	detail_::pipelined_upload(staging, stream, num_rows, row_size,
+		[&](char* slot, size_t first, size_t count) {
+			pack_indexed(slot, source, row_size, indices + first, count);
+		},
+		[&](char* slot, size_t first, size_t count) {
+			memory::async::copy(destination_ + first * row_size, slot, count * row_size, stream);
+		});
+}
+
+/**
+ * @brief Split an array of structures into per-field arrays, uploading each
+ * to its own device memory region.
+ *
+ * @copydetails upload_strided
+ */
+inline void upload_aos_to_soa(
+	const ::std::vector<region_t>&  destinations,
+	const void*                     source,
+	size_t                          struct_size,
+	size_t                          num_structs,
+	const ::std::vector<field_t>&   fields,
+	staging_buffer_t&               staging,
+	const stream_t&                 stream)
+{
+	if (destinations.size() != fields.size()) {
+		throw ::std::invalid_argument("The number of destinations and fields for AoS-to-SoA uploading differs");
+	}
+	size_t packed_struct_size { 0 };
+	for(size_t f = 0; f < fields.size(); f++) {
+		detail_::ensure_fits(destinations[f], fields[f].size * num_structs);
+		packed_struct_size += fields[f].size;
+	}
+	auto source_ = static_cast<const char*>(source);
+	::std::vector<void*> slot_destinations(fields.size());
+	detail_::pipelined_upload(staging, stream, num_structs, packed_struct_size,
+		[&](char* slot, size_t first, size_t count) {
+			// Within a slot, the chunk's fields are laid out one after the other
+			auto field_start = slot;
+			for(size_t f = 0; f < fields.size(); f++) {
+				slot_destinations[f] = field_start;
+				field_start += fields[f].size * count;
+			}
+			pack_aos_to_soa(slot_destinations, source_ + first * struct_size, struct_size, count, fields);
+		},
+		[&](char*, size_t first, size_t count) {
+			for(size_t f = 0; f < fields.size(); f++) {
+				memory::async::copy(static_cast<char*>(destinations[f].start()) + first * fields[f].size,
+					slot_destinations[f], count * fields[f].size, stream);
+			}
+		});
+}
+
+} // namespace staging
+} // namespace memory
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_STAGING_HPP_
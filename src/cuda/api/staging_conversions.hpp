@@ -0,0 +1,608 @@
+/**
+ * @file staging_conversions.hpp
+ *
+ * @brief Precision-reducing conversions performed on the host while staging
+ * data for transfer - FP32 to FP16 or BF16, and int64 to int32 - with the
+ * corresponding widening conversions for data transferred back from the device.
+ *
+ * Converting before uploading (and after downloading) halves the number
+ * of bytes which need to cross the host-device interconnect, for data which
+ * device code uses at reduced precision anyway.
+ *
+ * @note Half-precision values are represented on the host by their raw 16-bit
+ * patterns (IEEE 754 binary16, or bfloat16); these are bit-compatible with
+ * CUDA's `__half` and `__nv_bfloat16` types on the device.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_STAGING_CONVERSIONS_HPP_
+#define CUDA_API_WRAPPERS_STAGING_CONVERSIONS_HPP_
+
+#include <cuda/api/staging.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace cuda {
+namespace memory {
+namespace staging {
+
+/**
+ * What to do with integers which don't fit in a narrower type
+ */
+enum class overflow_handling_t {
+	throw_exception,
+	saturate,
+};
+
+namespace detail_ {
+
+inline uint32_t float_bits(float f) noexcept { uint32_t u; ::std::memcpy(&u, &f, sizeof(u)); return u; }
+inline float bits_to_float(uint32_t u) noexcept { float f; ::std::memcpy(&f, &u, sizeof(f)); return f; }
+
+/**
+ * Round-to-nearest-even conversion, with IEEE handling of subnormals, infinities and NaNs
+ */
+inline uint16_t fp32_to_fp16(float value) noexcept
+{
+	static constexpr const uint32_t fp32_infinity = 255u << 23;
+	static constexpr const uint32_t fp16_overflow_threshold = (127u + 16) << 23;
+	static constexpr const uint32_t subnormal_magic = ((127u - 15) + (23 - 10) + 1) << 23;
+	auto bits = float_bits(value);
+	auto sign = bits & 0x80000000u;
+	bits ^= sign;
+	uint32_t result;
+	if (bits >= fp16_overflow_threshold) {
+		// NaNs are quieted and keep the upper part of their payload, as with the F16C instructions
+		result = (bits > fp32_infinity) ? (0x7E00 | ((bits >> 13) & 0x3FF)) : 0x7C00;
+	}
+	else if (bits < (113u << 23)) {
+		// The result is subnormal; let the FPU do the rounding
+		auto shifted = float_bits(bits_to_float(bits) + bits_to_float(subnormal_magic));
+		result = shifted - subnormal_magic;
+	}
+	else {
+		auto mantissa_is_odd = (bits >> 13) & 1;
+		bits += ((15u - 127) << 23) + 0xFFF + mantissa_is_odd;
+		result = bits >> 13;
+	}
+	return static_cast<uint16_t>(result | (sign >> 16));
+}
+
+inline float fp16_to_fp32(uint16_t value) noexcept
+{
+	static constexpr const uint32_t shifted_exponent = 0x7C00u << 13;
+	static constexpr const uint32_t magic = 113u << 23;
+	uint32_t bits = (value & 0x7FFFu) << 13;
+	auto exponent = bits & shifted_exponent;
+	bits += (127u - 15) << 23;
+	if (exponent == shifted_exponent) {
+		bits += (128u - 16) << 23;
+		if (value & 0x3FFu) { bits |= 0x400000u; } // quiet signaling NaNs, as the F16C instructions do
+	}
+	else if (exponent == 0) {
+		bits += 1u << 23;
+		bits = float_bits(bits_to_float(bits) - bits_to_float(magic));
+	}
+	return bits_to_float(bits | (static_cast<uint32_t>(value & 0x8000u) << 16));
+}
+
+inline uint16_t fp32_to_bf16(float value) noexcept
+{
+	auto bits = float_bits(value);
+	if ((bits & 0x7FFFFFFFu) > 0x7F800000u) {
+		return static_cast<uint16_t>((bits >> 16) | 0x40); // quiet the NaN
+	}
+	bits += 0x7FFFu + ((bits >> 16) & 1);
+	return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float bf16_to_fp32(uint16_t value) noexcept
+{
+	return bits_to_float(static_cast<uint32_t>(value) << 16);
+}
+
+inline bool fits_in_int32(int64_t value) noexcept
+{
+	return value >= ::std::numeric_limits<int32_t>::min() and value <= ::std::numeric_limits<int32_t>::max();
+}
+
+inline int32_t saturate_to_int32(int64_t value) noexcept
+{
+	return
+		value < ::std::numeric_limits<int32_t>::min() ? ::std::numeric_limits<int32_t>::min() :
+		value > ::std::numeric_limits<int32_t>::max() ? ::std::numeric_limits<int32_t>::max() :
+		static_cast<int32_t>(value);
+}
+
+#ifdef CUDA_API_WRAPPERS_HOST_SIMD
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// Note: All AVX2-capable CPUs also support the F16C instructions
+
+__attribute__((target("avx2,f16c")))
+inline size_t fp32_to_fp16_avx2(uint16_t* destination, const float* source, size_t n) noexcept
+{
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8) {
+		auto converted = _mm256_cvtps_ph(_mm256_loadu_ps(source + i), _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), converted);
+	}
+	return i;
+}
+
+__attribute__((target("avx512f")))
+inline size_t fp32_to_fp16_avx512(uint16_t* destination, const float* source, size_t n) noexcept
+{
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16) {
+		auto converted = _mm512_cvtps_ph(_mm512_loadu_ps(source + i), _MM_FROUND_TO_NEAREST_INT);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), converted);
+	}
+	return i;
+}
+
+__attribute__((target("avx2,f16c")))
+inline size_t fp16_to_fp32_avx2(float* destination, const uint16_t* source, size_t n) noexcept
+{
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8) {
+		auto halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+		_mm256_storeu_ps(destination + i, _mm256_cvtph_ps(halves));
+	}
+	return i;
+}
+
+__attribute__((target("avx512f")))
+inline size_t fp16_to_fp32_avx512(float* destination, const uint16_t* source, size_t n) noexcept
+{
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16) {
+		auto halves = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+		_mm512_storeu_ps(destination + i, _mm512_cvtph_ps(halves));
+	}
+	return i;
+}
+
+// BF16 rounding is emulated with integer arithmetic, the same way as in fp32_to_bf16()
+
+__attribute__((target("avx2")))
+inline size_t fp32_to_bf16_avx2(uint16_t* destination, const float* source, size_t n) noexcept
+{
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i rounding_bias = _mm256_set1_epi32(0x7FFF);
+	const __m256i abs_mask = _mm256_set1_epi32(0x7FFFFFFF);
+	const __m256i infinity = _mm256_set1_epi32(0x7F800000);
+	const __m256i quiet_bit = _mm256_set1_epi32(0x40);
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8) {
+		auto bits = _mm256_castps_si256(_mm256_loadu_ps(source + i));
+		auto lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), one);
+		auto rounded = _mm256_srli_epi32(_mm256_add_epi32(bits, _mm256_add_epi32(rounding_bias, lsb)), 16);
+		auto is_nan = _mm256_cmpgt_epi32(_mm256_and_si256(bits, abs_mask), infinity);
+		auto quieted = _mm256_or_si256(_mm256_srli_epi32(bits, 16), quiet_bit);
+		auto result = _mm256_blendv_epi8(rounded, quieted, is_nan);
+		// Pack the 32-bit lanes' low halves; packing is per 128-bit lane, hence the permutation
+		auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(result, result), 0xD8);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm256_castsi256_si128(packed));
+	}
+	return i;
+}
+
+__attribute__((target("avx512f")))
+inline size_t fp32_to_bf16_avx512(uint16_t* destination, const float* source, size_t n) noexcept
+{
+	const __m512i one = _mm512_set1_epi32(1);
+	const __m512i rounding_bias = _mm512_set1_epi32(0x7FFF);
+	const __m512i abs_mask = _mm512_set1_epi32(0x7FFFFFFF);
+	const __m512i infinity = _mm512_set1_epi32(0x7F800000);
+	const __m512i quiet_bit = _mm512_set1_epi32(0x40);
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16) {
+		auto bits = _mm512_castps_si512(_mm512_loadu_ps(source + i));
+		auto lsb = _mm512_and_si512(_mm512_srli_epi32(bits, 16), one);
+		auto rounded = _mm512_srli_epi32(_mm512_add_epi32(bits, _mm512_add_epi32(rounding_bias, lsb)), 16);
+		auto is_nan = _mm512_cmpgt_epi32_mask(_mm512_and_si512(bits, abs_mask), infinity);
+		auto quieted = _mm512_or_si512(_mm512_srli_epi32(bits, 16), quiet_bit);
+		auto result = _mm512_mask_blend_epi32(is_nan, rounded, quieted);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm512_cvtepi32_epi16(result));
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t bf16_to_fp32_avx2(float* destination, const uint16_t* source, size_t n) noexcept
+{
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8) {
+		auto widened = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_slli_epi32(widened, 16));
+	}
+	return i;
+}
+
+__attribute__((target("avx512f")))
+inline size_t bf16_to_fp32_avx512(float* destination, const uint16_t* source, size_t n) noexcept
+{
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16) {
+		auto widened = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)));
+		_mm512_storeu_si512(destination + i, _mm512_slli_epi32(widened, 16));
+	}
+	return i;
+}
+
+/**
+ * @return the number of elements converted; stops early at an element
+ * which overflows, unless saturating
+ */
+__attribute__((target("avx512f")))
+inline size_t int64_to_int32_avx512(int32_t* destination, const int64_t* source, size_t n, overflow_handling_t handling) noexcept
+{
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8) {
+		auto wide = _mm512_loadu_si512(source + i);
+		__m256i narrow;
+		if (handling == overflow_handling_t::saturate) {
+			narrow = _mm512_cvtsepi64_epi32(wide);
+		}
+		else {
+			narrow = _mm512_cvtepi64_epi32(wide);
+			if (_mm512_cmpneq_epi64_mask(_mm512_cvtepi32_epi64(narrow), wide) != 0) { break; }
+		}
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), narrow);
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t int32_to_int64_avx2(int64_t* destination, const int32_t* source, size_t n) noexcept
+{
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4) {
+		auto widened = _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), widened);
+	}
+	return i;
+}
+
+__attribute__((target("avx512f")))
+inline size_t int32_to_int64_avx512(int64_t* destination, const int32_t* source, size_t n) noexcept
+{
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8) {
+		auto widened = _mm512_cvtepi32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)));
+		_mm512_storeu_si512(destination + i, widened);
+	}
+	return i;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#define CUDA_API_WRAPPERS_SIMD_DISPATCH(level, num_done, avx512_call, avx2_call) \
+	switch(level) { \
+	case simd_level_t::avx512: num_done = avx512_call; break; \
+	case simd_level_t::avx2:   num_done = avx2_call; break; \
+	default: break; \
+	}
+#else
+#define CUDA_API_WRAPPERS_SIMD_DISPATCH(level, num_done, avx512_call, avx2_call) (void) level;
+#endif // CUDA_API_WRAPPERS_HOST_SIMD
+
+inline void fp32_to_fp16(uint16_t* destination, const float* source, size_t n, simd_level_t level) noexcept
+{
+	size_t i = 0;
+	CUDA_API_WRAPPERS_SIMD_DISPATCH(level, i,
+		fp32_to_fp16_avx512(destination, source, n), fp32_to_fp16_avx2(destination, source, n))
+	for(; i < n; i++) { destination[i] = fp32_to_fp16(source[i]); }
+}
+
+inline void fp16_to_fp32(float* destination, const uint16_t* source, size_t n, simd_level_t level) noexcept
+{
+	size_t i = 0;
+	CUDA_API_WRAPPERS_SIMD_DISPATCH(level, i,
+		fp16_to_fp32_avx512(destination, source, n), fp16_to_fp32_avx2(destination, source, n))
+	for(; i < n; i++) { destination[i] = fp16_to_fp32(source[i]); }
+}
+
+inline void fp32_to_bf16(uint16_t* destination, const float* source, size_t n, simd_level_t level) noexcept
+{
+	size_t i = 0;
+	CUDA_API_WRAPPERS_SIMD_DISPATCH(level, i,
+		fp32_to_bf16_avx512(destination, source, n), fp32_to_bf16_avx2(destination, source, n))
+	for(; i < n; i++) { destination[i] = fp32_to_bf16(source[i]); }
+}
+
+inline void bf16_to_fp32(float* destination, const uint16_t* source, size_t n, simd_level_t level) noexcept
+{
+	size_t i = 0;
+	CUDA_API_WRAPPERS_SIMD_DISPATCH(level, i,
+		bf16_to_fp32_avx512(destination, source, n), bf16_to_fp32_avx2(destination, source, n))
+	for(; i < n; i++) { destination[i] = bf16_to_fp32(source[i]); }
+}
+
+/**
+ * @note The AVX2 instruction set lacks a narrowing conversion for 64-bit
+ * integers; the scalar loop vectorizes reasonably well anyway.
+ *
+ * @return @p n if all elements were converted, otherwise the index of
+ * the first element which does not fit in 32 bits
+ */
+inline size_t int64_to_int32(
+	int32_t* destination, const int64_t* source, size_t n,
+	overflow_handling_t handling, simd_level_t level) noexcept
+{
+	size_t i = 0;
+	CUDA_API_WRAPPERS_SIMD_DISPATCH(level, i,
+		int64_to_int32_avx512(destination, source, n, handling), 0)
+	if (handling == overflow_handling_t::saturate) {
+		for(; i < n; i++) { destination[i] = saturate_to_int32(source[i]); }
+		return n;
+	}
+	for(; i < n; i++) {
+		if (not fits_in_int32(source[i])) { return i; }
+		destination[i] = static_cast<int32_t>(source[i]);
+	}
+	return n;
+}
+
+inline void int32_to_int64(int64_t* destination, const int32_t* source, size_t n, simd_level_t level) noexcept
+{
+	size_t i = 0;
+	CUDA_API_WRAPPERS_SIMD_DISPATCH(level, i,
+		int32_to_int64_avx512(destination, source, n), int32_to_int64_avx2(destination, source, n))
+	for(; i < n; i++) { destination[i] = source[i]; }
+}
+
+#undef CUDA_API_WRAPPERS_SIMD_DISPATCH
+
+} // namespace detail_
+
+/**
+ * @brief Convert single-precision floating-point values to half-precision (IEEE binary16),
+ * rounding to nearest-even.
+ */
+inline void convert_fp32_to_fp16(
+	uint16_t* destination, const float* source, size_t num_elements,
+	simd_level_t max_simd_level = simd_level_t::avx512)
+{
+	auto level = detail_::effective_level(max_simd_level);
+	detail_::parallelize(num_elements, sizeof(uint16_t), [&](size_t first, size_t count) {
+		detail_::fp32_to_fp16(destination + first, source + first, count, level);
+	});
+}
+
+/**
+ * @brief Convert half-precision (IEEE binary16) values to single-precision (exactly).
+ */
+inline void convert_fp16_to_fp32(
+	float* destination, const uint16_t* source, size_t num_elements,
+	simd_level_t max_simd_level = simd_level_t::avx512)
+{
+	auto level = detail_::effective_level(max_simd_level);
+	detail_::parallelize(num_elements, sizeof(float), [&](size_t first, size_t count) {
+		detail_::fp16_to_fp32(destination + first, source + first, count, level);
+	});
+}
+
+/**
+ * @brief Convert single-precision floating-point values to bfloat16, rounding to nearest-even.
+ */
+inline void convert_fp32_to_bf16(
+	uint16_t* destination, const float* source, size_t num_elements,
+	simd_level_t max_simd_level = simd_level_t::avx512)
+{
+	auto level = detail_::effective_level(max_simd_level);
+	detail_::parallelize(num_elements, sizeof(uint16_t), [&](size_t first, size_t count) {
+		detail_::fp32_to_bf16(destination + first, source + first, count, level);
+	});
+}
+
+/**
+ * @brief Convert bfloat16 values to single-precision (exactly).
+ */
+inline void convert_bf16_to_fp32(
+	float* destination, const uint16_t* source, size_t num_elements,
+	simd_level_t max_simd_level = simd_level_t::avx512)
+{
+	auto level = detail_::effective_level(max_simd_level);
+	detail_::parallelize(num_elements, sizeof(float), [&](size_t first, size_t count) {
+		detail_::bf16_to_fp32(destination + first, source + first, count, level);
+	});
+}
+
+/**
+ * @brief Convert 64-bit integers to 32-bit integers.
+ *
+ * @throws ::std::out_of_range if some value does not fit in 32 bits and
+ * @p handling is @ref overflow_handling_t::throw_exception ; the destination
+ * contents are unspecified in that case.
+ */
+inline void convert_int64_to_int32(
+	int32_t* destination, const int64_t* source, size_t num_elements,
+	overflow_handling_t  handling = overflow_handling_t::throw_exception,
+	simd_level_t         max_simd_level = simd_level_t::avx512)
+{
+	auto level = detail_::effective_level(max_simd_level);
+	detail_::parallelize(num_elements, sizeof(int32_t), [&](size_t first, size_t count) {
+		auto num_converted = detail_::int64_to_int32(destination + first, source + first, count, handling, level);
+		if (num_converted < count) {
+			auto index = first + num_converted;
+			throw ::std::out_of_range("Value " + ::std::to_string(source[index]) + " at index "
+				+ ::std::to_string(index) + " does not fit in a 32-bit integer");
+		}
+	});
+}
+
+/**
+ * @brief Convert 32-bit integers to 64-bit integers.
+ */
+inline void convert_int32_to_int64(
+	int64_t* destination, const int32_t* source, size_t num_elements,
+	simd_level_t max_simd_level = simd_level_t::avx512)
+{
+	auto level = detail_::effective_level(max_simd_level);
+	detail_::parallelize(num_elements, sizeof(int64_t), [&](size_t first, size_t count) {
+		detail_::int32_to_int64(destination + first, source + first, count, level);
+	});
+}
+
+namespace detail_ {
+
+template <typename Packed, typename Unpacked, typename Convert>
+inline void upload_converted(
+	region_t           destination,
+	const Unpacked*    source,
+	size_t             num_elements,
+	staging_buffer_t&  staging,
+	const stream_t&    stream,
+	Convert            convert)
+{
+	ensure_fits(destination, num_elements * sizeof(Packed));
+	auto destination_ = static_cast<Packed*>(destination.start());
+	pipelined_upload(staging, stream, num_elements, sizeof(Packed),
+		[&](char* slot, size_t first, size_t count) {
+			convert(reinterpret_cast<Packed*>(slot), source + first, count);
+		},
+		[&](char* slot, size_t first, size_t count) {
+			memory::async::copy(destination_ + first, slot, count * sizeof(Packed), stream);
+		});
+}
+
+template <typename Packed, typename Unpacked, typename Convert>
+inline void download_converted(
+	Unpacked*          destination,
+	const_region_t     source,
+	size_t             num_elements,
+	staging_buffer_t&  staging,
+	const stream_t&    stream,
+	Convert            convert)
+{
+	if (source.size() < num_elements * sizeof(Packed)) {
+		throw ::std::invalid_argument("Download source region of size " + ::std::to_string(source.size())
+			+ " is too small for " + ::std::to_string(num_elements) + " packed elements");
+	}
+	auto source_ = static_cast<const Packed*>(source.start());
+	pipelined_download(staging, stream, num_elements, sizeof(Packed),
+		[&](char* slot, size_t first, size_t count) {
+			memory::async::copy(slot, source_ + first, count * sizeof(Packed), stream);
+		},
+		[&](char* slot, size_t first, size_t count) {
+			convert(destination + first, reinterpret_cast<const Packed*>(slot), count);
+		});
+}
+
+} // namespace detail_
+
+/**
+ * @brief Upload single-precision values to device memory as half-precision
+ * (IEEE binary16) values, converting them on the host while staging.
+ *
+ * @param destination device memory for @p num_elements 16-bit values
+ * @param source the values to convert and upload
+ * @param num_elements number of values
+ * @param staging pinned staging slots through which to upload
+ * @param stream the stream on which to enqueue the copies
+ *
+ * @note Returns once all copies have been enqueued.
+ */
+inline void upload_as_fp16(
+	region_t destination, const float* source, size_t num_elements,
+	staging_buffer_t& staging, const stream_t& stream)
+{
+	detail_::upload_converted<uint16_t>(destination, source, num_elements, staging, stream,
+		[](uint16_t* d, const float* s, size_t n) { convert_fp32_to_fp16(d, s, n); });
+}
+
+/**
+ * @brief Upload single-precision values to device memory as bfloat16 values,
+ * converting them on the host while staging.
+ *
+ * @copydetails upload_as_fp16
+ */
+inline void upload_as_bf16(
+	region_t destination, const float* source, size_t num_elements,
+	staging_buffer_t& staging, const stream_t& stream)
+{
+	detail_::upload_converted<uint16_t>(destination, source, num_elements, staging, stream,
+		[](uint16_t* d, const float* s, size_t n) { convert_fp32_to_bf16(d, s, n); });
+}
+
+/**
+ * @brief Upload 64-bit integers to device memory as 32-bit integers,
+ * converting them on the host while staging.
+ *
+ * @throws ::std::out_of_range if a value does not fit in 32 bits and @p handling
+ * is @ref overflow_handling_t::throw_exception ; copies of chunks preceding the
+ * offending value may have been enqueued already.
+ */
+inline void upload_as_int32(
+	region_t destination, const int64_t* source, size_t num_elements,
+	staging_buffer_t& staging, const stream_t& stream,
+	overflow_handling_t handling = overflow_handling_t::throw_exception)
+{
+	detail_::upload_converted<int32_t>(destination, source, num_elements, staging, stream,
+		[handling](int32_t* d, const int64_t* s, size_t n) { convert_int64_to_int32(d, s, n, handling); });
+}
+
+/**
+ * @brief Download half-precision (IEEE binary16) values from device memory,
+ * widening them to single-precision on the host.
+ *
+ * @param destination host memory for @p num_elements values
+ * @param source device memory holding @p num_elements 16-bit values
+ * @param num_elements number of values
+ * @param staging pinned staging slots through which to download
+ * @param stream the stream on which to enqueue the copies
+ *
+ * @note Returns once all values have been downloaded and converted.
+ */
+inline void download_from_fp16(
+	float* destination, const_region_t source, size_t num_elements,
+	staging_buffer_t& staging, const stream_t& stream)
+{
+	detail_::download_converted<uint16_t>(destination, source, num_elements, staging, stream,
+		[](float* d, const uint16_t* s, size_t n) { convert_fp16_to_fp32(d, s, n); });
+}
+
+/**
+ * @brief Download bfloat16 values from device memory, widening them
+ * to single-precision on the host.
+ *
+ * @copydetails download_from_fp16
+ */
+inline void download_from_bf16(
+	float* destination, const_region_t source, size_t num_elements,
+	staging_buffer_t& staging, const stream_t& stream)
+{
+	detail_::download_converted<uint16_t>(destination, source, num_elements, staging, stream,
+		[](float* d, const uint16_t* s, size_t n) { convert_bf16_to_fp32(d, s, n); });
+}
+
+/**
+ * @brief Download 32-bit integers from device memory, widening them
+ * to 64 bits on the host.
+ *
+ * @copydetails download_from_fp16
+ */
+inline void download_from_int32(
+	int64_t* destination, const_region_t source, size_t num_elements,
+	staging_buffer_t& staging, const stream_t& stream)
+{
+	detail_::download_converted<int32_t>(destination, source, num_elements, staging, stream,
+		[](int64_t* d, const int32_t* s, size_t n) { convert_int32_to_int64(d, s, n); });
+}
+
+} // namespace staging
+} // namespace memory
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_STAGING_CONVERSIONS_HPP_
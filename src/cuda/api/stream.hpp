@@ -9,10 +9,13 @@
 #define CUDA_API_WRAPPERS_STREAM_HPP_
 
 #include <cuda/api/current_device.hpp>
+#include <cuda/api/detail/deferred_destruction.hpp>
 #include <cuda/api/error.hpp>
+#include <cuda/api/fill.hpp>
 #include <cuda/api/kernel_launch.hpp>
 #include <cuda/api/memory.hpp>
 #include <cuda/api/miscellany.hpp>
+#include <cuda/api/recording.hpp>
 #include <cuda/common/types.hpp>
 
 #include <cuda_runtime_api.h>
@@ -99,7 +102,8 @@ inline device::id_t associated_device(stream::id_t stream_id)
 	if (stream_id == cuda::stream::default_stream_id) {
 		throw ::std::invalid_argument("Cannot determine device association for the default/null stream");
 	}
-	for(device::id_t device_index = 0; device_index < device::count(); device_index++) {
+	auto num_devices = device::count();
+	for(device::id_t device_index = 0; device_index < num_devices; device_index++) {
 		if (is_associated_with(stream_id, device_index)) { return device_index; }
 	}
 	throw ::std::runtime_error(
@@ -348,6 +352,11 @@ public: // mutators
 		 **/
 		void copy(void *destination, const void *source, size_t num_bytes)
 		{
+			auto hook = memory::async::detail_::copy_hook().load(::std::memory_order_relaxed);
+			if (hook != nullptr) {
+				hook(destination, source, num_bytes, associated_stream);
+				return;
+			}
 			// It is not necessary to make the device current, according to:
 			// http://docs.nvidia.com/cuda/cuda-c-programming-guide/index.html#stream-and-event-behavior
 			memory::async::detail_::copy(destination, source, num_bytes, associated_stream.id_);
@@ -407,6 +416,31 @@ public: // mutators
 			memory::device::async::detail_::zero(destination, num_bytes, associated_stream.id_);
 		}
 
+		/**
+		 * Set each element of an array in device memory to the same value - which,
+		 * unlike with @ref memset(), may be 2, 4 or 8 bytes wide.
+		 */
+		template <typename T>
+		void fill(T* destination, const T& value, size_t num_elements)
+		{
+			device_setter_type set_device_for_this_scope(associated_stream.device_id_);
+			memory::device::async::detail_::fill(destination, value, num_elements, associated_stream.id_);
+		}
+
+		/**
+		 * Set each element of a pitched 2D array in device memory to the same value
+		 *
+		 * @param pitch_in_bytes the distance between the starts of consecutive rows
+		 * @param width_in_elements the number of elements to set in each row
+		 */
+		template <typename T>
+		void fill_2d(T* destination, size_t pitch_in_bytes, size_t width_in_elements, size_t height, const T& value)
+		{
+			device_setter_type set_device_for_this_scope(associated_stream.device_id_);
+			memory::device::async::detail_::fill_2d(
+				destination, pitch_in_bytes, width_in_elements, height, value, associated_stream.id_);
+		}
+
 		/**
 		 * Have an event 'fire', i.e. marked as having occurred,
 		 * after all hereto-scheduled work on this stream has been completed.
@@ -596,7 +630,7 @@ public: // constructors and destructor
 
 	~stream_t()
 	{
-		if (owning) {
+		if (owning and not cuda::detail_::defer_destruction(cuda::detail_::destroyable_t::stream, id_, device_id_)) {
 			device_setter_type set_device_for_this_scope(device_id_);
 			cudaStreamDestroy(id_);
 		}
@@ -695,10 +729,13 @@ using queue_id_t = stream::id_t;
 
 inline void synchronize(const stream_t& stream)
 {
+	auto recording_start = recording::detail_::begin();
 	auto status = cudaStreamSynchronize(stream.id());
 	throw_if_error(status,
 		::std::string("Failed synchronizing a stream")
 		+ " on CUDA device " + ::std::to_string(stream.device().id()));
+	recording::detail_::end(recording_start, recording::detail_::make_record(
+		recording::operation_t::synchronize_stream, stream.id(), nullptr, nullptr, nullptr, 0, stream.device().id()));
 }
 
 
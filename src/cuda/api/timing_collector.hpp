@@ -0,0 +1,335 @@
+/**
+ * @file timing_collector.hpp
+ *
+ * @brief Timing many spans of stream work cheaply enough for always-on sampling:
+ * Spans are marked with pooled events; completed spans are resolved together, in a
+ * single sweep, relative to a common epoch event - so that they can be placed on
+ * a timeline, rather than merely measured - and their events are then recycled.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_TIMING_COLLECTOR_HPP_
+#define CUDA_API_WRAPPERS_TIMING_COLLECTOR_HPP_
+
+#include <cuda/api/device.hpp>
+#include <cuda/api/event.hpp>
+#include <cuda/api/event_pool.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/stream.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cuda {
+
+namespace timing {
+
+/**
+ * A span of work on a stream, placed on the collector's timeline
+ */
+struct span_t {
+	/** As passed when the span began; not copied, so it must outlive the collector's use of it */
+	const char*  label;
+	/** Since the collector's first epoch */
+	double       start_seconds;
+	double       end_seconds;
+
+	double seconds() const noexcept { return end_seconds - start_seconds; }
+};
+
+struct stream_timeline_t {
+	stream::id_t             stream;
+	/** By start time */
+	::std::vector<span_t>    spans;
+};
+
+using timeline_t = ::std::vector<stream_timeline_t>;
+
+struct options_t {
+	/**
+	 * How often to record a new epoch event, against which newly-begun spans are timed.
+	 * Event timings are single-precision milliseconds, so their resolution degrades
+	 * with the distance from the epoch; consecutive epochs are chained together.
+	 */
+	::std::chrono::milliseconds epoch_interval { 1000 };
+	/**
+	 * Once this many spans await resolution, beginning another one first collects
+	 * those which have completed
+	 */
+	size_t collection_threshold { 4096 };
+	/**
+	 * Spans begun while this many spans await resolution - even after collecting the
+	 * completed ones - are dropped rather than timed; this bounds the number of events
+	 * held, e.g. when spans are never ended, or when their work never completes
+	 */
+	size_t max_pending_spans { 64 * 1024 };
+	/**
+	 * Epochs are held while spans are timed against them; spans which are never ended
+	 * keep theirs from being released. Once this many are held, no more are recorded,
+	 * and new spans are timed against the latest one (at a lower resolution)
+	 */
+	size_t max_epochs { 1024 };
+};
+
+struct statistics_t {
+	size_t spans_begun     { 0 };
+	size_t spans_resolved  { 0 };
+	/** Not timed, due to @ref options_t::max_pending_spans */
+	size_t spans_dropped   { 0 };
+	size_t sweeps          { 0 };
+	size_t epochs          { 0 };
+};
+
+} // namespace timing
+
+/**
+ * @brief Times spans of work on the streams of a single device, and gathers
+ * them into a per-stream timeline
+ *
+ * Typical use:
+ *
+ *   auto span = collector.begin(stream, "decode");
+ *   stream.enqueue.kernel_launch(decode, ...);
+ *   collector.end(span);
+ *   ...
+ *   collector.collect();   // e.g. periodically
+ *   for(const auto& stream_timeline : collector.take_timeline()) { ... }
+ */
+class timing_collector_t {
+public: // types
+	using span_id_t = size_t;
+	using options_t = timing::options_t;
+	using statistics_t = timing::statistics_t;
+	using timeline_t = timing::timeline_t;
+
+	/** Returned by @ref begin() for spans which are dropped rather than timed */
+	enum : span_id_t { dropped_span = ::std::numeric_limits<span_id_t>::max() };
+
+public: // getters
+	device_t device() const noexcept { return device::get(device_id_); }
+
+	statistics_t statistics() const
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		return statistics_;
+	}
+
+	size_t num_pending() const
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		return pending_.size();
+	}
+
+public: // mutators
+	/**
+	 * @brief Mark the beginning of a span, at the current end of @p stream
+	 *
+	 * @param label identifies the span on the timeline; typically a string literal
+	 * @return the span's identifier, to pass to @ref end(); or @ref dropped_span , if
+	 * @ref options_t::max_pending_spans spans still await resolution
+	 */
+	span_id_t begin(const stream_t& stream, const char* label = nullptr)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		if (pending_.size() >= options_.collection_threshold) { sweep(); }
+		if (pending_.size() >= options_.max_pending_spans) {
+			statistics_.spans_dropped++;
+			return dropped_span;
+		}
+		// Recording epochs on the streams being timed, rather than on some other stream,
+		// keeps them from introducing dependencies between streams
+		if (epochs_.empty() or (
+			::std::chrono::steady_clock::now() - epochs_.rbegin()->second.recorded_at >= options_.epoch_interval
+			and epochs_.size() < options_.max_epochs))
+		{
+			record_epoch(stream);
+		}
+		auto start = pool_.acquire();
+		stream_t(stream).enqueue.event(start.get());
+		auto& latest_epoch = *epochs_.rbegin();
+		auto epoch_index = latest_epoch.first;
+		latest_epoch.second.num_spans++;
+		auto span_id = next_span_id_++;
+		pending_.emplace(span_id, pending_span_t{ stream.id(), label, epoch_index, ::std::move(start), nullptr });
+		statistics_.spans_begun++;
+		return span_id;
+	}
+
+	/**
+	 * @brief Mark the end of a span, at the current end of the stream on which it began
+	 *
+	 * @note Ending a dropped span has no effect
+	 */
+	void end(span_id_t span_id)
+	{
+		if (span_id == dropped_span) { return; }
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto it = pending_.find(span_id);
+		if (it == pending_.end() or it->second.end) {
+			throw ::std::invalid_argument("No span " + ::std::to_string(span_id) + " awaiting its end");
+		}
+		auto end_event = pool_.acquire();
+		device::current::detail_::scoped_override_t set_device_for_this_scope(device_id_);
+		stream::detail_::record_event_on_current_device(
+			device_id_, it->second.stream, end_event.get().id());
+		it->second.end.reset(new event_pool::pooled_event_t(::std::move(end_event)));
+	}
+
+	/**
+	 * @brief Time the work @p enqueue_work enqueues on @p stream
+	 */
+	template <typename F>
+	void time(const stream_t& stream, const char* label, F&& enqueue_work)
+	{
+		auto span_id = begin(stream, label);
+		enqueue_work();
+		end(span_id);
+	}
+
+	/**
+	 * @brief Resolve all spans which have completed, placing them on the timeline
+	 * and recycling their events
+	 *
+	 * @note Does not block
+	 */
+	void collect()
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		sweep();
+	}
+
+	/**
+	 * @return the spans resolved so far - and not yet taken - by stream
+	 */
+	timeline_t take_timeline()
+	{
+		timeline_t timeline;
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		for(auto& stream_spans : resolved_) {
+			auto& spans = stream_spans.second;
+			::std::sort(spans.begin(), spans.end(),
+				[](const timing::span_t& lhs, const timing::span_t& rhs) { return lhs.start_seconds < rhs.start_seconds; });
+			timeline.push_back(timing::stream_timeline_t{ stream_spans.first, ::std::move(spans) });
+		}
+		resolved_.clear();
+		return timeline;
+	}
+
+public: // constructors and destructor
+	explicit timing_collector_t(device_t device, options_t options = {}) :
+		device_id_(device.id()),
+		options_(options),
+		pool_(device, event::sync_by_blocking, event::do_record_timings) { }
+
+	timing_collector_t(const timing_collector_t&) = delete;
+
+public: // operators
+	timing_collector_t& operator=(const timing_collector_t&) = delete;
+
+protected: // types
+	struct epoch_t {
+		event_pool::pooled_event_t              event;
+		::std::chrono::steady_clock::time_point recorded_at;
+		/** Since the first epoch; only valid once resolved */
+		double                                  offset_seconds;
+		/** Set once both this epoch and the one before it have occurred */
+		bool                                    resolved;
+		/** Pending spans timed against this epoch */
+		size_t                                  num_spans;
+	};
+
+	struct pending_span_t {
+		stream::id_t                                     stream;
+		const char*                                      label;
+		size_t                                           epoch_index;
+		event_pool::pooled_event_t                       start;
+		::std::unique_ptr<event_pool::pooled_event_t>    end;
+	};
+
+protected: // non-mutators
+	static double seconds_between(const event_t& earlier, const event_t& later)
+	{
+		return ::std::chrono::duration<double>(event::time_elapsed_between(earlier, later)).count();
+	}
+
+protected: // mutators
+	void record_epoch(const stream_t& stream)
+	{
+		auto event = pool_.acquire();
+		stream_t(stream).enqueue.event(event.get());
+		epochs_.emplace(next_epoch_index_++,
+			epoch_t{ ::std::move(event), ::std::chrono::steady_clock::now(), 0.0, false, 0 });
+		statistics_.epochs++;
+	}
+
+	void sweep()
+	{
+		statistics_.sweeps++;
+		// Each epoch is placed relative to the one held before it - which must have
+		// occurred as well, as epochs may be recorded on different streams; the very
+		// first epoch is the timeline's origin
+		epoch_t* previous = nullptr;
+		for(auto& indexed_epoch : epochs_) {
+			auto& epoch = indexed_epoch.second;
+			if (not epoch.resolved) {
+				if (not epoch.event->has_occurred()) { break; }
+				epoch.offset_seconds = (previous == nullptr) ? 0.0 :
+					previous->offset_seconds + seconds_between(previous->event, epoch.event);
+				epoch.resolved = true;
+			}
+			previous = &epoch;
+		}
+
+		for(auto it = pending_.begin(); it != pending_.end(); ) {
+			auto& span = it->second;
+			auto& epoch = epochs_.at(span.epoch_index);
+			// The span's start precedes its end on the same stream
+			if (not span.end or not epoch.resolved or not (*span.end)->has_occurred()) {
+				++it;
+				continue;
+			}
+			resolved_[span.stream].push_back(timing::span_t{
+				span.label,
+				epoch.offset_seconds + seconds_between(epoch.event, span.start),
+				epoch.offset_seconds + seconds_between(epoch.event, *span.end) });
+			epoch.num_spans--;
+			statistics_.spans_resolved++;
+			it = pending_.erase(it);
+		}
+
+		// An epoch remains needed while spans are timed against it, or while
+		// it is the latest resolved one, which the next epoch is placed against
+		for(auto it = epochs_.begin(); it != epochs_.end(); ) {
+			auto next = ::std::next(it);
+			if (next == epochs_.end() or not next->second.resolved) { break; }
+			if (it->second.num_spans == 0) { epochs_.erase(it); }
+			it = next;
+		}
+	}
+
+protected: // data members
+	device::id_t                                                  device_id_;
+	options_t                                                     options_;
+	event_pool_t                                                  pool_;
+	mutable ::std::mutex                                          mutex_;
+	/** By index among all epochs recorded */
+	::std::map<size_t, epoch_t>                                   epochs_;
+	size_t                                                        next_epoch_index_ { 0 };
+	::std::unordered_map<span_id_t, pending_span_t>               pending_;
+	span_id_t                                                     next_span_id_ { 0 };
+	::std::map<stream::id_t, ::std::vector<timing::span_t>>       resolved_;
+	statistics_t                                                  statistics_;
+};
+
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_TIMING_COLLECTOR_HPP_
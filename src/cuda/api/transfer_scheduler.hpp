@@ -0,0 +1,299 @@
+/**
+ * @file transfer_scheduler.hpp
+ *
+ * @brief Scheduling host-to-device and device-to-host copies on separate, dedicated
+ * streams, interleaved chunk by chunk - so that devices with two copy engines carry
+ * out transfers in both directions at the same time, rather than one after the other.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_TRANSFER_SCHEDULER_HPP_
+#define CUDA_API_WRAPPERS_TRANSFER_SCHEDULER_HPP_
+
+#include <cuda/api/device.hpp>
+#include <cuda/api/event.hpp>
+#include <cuda/api/event_pool.hpp>
+#include <cuda/api/memory.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/stream.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace cuda {
+
+namespace transfer_scheduling {
+
+enum class direction_t : int {
+	host_to_device = 0,
+	device_to_host = 1
+};
+
+struct options_t {
+	/**
+	 * Transfers larger than this are split, so that transfers in the other direction
+	 * are interleaved with them
+	 */
+	size_t chunk_size { 4 * 1024 * 1024 };
+	/**
+	 * Queued transfers are dispatched once their total size reaches this many bytes,
+	 * even without an explicit @ref transfer_scheduler_t::dispatch()
+	 */
+	size_t dispatch_threshold { 64 * 1024 * 1024 };
+};
+
+struct statistics_t {
+	size_t transfers[2]  { 0, 0 };
+	size_t chunks[2]     { 0, 0 };
+	size_t bytes[2]      { 0, 0 };
+	size_t dispatches    { 0 };
+};
+
+///@cond
+namespace detail_ {
+
+struct completion_t {
+	event_pool::pooled_event_t  event;
+	::std::atomic<bool>         dispatched { false };
+
+	explicit completion_t(event_pool::pooled_event_t&& event_) : event(::std::move(event_)) { }
+};
+
+} // namespace detail_
+///@endcond
+
+/**
+ * @brief Marks the completion of a scheduled transfer
+ */
+class token_t {
+public: // getters
+	/**
+	 * @return true once the transfer has been dispatched, and carried out in full
+	 */
+	bool is_complete() const
+	{
+		return completion_->dispatched and completion_->event->has_occurred();
+	}
+
+public: // mutators
+	/**
+	 * @brief Block until the transfer has been carried out in full
+	 *
+	 * @throws ::std::logic_error if the transfer has not yet been dispatched -
+	 * as otherwise, this would never return
+	 */
+	void wait() const
+	{
+		check_dispatched();
+		completion_->event->synchronize();
+	}
+
+	/**
+	 * @brief Have work enqueued on @p stream from now on wait for the transfer
+	 */
+	void enqueue_wait(stream_t stream) const
+	{
+		check_dispatched();
+		stream.enqueue.wait(completion_->event);
+	}
+
+public: // constructors and destructor
+	explicit token_t(::std::shared_ptr<detail_::completion_t> completion) : completion_(::std::move(completion)) { }
+
+protected: // non-mutators
+	void check_dispatched() const
+	{
+		if (not completion_->dispatched) {
+			throw ::std::logic_error("Waiting for a transfer which has not yet been dispatched");
+		}
+	}
+
+protected: // data members
+	::std::shared_ptr<detail_::completion_t> completion_;
+};
+
+} // namespace transfer_scheduling
+
+/**
+ * @brief Queues copies between the host and a device by direction, and dispatches
+ * them onto a host-to-device and a device-to-host stream of its own, alternating
+ * between the directions chunk by chunk.
+ *
+ * Typical use, in a streaming loop:
+ *
+ *   auto uploaded = scheduler.to_device(device_input, host_input[i + 1], size);
+ *   auto downloaded = scheduler.to_host(host_output[i - 1], device_output, size, &compute_stream);
+ *   scheduler.dispatch();
+ *   uploaded.enqueue_wait(compute_stream);
+ *   ...
+ *
+ * @note For the copies to be asynchronous, and overlap, host memory must be pinned.
+ * On devices with a single copy engine the transfers are not split, as they
+ * would not overlap anyway.
+ */
+class transfer_scheduler_t {
+public: // types
+	using direction_t = transfer_scheduling::direction_t;
+	using options_t = transfer_scheduling::options_t;
+	using statistics_t = transfer_scheduling::statistics_t;
+	using token_t = transfer_scheduling::token_t;
+
+public: // getters
+	device_t device() const noexcept { return device::get(device_id_); }
+
+	const stream_t& stream(direction_t direction) const noexcept
+	{
+		return streams_[static_cast<int>(direction)];
+	}
+
+	/**
+	 * @return true if transfers in the two directions can be carried out at the same time
+	 */
+	bool is_bidirectional() const noexcept { return bidirectional_; }
+
+	statistics_t statistics() const
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		return statistics_;
+	}
+
+public: // mutators
+	/**
+	 * @brief Queue a copy, to be carried out with the next dispatch
+	 *
+	 * @param after if not null, the copy only begins once the work enqueued on
+	 * this stream so far has concluded
+	 */
+	token_t schedule(
+		direction_t      direction,
+		void*            destination,
+		const void*      source,
+		size_t           num_bytes,
+		const stream_t*  after = nullptr)
+	{
+		auto completion = ::std::make_shared<transfer_scheduling::detail_::completion_t>(events_.acquire());
+		request_t request { static_cast<char*>(destination), static_cast<const char*>(source), num_bytes, completion, nullptr };
+		if (after != nullptr) {
+			request.after.reset(new event_pool::pooled_event_t(events_.acquire()));
+			stream_t(*after).enqueue.event(request.after->get());
+		}
+		bool should_dispatch;
+		{
+			::std::lock_guard<::std::mutex> lock(mutex_);
+			queues_[static_cast<int>(direction)].push_back(::std::move(request));
+			queued_bytes_ += num_bytes;
+			should_dispatch = queued_bytes_ >= options_.dispatch_threshold;
+		}
+		if (should_dispatch) { dispatch(); }
+		return token_t{ ::std::move(completion) };
+	}
+
+	token_t to_device(void* destination, const void* source, size_t num_bytes, const stream_t* after = nullptr)
+	{
+		return schedule(direction_t::host_to_device, destination, source, num_bytes, after);
+	}
+
+	token_t to_host(void* destination, const void* source, size_t num_bytes, const stream_t* after = nullptr)
+	{
+		return schedule(direction_t::device_to_host, destination, source, num_bytes, after);
+	}
+
+	/**
+	 * @brief Enqueue all queued copies onto the scheduler's streams, alternating
+	 * between the directions with every chunk
+	 */
+	void dispatch()
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		if (queues_[0].empty() and queues_[1].empty()) { return; }
+		auto chunk_size = bidirectional_ ? ::std::max<size_t>(options_.chunk_size, 1) : static_cast<size_t>(-1);
+		while (not (queues_[0].empty() and queues_[1].empty())) {
+			for(int direction = 0; direction < 2; direction++) {
+				auto& queue = queues_[direction];
+				if (queue.empty()) { continue; }
+				auto& request = queue.front();
+				auto& stream_ = streams_[direction];
+				if (request.after) {
+					stream_.enqueue.wait(request.after->get());
+					request.after.reset();
+				}
+				auto this_chunk_size = ::std::min(chunk_size, request.remaining);
+				memory::async::detail_::copy(request.destination, request.source, this_chunk_size, stream_.id());
+				request.destination += this_chunk_size;
+				request.source += this_chunk_size;
+				request.remaining -= this_chunk_size;
+				queued_bytes_ -= this_chunk_size;
+				statistics_.chunks[direction]++;
+				statistics_.bytes[direction] += this_chunk_size;
+				if (request.remaining == 0) {
+					stream_.enqueue.event(request.completion->event.get());
+					request.completion->dispatched = true;
+					statistics_.transfers[direction]++;
+					queue.pop_front();
+				}
+			}
+		}
+		statistics_.dispatches++;
+	}
+
+	/**
+	 * @brief Dispatch all queued copies, and block until they have been carried out
+	 */
+	void synchronize()
+	{
+		dispatch();
+		for(auto& stream_ : streams_) { stream_.synchronize(); }
+	}
+
+public: // constructors and destructor
+	explicit transfer_scheduler_t(device_t device, options_t options = {}) :
+		device_id_(device.id()),
+		options_(options),
+		bidirectional_(device.get_attribute(cudaDevAttrAsyncEngineCount) >= 2),
+		streams_ { device.create_stream(stream::async), device.create_stream(stream::async) },
+		events_(device, event::sync_by_blocking, event::dont_record_timings)
+	{ }
+
+	transfer_scheduler_t(const transfer_scheduler_t&) = delete;
+
+	~transfer_scheduler_t()
+	{
+		// Queued copies are still expected to be carried out; and the streams
+		// must not be destroyed while their copies are in progress
+		try { synchronize(); }
+		catch(...) { }
+	}
+
+public: // operators
+	transfer_scheduler_t& operator=(const transfer_scheduler_t&) = delete;
+
+protected: // types
+	struct request_t {
+		char*                                                               destination;
+		const char*                                                         source;
+		size_t                                                              remaining;
+		::std::shared_ptr<transfer_scheduling::detail_::completion_t>       completion;
+		::std::unique_ptr<event_pool::pooled_event_t>                       after;
+	};
+
+protected: // data members
+	device::id_t                   device_id_;
+	options_t                      options_;
+	bool                           bidirectional_;
+	/** indexed by direction */
+	stream_t                       streams_[2];
+	/** For marking transfers' completions, and the points in other streams they follow */
+	event_pool_t                   events_;
+	mutable ::std::mutex           mutex_;
+	::std::deque<request_t>        queues_[2];
+	size_t                         queued_bytes_ { 0 };
+	statistics_t                   statistics_;
+};
+
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_TRANSFER_SCHEDULER_HPP_
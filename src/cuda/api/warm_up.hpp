@@ -0,0 +1,217 @@
+/**
+ * @file warm_up.hpp
+ *
+ * @brief Initializing CUDA devices ahead of their first use, on background threads.
+ *
+ * The CUDA runtime creates a device's (primary) context lazily, on the first
+ * call which requires it - typically taking a sizable fraction of a second per
+ * device, which is then paid by whatever work happens to use the device first.
+ * Warming up the devices in the background, while the application is busy with
+ * other initialization, moves that cost off the critical path.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_WARM_UP_HPP_
+#define CUDA_API_WRAPPERS_WARM_UP_HPP_
+
+#include <cuda/api/affinity.hpp>
+#include <cuda/api/current_device.hpp>
+#include <cuda/api/device.hpp>
+#include <cuda/api/devices.hpp>
+#include <cuda/api/event.hpp>
+#include <cuda/api/miscellany.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/stream.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <ostream>
+#include <vector>
+
+namespace cuda {
+
+/**
+ * What to do for each device, beyond creating its primary context
+ */
+struct warm_up_options_t {
+	/**
+	 * The number of streams to create on each device, e.g. to populate a
+	 * pool from which requests later draw streams
+	 */
+	size_t streams_per_device { 0 };
+
+	/**
+	 * Whether the pre-created streams synchronize with the default stream
+	 */
+	bool streams_synchronize_with_default_stream { stream::async };
+
+	/**
+	 * The number of events to create on each device
+	 */
+	size_t events_per_device { 0 };
+
+	bool events_use_blocking_sync { event::sync_by_blocking };
+	bool events_record_timings { event::dont_record_timings };
+
+	/**
+	 * The number of bytes of device memory to allocate, and then keep reserved,
+	 * in each device's default memory pool - so that the first stream-ordered
+	 * allocations (up to that size) need not obtain memory from the driver.
+	 * The pool's release threshold is raised to this size, if it is lower.
+	 *
+	 * @note Ignored with CUDA versions below 11.2, which lack memory pools.
+	 */
+	size_t memory_pool_reservation { 0 };
+
+	/**
+	 * Bind the thread warming up each device to the CPUs close to it, so that
+	 * the host-side structures of the device's context are allocated nearby
+	 */
+	bool bind_threads_near_devices { true };
+};
+
+/**
+ * The outcome of warming up a single device: the resources created on it
+ * per the @ref warm_up_options_t, which are now the caller's to keep.
+ */
+struct warmed_up_device_t {
+	device::id_t            device_id;
+	::std::vector<stream_t> streams;
+	::std::vector<event_t>  events;
+	/**
+	 * Time spent on creating the device's context
+	 */
+	double                  context_creation_seconds;
+	/**
+	 * Time spent on warming up the device altogether
+	 */
+	double                  total_seconds;
+};
+
+inline ::std::ostream& operator<<(::std::ostream& os, const warmed_up_device_t& warmed_up)
+{
+	return os
+		<< "device " << warmed_up.device_id << ": context created in "
+		<< warmed_up.context_creation_seconds * 1000 << " ms, warmed up in "
+		<< warmed_up.total_seconds * 1000 << " ms (" << warmed_up.streams.size()
+		<< " streams, " << warmed_up.events.size() << " events)";
+}
+
+///@cond
+namespace detail_ {
+
+inline double seconds_since(::std::chrono::steady_clock::time_point start)
+{
+	return ::std::chrono::duration<double>(::std::chrono::steady_clock::now() - start).count();
+}
+
+inline void reserve_pool_memory(const stream_t& stream, size_t num_bytes)
+{
+#if CUDART_VERSION >= 11020
+	cudaMemPool_t pool;
+	auto device_id = stream.device().id();
+	throw_if_error(cudaDeviceGetDefaultMemPool(&pool, device_id),
+		"Failed obtaining the default memory pool of CUDA device " + ::std::to_string(device_id));
+	// Without raising the threshold, the pool would return the memory to
+	// the driver at the next synchronization; but a higher threshold, e.g.
+	// one set by the user, is kept
+	uint64_t threshold;
+	throw_if_error(cudaMemPoolGetAttribute(pool, cudaMemPoolAttrReleaseThreshold, &threshold),
+		"Failed obtaining the release threshold of the default memory pool of CUDA device "
+		+ ::std::to_string(device_id));
+	if (threshold < num_bytes) {
+		threshold = num_bytes;
+		throw_if_error(cudaMemPoolSetAttribute(pool, cudaMemPoolAttrReleaseThreshold, &threshold),
+			"Failed setting the release threshold of the default memory pool of CUDA device "
+			+ ::std::to_string(device_id));
+	}
+	auto region = memory::device::async::detail_::allocate(device_id, stream.id(), num_bytes);
+	throw_if_error(cudaFreeAsync(region.start(), stream.id()),
+		"Failed scheduling the release of memory to the default pool of CUDA device "
+		+ ::std::to_string(device_id));
+	stream.synchronize();
+#else
+	(void) stream;
+	(void) num_bytes;
+#endif
+}
+
+inline warmed_up_device_t warm_up(device::id_t device_id, const warm_up_options_t& options)
+{
+	auto start = ::std::chrono::steady_clock::now();
+	if (options.bind_threads_near_devices) { affinity::bind_this_thread_near(device::get(device_id)); }
+	device::current::detail_::scoped_override_t set_device_for_this_scope(device_id);
+	force_runtime_initialization();
+	auto context_creation_seconds = seconds_since(start);
+
+	auto device = device::get(device_id);
+	::std::vector<stream_t> streams;
+	streams.reserve(options.streams_per_device);
+	for(size_t i = 0; i < options.streams_per_device; i++) {
+		streams.emplace_back(device.create_stream(options.streams_synchronize_with_default_stream));
+	}
+	::std::vector<event_t> events;
+	events.reserve(options.events_per_device);
+	for(size_t i = 0; i < options.events_per_device; i++) {
+		events.emplace_back(device.create_event(options.events_use_blocking_sync, options.events_record_timings));
+	}
+	if (options.memory_pool_reservation > 0) {
+		reserve_pool_memory(streams.empty() ? device.create_stream(stream::async) : streams.front(),
+			options.memory_pool_reservation);
+	}
+	return { device_id, ::std::move(streams), ::std::move(events), context_creation_seconds, seconds_since(start) };
+}
+
+} // namespace detail_
+///@endcond
+
+/**
+ * @brief Warm up CUDA devices in the background: create their contexts - each
+ * device on a thread of its own - and any resources specified in @p options.
+ *
+ * @return a future which becomes ready once all devices have been warmed up,
+ * holding the results for each of @p devices (in the same order) - or the
+ * first exception encountered.
+ *
+ * @note Like any future obtained from `::std::async`, destroying the returned
+ * future waits for the warm-up to conclude - so keep it around until
+ * the devices are about to be used.
+ */
+inline ::std::future<::std::vector<warmed_up_device_t>> warm_up(
+	const ::std::vector<device_t>&  devices,
+	warm_up_options_t               options = {})
+{
+	::std::vector<device::id_t> device_ids;
+	device_ids.reserve(devices.size());
+	for(const auto& device : devices) { device_ids.push_back(device.id()); }
+	return ::std::async(::std::launch::async, [device_ids, options]() {
+		::std::vector<::std::future<warmed_up_device_t>> per_device;
+		per_device.reserve(device_ids.size());
+		for(auto device_id : device_ids) {
+			per_device.emplace_back(::std::async(::std::launch::async, [device_id, options]() {
+				return detail_::warm_up(device_id, options);
+			}));
+		}
+		::std::vector<warmed_up_device_t> warmed_up;
+		warmed_up.reserve(device_ids.size());
+		// If one device fails, the others' futures still wait for their threads
+		for(auto& device_future : per_device) { warmed_up.emplace_back(device_future.get()); }
+		return warmed_up;
+	});
+}
+
+/**
+ * @brief Warm up all CUDA devices on the system in the background.
+ *
+ * @see warm_up(const ::std::vector<device_t>&, warm_up_options_t)
+ */
+inline ::std::future<::std::vector<warmed_up_device_t>> warm_up(warm_up_options_t options = {})
+{
+	::std::vector<device_t> all;
+	for(auto device : devices()) { all.push_back(device); }
+	return warm_up(all, options);
+}
+
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_WARM_UP_HPP_
@@ -0,0 +1,456 @@
+/**
+ * @file zero_tracker.hpp
+ *
+ * @brief Tracking which parts of device memory regions are known to be all-zero,
+ * so that zeroing them again - as code commonly does before every use of a freshly
+ * allocated or recycled buffer - is skipped, rather than costing another memset.
+ *
+ * Tracking is limited to regions registered with the tracker, e.g. by a @ref
+ * zeroing_pool_t . Writes into them through the wrappers' copy and memset functions
+ * clear the regions' "zero" marks automatically; but the tracker cannot observe
+ * writes by kernels, so these must be reported with @ref zero_tracker_t::mark_written().
+ *
+ * Zeroing is only ever skipped where that is explicitly requested - by @ref
+ * zeroing_pool_t::acquire() , or with @ref zero_tracking::zero_where_needed() ;
+ * @ref memory::device::zero() and its ilk always zero the entire range, so that
+ * code unaware of the tracking - which may not report its kernels' writes - is
+ * unaffected by it.
+ *
+ * @note The marks reflect the order in which work is enqueued, not its progress: A range
+ * zeroed asynchronously is marked as zero right away; and zeroing it again is skipped
+ * even on another stream, which must therefore be synchronized with the first.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_ZERO_TRACKER_HPP_
+#define CUDA_API_WRAPPERS_ZERO_TRACKER_HPP_
+
+#include <cuda/api/device.hpp>
+#include <cuda/api/memory.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/stream.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace cuda {
+namespace memory {
+
+namespace zero_tracking {
+
+struct statistics_t {
+	/**
+	 * Requests to zero a range at least partially within a tracked region, where
+	 * parts already known to be zero may be skipped
+	 */
+	size_t zeroing_requests   { 0 };
+	/** Requests to zero a range which was already known to be zero in its entirety */
+	size_t memsets_avoided    { 0 };
+	size_t bytes_requested    { 0 };
+	/** Bytes requested to be zeroed which were already known to be zero */
+	size_t bytes_avoided      { 0 };
+};
+
+} // namespace zero_tracking
+
+/**
+ * @brief Keeps, for each tracked device memory region, the set of its sub-ranges
+ * known to be all-zero
+ *
+ * @note There is a single, process-wide tracker (see @ref zero_tracking::tracker()), as
+ * it must see all writes through the wrappers - regardless of which code makes them.
+ */
+class zero_tracker_t final : public memory::detail_::zero_state_tracker_t {
+public: // types
+	using statistics_t = zero_tracking::statistics_t;
+
+public: // getters
+	statistics_t statistics() const
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		return statistics_;
+	}
+
+	bool is_tracked(const void* start) const
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		return regions_.find(address(start)) != regions_.end();
+	}
+
+	/**
+	 * @return true if the entire range is known to be zero
+	 */
+	bool is_zero(const void* start, size_t num_bytes) const
+	{
+		if (num_bytes == 0) { return true; }
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto begin = address(start);
+		auto it = zero_ranges_.upper_bound(begin);
+		if (it == zero_ranges_.begin()) { return false; }
+		--it;
+		return it->second >= begin + num_bytes;
+	}
+
+public: // mutators
+	/**
+	 * @brief Start tracking a region, e.g. once it has been allocated
+	 *
+	 * @param is_zero true if the region's contents are known to be zero already
+	 */
+	void track(region_t region, bool is_zero = false)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto begin = address(region.start());
+		regions_[begin] = begin + region.size();
+		if (is_zero) { add_zero_range(begin, begin + region.size()); }
+		else { remove_zero_range(begin, begin + region.size()); }
+		has_regions_.store(true, ::std::memory_order_relaxed);
+	}
+
+	void untrack(const void* start)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto it = regions_.find(address(start));
+		if (it == regions_.end()) { return; }
+		remove_zero_range(it->first, it->second);
+		regions_.erase(it);
+		has_regions_.store(not regions_.empty(), ::std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Report a write to device memory not made through the wrappers'
+	 * copy and memset functions - e.g. by a kernel
+	 */
+	void mark_written(const void* start, size_t num_bytes)
+	{
+		if (not has_regions_.load(::std::memory_order_relaxed) or num_bytes == 0) { return; }
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		remove_zero_range(address(start), address(start) + num_bytes);
+	}
+
+	void mark_written(region_t region) { mark_written(region.start(), region.size()); }
+
+	/**
+	 * @brief Report that a range has been zeroed other than through the wrappers'
+	 * memset functions; parts of it outside of tracked regions are ignored
+	 */
+	void mark_zero(const void* start, size_t num_bytes)
+	{
+		if (not has_regions_.load(::std::memory_order_relaxed) or num_bytes == 0) { return; }
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto begin = address(start);
+		auto end = begin + num_bytes;
+		// Only the parts within tracked regions are marked, as writes
+		// elsewhere are not reported to the tracker
+		auto it = regions_.upper_bound(begin);
+		if (it != regions_.begin()) { --it; }
+		for(; it != regions_.end() and it->first < end; ++it) {
+			auto clipped_begin = ::std::max(begin, it->first);
+			auto clipped_end = ::std::min(end, it->second);
+			if (clipped_begin < clipped_end) { add_zero_range(clipped_begin, clipped_end); }
+		}
+	}
+
+	void reset_statistics()
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		statistics_ = statistics_t{};
+	}
+
+	/**
+	 * @return the parts of a range which are not already known to be zero, and
+	 * actually need zeroing
+	 */
+	::std::vector<region_t> parts_to_zero(void* start, size_t num_bytes)
+	{
+		::std::vector<region_t> parts;
+		if (not has_regions_.load(::std::memory_order_relaxed)) {
+			parts.emplace_back(start, num_bytes);
+			return parts;
+		}
+		auto begin = address(start);
+		auto end = begin + num_bytes;
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto it = zero_ranges_.upper_bound(begin);
+		if (it != zero_ranges_.begin()) { --it; }
+		auto position = begin;
+		for(; it != zero_ranges_.end() and it->first < end; ++it) {
+			if (it->second <= position) { continue; }
+			if (it->first > position) {
+				parts.emplace_back(pointer(position), static_cast<size_t>(it->first - position));
+			}
+			position = it->second;
+		}
+		if (position < end) {
+			parts.emplace_back(pointer(position), static_cast<size_t>(end - position));
+		}
+		size_t bytes_to_zero = 0;
+		for(const auto& part : parts) { bytes_to_zero += part.size(); }
+		if (bytes_to_zero < num_bytes or overlaps_tracked_region(begin, end)) {
+			statistics_.zeroing_requests++;
+			statistics_.bytes_requested += num_bytes;
+			statistics_.bytes_avoided += num_bytes - bytes_to_zero;
+			if (parts.empty()) { statistics_.memsets_avoided++; }
+		}
+		return parts;
+	}
+
+public: // hooks, called by the wrappers' memory functions
+	void zeroed(void* start, size_t num_bytes) override { mark_zero(start, num_bytes); }
+
+	void written(void* start, size_t num_bytes) override { mark_written(start, num_bytes); }
+
+	void freed(void* start) override
+	{
+		if (has_regions_.load(::std::memory_order_relaxed)) { untrack(start); }
+	}
+
+public: // constructors and destructor
+	zero_tracker_t() = default;
+	zero_tracker_t(const zero_tracker_t&) = delete;
+
+protected: // non-mutators
+	static uintptr_t address(const void* ptr) noexcept { return reinterpret_cast<uintptr_t>(ptr); }
+	static void* pointer(uintptr_t address) noexcept { return reinterpret_cast<void*>(address); }
+
+	bool overlaps_tracked_region(uintptr_t begin, uintptr_t end) const
+	{
+		auto it = regions_.upper_bound(begin);
+		if (it != regions_.begin() and ::std::prev(it)->second > begin) { return true; }
+		return it != regions_.end() and it->first < end;
+	}
+
+protected: // mutators
+	void add_zero_range(uintptr_t begin, uintptr_t end)
+	{
+		// Merging with overlapping and adjacent ranges
+		auto it = zero_ranges_.upper_bound(begin);
+		if (it != zero_ranges_.begin() and ::std::prev(it)->second >= begin) { --it; }
+		while (it != zero_ranges_.end() and it->first <= end) {
+			begin = ::std::min(begin, it->first);
+			end = ::std::max(end, it->second);
+			it = zero_ranges_.erase(it);
+		}
+		zero_ranges_[begin] = end;
+	}
+
+	void remove_zero_range(uintptr_t begin, uintptr_t end)
+	{
+		auto it = zero_ranges_.upper_bound(begin);
+		if (it != zero_ranges_.begin()) { --it; }
+		while (it != zero_ranges_.end() and it->first < end) {
+			auto range_begin = it->first;
+			auto range_end = it->second;
+			if (range_end <= begin) { ++it; continue; }
+			it = zero_ranges_.erase(it);
+			if (range_begin < begin) { zero_ranges_[range_begin] = begin; }
+			if (range_end > end) { zero_ranges_[end] = range_end; }
+		}
+	}
+
+protected: // data members
+	mutable ::std::mutex                  mutex_;
+	/** Lets writes to untracked memory skip locking while no region is tracked */
+	::std::atomic<bool>                   has_regions_ { false };
+	/** Tracked regions, from start to end address */
+	::std::map<uintptr_t, uintptr_t>      regions_;
+	/** Disjoint, non-adjacent ranges known to be zero, from start to end address */
+	::std::map<uintptr_t, uintptr_t>      zero_ranges_;
+	statistics_t                          statistics_;
+};
+
+namespace zero_tracking {
+
+inline zero_tracker_t& tracker()
+{
+	static zero_tracker_t tracker_;
+	return tracker_;
+}
+
+///@cond
+namespace detail_ {
+
+struct enablement_t {
+	::std::mutex  mutex;
+	size_t        count { 0 };
+};
+
+inline enablement_t& enablement()
+{
+	static enablement_t enablement_;
+	return enablement_;
+}
+
+} // namespace detail_
+///@endcond
+
+/**
+ * @brief Have the wrappers' memory functions report their writes to the tracker
+ *
+ * @note Enabling is counted: Tracking remains enabled until @ref disable() has been
+ * called as many times as this function, so that independent users of the tracker
+ * (e.g. several @ref zeroing_pool_t's) do not disable it for each other.
+ *
+ * @note While enabled, every copy and memset made through the wrappers is checked
+ * against the tracked regions.
+ */
+inline void enable()
+{
+	auto& enablement = detail_::enablement();
+	::std::lock_guard<::std::mutex> lock(enablement.mutex);
+	if (enablement.count++ == 0) { memory::detail_::zero_state_tracker().store(&tracker()); }
+}
+
+/**
+ * @brief Undo one call to @ref enable()
+ */
+inline void disable()
+{
+	auto& enablement = detail_::enablement();
+	::std::lock_guard<::std::mutex> lock(enablement.mutex);
+	if (enablement.count == 0) { return; }
+	if (--enablement.count == 0) { memory::detail_::zero_state_tracker().store(nullptr); }
+}
+
+inline bool is_enabled() noexcept { return memory::detail_::zero_state_tracker().load() == &tracker(); }
+
+/**
+ * @brief Zero a range of device memory, except for the parts of it known to be zero already
+ *
+ * @note Only use this where every write to the range not made through the wrappers'
+ * copy and memset functions - e.g. by a kernel - has been reported to the tracker
+ * (see @ref zero_tracker_t::mark_written() ). While tracking is not enabled, the
+ * entire range is zeroed.
+ */
+inline void zero_where_needed(void* start, size_t num_bytes, const stream_t& stream)
+{
+	if (not is_enabled()) {
+		device::async::detail_::zero(start, num_bytes, stream.id());
+		return;
+	}
+	for(const auto& part : tracker().parts_to_zero(start, num_bytes)) {
+		device::async::detail_::zero(part.start(), part.size(), stream.id());
+	}
+}
+
+inline void zero_where_needed(region_t region, const stream_t& stream)
+{
+	zero_where_needed(region.start(), region.size(), stream);
+}
+
+} // namespace zero_tracking
+
+/**
+ * @brief A pool of device memory buffers, handed out all-zero - with a buffer
+ * only zeroed where it is not already known to be zero
+ *
+ * @note Zero tracking is enabled while any pool exists.
+ */
+class zeroing_pool_t {
+public: // getters
+	device_t device() const noexcept { return cuda::device::get(device_id_); }
+
+	size_t num_allocations() const
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		return allocation_sizes_.size();
+	}
+
+public: // mutators
+	/**
+	 * @brief Obtain an all-zero buffer of at least @p num_bytes bytes
+	 *
+	 * @note The buffer is zeroed on @p stream, i.e. it is only all-zero once
+	 * the work enqueued on the stream so far has concluded
+	 */
+	region_t acquire(size_t num_bytes, const stream_t& stream)
+	{
+		void* start = nullptr;
+		{
+			::std::lock_guard<::std::mutex> lock(mutex_);
+			auto it = free_buffers_.lower_bound(num_bytes);
+			if (it != free_buffers_.end()) {
+				start = it->second;
+				free_buffers_.erase(it);
+			}
+		}
+		if (start == nullptr) {
+			start = device::detail_::allocate(device_id_, num_bytes).start();
+			zero_tracking::tracker().track({ start, num_bytes });
+			::std::lock_guard<::std::mutex> lock(mutex_);
+			allocation_sizes_[start] = num_bytes;
+		}
+		zero_tracking::zero_where_needed(start, num_bytes, stream);
+		return { start, num_bytes };
+	}
+
+	/**
+	 * @brief Return a buffer to the pool
+	 *
+	 * @param written_by_kernels if true, the entire buffer is considered to have
+	 * been written to; otherwise, only writes made through the wrappers' copy and
+	 * memset functions, and those reported to the tracker, are accounted for
+	 */
+	void release(region_t buffer, bool written_by_kernels = true)
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto it = allocation_sizes_.find(buffer.start());
+		if (it == allocation_sizes_.end()) {
+			throw ::std::invalid_argument("Releasing a buffer not acquired from the zeroing pool");
+		}
+		if (written_by_kernels) { zero_tracking::tracker().mark_written(it->first, it->second); }
+		free_buffers_.emplace(it->second, it->first);
+	}
+
+	/**
+	 * @brief Free the buffers currently in the pool
+	 */
+	void trim()
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		for(const auto& buffer : free_buffers_) {
+			allocation_sizes_.erase(buffer.second);
+			device::free(buffer.second);
+		}
+		free_buffers_.clear();
+	}
+
+public: // constructors and destructor
+	explicit zeroing_pool_t(device_t device) : device_id_(device.id())
+	{
+		zero_tracking::enable();
+	}
+
+	zeroing_pool_t(const zeroing_pool_t&) = delete;
+
+	/**
+	 * @note Frees all buffers acquired from the pool, including those not released
+	 */
+	~zeroing_pool_t()
+	{
+		for(const auto& allocation : allocation_sizes_) {
+			try { device::free(allocation.first); }
+			catch(...) { }
+		}
+		zero_tracking::disable();
+	}
+
+public: // operators
+	zeroing_pool_t& operator=(const zeroing_pool_t&) = delete;
+
+protected: // data members
+	cuda::device::id_t                   device_id_;
+	mutable ::std::mutex                 mutex_;
+	::std::map<void*, size_t>            allocation_sizes_;
+	/** by size */
+	::std::multimap<size_t, void*>       free_buffers_;
+};
+
+} // namespace memory
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_ZERO_TRACKER_HPP_
@@ -0,0 +1,18 @@
+/**
+ * @file io.hpp
+ *
+ * @brief A single file which includes, in turn, all of the wrappers'
+ * facilities for moving data between files and device memory.
+ */
+#pragma once
+#ifndef CUDA_IO_WRAPPERS_HPP_
+#define CUDA_IO_WRAPPERS_HPP_
+
+static_assert(__cplusplus >= 201103L, "The CUDA API wrappers can only be compiled with C++11 or a later version of the C++ language standard");
+
+#include <cuda/io/file_reader.hpp>
+#include <cuda/io/loading.hpp>
+#include <cuda/io/checkpoint.hpp>
+#include <cuda/io/mapped_file.hpp>
+
+#endif // CUDA_IO_WRAPPERS_HPP_
@@ -0,0 +1,628 @@
+/**
+ * @file io/checkpoint.hpp
+ *
+ * @brief Saving regions of device memory to a file, and restoring them, with
+ * chunked device-host transfers overlapping file I/O through a bounded ring of
+ * pinned host buffers - so that peak host memory use is independent of the
+ * amount of data saved.
+ *
+ * @note The file format uses the host's native byte order.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_IO_CHECKPOINT_HPP_
+#define CUDA_API_WRAPPERS_IO_CHECKPOINT_HPP_
+
+#include <cuda/io/detail/async_io.hpp>
+#include <cuda/io/file_reader.hpp>
+#include <cuda/io/loading.hpp>
+
+#include <cuda/api/affinity.hpp>
+#include <cuda/api/detail/file_system.hpp>
+#include <cuda/api/device.hpp>
+#include <cuda/api/event.hpp>
+#include <cuda/api/memory.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/stream.hpp>
+#include <cuda/api/unique_ptr.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cuda {
+namespace io {
+
+namespace checkpoint {
+
+struct options_t {
+	/** size of each pinned buffer, and thus of each transfer and each file write */
+	size_t        chunk_size { 16 * 1024 * 1024 };
+	size_t        num_buffers { 4 };
+	/** Bypass the OS page cache, where the file system supports it */
+	bool          direct_io { true };
+	io_backend_t  backend { io_backend_t::automatic };
+	/**
+	 * Store a checksum of each region when saving; verify the stored
+	 * checksums (if any) when restoring
+	 */
+	bool          checksums { true };
+	/**
+	 * When saving, only return once the file's new name, as well as its data, has
+	 * reached the storage device (the data is flushed regardless, before the file
+	 * replaces any existing one)
+	 */
+	bool          durable { true };
+	/** Bind the threads performing file I/O (if any) to the CPUs close to the device */
+	bool          bind_workers_near_device { true };
+};
+
+struct statistics_t {
+	size_t        bytes { 0 };
+	size_t        chunks { 0 };
+	double        seconds { 0 };
+	/** time spent blocked waiting for file reads or writes to conclude */
+	double        seconds_waiting_for_io { 0 };
+	/** time spent blocked waiting for device-host transfers */
+	double        seconds_waiting_for_transfers { 0 };
+	io_backend_t  backend { io_backend_t::automatic };
+	bool          direct_io { false };
+
+	/** in bytes per second */
+	double throughput() const noexcept { return seconds > 0 ? bytes / seconds : 0; }
+};
+
+inline ::std::ostream& operator<<(::std::ostream& os, const statistics_t& statistics)
+{
+	return os
+		<< statistics.bytes << " bytes in " << statistics.chunks << " chunks, "
+		<< statistics.seconds << " sec (" << statistics.throughput() / 1e9 << " GB/sec); "
+		<< "waited " << statistics.seconds_waiting_for_io << " sec for file I/O, "
+		<< statistics.seconds_waiting_for_transfers << " sec for transfers; "
+		<< "using " << name(statistics.backend) << (statistics.direct_io ? ", direct I/O" : "");
+}
+
+///@cond
+namespace detail_ {
+
+/**
+ * A streaming, non-cryptographic 64-bit checksum, mixing four independent
+ * lanes of 8-byte words (in the manner of XXH64, but not compatible with it)
+ */
+class checksummer_t {
+public:
+	uint64_t value() const noexcept
+	{
+		auto result = (total_size_ >= stripe_size) ?
+			rotate_left(lanes_[0], 1) + rotate_left(lanes_[1], 7) + rotate_left(lanes_[2], 12) + rotate_left(lanes_[3], 18) :
+			lanes_[2] + prime_5;
+		result += total_size_;
+		for(size_t i = 0; i < tail_size_; i++) {
+			result ^= tail_[i] * prime_5;
+			result = rotate_left(result, 11) * prime_1;
+		}
+		result ^= result >> 33; result *= prime_2;
+		result ^= result >> 29; result *= prime_3;
+		result ^= result >> 32;
+		return result;
+	}
+
+	void update(const void* data, size_t size) noexcept
+	{
+		auto bytes = static_cast<const unsigned char*>(data);
+		total_size_ += size;
+		if (tail_size_ > 0) {
+			auto num_to_fill = ::std::min(size, stripe_size - tail_size_);
+			::std::memcpy(tail_ + tail_size_, bytes, num_to_fill);
+			tail_size_ += num_to_fill; bytes += num_to_fill; size -= num_to_fill;
+			if (tail_size_ < stripe_size) { return; }
+			consume_stripe(tail_);
+			tail_size_ = 0;
+		}
+		for(; size >= stripe_size; bytes += stripe_size, size -= stripe_size) {
+			consume_stripe(bytes);
+		}
+		::std::memcpy(tail_, bytes, size);
+		tail_size_ = size;
+	}
+
+protected:
+	enum : size_t { stripe_size = 32 };
+	static constexpr uint64_t prime_1 = 0x9E3779B185EBCA87ULL;
+	static constexpr uint64_t prime_2 = 0xC2B2AE3D27D4EB4FULL;
+	static constexpr uint64_t prime_3 = 0x165667B19E3779F9ULL;
+	static constexpr uint64_t prime_5 = 0x27D4EB2F165667C5ULL;
+
+	static uint64_t rotate_left(uint64_t x, unsigned bits) noexcept { return (x << bits) | (x >> (64 - bits)); }
+
+	void consume_stripe(const unsigned char* stripe) noexcept
+	{
+		for(int lane = 0; lane < 4; lane++) {
+			uint64_t word;
+			::std::memcpy(&word, stripe + lane * sizeof(uint64_t), sizeof(word));
+			lanes_[lane] = rotate_left(lanes_[lane] + word * prime_2, 31) * prime_1;
+		}
+	}
+
+	uint64_t       lanes_[4] { prime_1 + prime_2, prime_2, 0, 0 - prime_1 };
+	unsigned char  tail_[stripe_size];
+	size_t         tail_size_ { 0 };
+	uint64_t       total_size_ { 0 };
+};
+
+constexpr const char magic[8] = { 'C', 'U', 'D', 'A', 'C', 'K', 'P', 'T' };
+enum : uint32_t { format_version = 1, has_checksums = 1 };
+
+struct file_header_t {
+	char      magic[8];
+	uint32_t  version;
+	uint32_t  flags;
+	uint64_t  num_regions;
+	// followed by num_regions region_record_t's
+};
+
+struct region_record_t {
+	uint64_t  offset;
+	uint64_t  size;
+	uint64_t  checksum;
+};
+
+inline size_t round_up(size_t x, size_t alignment) noexcept
+{
+	return (x + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * The file layout: a header, then each region's data, with every region
+ * starting at an offset suitable for direct I/O
+ */
+inline ::std::vector<region_record_t> layout(const ::std::vector<size_t>& region_sizes)
+{
+	::std::vector<region_record_t> records;
+	auto offset = round_up(sizeof(file_header_t) + region_sizes.size() * sizeof(region_record_t), io::detail_::direct_io_alignment);
+	for(auto size : region_sizes) {
+		records.push_back({ offset, size, 0 });
+		offset += round_up(size, io::detail_::direct_io_alignment);
+	}
+	return records;
+}
+
+} // namespace detail_
+///@endcond
+
+/**
+ * @brief Saves device memory regions to files, and restores them, through
+ * a ring of pinned host buffers.
+ *
+ * The ring is allocated once, so this should be reused for repeated
+ * checkpointing.
+ */
+class pipeline_t {
+public: // getters
+	const options_t& options() const noexcept { return options_; }
+	device_t device() const noexcept { return cuda::device::get(device_id_); }
+
+public: // mutators
+
+	/**
+	 * @brief Write the contents of a sequence of device memory regions to a file
+	 * (replacing any existing file).
+	 *
+	 * @note The regions are read from on @p stream , i.e. after any work
+	 * already enqueued on it has concluded; when this returns, the stream is no
+	 * longer in use by the save.
+	 *
+	 * @note The checkpoint is written to a temporary file in the same directory,
+	 * which then replaces the file at @p path ; so, if the save fails - or the
+	 * system crashes - any existing checkpoint remains intact.
+	 */
+	statistics_t save(
+		const ::std::vector<memory::const_region_t>&  regions,
+		const ::std::string&                          path,
+		const stream_t&                               stream)
+	{
+		auto start = io::detail_::clock_t::now();
+		auto temporary_path = cuda::detail_::file_system::unique_temporary_path(path);
+		statistics_t statistics;
+		try {
+			statistics = write_file(regions, temporary_path, stream);
+			if (::rename(temporary_path.c_str(), path.c_str()) != 0) {
+				throw io::detail_::os_error(errno, "Failed replacing checkpoint file " + path);
+			}
+		}
+		catch(...) {
+			::unlink(temporary_path.c_str());
+			throw;
+		}
+		if (options_.durable) { sync_directory_of(path); }
+		statistics.seconds = io::detail_::seconds_since(start);
+		return statistics;
+	}
+
+	/**
+	 * @brief Read the contents of a sequence of device memory regions from a file
+	 * written by @ref save .
+	 *
+	 * @note When this returns, all transfers have been enqueued on @p stream
+	 * - but not necessarily completed.
+	 *
+	 * @throws ::std::invalid_argument if the file does not hold as many regions as
+	 * are specified, or if any of them is larger than the corresponding region
+	 * @throws ::std::runtime_error if the file is not a checkpoint, or if a
+	 * checksum doesn't match (in which case the regions' contents are unspecified)
+	 */
+	statistics_t restore(
+		const ::std::vector<memory::region_t>&  regions,
+		const ::std::string&                    path,
+		const stream_t&                         stream)
+	{
+		auto start = io::detail_::clock_t::now();
+		auto records = read_header(path, regions);
+		bool verify = options_.checksums and (header_flags_ & detail_::has_checksums);
+
+		read_options_t read_options;
+		read_options.direct_io = options_.direct_io;
+		read_options.backend = options_.backend;
+		chunked_file_reader_t reader(path, buffers_, options_.chunk_size, read_options);
+		statistics_t statistics;
+		statistics.backend = reader.backend();
+		statistics.direct_io = reader.uses_direct_io();
+		::std::vector<detail_::checksummer_t> checksummers(regions.size());
+
+		::std::deque<size_t> transferring;
+		size_t region_index = 0;
+		chunk_t chunk {};
+		try {
+			while (not reader.done() and region_index < regions.size()) {
+				while (not transferring.empty() and events_[transferring.front()].has_occurred()) {
+					reader.release(transferring.front());
+					transferring.pop_front();
+				}
+				if (not reader.next_is_ready() and reader.num_reads_in_flight() == 0) {
+					auto wait_start = io::detail_::clock_t::now();
+					events_[transferring.front()].synchronize();
+					statistics.seconds_waiting_for_transfers += io::detail_::seconds_since(wait_start);
+					reader.release(transferring.front());
+					transferring.pop_front();
+				}
+				auto wait_start = io::detail_::clock_t::now();
+				reader.next(chunk);
+				statistics.seconds_waiting_for_io += io::detail_::seconds_since(wait_start);
+				statistics.chunks++;
+
+				// A chunk may hold (parts of) several regions, as well as padding
+				auto chunk_end = chunk.offset + chunk.size;
+				for(; region_index < regions.size(); region_index++) {
+					const auto& record = records[region_index];
+					auto overlap_start = ::std::max<size_t>(chunk.offset, record.offset);
+					auto overlap_end = ::std::min<size_t>(chunk_end, record.offset + record.size);
+					if (overlap_start < overlap_end) {
+						auto data = static_cast<const char*>(chunk.data) + (overlap_start - chunk.offset);
+						auto size = overlap_end - overlap_start;
+						memory::async::copy(static_cast<char*>(regions[region_index].start()) + (overlap_start - record.offset),
+							data, size, stream);
+						if (verify) { checksummers[region_index].update(data, size); }
+						statistics.bytes += size;
+					}
+					if (record.offset + record.size > chunk_end) { break; }
+				}
+				events_[chunk.buffer_index].record(stream);
+				transferring.push_back(chunk.buffer_index);
+			}
+		}
+		catch(...) {
+			for(auto buffer_index : transferring) { events_[buffer_index].synchronize(); }
+			throw;
+		}
+		auto wait_start = io::detail_::clock_t::now();
+		for(auto buffer_index : transferring) { events_[buffer_index].synchronize(); }
+		statistics.seconds_waiting_for_transfers += io::detail_::seconds_since(wait_start);
+
+		if (statistics.bytes != total_size(records)) {
+			throw ::std::runtime_error("Checkpoint file " + path + " is truncated");
+		}
+		for(size_t i = 0; verify and i < regions.size(); i++) {
+			if (checksummers[i].value() != records[i].checksum) {
+				throw ::std::runtime_error("Checksum mismatch for region " + ::std::to_string(i)
+					+ " of checkpoint file " + path);
+			}
+		}
+		statistics.seconds = io::detail_::seconds_since(start);
+		return statistics;
+	}
+
+public: // constructors and destructor
+	explicit pipeline_t(device_t device, options_t options = {}) :
+		device_id_(device.id()),
+		options_(options),
+		ring_(memory::host::make_unique<char[]>(options.chunk_size * options.num_buffers))
+	{
+		if (options.chunk_size == 0 or options.num_buffers == 0) {
+			throw ::std::invalid_argument("A checkpointing pipeline must have at least one non-empty buffer");
+		}
+		for(size_t i = 0; i < options.num_buffers; i++) {
+			buffers_.push_back(ring_.get() + i * options.chunk_size);
+			events_.emplace_back(device.create_event(event::sync_by_blocking, event::dont_record_timings));
+		}
+	}
+
+	pipeline_t(const pipeline_t&) = delete;
+	pipeline_t(pipeline_t&&) = default;
+
+public: // operators
+	pipeline_t& operator=(const pipeline_t&) = delete;
+	pipeline_t& operator=(pipeline_t&&) = delete;
+
+protected: // non-mutators
+	::std::unique_ptr<io::detail_::async_io_t> make_io() const
+	{
+		::std::vector<iovec> iovecs;
+		for(auto buffer : buffers_) { iovecs.push_back({ buffer, options_.chunk_size }); }
+		auto worker_cpus = options_.bind_workers_near_device ?
+			affinity::local_cpus(device()) : affinity::cpu_list_t{};
+		return io::detail_::make_async_io(options_.backend, static_cast<unsigned>(buffers_.size()), iovecs, worker_cpus);
+	}
+
+	static size_t total_size(const ::std::vector<detail_::region_record_t>& records) noexcept
+	{
+		size_t total = 0;
+		for(const auto& record : records) { total += record.size; }
+		return total;
+	}
+
+	/**
+	 * Completes a failed or short write, through the page cache
+	 */
+	static void complete_write(const ::std::string& path, ssize_t result, char* buffer, size_t size, size_t offset)
+	{
+		if (result < 0) {
+			throw io::detail_::os_error(static_cast<int>(-result), "Failed writing to checkpoint file " + path);
+		}
+		auto written = static_cast<size_t>(result);
+		bool opened_direct;
+		auto fd = io::detail_::open_file(path, O_WRONLY, false, opened_direct);
+		result = io::detail_::transfer_fully(io::detail_::operation_t::write, fd.get(),
+			buffer + written, size - written, static_cast<off_t>(offset + written));
+		if (result < 0 or static_cast<size_t>(result) < size - written) {
+			throw io::detail_::os_error(result < 0 ? static_cast<int>(-result) : ENOSPC,
+				"Failed writing to checkpoint file " + path);
+		}
+	}
+
+	/**
+	 * Flushes the entry of @p path in its directory to storage, so that
+	 * a file renamed into place remains there after a crash
+	 */
+	static void sync_directory_of(const ::std::string& path)
+	{
+		auto last_separator = path.rfind('/');
+		auto directory = (last_separator == ::std::string::npos) ? ::std::string(".") :
+			(last_separator == 0) ? ::std::string("/") : path.substr(0, last_separator);
+		int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0) {
+			throw io::detail_::os_error(errno, "Failed opening directory " + directory + " of checkpoint file " + path);
+		}
+		io::detail_::file_descriptor_t directory_fd { fd };
+		// Some file systems do not support syncing directories
+		if (::fsync(directory_fd.get()) != 0 and errno != EINVAL) {
+			throw io::detail_::os_error(errno, "Failed flushing directory " + directory + " to storage");
+		}
+	}
+
+	static void write_header(
+		const ::std::string&                            path,
+		const detail_::file_header_t&                   header,
+		const ::std::vector<detail_::region_record_t>&  records)
+	{
+		::std::vector<char> bytes(sizeof(header) + records.size() * sizeof(detail_::region_record_t));
+		::std::memcpy(bytes.data(), &header, sizeof(header));
+		if (not records.empty()) { ::std::memcpy(bytes.data() + sizeof(header), records.data(), bytes.size() - sizeof(header)); }
+		bool opened_direct;
+		auto fd = io::detail_::open_file(path, O_WRONLY, false, opened_direct);
+		auto result = io::detail_::transfer_fully(io::detail_::operation_t::write, fd.get(), bytes.data(), bytes.size(), 0);
+		if (result < 0 or static_cast<size_t>(result) < bytes.size()) {
+			throw io::detail_::os_error(result < 0 ? static_cast<int>(-result) : ENOSPC,
+				"Failed writing the header of checkpoint file " + path);
+		}
+	}
+
+protected: // mutators
+	/**
+	 * Writes a new checkpoint file at @p path , which must not exist
+	 */
+	statistics_t write_file(
+		const ::std::vector<memory::const_region_t>&  regions,
+		const ::std::string&                          path,
+		const stream_t&                               stream)
+	{
+		::std::vector<size_t> region_sizes;
+		for(const auto& region : regions) { region_sizes.push_back(region.size()); }
+		auto records = detail_::layout(region_sizes);
+
+		bool aligned = options_.chunk_size % io::detail_::direct_io_alignment == 0;
+		for(auto buffer : buffers_) {
+			aligned = aligned and reinterpret_cast<uintptr_t>(buffer) % io::detail_::direct_io_alignment == 0;
+		}
+		statistics_t statistics;
+		auto fd = io::detail_::open_file(path, O_WRONLY | O_CREAT | O_EXCL, options_.direct_io and aligned, statistics.direct_io);
+		auto io = make_io();
+		statistics.backend = io->backend();
+
+		struct pending_write_t { size_t buffer_index; size_t file_offset; size_t size; };
+		::std::vector<pending_write_t> writes(buffers_.size());
+		::std::vector<size_t> free_buffers;
+		for(size_t i = buffers_.size(); i > 0; i--) { free_buffers.push_back(i - 1); }
+		struct copying_t { size_t buffer_index; size_t region_index; size_t file_offset; size_t size; };
+		::std::deque<copying_t> copying;
+		size_t writes_in_flight = 0;
+		::std::vector<detail_::checksummer_t> checksummers(regions.size());
+
+		auto await_write = [&]() {
+			auto wait_start = io::detail_::clock_t::now();
+			auto completion = io->wait();
+			statistics.seconds_waiting_for_io += io::detail_::seconds_since(wait_start);
+			writes_in_flight--;
+			const auto& write = writes[completion.tag];
+			if (completion.result < 0 or static_cast<size_t>(completion.result) < write.size) {
+				complete_write(path, completion.result, static_cast<char*>(buffers_[write.buffer_index]), write.size, write.file_offset);
+			}
+			free_buffers.push_back(write.buffer_index);
+		};
+		auto write_copied = [&](bool block) {
+			const auto& front = copying.front();
+			auto& event = events_[front.buffer_index];
+			if (not block and not event.has_occurred()) { return false; }
+			auto wait_start = io::detail_::clock_t::now();
+			event.synchronize();
+			statistics.seconds_waiting_for_transfers += io::detail_::seconds_since(wait_start);
+			auto buffer = buffers_[front.buffer_index];
+			if (options_.checksums) { checksummers[front.region_index].update(buffer, front.size); }
+			auto write_size = statistics.direct_io ? detail_::round_up(front.size, io::detail_::direct_io_alignment) : front.size;
+			writes[front.buffer_index] = { front.buffer_index, front.file_offset, write_size };
+			io->submit(io::detail_::operation_t::write, fd.get(), buffer, write_size,
+				static_cast<off_t>(front.file_offset), static_cast<int>(front.buffer_index), front.buffer_index);
+			writes_in_flight++;
+			copying.pop_front();
+			return true;
+		};
+		auto drain = [&]() {
+			while (not copying.empty()) { write_copied(true); }
+			while (writes_in_flight > 0) { await_write(); }
+		};
+
+		try {
+			for(size_t region_index = 0; region_index < regions.size(); region_index++) {
+				auto region_start = static_cast<const char*>(regions[region_index].start());
+				auto region_size = regions[region_index].size();
+				for(size_t offset = 0; offset < region_size; offset += options_.chunk_size) {
+					while (free_buffers.empty()) {
+						if (not copying.empty() and write_copied(writes_in_flight == 0)) { continue; }
+						await_write();
+					}
+					auto buffer_index = free_buffers.back();
+					free_buffers.pop_back();
+					auto size = ::std::min(options_.chunk_size, region_size - offset);
+					memory::async::copy(buffers_[buffer_index], region_start + offset, size, stream);
+					events_[buffer_index].record(stream);
+					copying.push_back({ buffer_index, region_index, records[region_index].offset + offset, size });
+					statistics.bytes += size;
+					statistics.chunks++;
+					while (not copying.empty() and write_copied(false)) { }
+				}
+			}
+			drain();
+		}
+		catch(...) {
+			// The ring must not be reused while transfers or writes into it are pending
+			try { drain(); } catch(...) { }
+			throw;
+		}
+
+		detail_::file_header_t header;
+		::std::memcpy(header.magic, detail_::magic, sizeof(header.magic));
+		header.version = detail_::format_version;
+		header.flags = options_.checksums ? static_cast<uint32_t>(detail_::has_checksums) : 0;
+		header.num_regions = regions.size();
+		for(size_t i = 0; i < regions.size(); i++) { records[i].checksum = checksummers[i].value(); }
+		write_header(path, header, records);
+		if (::fdatasync(fd.get()) != 0) {
+			throw io::detail_::os_error(errno, "Failed flushing checkpoint file " + path + " to storage");
+		}
+		return statistics;
+	}
+
+	::std::vector<detail_::region_record_t> read_header(
+		const ::std::string&                    path,
+		const ::std::vector<memory::region_t>&  regions)
+	{
+		bool opened_direct;
+		auto fd = io::detail_::open_file(path, O_RDONLY, false, opened_direct);
+		auto file_size = io::detail_::file_size(fd.get(), path);
+		auto read_exactly = [&](void* destination, size_t size, size_t offset) {
+			auto result = io::detail_::transfer_fully(io::detail_::operation_t::read, fd.get(), static_cast<char*>(destination), size, static_cast<off_t>(offset));
+			if (result < 0) { throw io::detail_::os_error(static_cast<int>(-result), "Failed reading checkpoint file " + path); }
+			if (static_cast<size_t>(result) < size) { throw ::std::runtime_error("Checkpoint file " + path + " is truncated"); }
+		};
+		detail_::file_header_t header;
+		read_exactly(&header, sizeof(header), 0);
+		if (::std::memcmp(header.magic, detail_::magic, sizeof(header.magic)) != 0 or header.version != detail_::format_version) {
+			throw ::std::runtime_error("File " + path + " is not a checkpoint in a supported format");
+		}
+		if (header.num_regions != regions.size()) {
+			throw ::std::invalid_argument("Checkpoint file " + path + " holds " + ::std::to_string(header.num_regions)
+				+ " regions, but " + ::std::to_string(regions.size()) + " were specified");
+		}
+		::std::vector<detail_::region_record_t> records(regions.size());
+		if (not records.empty()) {
+			read_exactly(records.data(), records.size() * sizeof(detail_::region_record_t), sizeof(header));
+		}
+		size_t previous_end = 0;
+		for(size_t i = 0; i < records.size(); i++) {
+			if (records[i].size > regions[i].size()) {
+				throw ::std::invalid_argument("Region " + ::std::to_string(i) + " of checkpoint file " + path + " ("
+					+ ::std::to_string(records[i].size) + " bytes) does not fit in a region of "
+					+ ::std::to_string(regions[i].size()) + " bytes");
+			}
+			if (records[i].offset < previous_end or records[i].offset + records[i].size > file_size) {
+				throw ::std::runtime_error("Checkpoint file " + path + " is corrupt or truncated");
+			}
+			previous_end = records[i].offset + records[i].size;
+		}
+		header_flags_ = header.flags;
+		return records;
+	}
+
+protected: // data members
+	cuda::device::id_t                  device_id_;
+	options_t                           options_;
+	memory::host::unique_ptr<char[]>    ring_;
+	::std::vector<void*>                buffers_;
+	::std::vector<event_t>              events_;
+	uint32_t                            header_flags_ { 0 };
+};
+
+} // namespace checkpoint
+
+/**
+ * @brief Save the contents of a sequence of device memory regions to a file,
+ * overlapping device-to-host transfers with file writes.
+ *
+ * @note Peak host memory use is bounded by the size of the pinned buffer ring,
+ * i.e. `options.chunk_size * options.num_buffers`; this allocates such a ring
+ * for the single save - use a @ref checkpoint::pipeline_t for repeated saves.
+ */
+inline checkpoint::statistics_t save_device_regions(
+	const ::std::vector<memory::const_region_t>&  regions,
+	const ::std::string&                          path,
+	const stream_t&                               stream,
+	checkpoint::options_t                         options = {})
+{
+	checkpoint::pipeline_t pipeline(stream.device(), options);
+	return pipeline.save(regions, path, stream);
+}
+
+/**
+ * @brief Restore the contents of a sequence of device memory regions from a file
+ * written by @ref save_device_regions , overlapping file reads with host-to-device
+ * transfers.
+ */
+inline checkpoint::statistics_t load_device_regions(
+	const ::std::vector<memory::region_t>&  regions,
+	const ::std::string&                    path,
+	const stream_t&                         stream,
+	checkpoint::options_t                   options = {})
+{
+	checkpoint::pipeline_t pipeline(stream.device(), options);
+	return pipeline.restore(regions, path, stream);
+}
+
+} // namespace io
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_IO_CHECKPOINT_HPP_
@@ -0,0 +1,434 @@
+/**
+ * @file io/detail/async_io.hpp
+ *
+ * @brief Asynchronous positioned file reads and writes, performed either through
+ * Linux's io_uring interface or - where that is unavailable - by blocking
+ * `pread()`/`pwrite()` calls on a pool of threads.
+ *
+ * @note This is host-only code, independent of CUDA.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_IO_DETAIL_ASYNC_IO_HPP_
+#define CUDA_API_WRAPPERS_IO_DETAIL_ASYNC_IO_HPP_
+
+#include <cuda/api/detail/thread_pool.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && !defined(CUDA_API_WRAPPERS_DISABLE_IO_URING)
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define CUDA_API_WRAPPERS_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+#endif
+
+namespace cuda {
+namespace io {
+
+/**
+ * The mechanism used for asynchronous file I/O
+ */
+enum class io_backend_t {
+	/** io_uring if the kernel supports (and permits) it, otherwise a thread pool */
+	automatic,
+	io_uring,
+	/** blocking positioned reads/writes on a pool of threads */
+	thread_pool,
+};
+
+inline const char* name(io_backend_t backend) noexcept
+{
+	switch(backend) {
+	case io_backend_t::io_uring:    return "io_uring";
+	case io_backend_t::thread_pool: return "thread pool";
+	default:                        return "automatic";
+	}
+}
+
+///@cond
+
+namespace detail_ {
+
+inline ::std::system_error os_error(int error_number, const ::std::string& what)
+{
+	return ::std::system_error(error_number, ::std::system_category(), what);
+}
+
+/**
+ * An owning file descriptor
+ */
+class file_descriptor_t {
+public:
+	int get() const noexcept { return fd_; }
+
+	explicit file_descriptor_t(int fd = -1) noexcept : fd_(fd) { }
+	file_descriptor_t(const file_descriptor_t&) = delete;
+	file_descriptor_t(file_descriptor_t&& other) noexcept : fd_(other.fd_) { other.fd_ = -1; }
+	~file_descriptor_t() { if (fd_ >= 0) { ::close(fd_); } }
+	file_descriptor_t& operator=(const file_descriptor_t&) = delete;
+	file_descriptor_t& operator=(file_descriptor_t&& other) noexcept
+	{
+		::std::swap(fd_, other.fd_);
+		return *this;
+	}
+
+protected:
+	int fd_;
+};
+
+/**
+ * Opens a file, with `O_DIRECT` if requested and supported by the file system
+ *
+ * @param[out] opened_direct whether the file was opened with O_DIRECT
+ */
+inline file_descriptor_t open_file(const ::std::string& path, int flags, bool try_direct, bool& opened_direct, mode_t mode = 0644)
+{
+	opened_direct = false;
+#if defined(O_DIRECT)
+	if (try_direct) {
+		int fd = ::open(path.c_str(), flags | O_DIRECT | O_CLOEXEC, mode);
+		if (fd >= 0) { opened_direct = true; return file_descriptor_t{fd}; }
+		// Some file systems (e.g. tmpfs) reject O_DIRECT; others errors will recur below
+	}
+#else
+	(void) try_direct;
+#endif
+	int fd = ::open(path.c_str(), flags | O_CLOEXEC, mode);
+	if (fd < 0) { throw os_error(errno, "Failed opening file " + path); }
+	return file_descriptor_t{fd};
+}
+
+inline size_t file_size(int fd, const ::std::string& path)
+{
+	struct stat status;
+	if (::fstat(fd, &status) != 0) { throw os_error(errno, "Failed obtaining the size of " + path); }
+	return static_cast<size_t>(status.st_size);
+}
+
+/**
+ * Alignment of addresses, offsets and sizes for I/O on files opened with O_DIRECT
+ */
+enum : size_t { direct_io_alignment = 4096 };
+
+enum class operation_t { read, write };
+
+/**
+ * The most bytes a single asynchronous operation transfers: Linux limits each
+ * read or write to this much, and io_uring describes operations' sizes and
+ * results with 32-bit values. Larger operations conclude having transferred
+ * only this much, like any other short read or write.
+ */
+enum : size_t { max_operation_size = 0x7FFFF000 };
+
+struct completion_t {
+	uint64_t  tag;
+	/** number of bytes transferred, or the negation of an error number */
+	ssize_t   result;
+};
+
+/**
+ * Synchronously transfers as much of the requested range as possible,
+ * stopping short only at the end of file (or on error)
+ */
+inline ssize_t transfer_fully(operation_t operation, int fd, char* buffer, size_t size, off_t offset) noexcept
+{
+	size_t done = 0;
+	while (done < size) {
+		auto result = (operation == operation_t::read) ?
+			::pread(fd, buffer + done, size - done, offset + static_cast<off_t>(done)) :
+			::pwrite(fd, buffer + done, size - done, offset + static_cast<off_t>(done));
+		if (result < 0) {
+			if (errno == EINTR) { continue; }
+			return (done > 0) ? static_cast<ssize_t>(done) : -errno;
+		}
+		if (result == 0) { break; }
+		done += static_cast<size_t>(result);
+	}
+	return static_cast<ssize_t>(done);
+}
+
+/**
+ * A queue of asynchronous positioned reads and writes; completions may be
+ * reported in any order
+ */
+class async_io_t {
+public:
+	virtual io_backend_t backend() const noexcept = 0;
+
+	/**
+	 * @param buffer_index index of the buffer among those registered on
+	 * construction, or -1 if the buffer is not one of them
+	 * @param tag reported back with the operation's completion
+	 *
+	 * @note The operation may transfer fewer than @p size bytes - e.g. when
+	 * @p size exceeds @ref max_operation_size - in which case the caller must
+	 * transfer the rest itself.
+	 */
+	virtual void submit(operation_t operation, int fd, void* buffer, size_t size, off_t offset,
+		int buffer_index, uint64_t tag) = 0;
+
+	/**
+	 * Blocks until some submitted operation has completed
+	 */
+	virtual completion_t wait() = 0;
+
+	virtual ~async_io_t() = default;
+};
+
+class thread_pool_io_t : public async_io_t {
+public:
+	io_backend_t backend() const noexcept override { return io_backend_t::thread_pool; }
+
+	void submit(operation_t operation, int fd, void* buffer, size_t size, off_t offset, int, uint64_t tag) override
+	{
+		pool_->submit([=]() {
+			auto result = transfer_fully(operation, fd, static_cast<char*>(buffer), size, offset);
+			{
+				::std::lock_guard<::std::mutex> lock(mutex_);
+				completions_.push_back({ tag, result });
+			}
+			completion_available_.notify_one();
+		});
+	}
+
+	completion_t wait() override
+	{
+		::std::unique_lock<::std::mutex> lock(mutex_);
+		completion_available_.wait(lock, [this] { return not completions_.empty(); });
+		auto completion = completions_.front();
+		completions_.pop_front();
+		return completion;
+	}
+
+	thread_pool_io_t(size_t num_threads, cuda::detail_::numa::cpu_list_t cpus) :
+		pool_(new cuda::detail_::thread_pool_t(num_threads, ::std::move(cpus))) { }
+
+	~thread_pool_io_t()
+	{
+		// Let outstanding operations conclude before the completion queue is destroyed
+		pool_.reset();
+	}
+
+protected:
+	::std::mutex                                        mutex_;
+	::std::condition_variable                           completion_available_;
+	::std::deque<completion_t>                          completions_;
+	::std::unique_ptr<cuda::detail_::thread_pool_t>     pool_;
+};
+
+#ifdef CUDA_API_WRAPPERS_HAVE_IO_URING
+
+/**
+ * An owning wrapper of a shared memory mapping
+ */
+class mapping_t {
+public:
+	void* get() const noexcept { return start_; }
+	size_t size() const noexcept { return size_; }
+
+	mapping_t() noexcept = default;
+	mapping_t(size_t size, int fd, off_t offset) : size_(size)
+	{
+		start_ = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+		if (start_ == MAP_FAILED) {
+			start_ = nullptr;
+			throw os_error(errno, "Failed mapping io_uring queues");
+		}
+	}
+	mapping_t(const mapping_t&) = delete;
+	mapping_t(mapping_t&& other) noexcept : start_(other.start_), size_(other.size_) { other.start_ = nullptr; }
+	~mapping_t() { if (start_ != nullptr) { ::munmap(start_, size_); } }
+	mapping_t& operator=(const mapping_t&) = delete;
+	mapping_t& operator=(mapping_t&& other) noexcept
+	{
+		::std::swap(start_, other.start_);
+		::std::swap(size_, other.size_);
+		return *this;
+	}
+
+protected:
+	void*   start_ { nullptr };
+	size_t  size_ { 0 };
+};
+
+class uring_io_t : public async_io_t {
+public:
+	io_backend_t backend() const noexcept override { return io_backend_t::io_uring; }
+
+	void submit(operation_t operation, int fd, void* buffer, size_t size, off_t offset,
+		int buffer_index, uint64_t tag) override
+	{
+		size = ::std::min<size_t>(size, max_operation_size);
+		auto tail = *sq_tail_;
+		auto index = tail & *sq_mask_;
+		auto& sqe = sqes_[index];
+		::std::memset(&sqe, 0, sizeof(sqe));
+		sqe.fd = fd;
+		sqe.off = static_cast<uint64_t>(offset);
+		sqe.user_data = tag;
+		if (fixed_buffers_ and buffer_index >= 0) {
+			sqe.opcode = (operation == operation_t::read) ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+			sqe.addr = reinterpret_cast<uint64_t>(buffer);
+			sqe.len = static_cast<uint32_t>(size);
+			sqe.buf_index = static_cast<uint16_t>(buffer_index);
+		}
+		else {
+			// Vectored operations are supported by older kernels than plain ones
+			auto& iov = iovecs_[index];
+			iov.iov_base = buffer;
+			iov.iov_len = size;
+			sqe.opcode = (operation == operation_t::read) ? IORING_OP_READV : IORING_OP_WRITEV;
+			sqe.addr = reinterpret_cast<uint64_t>(&iov);
+			sqe.len = 1;
+		}
+		sq_array_[index] = index;
+		__atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+		while (enter(1, 0, 0) < 0) {
+			if (errno != EINTR and errno != EAGAIN) { throw os_error(errno, "Failed submitting an io_uring operation"); }
+		}
+	}
+
+	completion_t wait() override
+	{
+		while(true) {
+			auto head = *cq_head_;
+			if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+				const auto& cqe = cqes_[head & *cq_mask_];
+				completion_t completion { cqe.user_data, static_cast<ssize_t>(cqe.res) };
+				__atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+				return completion;
+			}
+			if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0 and errno != EINTR) {
+				throw os_error(errno, "Failed waiting for io_uring completions");
+			}
+		}
+	}
+
+	/**
+	 * @param queue_depth maximum number of operations in flight
+	 * @param buffers if non-empty, registered as fixed buffers (if permitted),
+	 * for use with @ref submit 's buffer index parameter
+	 */
+	uring_io_t(unsigned queue_depth, const ::std::vector<iovec>& buffers)
+	{
+		io_uring_params params;
+		::std::memset(&params, 0, sizeof(params));
+		int fd = static_cast<int>(::syscall(__NR_io_uring_setup, queue_depth, &params));
+		if (fd < 0) { throw os_error(errno, "Failed setting up an io_uring instance"); }
+		ring_fd_ = file_descriptor_t{fd};
+
+		auto sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		auto cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		bool single_mapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (single_mapping) { sq_ring_size = cq_ring_size = ::std::max(sq_ring_size, cq_ring_size); }
+		// Each mapping is released on its own if a later one fails
+		sq_ring_ = mapping_t(sq_ring_size, ring_fd_.get(), IORING_OFF_SQ_RING);
+		if (not single_mapping) { cq_ring_ = mapping_t(cq_ring_size, ring_fd_.get(), IORING_OFF_CQ_RING); }
+		sqes_mapping_ = mapping_t(params.sq_entries * sizeof(io_uring_sqe), ring_fd_.get(), IORING_OFF_SQES);
+		sqes_ = static_cast<io_uring_sqe*>(sqes_mapping_.get());
+
+		auto sq = static_cast<char*>(sq_ring_.get());
+		sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		auto cq = static_cast<char*>(single_mapping ? sq_ring_.get() : cq_ring_.get());
+		cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+		iovecs_.resize(params.sq_entries);
+
+		if (not buffers.empty()) {
+			// This fails if the buffers exceed the locked memory limit; vectored I/O is used instead
+			fixed_buffers_ = ::syscall(__NR_io_uring_register, ring_fd_.get(), IORING_REGISTER_BUFFERS,
+				buffers.data(), static_cast<unsigned>(buffers.size())) == 0;
+		}
+	}
+
+	bool uses_fixed_buffers() const noexcept { return fixed_buffers_; }
+
+protected:
+	int enter(unsigned to_submit, unsigned min_complete, unsigned flags) noexcept
+	{
+		return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_.get(), to_submit, min_complete, flags, nullptr, 0));
+	}
+
+	file_descriptor_t     ring_fd_;
+	mapping_t             sq_ring_;
+	/** Unused if the kernel maps both rings together */
+	mapping_t             cq_ring_;
+	mapping_t             sqes_mapping_;
+	io_uring_sqe*         sqes_ { nullptr };
+	io_uring_cqe*         cqes_ { nullptr };
+	unsigned*             sq_tail_ { nullptr };
+	unsigned*             sq_mask_ { nullptr };
+	unsigned*             sq_array_ { nullptr };
+	unsigned*             cq_head_ { nullptr };
+	unsigned*             cq_tail_ { nullptr };
+	unsigned*             cq_mask_ { nullptr };
+	::std::vector<iovec>  iovecs_;
+	bool                  fixed_buffers_ { false };
+};
+
+#endif // CUDA_API_WRAPPERS_HAVE_IO_URING
+
+/**
+ * Creates an I/O queue using the preferred backend
+ *
+ * @param worker_cpus CPUs to bind the thread pool backend's threads to; empty for no binding
+ * @throws ::std::system_error if io_uring was explicitly requested, but cannot be used
+ */
+inline ::std::unique_ptr<async_io_t> make_async_io(
+	io_backend_t                             preference,
+	unsigned                                 queue_depth,
+	const ::std::vector<iovec>&              buffers,
+	const cuda::detail_::numa::cpu_list_t&   worker_cpus = {})
+{
+#ifdef CUDA_API_WRAPPERS_HAVE_IO_URING
+	if (preference != io_backend_t::thread_pool) {
+		try {
+			return ::std::unique_ptr<async_io_t>(new uring_io_t(queue_depth, buffers));
+		}
+		catch(::std::system_error&) {
+			// e.g. an older kernel, or io_uring being disabled or filtered by a seccomp policy
+			if (preference == io_backend_t::io_uring) { throw; }
+		}
+	}
+#else
+	if (preference == io_backend_t::io_uring) {
+		throw ::std::system_error(ENOSYS, ::std::system_category(), "io_uring is not supported by this build");
+	}
+	(void) buffers;
+#endif
+	return ::std::unique_ptr<async_io_t>(new thread_pool_io_t(queue_depth, worker_cpus));
+}
+
+} // namespace detail_
+
+///@endcond
+
+} // namespace io
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_IO_DETAIL_ASYNC_IO_HPP_
@@ -0,0 +1,288 @@
+/**
+ * @file io/file_reader.hpp
+ *
+ * @brief Reading a file, in order, through a fixed ring of caller-provided buffers,
+ * with multiple reads in flight - using direct (page-cache-bypassing) I/O where
+ * possible.
+ *
+ * @note This is host-only code, independent of CUDA; it may be used (and tested)
+ * on machines without a GPU.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_IO_FILE_READER_HPP_
+#define CUDA_API_WRAPPERS_IO_FILE_READER_HPP_
+
+#include <cuda/io/detail/async_io.hpp>
+
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cuda {
+namespace io {
+
+struct read_options_t {
+	/**
+	 * Open the file with O_DIRECT, bypassing the OS page cache. This is ignored
+	 * if the file system doesn't support it, or if the buffers (or their size)
+	 * are not aligned to file system blocks.
+	 */
+	bool          direct_io { true };
+	io_backend_t  backend { io_backend_t::automatic };
+	/** maximum number of reads in flight; 0 for one per buffer */
+	unsigned      queue_depth { 0 };
+	/**
+	 * CPUs to run the thread pool backend's threads on; empty for no binding.
+	 * (A @ref file_loader_t sets this to the CPUs close to its device.)
+	 */
+	::std::vector<unsigned> worker_cpus;
+};
+
+/**
+ * A stretch of the file, read into one of the reader's buffers
+ */
+struct chunk_t {
+	size_t       buffer_index;
+	size_t       offset;
+	size_t       size;
+	const void*  data;
+};
+
+/**
+ * @brief Reads a file into a ring of buffers, asynchronously, delivering
+ * the contents in order, one buffer-sized chunk at a time.
+ *
+ * Reads are issued into all buffers on construction; each buffer, once its
+ * chunk has been delivered and consumed, must be released back to the reader
+ * so that further reads can be issued into it.
+ */
+class chunked_file_reader_t {
+public: // types
+	struct statistics_t {
+		size_t  reads { 0 };
+		size_t  bytes_read { 0 };
+		/** reads which returned fewer bytes than requested, and had to be completed */
+		size_t  short_reads { 0 };
+	};
+
+public: // getters
+	size_t file_size() const noexcept { return file_size_; }
+	size_t buffer_size() const noexcept { return buffer_size_; }
+	size_t num_chunks() const noexcept { return num_chunks_; }
+	io_backend_t backend() const noexcept { return io_->backend(); }
+	bool uses_direct_io() const noexcept { return direct_io_; }
+	size_t num_reads_in_flight() const noexcept { return in_flight_; }
+	const statistics_t& statistics() const noexcept { return statistics_; }
+
+	/**
+	 * @return true if all chunks have been delivered
+	 */
+	bool done() const noexcept { return next_to_deliver_ == num_chunks_; }
+
+	/**
+	 * @return true if the next chunk has already been read, i.e. @ref next()
+	 * will not block
+	 */
+	bool next_is_ready() const noexcept
+	{
+		return completed_.find(next_to_deliver_) != completed_.end();
+	}
+
+public: // mutators
+
+	/**
+	 * @brief Obtain the next chunk of the file, waiting for its read to conclude if necessary
+	 *
+	 * @return false if the entire file has already been delivered
+	 *
+	 * @throws ::std::logic_error if the next chunk can't be read, since every buffer is
+	 * still held (unreleased) by the caller
+	 * @throws ::std::system_error on read failure
+	 */
+	bool next(chunk_t& chunk)
+	{
+		if (done()) { return false; }
+		auto it = completed_.find(next_to_deliver_);
+		while (it == completed_.end()) {
+			if (in_flight_ == 0) {
+				throw ::std::logic_error("No buffers have been released to read the next file chunk into");
+			}
+			complete_one();
+			it = completed_.find(next_to_deliver_);
+		}
+		auto buffer_index = it->second;
+		completed_.erase(it);
+		auto offset = next_to_deliver_ * buffer_size_;
+		chunk = { buffer_index, offset, chunk_size(next_to_deliver_), buffers_[buffer_index] };
+		next_to_deliver_++;
+		return true;
+	}
+
+	/**
+	 * @brief Return a buffer (whose chunk's contents are no longer needed)
+	 * to the reader, for reading a subsequent chunk.
+	 */
+	void release(size_t buffer_index)
+	{
+		if (buffer_index >= buffers_.size()) {
+			throw ::std::out_of_range("Invalid file reader buffer index " + ::std::to_string(buffer_index));
+		}
+		issue_or_park(buffer_index);
+	}
+
+public: // constructors and destructor
+
+	/**
+	 * @param buffers the ring of buffers to read into; these must remain valid
+	 * for the reader's lifetime
+	 * @param buffer_size size in bytes of each buffer, and thus of every chunk
+	 * but (possibly) the last
+	 */
+	chunked_file_reader_t(
+		const ::std::string&          path,
+		const ::std::vector<void*>&   buffers,
+		size_t                        buffer_size,
+		read_options_t                options = {})
+	: path_(path), buffers_(buffers), buffer_size_(buffer_size)
+	{
+		if (buffers.empty() or buffer_size == 0) {
+			throw ::std::invalid_argument("A file reader requires at least one non-empty buffer");
+		}
+		bool can_read_directly = options.direct_io and buffer_size % detail_::direct_io_alignment == 0;
+		for(auto buffer : buffers) {
+			can_read_directly = can_read_directly and reinterpret_cast<uintptr_t>(buffer) % detail_::direct_io_alignment == 0;
+		}
+		fd_ = detail_::open_file(path, O_RDONLY, can_read_directly, direct_io_);
+		file_size_ = detail_::file_size(fd_.get(), path);
+		num_chunks_ = (file_size_ + buffer_size - 1) / buffer_size;
+
+		::std::vector<iovec> iovecs;
+		for(auto buffer : buffers) { iovecs.push_back({ buffer, buffer_size }); }
+		auto queue_depth = (options.queue_depth == 0) ?
+			static_cast<unsigned>(buffers.size()) : options.queue_depth;
+		io_ = detail_::make_async_io(options.backend, queue_depth, iovecs, options.worker_cpus);
+		max_in_flight_ = queue_depth;
+
+		for(size_t i = 0; i < buffers.size(); i++) { issue_or_park(i); }
+	}
+
+	chunked_file_reader_t(const chunked_file_reader_t&) = delete;
+	chunked_file_reader_t(chunked_file_reader_t&&) = default;
+
+	~chunked_file_reader_t()
+	{
+		// The reads must not outlive the buffers they target
+		while (io_ and in_flight_ > 0) {
+			try { complete_one(); }
+			catch(::std::exception&) { }
+		}
+	}
+
+public: // operators
+	chunked_file_reader_t& operator=(const chunked_file_reader_t&) = delete;
+	chunked_file_reader_t& operator=(chunked_file_reader_t&&) = delete;
+
+protected: // non-mutators
+	size_t chunk_size(size_t chunk_index) const noexcept
+	{
+		auto offset = chunk_index * buffer_size_;
+		return ::std::min(buffer_size_, file_size_ - offset);
+	}
+
+protected: // mutators
+	void issue_or_park(size_t buffer_index)
+	{
+		if (next_to_issue_ == num_chunks_) { return; }
+		if (in_flight_ == max_in_flight_) {
+			idle_buffers_.push_back(buffer_index);
+			return;
+		}
+		issue(buffer_index);
+	}
+
+	void issue(size_t buffer_index)
+	{
+		auto chunk_index = next_to_issue_++;
+		auto size = chunk_size(chunk_index);
+		if (direct_io_) {
+			// The tail of the file is read using a whole number of blocks
+			size = (size + detail_::direct_io_alignment - 1) / detail_::direct_io_alignment * detail_::direct_io_alignment;
+		}
+		buffer_of_chunk_[chunk_index] = buffer_index;
+		io_->submit(detail_::operation_t::read, fd_.get(), buffers_[buffer_index], size,
+			static_cast<off_t>(chunk_index * buffer_size_), static_cast<int>(buffer_index), chunk_index);
+		in_flight_++;
+	}
+
+	void complete_one()
+	{
+		auto completion = io_->wait();
+		in_flight_--;
+		auto chunk_index = static_cast<size_t>(completion.tag);
+		auto buffer_index = buffer_of_chunk_[chunk_index];
+		buffer_of_chunk_.erase(chunk_index);
+		if (completion.result < 0) {
+			throw detail_::os_error(static_cast<int>(-completion.result),
+				"Failed reading chunk " + ::std::to_string(chunk_index) + " of file " + path_);
+		}
+		auto expected = chunk_size(chunk_index);
+		auto got = static_cast<size_t>(completion.result);
+		if (got < expected) {
+			complete_short_read(chunk_index, buffer_index, got);
+		}
+		statistics_.reads++;
+		statistics_.bytes_read += expected;
+		completed_[chunk_index] = buffer_index;
+		if (not idle_buffers_.empty() and next_to_issue_ < num_chunks_) {
+			auto idle_buffer = idle_buffers_.back();
+			idle_buffers_.pop_back();
+			issue(idle_buffer);
+		}
+	}
+
+	void complete_short_read(size_t chunk_index, size_t buffer_index, size_t already_read)
+	{
+		statistics_.short_reads++;
+		// The remainder may not be block-aligned, so it is read through the page cache
+		if (buffered_fd_.get() < 0) {
+			bool opened_direct;
+			buffered_fd_ = detail_::open_file(path_, O_RDONLY, false, opened_direct);
+		}
+		auto remainder = chunk_size(chunk_index) - already_read;
+		auto result = detail_::transfer_fully(detail_::operation_t::read, buffered_fd_.get(),
+			static_cast<char*>(buffers_[buffer_index]) + already_read, remainder,
+			static_cast<off_t>(chunk_index * buffer_size_ + already_read));
+		if (result < 0) {
+			throw detail_::os_error(static_cast<int>(-result), "Failed reading from file " + path_);
+		}
+		if (static_cast<size_t>(result) < remainder) {
+			throw ::std::runtime_error("File " + path_ + " was truncated while being read");
+		}
+	}
+
+protected: // data members
+	::std::string                           path_;
+	::std::vector<void*>                    buffers_;
+	size_t                                  buffer_size_;
+	detail_::file_descriptor_t              fd_;
+	detail_::file_descriptor_t              buffered_fd_;
+	bool                                    direct_io_ { false };
+	size_t                                  file_size_ { 0 };
+	size_t                                  num_chunks_ { 0 };
+	::std::unique_ptr<detail_::async_io_t>  io_;
+	size_t                                  max_in_flight_ { 0 };
+	size_t                                  in_flight_ { 0 };
+	size_t                                  next_to_issue_ { 0 };
+	size_t                                  next_to_deliver_ { 0 };
+	::std::map<size_t, size_t>              buffer_of_chunk_;
+	::std::map<size_t, size_t>              completed_;
+	::std::vector<size_t>                   idle_buffers_;
+	statistics_t                            statistics_;
+};
+
+} // namespace io
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_IO_FILE_READER_HPP_
@@ -0,0 +1,211 @@
+/**
+ * @file io/loading.hpp
+ *
+ * @brief Loading files directly into device memory, overlapping file reads
+ * with host-to-device transfers through a ring of pinned host buffers.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_IO_LOADING_HPP_
+#define CUDA_API_WRAPPERS_IO_LOADING_HPP_
+
+#include <cuda/io/file_reader.hpp>
+
+#include <cuda/api/affinity.hpp>
+#include <cuda/api/device.hpp>
+#include <cuda/api/event.hpp>
+#include <cuda/api/memory.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/stream.hpp>
+#include <cuda/api/unique_ptr.hpp>
+
+#include <chrono>
+#include <deque>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cuda {
+namespace io {
+
+struct load_options_t {
+	/** size of each pinned buffer, and thus of each file read and each transfer */
+	size_t          chunk_size { 16 * 1024 * 1024 };
+	size_t          num_buffers { 4 };
+	read_options_t  read;
+	/**
+	 * Unless specific CPUs are set in @ref read_options_t::worker_cpus, bind
+	 * the threads reading the file to the CPUs close to the device
+	 */
+	bool            bind_workers_near_device { true };
+};
+
+struct load_statistics_t {
+	size_t        bytes { 0 };
+	size_t        chunks { 0 };
+	double        seconds { 0 };
+	/** time spent blocked waiting for file reads to conclude */
+	double        seconds_waiting_for_reads { 0 };
+	/** time spent blocked waiting for transfers, to free up buffers */
+	double        seconds_waiting_for_transfers { 0 };
+	io_backend_t  backend { io_backend_t::automatic };
+	bool          direct_io { false };
+
+	/** in bytes per second */
+	double throughput() const noexcept { return seconds > 0 ? bytes / seconds : 0; }
+};
+
+inline ::std::ostream& operator<<(::std::ostream& os, const load_statistics_t& statistics)
+{
+	return os
+		<< statistics.bytes << " bytes in " << statistics.chunks << " chunks, "
+		<< statistics.seconds << " sec (" << statistics.throughput() / 1e9 << " GB/sec); "
+		<< "waited " << statistics.seconds_waiting_for_reads << " sec for reads, "
+		<< statistics.seconds_waiting_for_transfers << " sec for transfers; "
+		<< "using " << name(statistics.backend) << (statistics.direct_io ? ", direct I/O" : "");
+}
+
+///@cond
+namespace detail_ {
+
+using clock_t = ::std::chrono::steady_clock;
+
+inline double seconds_since(clock_t::time_point start)
+{
+	return ::std::chrono::duration<double>(clock_t::now() - start).count();
+}
+
+} // namespace detail_
+///@endcond
+
+/**
+ * @brief Loads files into device memory through a ring of pinned host buffers.
+ *
+ * Each chunk of the file is read (by the OS, asynchronously) into one of the
+ * buffers, then copied to the device asynchronously on the caller's stream; the
+ * buffer is reused once that copy has concluded. The ring is allocated once,
+ * so a loader should be reused for loading multiple files.
+ */
+class file_loader_t {
+public: // getters
+	const load_options_t& options() const noexcept { return options_; }
+	device_t device() const noexcept { return cuda::device::get(device_id_); }
+
+public: // mutators
+
+	/**
+	 * @brief Load an entire file into (the beginning of) a region of device memory.
+	 *
+	 * @note When this returns, all reads have concluded, and all transfers
+	 * have been enqueued on @p stream - but not necessarily completed.
+	 *
+	 * @throws ::std::invalid_argument if the file is larger than @p destination
+	 */
+	load_statistics_t load(const ::std::string& path, memory::region_t destination, const stream_t& stream)
+	{
+		auto start = detail_::clock_t::now();
+		chunked_file_reader_t reader(path, buffers_, options_.chunk_size, options_.read);
+		if (reader.file_size() > destination.size()) {
+			throw ::std::invalid_argument("File " + path + " (" + ::std::to_string(reader.file_size())
+				+ " bytes) does not fit in a region of " + ::std::to_string(destination.size()) + " bytes");
+		}
+		load_statistics_t statistics;
+		statistics.backend = reader.backend();
+		statistics.direct_io = reader.uses_direct_io();
+
+		// Buffers whose contents are being transferred, in order of enqueuing
+		::std::deque<size_t> transferring;
+		auto destination_start = static_cast<char*>(destination.start());
+		chunk_t chunk {};
+		try {
+			while (not reader.done()) {
+				while (not transferring.empty() and events_[transferring.front()].has_occurred()) {
+					reader.release(transferring.front());
+					transferring.pop_front();
+				}
+				if (not reader.next_is_ready() and reader.num_reads_in_flight() == 0) {
+					// All buffers are held by transfers; wait for the earliest one
+					auto wait_start = detail_::clock_t::now();
+					events_[transferring.front()].synchronize();
+					statistics.seconds_waiting_for_transfers += detail_::seconds_since(wait_start);
+					reader.release(transferring.front());
+					transferring.pop_front();
+				}
+				auto wait_start = detail_::clock_t::now();
+				reader.next(chunk);
+				statistics.seconds_waiting_for_reads += detail_::seconds_since(wait_start);
+				memory::async::copy(destination_start + chunk.offset, chunk.data, chunk.size, stream);
+				events_[chunk.buffer_index].record(stream);
+				transferring.push_back(chunk.buffer_index);
+				statistics.bytes += chunk.size;
+				statistics.chunks++;
+			}
+		}
+		catch(...) {
+			for(auto buffer_index : transferring) { events_[buffer_index].synchronize(); }
+			throw;
+		}
+		// The ring may be reused (or freed) only once the transfers have concluded
+		auto wait_start = detail_::clock_t::now();
+		for(auto buffer_index : transferring) { events_[buffer_index].synchronize(); }
+		statistics.seconds_waiting_for_transfers += detail_::seconds_since(wait_start);
+		statistics.seconds = detail_::seconds_since(start);
+		return statistics;
+	}
+
+public: // constructors and destructor
+	explicit file_loader_t(device_t device, load_options_t options = {}) :
+		device_id_(device.id()),
+		options_(options),
+		ring_(memory::host::make_unique<char[]>(options.chunk_size * options.num_buffers))
+	{
+		if (options.chunk_size == 0 or options.num_buffers == 0) {
+			throw ::std::invalid_argument("A file loader must have at least one non-empty buffer");
+		}
+		for(size_t i = 0; i < options.num_buffers; i++) {
+			buffers_.push_back(ring_.get() + i * options.chunk_size);
+			events_.emplace_back(device.create_event(event::sync_by_blocking, event::dont_record_timings));
+		}
+		if (options_.bind_workers_near_device and options_.read.worker_cpus.empty()) {
+			options_.read.worker_cpus = affinity::local_cpus(device);
+		}
+	}
+
+	file_loader_t(const file_loader_t&) = delete;
+	file_loader_t(file_loader_t&&) = default;
+
+public: // operators
+	file_loader_t& operator=(const file_loader_t&) = delete;
+	file_loader_t& operator=(file_loader_t&&) = delete;
+
+protected: // data members
+	cuda::device::id_t                      device_id_;
+	load_options_t                          options_;
+	memory::host::unique_ptr<char[]>        ring_;
+	::std::vector<void*>                    buffers_;
+	::std::vector<event_t>                  events_;
+};
+
+/**
+ * @brief Load an entire file into (the beginning of) a region of device memory,
+ * overlapping file reads with host-to-device transfers.
+ *
+ * @note This allocates a pinned ring of buffers for the single load; use
+ * a @ref file_loader_t to load multiple files.
+ *
+ * @return statistics regarding the load, including its throughput
+ */
+inline load_statistics_t load_file_to_device(
+	const ::std::string&  path,
+	memory::region_t      destination,
+	const stream_t&       stream,
+	load_options_t        options = {})
+{
+	file_loader_t loader(stream.device(), options);
+	return loader.load(path, destination, stream);
+}
+
+} // namespace io
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_IO_LOADING_HPP_
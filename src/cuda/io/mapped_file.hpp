@@ -0,0 +1,325 @@
+/**
+ * @file io/mapped_file.hpp
+ *
+ * @brief Memory-mapping files and registering (pinning) the mapping with CUDA,
+ * so that their contents can be transferred to devices directly from the OS
+ * page cache, with no intermediate copying into a staging buffer.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_IO_MAPPED_FILE_HPP_
+#define CUDA_API_WRAPPERS_IO_MAPPED_FILE_HPP_
+
+#include <cuda/io/detail/async_io.hpp>
+
+#include <cuda/api/detail/thread_pool.hpp>
+#include <cuda/api/error.hpp>
+#include <cuda/api/event.hpp>
+#include <cuda/api/memory.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/stream.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace cuda {
+namespace io {
+
+struct mapping_options_t {
+	/**
+	 * Fault in the file's pages, using multiple threads, before registering
+	 * the mapping (which would otherwise fault them in serially)
+	 */
+	bool    populate { true };
+	/**
+	 * The largest stretch of the mapping to register at once; files larger than
+	 * this are registered one window at a time while being transferred. 0 means no
+	 * limit other than the one imposed by the system.
+	 */
+	size_t  max_registered_size { 0 };
+	/**
+	 * The size of the windows used when the file can't be registered in its
+	 * entirety (if @ref max_registered_size is 0)
+	 */
+	size_t  window_size { 256 * 1024 * 1024 };
+};
+
+/**
+ * @brief A read-only memory mapping of an entire file, registered with CUDA
+ * as pinned memory if possible.
+ *
+ * @note When the whole mapping is registered, @ref region() may be used as the
+ * source of any asynchronous copy; otherwise - e.g. when the file exceeds
+ * the amount of memory which may be pinned - data should be transferred using
+ * @ref upload() , which registers and deregisters a window of the file at a time.
+ */
+class mapped_file_region_t {
+public: // getters
+	size_t size() const noexcept { return size_; }
+
+	/**
+	 * @return true if the entire mapping is registered as pinned memory
+	 */
+	bool is_registered() const noexcept { return registered_; }
+
+	/**
+	 * @return true if the mapping could be registered in its read-only form,
+	 * i.e. if transfers do not cause private copies of the file's pages to
+	 * be made
+	 */
+	bool is_read_only() const noexcept { return read_only_; }
+
+	/**
+	 * The file's contents, as mapped into the process' address space
+	 */
+	memory::const_region_t region() const noexcept { return { mapping_, size_ }; }
+
+public: // mutators
+
+	/**
+	 * @brief Transfer (part of) the file's contents to device memory.
+	 *
+	 * @note When the mapping is registered in its entirety, this simply enqueues
+	 * a single copy, followed by an event which the region's destruction waits for.
+	 * Otherwise, it enqueues copies of one window of the file at a time, waiting
+	 * for the transfer from each window to conclude before its registration ends;
+	 * the last windows remain registered until the next upload or the region's
+	 * destruction.
+	 */
+	void upload(memory::region_t destination, size_t offset, size_t num_bytes, const stream_t& stream)
+	{
+		if (offset > size_ or num_bytes > size_ - offset) {
+			throw ::std::out_of_range("Attempt to upload bytes beyond the end of a mapped file");
+		}
+		if (num_bytes > destination.size()) {
+			throw ::std::invalid_argument("Attempt to upload " + ::std::to_string(num_bytes)
+				+ " bytes of a mapped file into a region of " + ::std::to_string(destination.size()) + " bytes");
+		}
+		if (num_bytes == 0) { return; }
+		auto destination_start = static_cast<char*>(destination.start());
+		if (registered_) {
+			memory::async::copy(destination_start, mapping_ + offset, num_bytes, stream);
+			record_transfer(stream);
+			return;
+		}
+		prepare_windows(stream);
+		auto end = offset + num_bytes;
+		for(auto window_start = offset / window_size_ * window_size_; window_start < end; window_start += window_size_) {
+			// Windows always begin at multiples of the window size, so a window overlapping
+			// this one's range must begin where it does; it's reused rather than registered again
+			auto existing = ::std::find_if(windows_.begin(), windows_.end(),
+				[&](const window_t& window) { return window.registered and window.start == window_start; });
+			if (existing != windows_.end()) {
+				next_window_ = (static_cast<size_t>(existing - windows_.begin()) + 1) % windows_.size();
+			}
+			auto& window = (existing != windows_.end()) ? *existing : windows_[next_window_];
+			if (existing == windows_.end()) {
+				next_window_ = (next_window_ + 1) % windows_.size();
+				release(window);
+				window.start = window_start;
+				window.size = ::std::min(window_size_, size_ - window_start);
+				memory::host::detail_::register_(mapping_ + window.start, window.size, registration_flags_);
+				window.registered = true;
+			}
+			auto copy_start = ::std::max(offset, window_start);
+			auto copy_end = ::std::min(end, window_start + window.size);
+			memory::async::copy(destination_start + (copy_start - offset), mapping_ + copy_start, copy_end - copy_start, stream);
+			window.transferred.record(stream);
+		}
+	}
+
+	void upload(memory::region_t destination, const stream_t& stream)
+	{
+		upload(destination, 0, size_, stream);
+	}
+
+public: // constructors and destructor
+
+	explicit mapped_file_region_t(const ::std::string& path, mapping_options_t options = {})
+	{
+		bool opened_direct;
+		auto fd = detail_::open_file(path, O_RDONLY, false, opened_direct);
+		size_ = detail_::file_size(fd.get(), path);
+		if (size_ == 0) { return; }
+
+		read_only_ = read_only_registration_supported();
+		// Otherwise, registration requires writable pages; the mapping is then private,
+		// so that the file itself can never be modified through it
+		auto protection = read_only_ ? PROT_READ : (PROT_READ | PROT_WRITE);
+		auto sharing = read_only_ ? MAP_SHARED : MAP_PRIVATE;
+#if CUDART_VERSION >= 11010
+		if (read_only_) { registration_flags_ = cudaHostRegisterReadOnly; }
+#endif
+		auto mapping = ::mmap(nullptr, size_, protection, sharing, fd.get(), 0);
+		if (mapping == MAP_FAILED) { throw detail_::os_error(errno, "Failed mapping file " + path); }
+		mapping_ = static_cast<const char*>(mapping);
+		::madvise(mapping, size_, MADV_SEQUENTIAL);
+		::madvise(mapping, size_, MADV_WILLNEED);
+
+		try {
+			if (options.populate) { populate(); }
+			auto page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+			auto window_size = (options.max_registered_size > 0) ? options.max_registered_size : options.window_size;
+			window_size_ = ::std::max(page_size, window_size / page_size * page_size);
+			if (options.max_registered_size == 0 or size_ <= options.max_registered_size) {
+				try {
+					memory::host::detail_::register_(mapping_, size_, registration_flags_);
+					registered_ = true;
+				}
+				catch(cuda::runtime_error&) {
+					// Typically, the file exceeds the limit on pinned memory; windows will be used instead
+				}
+			}
+		}
+		catch(...) {
+			::munmap(mapping, size_);
+			throw;
+		}
+	}
+
+	mapped_file_region_t(const mapped_file_region_t&) = delete;
+
+	mapped_file_region_t(mapped_file_region_t&& other) noexcept :
+		mapping_(other.mapping_),
+		size_(other.size_),
+		registered_(other.registered_),
+		read_only_(other.read_only_),
+		registration_flags_(other.registration_flags_),
+		window_size_(other.window_size_),
+		windows_(::std::move(other.windows_)),
+		next_window_(other.next_window_),
+		transfers_(::std::move(other.transfers_))
+	{
+		other.mapping_ = nullptr;
+		other.registered_ = false;
+	}
+
+	~mapped_file_region_t()
+	{
+		if (mapping_ == nullptr) { return; }
+		for(auto& window : windows_) {
+			try { release(window); } catch(...) { }
+		}
+		if (registered_) {
+			// The mapping may only go away once the copies from it have concluded
+			for(auto& transfer : transfers_) {
+				try { transfer.synchronize(); } catch(...) { }
+			}
+			cudaHostUnregister(const_cast<char*>(mapping_));
+		}
+		::munmap(const_cast<char*>(mapping_), size_);
+	}
+
+public: // operators
+	mapped_file_region_t& operator=(const mapped_file_region_t&) = delete;
+	mapped_file_region_t& operator=(mapped_file_region_t&&) = delete;
+
+protected: // types
+	struct window_t {
+		size_t   start;
+		size_t   size;
+		bool     registered;
+		event_t  transferred;
+	};
+
+protected: // non-mutators
+	/**
+	 * @return true if every device in the system supports registering read-only
+	 * host memory, which a registration of the mapping would be visible to
+	 */
+	static bool read_only_registration_supported()
+	{
+#if CUDART_VERSION >= 11010
+		auto num_devices = device::count();
+		if (num_devices == 0) { return false; }
+		for(device::id_t device_id = 0; device_id < num_devices; device_id++) {
+			int supported;
+			auto status = cudaDeviceGetAttribute(&supported, cudaDevAttrHostRegisterReadOnlySupported, device_id);
+			throw_if_error(status, "Failed determining whether CUDA device " + ::std::to_string(device_id)
+				+ " supports registering read-only host memory");
+			if (supported == 0) { return false; }
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+protected: // mutators
+	void populate()
+	{
+		enum : size_t { piece_size = 64 * 1024 * 1024 };
+		auto page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+		auto num_pieces = (size_ + piece_size - 1) / piece_size;
+		cuda::detail_::default_thread_pool().parallel_for(num_pieces, [&](size_t piece_index) {
+			auto start = mapping_ + piece_index * piece_size;
+			auto size = ::std::min<size_t>(piece_size, size_ - piece_index * piece_size);
+#ifdef MADV_POPULATE_READ
+			if (::madvise(const_cast<char*>(start), size, MADV_POPULATE_READ) == 0) { return; }
+			// Not supported before Linux 5.14
+#endif
+			volatile char sink;
+			for(size_t offset = 0; offset < size; offset += page_size) { sink = start[offset]; }
+			(void) sink;
+		});
+	}
+
+	void prepare_windows(const stream_t& stream)
+	{
+		auto device = stream.device();
+		if (not windows_.empty() and windows_.front().transferred.device_id() == device.id()) { return; }
+		for(auto& window : windows_) { release(window); }
+		windows_.clear();
+		// Two windows: one may be registered while the other is being transferred from
+		for(int i = 0; i < 2; i++) {
+			windows_.push_back({ 0, 0, false, device.create_event(event::sync_by_blocking, event::dont_record_timings) });
+		}
+		next_window_ = 0;
+	}
+
+	/**
+	 * Records an event following a copy from the registered mapping, reusing
+	 * one which has already occurred if possible
+	 */
+	void record_transfer(const stream_t& stream)
+	{
+		auto device = stream.device();
+		for(auto& transfer : transfers_) {
+			if (transfer.device_id() == device.id() and transfer.has_occurred()) {
+				transfer.record(stream);
+				return;
+			}
+		}
+		transfers_.push_back(device.create_event(event::sync_by_blocking, event::dont_record_timings));
+		transfers_.back().record(stream);
+	}
+
+	void release(window_t& window)
+	{
+		if (not window.registered) { return; }
+		window.transferred.synchronize();
+		memory::host::deregister(mapping_ + window.start);
+		window.registered = false;
+	}
+
+protected: // data members
+	const char*              mapping_ { nullptr };
+	size_t                   size_ { 0 };
+	bool                     registered_ { false };
+	bool                     read_only_ { false };
+	unsigned                 registration_flags_ { cudaHostRegisterDefault };
+	size_t                   window_size_ { 0 };
+	::std::vector<window_t>  windows_;
+	size_t                   next_window_ { 0 };
+	/** Follow copies from the mapping, when it is registered in its entirety */
+	::std::vector<event_t>   transfers_;
+};
+
+} // namespace io
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_IO_MAPPED_FILE_HPP_
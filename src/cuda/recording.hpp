@@ -0,0 +1,20 @@
+/**
+ * @file recording.hpp
+ *
+ * @brief A single file which includes, in turn, all of the wrappers'
+ * facilities for recording API calls, and for analyzing and replaying
+ * the recordings.
+ */
+#pragma once
+#ifndef CUDA_RECORDING_WRAPPERS_HPP_
+#define CUDA_RECORDING_WRAPPERS_HPP_
+
+static_assert(__cplusplus >= 201103L, "The CUDA API wrappers can only be compiled with C++11 or a later version of the C++ language standard");
+
+#include <cuda/api/recording.hpp>
+#include <cuda/recording/format.hpp>
+#include <cuda/recording/analysis.hpp>
+#include <cuda/recording/timeline.hpp>
+#include <cuda/recording/replay.hpp>
+
+#endif // CUDA_RECORDING_WRAPPERS_HPP_
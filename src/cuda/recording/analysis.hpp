@@ -0,0 +1,327 @@
+/**
+ * @file recording/analysis.hpp
+ *
+ * @brief Offline analysis of API call recordings: reading the per-thread logs,
+ * merging them into a single sequence, deriving the dependencies among the
+ * calls, and determining the critical path through them.
+ *
+ * @note This file does not depend on CUDA, so that recordings can be analyzed
+ * on machines without it.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_RECORDING_ANALYSIS_HPP_
+#define CUDA_API_WRAPPERS_RECORDING_ANALYSIS_HPP_
+
+#include <cuda/recording/format.hpp>
+#include <cuda/api/detail/file_system.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cuda {
+namespace recording {
+
+/**
+ * The contents of a single thread's log
+ */
+struct log_t {
+	log_header_t           header;
+	::std::vector<record_t> records;
+};
+
+/**
+ * @throws ::std::runtime_error if the file cannot be read, or is not an API call log
+ * of a supported format version
+ */
+inline log_t read_log(const ::std::string& path)
+{
+	::std::unique_ptr<::std::FILE, int(*)(::std::FILE*)> file(::std::fopen(path.c_str(), "rb"), &::std::fclose);
+	if (not file) { throw ::std::runtime_error("Failed opening API call log " + path); }
+	log_t log;
+	if (::std::fread(&log.header, sizeof(log.header), 1, file.get()) != 1
+		or not detail_::has_valid_magic(log.header))
+	{
+		throw ::std::runtime_error(path + " is not an API call log");
+	}
+	if (log.header.version != format_version) {
+		throw ::std::runtime_error("Unsupported format version " + ::std::to_string(log.header.version)
+			+ " of API call log " + path);
+	}
+	record_t record;
+	while (::std::fread(&record, sizeof(record), 1, file.get()) == 1) {
+		log.records.push_back(record);
+	}
+	return log;
+}
+
+/**
+ * Reads all logs in a recording's directory, ordered by thread index
+ */
+inline ::std::vector<log_t> read_logs(const ::std::string& directory)
+{
+	::std::vector<::std::string> names;
+	if (not cuda::detail_::file_system::list_directory(directory, names)) {
+		throw ::std::runtime_error("Failed opening API call recording directory " + directory);
+	}
+	::std::vector<log_t> logs;
+	const ::std::string suffix { log_file_suffix };
+	for(const auto& name : names) {
+		if (name.size() > suffix.size() and name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+			logs.push_back(read_log(directory + '/' + name));
+		}
+	}
+	::std::sort(logs.begin(), logs.end(), [](const log_t& lhs, const log_t& rhs) {
+		return lhs.header.thread_index < rhs.header.thread_index;
+	});
+	return logs;
+}
+
+/**
+ * A recorded call, attributed to the thread which made it
+ */
+struct entry_t {
+	record_t  record;
+	uint32_t  thread_index;
+};
+
+/**
+ * @return the calls in all of a recording's logs, ordered by the time they were made
+ */
+inline ::std::vector<entry_t> merge(const ::std::vector<log_t>& logs)
+{
+	::std::vector<entry_t> entries;
+	for(const auto& log : logs) {
+		for(const auto& record : log.records) {
+			entries.push_back(entry_t{ record, log.header.thread_index });
+		}
+	}
+	::std::stable_sort(entries.begin(), entries.end(), [](const entry_t& lhs, const entry_t& rhs) {
+		return lhs.record.start < rhs.record.start;
+	});
+	return entries;
+}
+
+///@cond
+namespace detail_ {
+
+/**
+ * @return a key identifying the stream of a recorded call - which, for the
+ * default stream, also depends on the device, as it has the same handle on all devices
+ */
+inline uint64_t stream_key(const record_t& record) noexcept
+{
+	return record.stream != 0 ? record.stream : static_cast<uint64_t>(record.device_id);
+}
+
+} // namespace detail_
+///@endcond
+
+/**
+ * Calls, and the earlier calls each of them must wait for: the previous call
+ * by the same thread; for a call enqueued on a stream, the previous operation on
+ * that stream; for a wait on an event, the operation recording it; and for a
+ * synchronization - the operations it waits for.
+ *
+ * @note Predecessors always precede their successors in @ref entries
+ */
+struct dependency_graph_t {
+	::std::vector<entry_t>               entries;
+	::std::vector<::std::vector<size_t>> predecessors;
+};
+
+/**
+ * @param entries ordered by the time they were made, e.g. as returned by @ref merge()
+ */
+inline dependency_graph_t dependencies(::std::vector<entry_t> entries)
+{
+	enum : size_t { none = static_cast<size_t>(-1) };
+	struct stream_state_t {
+		size_t   last { none };
+		int32_t  device_id;
+	};
+	dependency_graph_t graph;
+	graph.predecessors.resize(entries.size());
+	::std::unordered_map<uint32_t, size_t> last_by_thread;
+	::std::unordered_map<uint64_t, size_t> last_recording_of_event;
+	::std::unordered_map<uint64_t, stream_state_t> streams;
+
+	for(size_t i = 0; i < entries.size(); i++) {
+		const auto& record = entries[i].record;
+		auto& predecessors = graph.predecessors[i];
+		auto add = [&](size_t predecessor) {
+			if (predecessor != none and ::std::find(predecessors.begin(), predecessors.end(), predecessor) == predecessors.end()) {
+				predecessors.push_back(predecessor);
+			}
+		};
+
+		auto thread_it = last_by_thread.find(entries[i].thread_index);
+		if (thread_it != last_by_thread.end()) { add(thread_it->second); }
+		last_by_thread[entries[i].thread_index] = i;
+
+		auto last_recording = [&]() {
+			auto it = last_recording_of_event.find(record.event);
+			return it == last_recording_of_event.end() ? size_t{none} : it->second;
+		};
+
+		switch(record.operation) {
+		case operation_t::wait_event:
+		case operation_t::synchronize_event:
+			add(last_recording());
+			break;
+		case operation_t::synchronize_stream: {
+			auto it = streams.find(detail_::stream_key(record));
+			if (it != streams.end()) { add(it->second.last); }
+			break;
+		}
+		case operation_t::synchronize_device:
+			for(const auto& stream : streams) {
+				if (stream.second.device_id == record.device_id) { add(stream.second.last); }
+			}
+			break;
+		default:
+			break;
+		}
+
+		if (is_enqueued(record.operation)) {
+			auto& stream = streams[detail_::stream_key(record)];
+			add(stream.last);
+			stream.last = i;
+			stream.device_id = record.device_id;
+		}
+		if (record.operation == operation_t::record_event) {
+			last_recording_of_event[record.event] = i;
+		}
+	}
+	graph.entries = ::std::move(entries);
+	return graph;
+}
+
+/**
+ * Rough figures for estimating how long the device spends on each operation,
+ * as recordings only time calls on the host
+ */
+struct cost_model_t {
+	double copy_bytes_per_second  { 12e9 };
+	double set_bytes_per_second   { 300e9 };
+	/** Kernel durations are unknown; this is charged for each launch */
+	double seconds_per_launch     { 10e-6 };
+};
+
+/**
+ * @return the estimated time, in seconds, an operation takes to complete - on the
+ * device for copies, memsets and launches, and on the host for other calls. Waits
+ * and synchronizations are free, as the time they take is spent on their predecessors.
+ */
+inline double estimated_seconds(const record_t& record, const cost_model_t& model = {})
+{
+	switch(record.operation) {
+	case operation_t::copy:
+	case operation_t::copy_async:
+		return static_cast<double>(record.size) / model.copy_bytes_per_second;
+	case operation_t::set:
+	case operation_t::set_async:
+		return static_cast<double>(record.size) / model.set_bytes_per_second;
+	case operation_t::launch:
+		return model.seconds_per_launch;
+	case operation_t::record_event:
+	case operation_t::wait_event:
+	case operation_t::synchronize_stream:
+	case operation_t::synchronize_event:
+	case operation_t::synchronize_device:
+		return 0;
+	default:
+		return static_cast<double>(record.duration) * 1e-9;
+	}
+}
+
+inline ::std::vector<double> estimated_costs(const dependency_graph_t& graph, const cost_model_t& model = {})
+{
+	::std::vector<double> costs;
+	costs.reserve(graph.entries.size());
+	for(const auto& entry : graph.entries) {
+		costs.push_back(estimated_seconds(entry.record, model));
+	}
+	return costs;
+}
+
+struct critical_path_t {
+	/** Indices into the graph's entries, from first to last */
+	::std::vector<size_t> entries;
+	double                seconds { 0 };
+};
+
+/**
+ * @brief Determine the longest chain of dependent calls
+ *
+ * @param costs the time, in seconds, each of the graph's entries takes, e.g.
+ * as returned by @ref estimated_costs()
+ */
+inline critical_path_t critical_path(const dependency_graph_t& graph, const ::std::vector<double>& costs)
+{
+	if (costs.size() != graph.entries.size()) {
+		throw ::std::invalid_argument("Expected a cost for each of the dependency graph's entries");
+	}
+	enum : size_t { none = static_cast<size_t>(-1) };
+	::std::vector<double> finish(costs.size());
+	::std::vector<size_t> via(costs.size(), none);
+	critical_path_t path;
+	size_t last = none;
+	for(size_t i = 0; i < costs.size(); i++) {
+		double start = 0;
+		for(auto predecessor : graph.predecessors[i]) {
+			if (via[i] == none or finish[predecessor] > start) {
+				start = finish[predecessor];
+				via[i] = predecessor;
+			}
+		}
+		finish[i] = start + costs[i];
+		if (last == none or finish[i] > path.seconds) {
+			path.seconds = finish[i];
+			last = i;
+		}
+	}
+	for(auto i = last; i != none; i = via[i]) { path.entries.push_back(i); }
+	::std::reverse(path.entries.begin(), path.entries.end());
+	return path;
+}
+
+inline critical_path_t critical_path(const dependency_graph_t& graph, const cost_model_t& model = {})
+{
+	return critical_path(graph, estimated_costs(graph, model));
+}
+
+struct operation_summary_t {
+	size_t    count       { 0 };
+	uint64_t  bytes       { 0 };
+	/** Total time spent in the calls, on the host */
+	double    host_seconds { 0 };
+};
+
+/**
+ * @return call counts, bytes and host time, per kind of operation
+ */
+inline ::std::map<operation_t, operation_summary_t> summarize(const ::std::vector<entry_t>& entries)
+{
+	::std::map<operation_t, operation_summary_t> summary;
+	for(const auto& entry : entries) {
+		auto& operation_summary = summary[entry.record.operation];
+		operation_summary.count++;
+		if (entry.record.operation != operation_t::launch) {
+			operation_summary.bytes += entry.record.size;
+		}
+		operation_summary.host_seconds += static_cast<double>(entry.record.duration) * 1e-9;
+	}
+	return summary;
+}
+
+} // namespace recording
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_RECORDING_ANALYSIS_HPP_
@@ -0,0 +1,133 @@
+/**
+ * @file recording/format.hpp
+ *
+ * @brief The format of API call recordings: per-thread log files, each a header
+ * followed by fixed-size binary records of the API calls the thread made through
+ * the wrappers.
+ *
+ * @note This file does not depend on CUDA, so that recordings can be read and
+ * analyzed on machines without it.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_RECORDING_FORMAT_HPP_
+#define CUDA_API_WRAPPERS_RECORDING_FORMAT_HPP_
+
+#include <cstdint>
+#include <cstring>
+
+namespace cuda {
+namespace recording {
+
+enum class operation_t : uint8_t {
+	allocate = 1,        ///< destination: allocated address; size: bytes
+	allocate_async,      ///< as above, plus stream
+	free,                ///< destination: freed address
+	copy,                ///< destination, source, size
+	copy_async,          ///< as above, plus stream
+	set,                 ///< destination, size
+	set_async,           ///< as above, plus stream
+	launch,              ///< stream; source: kernel address; grid, block; size: dynamic shared memory
+	record_event,        ///< stream, event
+	wait_event,          ///< stream (the waiting one), event
+	synchronize_stream,  ///< stream
+	synchronize_event,   ///< event
+	synchronize_device   ///< (device only)
+};
+
+inline const char* name(operation_t operation) noexcept
+{
+	switch(operation) {
+	case operation_t::allocate:           return "allocate";
+	case operation_t::allocate_async:     return "allocate_async";
+	case operation_t::free:               return "free";
+	case operation_t::copy:               return "copy";
+	case operation_t::copy_async:         return "copy_async";
+	case operation_t::set:                return "set";
+	case operation_t::set_async:          return "set_async";
+	case operation_t::launch:             return "launch";
+	case operation_t::record_event:       return "record_event";
+	case operation_t::wait_event:         return "wait_event";
+	case operation_t::synchronize_stream: return "synchronize_stream";
+	case operation_t::synchronize_event:  return "synchronize_event";
+	case operation_t::synchronize_device: return "synchronize_device";
+	}
+	return "unknown";
+}
+
+/**
+ * @return true for operations which are enqueued on a stream, i.e. which
+ * are ordered with respect to the stream's other operations
+ */
+inline bool is_enqueued(operation_t operation) noexcept
+{
+	switch(operation) {
+	case operation_t::allocate_async:
+	case operation_t::copy_async:
+	case operation_t::set_async:
+	case operation_t::launch:
+	case operation_t::record_event:
+	case operation_t::wait_event:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * A single API call. Streams and events are identified by their (opaque)
+ * handles, which are only meaningful within the recording; which other fields
+ * are used depends on the operation (see @ref operation_t).
+ */
+struct record_t {
+	/** When the call was made, in nanoseconds since the recording began */
+	uint64_t     start;
+	/** How long the call took on the host, in nanoseconds */
+	uint64_t     duration;
+	operation_t  operation;
+	uint8_t      reserved[3];
+	int32_t      device_id;
+	uint64_t     stream;
+	uint64_t     event;
+	uint64_t     destination;
+	uint64_t     source;
+	uint64_t     size;
+	uint32_t     grid[3];
+	uint32_t     block[3];
+};
+
+static_assert(sizeof(record_t) == 88, "Unexpected padding in the recording format");
+
+enum : uint32_t { format_version = 1 };
+
+/**
+ * The beginning of each log file
+ */
+struct log_header_t {
+	char      magic[8];
+	uint32_t  version;
+	/** The recording thread's index within the recording - not an OS thread id */
+	uint32_t  thread_index;
+	uint64_t  process_id;
+	/** When the recording began, in nanoseconds since the Unix epoch */
+	uint64_t  began_at;
+};
+
+constexpr const char* log_file_suffix = ".cudarec";
+
+///@cond
+namespace detail_ {
+
+inline const char* magic() noexcept { return "CUDAREC1"; }
+
+inline bool has_valid_magic(const log_header_t& header) noexcept
+{
+	return ::std::memcmp(header.magic, magic(), sizeof(header.magic)) == 0;
+}
+
+} // namespace detail_
+///@endcond
+
+} // namespace recording
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_RECORDING_FORMAT_HPP_
@@ -0,0 +1,352 @@
+/**
+ * @file recording/replay.hpp
+ *
+ * @brief Re-issuing a recorded sequence of API calls - with synthetic buffers
+ * in place of the recorded ones, and fresh streams and events - e.g. to reproduce
+ * a performance problem away from the traffic which triggered it.
+ *
+ * @note Memory contents are not recorded, so replayed copies and memsets only
+ * reproduce the recorded sizes and ordering; and as kernels are identified only
+ * by their addresses, launches are delegated to a user-provided stand-in.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_RECORDING_REPLAY_HPP_
+#define CUDA_API_WRAPPERS_RECORDING_REPLAY_HPP_
+
+#include <cuda/recording/analysis.hpp>
+#include <cuda/recording/timeline.hpp>
+
+#include <cuda/api/device.hpp>
+#include <cuda/api/event.hpp>
+#include <cuda/api/memory.hpp>
+#include <cuda/api/multi_wrapper_impls.hpp>
+#include <cuda/api/stream.hpp>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cuda {
+namespace recording {
+
+/**
+ * Enqueues a stand-in for a recorded kernel launch; the record holds the
+ * launch's grid and block dimensions, and its dynamic shared memory size.
+ */
+using launcher_t = ::std::function<void(const stream_t&, const record_t&)>;
+
+struct replay_statistics_t {
+	size_t  replayed { 0 };
+	/** Launches without a launcher, and frees of memory not allocated during the recording */
+	size_t  skipped  { 0 };
+	double  seconds  { 0 };
+};
+
+inline ::std::ostream& operator<<(::std::ostream& os, const replay_statistics_t& statistics)
+{
+	return os << "replayed " << statistics.replayed << " calls (" << statistics.skipped << " skipped) in "
+		<< statistics.seconds << " seconds";
+}
+
+/**
+ * @brief Re-issues recorded calls, in order, from a single thread.
+ *
+ * Recorded streams and events are mapped to ones created for the replay - the default
+ * stream to the default stream - and recorded allocations to allocations of the same
+ * size. Addresses within recorded allocations are translated accordingly; other
+ * addresses (e.g. of host memory, or of memory allocated before the recording began)
+ * are replaced with scratch buffers: pinned host memory for copies, device memory
+ * for memsets.
+ *
+ * @note Recorded devices beyond those present are mapped onto them, modulo their number
+ */
+class replayer_t {
+public: // mutators
+	/**
+	 * @param device_timings if not null, set to the time span each replayed copy,
+	 * memset and launch occupied its device - measured using events, in seconds since
+	 * the replay began - for analysis with @ref analyze(); other calls are left untimed
+	 *
+	 * @note Timings on different devices are aligned only up to the host-side
+	 * latency of recording an event
+	 */
+	replay_statistics_t replay(const ::std::vector<entry_t>& entries, timings_t* device_timings = nullptr)
+	{
+		struct epoch_t {
+			event_t  event;
+			double   seconds;
+		};
+		struct timed_operation_t {
+			size_t        index;
+			device::id_t  device_id;
+			event_t       before;
+			event_t       after;
+		};
+		::std::map<device::id_t, epoch_t> epochs;
+		::std::vector<timed_operation_t> timed_operations;
+
+		replay_statistics_t statistics;
+		auto started = ::std::chrono::steady_clock::now();
+		for(size_t i = 0; i < entries.size(); i++) {
+			const auto& record = entries[i].record;
+			bool time_it = device_timings != nullptr
+				and engine_of(record.operation) != engine_t::none
+				and (record.operation != operation_t::launch or launcher_);
+			if (not time_it) {
+				if (replay(record)) { statistics.replayed++; }
+				else { statistics.skipped++; }
+				continue;
+			}
+			auto& stream = stream_for(record);
+			auto device_id_ = stream.device().id();
+			if (epochs.find(device_id_) == epochs.end()) {
+				auto epoch = timing_event(cuda::device::get(device_id_).default_stream());
+				auto seconds = ::std::chrono::duration<double>(::std::chrono::steady_clock::now() - started).count();
+				epochs.emplace(device_id_, epoch_t{ ::std::move(epoch), seconds });
+			}
+			auto before = timing_event(stream);
+			replay(record);
+			statistics.replayed++;
+			timed_operations.push_back(timed_operation_t{ i, device_id_, ::std::move(before), timing_event(stream) });
+		}
+		synchronize_all();
+		statistics.seconds = ::std::chrono::duration<double>(::std::chrono::steady_clock::now() - started).count();
+
+		if (device_timings != nullptr) {
+			device_timings->assign(entries.size(), interval_t{});
+			for(auto& operation : timed_operations) {
+				operation.after.synchronize();
+				const auto& epoch = epochs.at(operation.device_id);
+				auto since_epoch = [&](const event_t& event) {
+					return epoch.seconds + ::std::chrono::duration<double>(
+						event::time_elapsed_between(epoch.event, event)).count();
+				};
+				(*device_timings)[operation.index] = interval_t{ since_epoch(operation.before), since_epoch(operation.after) };
+			}
+		}
+		return statistics;
+	}
+
+	/**
+	 * @return false if the call was skipped
+	 */
+	bool replay(const record_t& record)
+	{
+		switch(record.operation) {
+		case operation_t::allocate: {
+			auto region = memory::device::detail_::allocate(device_id(record), record.size);
+			allocations_[record.destination] = allocation_t{ region.start(), record.size };
+			return true;
+		}
+		case operation_t::allocate_async: {
+#if CUDART_VERSION >= 11020
+			auto& stream = stream_for(record);
+			auto region = memory::device::async::detail_::allocate(stream.device().id(), stream.id(), record.size);
+#else
+			auto region = memory::device::detail_::allocate(device_id(record), record.size);
+#endif
+			allocations_[record.destination] = allocation_t{ region.start(), record.size };
+			return true;
+		}
+		case operation_t::free: {
+			auto it = allocations_.find(record.destination);
+			if (it == allocations_.end()) { return false; }
+			memory::device::free(it->second.start);
+			allocations_.erase(it);
+			return true;
+		}
+		case operation_t::copy:
+			memory::copy(
+				translate(record.destination, record.size, host_scratch_),
+				translate(record.source, record.size, host_scratch_),
+				record.size);
+			return true;
+		case operation_t::copy_async:
+			memory::async::detail_::copy(
+				translate(record.destination, record.size, host_scratch_),
+				translate(record.source, record.size, host_scratch_),
+				record.size, stream_for(record).id());
+			return true;
+		case operation_t::set:
+			memory::device::set(translate(record.destination, record.size, device_scratch(record)), 0, record.size);
+			return true;
+		case operation_t::set_async:
+			memory::device::async::detail_::set(
+				translate(record.destination, record.size, device_scratch(record)), 0, record.size, stream_for(record).id());
+			return true;
+		case operation_t::launch:
+			if (not launcher_) { return false; }
+			launcher_(stream_for(record), record);
+			return true;
+		case operation_t::record_event:
+			stream_for(record).enqueue.event(event_for(record));
+			return true;
+		case operation_t::wait_event:
+			stream_for(record).enqueue.wait(event_for(record));
+			return true;
+		case operation_t::synchronize_stream:
+			stream_for(record).synchronize();
+			return true;
+		case operation_t::synchronize_event:
+			event_for(record).synchronize();
+			return true;
+		case operation_t::synchronize_device: {
+			auto device = cuda::device::get(device_id(record));
+			device.synchronize();
+			return true;
+		}
+		}
+		return false;
+	}
+
+public: // constructors and destructor
+	/**
+	 * @param launcher enqueues stand-ins for recorded kernel launches; if empty,
+	 * launches are skipped
+	 */
+	explicit replayer_t(launcher_t launcher = {}) :
+		launcher_(::std::move(launcher)),
+		num_devices_(cuda::device::count()) { }
+
+	replayer_t(const replayer_t&) = delete;
+
+	~replayer_t()
+	{
+		try {
+			synchronize_all();
+			for(const auto& allocation : allocations_) { memory::device::free(allocation.second.start); }
+			for(const auto& scratch : device_scratch_) {
+				if (scratch.second.start != nullptr) { memory::device::free(scratch.second.start); }
+			}
+			if (host_scratch_.start != nullptr) { memory::host::free(host_scratch_.start); }
+		}
+		catch(...) { }
+	}
+
+protected: // types
+	struct allocation_t {
+		void*   start;
+		size_t  size;
+	};
+
+	struct scratch_t {
+		void*       start { nullptr };
+		size_t      size { 0 };
+		/** -1 for pinned host memory */
+		device::id_t device_id { -1 };
+	};
+
+protected: // non-mutators
+	device::id_t device_id(const record_t& record) const noexcept
+	{
+		return record.device_id < 0 ? 0 : record.device_id % num_devices_;
+	}
+
+protected: // mutators
+	stream_t& stream_for(const record_t& record)
+	{
+		auto device_id_ = device_id(record);
+		// The default stream has the same handle on all devices
+		auto key = ::std::make_pair(record.stream, record.stream == 0 ? device_id_ : 0);
+		auto it = streams_.find(key);
+		if (it == streams_.end()) {
+			auto stream = (record.stream == 0) ?
+				cuda::device::get(device_id_).default_stream() :
+				stream::detail_::create(device_id_, stream::async);
+			it = streams_.emplace(key, ::std::move(stream)).first;
+		}
+		return it->second;
+	}
+
+	event_t& event_for(const record_t& record)
+	{
+		auto it = events_.find(record.event);
+		if (it == events_.end()) {
+			auto event = event::detail_::create(device_id(record),
+				event::sync_by_blocking, event::dont_record_timings, event::not_interprocess);
+			it = events_.emplace(record.event, ::std::move(event)).first;
+		}
+		return it->second;
+	}
+
+	static event_t timing_event(stream_t stream)
+	{
+		auto event = event::detail_::create(stream.device().id(),
+			event::sync_by_blocking, event::do_record_timings, event::not_interprocess);
+		stream.enqueue.event(event);
+		return event;
+	}
+
+	scratch_t& device_scratch(const record_t& record)
+	{
+		auto device_id_ = device_id(record);
+		auto& scratch = device_scratch_[device_id_];
+		scratch.device_id = device_id_;
+		return scratch;
+	}
+
+	/**
+	 * @return the replayed counterpart of a recorded address, or - if it is not
+	 * within a recorded allocation - the start of a scratch buffer of at least @p size bytes
+	 */
+	void* translate(uint64_t recorded_address, size_t size, scratch_t& scratch)
+	{
+		auto it = allocations_.upper_bound(recorded_address);
+		if (it != allocations_.begin()) {
+			--it;
+			auto offset = recorded_address - it->first;
+			if (offset + size <= it->second.size) {
+				return static_cast<char*>(it->second.start) + offset;
+			}
+		}
+		if (scratch.size < size) {
+			// Work already enqueued may still be using the current scratch buffer
+			synchronize_all();
+			if (scratch.device_id < 0) {
+				if (scratch.start != nullptr) { memory::host::free(scratch.start); }
+				scratch.start = nullptr;
+				scratch.start = memory::host::allocate(size);
+			}
+			else {
+				if (scratch.start != nullptr) { memory::device::free(scratch.start); }
+				scratch.start = nullptr;
+				scratch.start = memory::device::detail_::allocate(scratch.device_id, size).start();
+			}
+			scratch.size = size;
+		}
+		return scratch.start;
+	}
+
+	void synchronize_all()
+	{
+		for(auto& stream : streams_) { stream.second.synchronize(); }
+	}
+
+protected: // data members
+	launcher_t                                                   launcher_;
+	int                                                          num_devices_;
+	::std::map<::std::pair<uint64_t, device::id_t>, stream_t>    streams_;
+	::std::unordered_map<uint64_t, event_t>                      events_;
+	/** by recorded start address */
+	::std::map<uint64_t, allocation_t>                           allocations_;
+	scratch_t                                                    host_scratch_;
+	::std::unordered_map<device::id_t, scratch_t>                device_scratch_;
+};
+
+/**
+ * @brief Replay all calls in a recording's directory
+ */
+inline replay_statistics_t replay(const ::std::string& directory, launcher_t launcher = {})
+{
+	replayer_t replayer(::std::move(launcher));
+	return replayer.replay(merge(read_logs(directory)));
+}
+
+} // namespace recording
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_RECORDING_REPLAY_HPP_
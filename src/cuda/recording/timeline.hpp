@@ -0,0 +1,449 @@
+/**
+ * @file recording/timeline.hpp
+ *
+ * @brief Analysis of the device-side timeline of recorded calls: given the
+ * time span each copy, memset and kernel occupied on its device, determine
+ * the critical path, each stream's idle gaps, how much of the copying is
+ * overlapped with computation, and how busy each device's engines are; and
+ * write all of it out as a trace viewable with Perfetto (https://ui.perfetto.dev).
+ *
+ * The timings may be measured - see @ref replayer_t::replay() - or estimated,
+ * with @ref estimated_timings().
+ *
+ * @note This file does not depend on CUDA, so that recordings can be analyzed
+ * on machines without it.
+ */
+#pragma once
+#ifndef CUDA_API_WRAPPERS_RECORDING_TIMELINE_HPP_
+#define CUDA_API_WRAPPERS_RECORDING_TIMELINE_HPP_
+
+#include <cuda/recording/analysis.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace cuda {
+namespace recording {
+
+/**
+ * A span of time, in seconds since the beginning of a recording or a replay
+ */
+struct interval_t {
+	double start { -1 };
+	double end   { -1 };
+
+	bool is_timed() const noexcept { return start >= 0 and end >= start; }
+	double seconds() const noexcept { return is_timed() ? end - start : 0; }
+
+	constexpr interval_t() = default;
+	constexpr interval_t(double start_, double end_) : start(start_), end(end_) { }
+};
+
+/**
+ * The time span of each of a dependency graph's entries; untimed for entries
+ * which do not occupy the device
+ */
+using timings_t = ::std::vector<interval_t>;
+
+/**
+ * The kind of device engine an operation occupies
+ */
+enum class engine_t : uint8_t { none, copy, compute };
+
+inline const char* name(engine_t engine) noexcept
+{
+	switch(engine) {
+	case engine_t::copy:    return "copy";
+	case engine_t::compute: return "compute";
+	default:                return "none";
+	}
+}
+
+/**
+ * @note memsets are counted as computation, as they are carried out by kernels
+ */
+inline engine_t engine_of(operation_t operation) noexcept
+{
+	switch(operation) {
+	case operation_t::copy:
+	case operation_t::copy_async:
+		return engine_t::copy;
+	case operation_t::set:
+	case operation_t::set_async:
+	case operation_t::launch:
+		return engine_t::compute;
+	default:
+		return engine_t::none;
+	}
+}
+
+/**
+ * @brief Schedule each call as early as its dependencies allow, given
+ * the time each takes - for lack of measured timings
+ *
+ * @param costs in seconds, one per entry, e.g. as returned by @ref estimated_costs()
+ * @return intervals for the calls occupying the device; others are left untimed
+ */
+inline timings_t estimated_timings(const dependency_graph_t& graph, const ::std::vector<double>& costs)
+{
+	if (costs.size() != graph.entries.size()) {
+		throw ::std::invalid_argument("Expected a cost for each of the dependency graph's entries");
+	}
+	::std::vector<double> finish(costs.size());
+	timings_t timings(costs.size());
+	for(size_t i = 0; i < costs.size(); i++) {
+		double start = 0;
+		for(auto predecessor : graph.predecessors[i]) { start = ::std::max(start, finish[predecessor]); }
+		finish[i] = start + costs[i];
+		if (engine_of(graph.entries[i].record.operation) != engine_t::none) {
+			timings[i] = interval_t{ start, finish[i] };
+		}
+	}
+	return timings;
+}
+
+inline timings_t estimated_timings(const dependency_graph_t& graph, const cost_model_t& model = {})
+{
+	return estimated_timings(graph, estimated_costs(graph, model));
+}
+
+///@cond
+namespace detail_ {
+
+/**
+ * @return the disjoint union of the intervals, ordered
+ */
+inline ::std::vector<interval_t> merged(::std::vector<interval_t> intervals)
+{
+	::std::sort(intervals.begin(), intervals.end(), [](const interval_t& lhs, const interval_t& rhs) {
+		return lhs.start < rhs.start;
+	});
+	::std::vector<interval_t> result;
+	for(const auto& interval : intervals) {
+		if (not result.empty() and interval.start <= result.back().end) {
+			result.back().end = ::std::max(result.back().end, interval.end);
+		}
+		else { result.push_back(interval); }
+	}
+	return result;
+}
+
+inline double total_seconds(const ::std::vector<interval_t>& disjoint)
+{
+	double total = 0;
+	for(const auto& interval : disjoint) { total += interval.seconds(); }
+	return total;
+}
+
+inline double intersection_seconds(const ::std::vector<interval_t>& lhs, const ::std::vector<interval_t>& rhs)
+{
+	double total = 0;
+	for(size_t i = 0, j = 0; i < lhs.size() and j < rhs.size(); ) {
+		auto start = ::std::max(lhs[i].start, rhs[j].start);
+		auto end = ::std::min(lhs[i].end, rhs[j].end);
+		if (end > start) { total += end - start; }
+		if (lhs[i].end < rhs[j].end) { i++; } else { j++; }
+	}
+	return total;
+}
+
+} // namespace detail_
+///@endcond
+
+/**
+ * A period during which a stream had no work on the device
+ */
+struct gap_t {
+	double  start;
+	double  seconds;
+	/** The entry which ended the gap */
+	size_t  next_entry;
+};
+
+struct stream_utilization_t {
+	uint64_t             stream;
+	int32_t              device_id;
+	size_t               num_operations { 0 };
+	/** Time during which at least one of the stream's operations was in progress */
+	double               busy_seconds { 0 };
+	/** From the beginning of the stream's first operation to the end of its last */
+	double               span_seconds { 0 };
+	/** The longest gaps, longest first */
+	::std::vector<gap_t> longest_gaps;
+
+	double idle_seconds() const noexcept { return span_seconds - busy_seconds; }
+	double utilization() const noexcept { return span_seconds > 0 ? busy_seconds / span_seconds : 0; }
+};
+
+struct engine_utilization_t {
+	int32_t   device_id;
+	engine_t  engine;
+	double    busy_seconds { 0 };
+	/** Relative to the span of the entire timeline */
+	double    utilization { 0 };
+};
+
+struct path_step_t {
+	size_t       entry;
+	operation_t  operation;
+	uint64_t     stream;
+	int32_t      device_id;
+	interval_t   interval;
+};
+
+struct timeline_report_t {
+	/** The chain of dependent device operations which ended last */
+	::std::vector<path_step_t>          critical_path;
+	double                              critical_path_seconds { 0 };
+	::std::vector<stream_utilization_t> streams;
+	::std::vector<engine_utilization_t> engines;
+	/** From the beginning of the first device operation to the end of the last */
+	double                              span_seconds { 0 };
+	double                              copy_seconds { 0 };
+	double                              compute_seconds { 0 };
+	/** Time during which both copying and computation were in progress, on the same device */
+	double                              overlap_seconds { 0 };
+
+	/** The fraction of the copying time hidden behind computation */
+	double overlap_ratio() const noexcept { return copy_seconds > 0 ? overlap_seconds / copy_seconds : 0; }
+};
+
+struct report_options_t {
+	size_t  gaps_per_stream     { 5 };
+	/** Shorter gaps are not reported, as they are mostly launch overhead */
+	double  minimum_gap_seconds { 5e-6 };
+};
+
+/**
+ * @param timings one per entry of the graph, e.g. measured during a replay,
+ * or as returned by @ref estimated_timings()
+ */
+inline timeline_report_t analyze(
+	const dependency_graph_t&  graph,
+	const timings_t&           timings,
+	report_options_t           options = {})
+{
+	if (timings.size() != graph.entries.size()) {
+		throw ::std::invalid_argument("Expected timings for each of the dependency graph's entries");
+	}
+	timeline_report_t report;
+	const auto num_entries = graph.entries.size();
+
+	// The critical path: going back from the operation which ended last, through the
+	// predecessor which ended last; calls which were not timed end with their predecessors
+	enum : size_t { none = static_cast<size_t>(-1) };
+	::std::vector<double> effective_end(num_entries, -1);
+	::std::vector<size_t> binding(num_entries, none);
+	size_t last = none;
+	for(size_t i = 0; i < num_entries; i++) {
+		for(auto predecessor : graph.predecessors[i]) {
+			if (binding[i] == none or effective_end[predecessor] > effective_end[binding[i]]) {
+				binding[i] = predecessor;
+			}
+		}
+		effective_end[i] = timings[i].is_timed() ? timings[i].end :
+			(binding[i] == none ? -1 : effective_end[binding[i]]);
+		if (timings[i].is_timed() and (last == none or timings[i].end > timings[last].end)) { last = i; }
+	}
+	for(auto i = last; i != none; i = binding[i]) {
+		if (not timings[i].is_timed()) { continue; }
+		const auto& record = graph.entries[i].record;
+		report.critical_path.push_back(path_step_t{ i, record.operation, record.stream, record.device_id, timings[i] });
+	}
+	::std::reverse(report.critical_path.begin(), report.critical_path.end());
+	if (not report.critical_path.empty()) {
+		report.critical_path_seconds = report.critical_path.back().interval.end - report.critical_path.front().interval.start;
+	}
+
+	// Grouping the device operations by stream and by engine
+	::std::map<::std::pair<int32_t, uint64_t>, ::std::vector<size_t>> by_stream;
+	::std::map<::std::pair<int32_t, engine_t>, ::std::vector<interval_t>> by_engine;
+	double first_start = -1, last_end = -1;
+	for(size_t i = 0; i < num_entries; i++) {
+		const auto& record = graph.entries[i].record;
+		auto engine = engine_of(record.operation);
+		if (engine == engine_t::none or not timings[i].is_timed()) { continue; }
+		by_stream[::std::make_pair(record.device_id, record.stream)].push_back(i);
+		by_engine[::std::make_pair(record.device_id, engine)].push_back(timings[i]);
+		first_start = (first_start < 0) ? timings[i].start : ::std::min(first_start, timings[i].start);
+		last_end = ::std::max(last_end, timings[i].end);
+	}
+	report.span_seconds = (first_start < 0) ? 0 : last_end - first_start;
+
+	for(auto& stream : by_stream) {
+		auto& indices = stream.second;
+		::std::sort(indices.begin(), indices.end(), [&](size_t lhs, size_t rhs) {
+			return timings[lhs].start < timings[rhs].start;
+		});
+		stream_utilization_t utilization;
+		utilization.device_id = stream.first.first;
+		utilization.stream = stream.first.second;
+		utilization.num_operations = indices.size();
+		::std::vector<interval_t> intervals;
+		double busy_until = timings[indices.front()].start;
+		for(auto index : indices) {
+			const auto& interval = timings[index];
+			intervals.push_back(interval);
+			if (interval.start - busy_until >= options.minimum_gap_seconds) {
+				utilization.longest_gaps.push_back(gap_t{ busy_until, interval.start - busy_until, index });
+			}
+			busy_until = ::std::max(busy_until, interval.end);
+		}
+		utilization.busy_seconds = detail_::total_seconds(detail_::merged(::std::move(intervals)));
+		utilization.span_seconds = busy_until - timings[indices.front()].start;
+		::std::sort(utilization.longest_gaps.begin(), utilization.longest_gaps.end(),
+			[](const gap_t& lhs, const gap_t& rhs) { return lhs.seconds > rhs.seconds; });
+		if (utilization.longest_gaps.size() > options.gaps_per_stream) {
+			utilization.longest_gaps.resize(options.gaps_per_stream);
+		}
+		report.streams.push_back(::std::move(utilization));
+	}
+
+	::std::map<int32_t, ::std::vector<interval_t>> copying, computing;
+	for(auto& engine : by_engine) {
+		auto busy = detail_::merged(::std::move(engine.second));
+		engine_utilization_t utilization;
+		utilization.device_id = engine.first.first;
+		utilization.engine = engine.first.second;
+		utilization.busy_seconds = detail_::total_seconds(busy);
+		utilization.utilization = report.span_seconds > 0 ? utilization.busy_seconds / report.span_seconds : 0;
+		report.engines.push_back(utilization);
+		auto& per_device = (utilization.engine == engine_t::copy) ? copying : computing;
+		per_device[utilization.device_id] = ::std::move(busy);
+		if (utilization.engine == engine_t::copy) { report.copy_seconds += utilization.busy_seconds; }
+		else { report.compute_seconds += utilization.busy_seconds; }
+	}
+	for(const auto& device_copying : copying) {
+		auto it = computing.find(device_copying.first);
+		if (it != computing.end()) {
+			report.overlap_seconds += detail_::intersection_seconds(device_copying.second, it->second);
+		}
+	}
+	return report;
+}
+
+inline ::std::ostream& operator<<(::std::ostream& os, const timeline_report_t& report)
+{
+	auto in_ms = [](double seconds) { return seconds * 1e3; };
+	auto flags = os.flags();
+	auto precision = os.precision();
+	os << ::std::fixed << ::std::setprecision(3)
+		<< "Device timeline span: " << in_ms(report.span_seconds) << " ms\n"
+		<< "Copying: " << in_ms(report.copy_seconds) << " ms, computing: " << in_ms(report.compute_seconds)
+		<< " ms, overlapped: " << in_ms(report.overlap_seconds) << " ms ("
+		<< (report.overlap_ratio() * 100) << "% of copying)\n";
+
+	os << "\nEngines:\n";
+	for(const auto& engine : report.engines) {
+		os << "  device " << engine.device_id << ' ' << ::std::setw(8) << ::std::left << name(engine.engine) << ::std::right
+			<< ::std::setw(12) << in_ms(engine.busy_seconds) << " ms busy, "
+			<< ::std::setw(7) << (engine.utilization * 100) << "% utilized\n";
+	}
+
+	os << "\nStreams:\n";
+	for(const auto& stream : report.streams) {
+		os << "  device " << stream.device_id << " stream 0x" << ::std::hex << stream.stream << ::std::dec
+			<< ": " << stream.num_operations << " operations, "
+			<< in_ms(stream.busy_seconds) << " ms busy, " << in_ms(stream.idle_seconds()) << " ms idle ("
+			<< (stream.utilization() * 100) << "% utilized)\n";
+		for(const auto& gap : stream.longest_gaps) {
+			os << "    idle for " << in_ms(gap.seconds) << " ms from " << in_ms(gap.start)
+				<< " ms, until entry " << gap.next_entry << '\n';
+		}
+	}
+
+	os << "\nCritical path: " << report.critical_path.size() << " operations, "
+		<< in_ms(report.critical_path_seconds) << " ms\n";
+	for(const auto& step : report.critical_path) {
+		os << "  " << ::std::setw(12) << in_ms(step.interval.start) << " ms  " << name(step.operation)
+			<< " on device " << step.device_id << " stream 0x" << ::std::hex << step.stream << ::std::dec
+			<< ", " << in_ms(step.interval.seconds()) << " ms (entry " << step.entry << ")\n";
+	}
+	os.flags(flags);
+	os.precision(precision);
+	return os;
+}
+
+/**
+ * @brief Write out the timeline in the Chrome trace event format, which Perfetto
+ * (and chrome://tracing) can load: a process per device, a thread per stream, plus
+ * a track of the critical path.
+ *
+ * @param report if not null, its critical path is added as a separate track
+ */
+inline void write_perfetto_trace(
+	::std::ostream&            os,
+	const dependency_graph_t&  graph,
+	const timings_t&           timings,
+	const timeline_report_t*   report = nullptr)
+{
+	if (timings.size() != graph.entries.size()) {
+		throw ::std::invalid_argument("Expected timings for each of the dependency graph's entries");
+	}
+	// Trace timestamps are in microseconds; process ids must be non-negative
+	enum : int { analysis_process_id = 1 << 20 };
+	auto process_id = [](int32_t device_id) { return device_id + 1; };
+	auto in_us = [](double seconds) { return seconds * 1e6; };
+	auto flags = os.flags();
+	auto precision = os.precision();
+	os << ::std::fixed << ::std::setprecision(3) << "{\"traceEvents\":[\n";
+	bool first_event = true;
+	auto begin_event = [&]() -> ::std::ostream& {
+		if (not first_event) { os << ",\n"; }
+		first_event = false;
+		return os;
+	};
+
+	::std::map<::std::pair<int32_t, uint64_t>, int> thread_ids;
+	::std::vector<int32_t> named_devices;
+	for(size_t i = 0; i < graph.entries.size(); i++) {
+		const auto& record = graph.entries[i].record;
+		if (engine_of(record.operation) == engine_t::none or not timings[i].is_timed()) { continue; }
+		auto key = ::std::make_pair(record.device_id, record.stream);
+		auto it = thread_ids.find(key);
+		if (it == thread_ids.end()) {
+			it = thread_ids.emplace(key, static_cast<int>(thread_ids.size()) + 1).first;
+			if (::std::find(named_devices.begin(), named_devices.end(), record.device_id) == named_devices.end()) {
+				named_devices.push_back(record.device_id);
+				begin_event() << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << process_id(record.device_id)
+					<< ",\"args\":{\"name\":\"device " << record.device_id << "\"}}";
+			}
+			begin_event() << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << process_id(record.device_id)
+				<< ",\"tid\":" << it->second << ",\"args\":{\"name\":\""
+				<< (record.stream == 0 ? "default stream" : "stream 0x") << ::std::hex;
+			if (record.stream != 0) { os << record.stream; }
+			os << ::std::dec << "\"}}";
+		}
+		begin_event() << "{\"ph\":\"X\",\"name\":\"" << name(record.operation) << "\",\"cat\":\""
+			<< name(engine_of(record.operation)) << "\",\"pid\":" << process_id(record.device_id)
+			<< ",\"tid\":" << it->second << ",\"ts\":" << in_us(timings[i].start)
+			<< ",\"dur\":" << in_us(timings[i].seconds())
+			<< ",\"args\":{\"entry\":" << i << ",\"bytes\":" << (record.operation == operation_t::launch ? 0 : record.size)
+			<< ",\"host_thread\":" << graph.entries[i].thread_index << "}}";
+	}
+
+	if (report != nullptr and not report->critical_path.empty()) {
+		begin_event() << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << analysis_process_id
+			<< ",\"args\":{\"name\":\"analysis\"}}";
+		begin_event() << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << analysis_process_id
+			<< ",\"tid\":1,\"args\":{\"name\":\"critical path\"}}";
+		for(const auto& step : report->critical_path) {
+			begin_event() << "{\"ph\":\"X\",\"name\":\"" << name(step.operation) << "\",\"cat\":\"critical path\",\"pid\":"
+				<< analysis_process_id << ",\"tid\":1,\"ts\":" << in_us(step.interval.start)
+				<< ",\"dur\":" << in_us(step.interval.seconds()) << ",\"args\":{\"entry\":" << step.entry << "}}";
+		}
+	}
+	os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	os.flags(flags);
+	os.precision(precision);
+}
+
+} // namespace recording
+} // namespace cuda
+
+#endif // CUDA_API_WRAPPERS_RECORDING_TIMELINE_HPP_
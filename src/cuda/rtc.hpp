@@ -0,0 +1,19 @@
+/**
+ * @file rtc.hpp
+ *
+ * @brief A single file which includes, in turn, all of the wrappers for
+ * runtime compilation of CUDA C++ programs with NVRTC.
+ */
+#pragma once
+#ifndef CUDA_RTC_WRAPPERS_HPP_
+#define CUDA_RTC_WRAPPERS_HPP_
+
+static_assert(__cplusplus >= 201103L, "The CUDA NVRTC API wrappers can only be compiled with C++11 or a later version of the C++ language standard");
+
+#include <cuda/rtc/error.hpp>
+#include <cuda/rtc/cache.hpp>
+#include <cuda/rtc/program.hpp>
+#include <cuda/rtc/module.hpp>
+#include <cuda/rtc/specialization.hpp>
+
+#endif // CUDA_RTC_WRAPPERS_HPP_
@@ -0,0 +1,131 @@
+/**
+ * @file rtc/cache.hpp
+ *
+ * @brief A persistent, content-addressed on-disk cache for the results of
+ * runtime compilation, so that a program compiled by one process need not be
+ * recompiled by later ones.
+ */
+#pragma once
+#ifndef CUDA_RTC_WRAPPERS_CACHE_HPP_
+#define CUDA_RTC_WRAPPERS_CACHE_HPP_
+
+#include <cuda/api/detail/file_system.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace cuda {
+namespace rtc {
+
+/**
+ * @brief A directory of compilation results, each stored in a file named by
+ * its key - a hash of everything which determines the compilation's output.
+ *
+ * @note Entries are written to a temporary file, then renamed into place, so
+ * that multiple processes may safely share a cache directory.
+ */
+class cache_t {
+public: // getters
+	const ::std::string& directory() const noexcept { return directory_; }
+
+	::std::string path_of(const ::std::string& key) const { return directory_ + '/' + key; }
+
+public: // non-mutators
+
+	/**
+	 * @param[out] contents the entry's contents, if it was found
+	 * @return true if the cache holds an entry for @p key
+	 */
+	bool load(const ::std::string& key, ::std::string& contents) const
+	{
+		::std::ifstream file(path_of(key), ::std::ios::binary);
+		if (not file) { return false; }
+		contents.assign(::std::istreambuf_iterator<char>(file), ::std::istreambuf_iterator<char>());
+		return not file.bad();
+	}
+
+	/**
+	 * @return true if the entry was stored; failing to store an entry (e.g.
+	 * due to a lack of space or permissions) is not considered an error.
+	 *
+	 * @note Where renaming does not replace an existing file (i.e. on Windows),
+	 * the store which loses a race to create an entry fails harmlessly.
+	 */
+	bool store(const ::std::string& key, const ::std::string& contents) const noexcept
+	{
+		auto path = path_of(key);
+		// A unique temporary file, so that concurrent stores of the same entry -
+		// by other threads, as well as by other processes - never write to it
+		auto temporary_path = cuda::detail_::file_system::unique_temporary_path(path);
+		bool written;
+		try {
+			::std::ofstream file(temporary_path, ::std::ios::binary | ::std::ios::trunc);
+			file.write(contents.data(), static_cast<::std::streamsize>(contents.size()));
+			file.close();
+			written = not file.fail();
+		}
+		catch(...) {
+			written = false;
+		}
+		if (not written or ::std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+			::std::remove(temporary_path.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Remove an entry from the cache, if it is present
+	 */
+	void remove(const ::std::string& key) const noexcept
+	{
+		::std::remove(path_of(key).c_str());
+	}
+
+public: // constructors and destructor
+
+	/**
+	 * @param directory where to keep the cache's entries; created (along with
+	 * any missing parent directories) if necessary
+	 */
+	explicit cache_t(::std::string directory = default_directory()) : directory_(::std::move(directory))
+	{
+		cuda::detail_::file_system::create_directories(directory_, "runtime compilation cache directory");
+	}
+
+	/**
+	 * The cache directory used by default: the value of the `CUDA_API_WRAPPERS_RTC_CACHE_DIR`
+	 * environment variable, if set; otherwise, a subdirectory of the user's cache directory
+	 */
+	static ::std::string default_directory()
+	{
+		auto get_env = [](const char* name) -> ::std::string {
+			auto value = ::std::getenv(name);
+			return (value == nullptr) ? ::std::string{} : ::std::string{value};
+		};
+		auto directory = get_env("CUDA_API_WRAPPERS_RTC_CACHE_DIR");
+		if (not directory.empty()) { return directory; }
+#if defined(_WIN32)
+		auto user_cache_directory = get_env("LOCALAPPDATA");
+		if (user_cache_directory.empty()) { user_cache_directory = get_env("TEMP"); }
+#else
+		auto user_cache_directory = get_env("XDG_CACHE_HOME");
+		if (user_cache_directory.empty()) {
+			auto home = get_env("HOME");
+			user_cache_directory = home.empty() ? "/tmp" : home + "/.cache";
+		}
+#endif
+		return user_cache_directory + "/cuda-api-wrappers/rtc";
+	}
+
+protected: // data members
+	::std::string directory_;
+};
+
+} // namespace rtc
+} // namespace cuda
+
+#endif // CUDA_RTC_WRAPPERS_CACHE_HPP_
@@ -0,0 +1,132 @@
+/**
+ * @file rtc/detail/sha256.hpp
+ *
+ * @brief A compact implementation of the SHA-256 hash function (FIPS 180-4),
+ * used for content-addressing the runtime compilation cache.
+ */
+#pragma once
+#ifndef CUDA_RTC_WRAPPERS_DETAIL_SHA256_HPP_
+#define CUDA_RTC_WRAPPERS_DETAIL_SHA256_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+///@cond
+
+namespace cuda {
+namespace rtc {
+namespace detail_ {
+
+class sha256_t {
+public:
+	void update(const void* data, size_t size) noexcept
+	{
+		auto bytes = static_cast<const unsigned char*>(data);
+		total_size_ += size;
+		while (size > 0) {
+			auto num_to_take = ::std::min<size_t>(size, block_size - buffered_);
+			::std::memcpy(buffer_ + buffered_, bytes, num_to_take);
+			buffered_ += num_to_take; bytes += num_to_take; size -= num_to_take;
+			if (buffered_ == block_size) {
+				process_block(buffer_);
+				buffered_ = 0;
+			}
+		}
+	}
+
+	void update(const ::std::string& str) noexcept { update(str.data(), str.size()); }
+
+	/**
+	 * Appends a string along with its length, so that consecutive fields
+	 * can't be confused with each other
+	 */
+	void update_field(const ::std::string& str) noexcept
+	{
+		uint64_t length = str.size();
+		update(&length, sizeof(length));
+		update(str);
+	}
+
+	/**
+	 * @return the digest, as 64 lowercase hexadecimal digits
+	 */
+	::std::string hex_digest()
+	{
+		uint64_t bit_length = total_size_ * 8;
+		unsigned char padding[block_size + 8] = { 0x80 };
+		auto padding_size = ((buffered_ < 56) ? 56 : 120) - buffered_;
+		for(int i = 0; i < 8; i++) {
+			padding[padding_size + i] = static_cast<unsigned char>(bit_length >> (56 - 8 * i));
+		}
+		update(padding, padding_size + 8);
+
+		static const char digits[] = "0123456789abcdef";
+		::std::string result;
+		for(auto word : state_) {
+			for(int shift = 28; shift >= 0; shift -= 4) { result += digits[(word >> shift) & 0xF]; }
+		}
+		return result;
+	}
+
+protected:
+	enum : size_t { block_size = 64 };
+
+	static uint32_t rotate_right(uint32_t x, unsigned bits) noexcept { return (x >> bits) | (x << (32 - bits)); }
+
+	void process_block(const unsigned char* block) noexcept
+	{
+		static const uint32_t round_constants[64] = {
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+		};
+		uint32_t schedule[64];
+		for(int i = 0; i < 16; i++) {
+			schedule[i] =
+				  static_cast<uint32_t>(block[4 * i]) << 24 | static_cast<uint32_t>(block[4 * i + 1]) << 16
+				| static_cast<uint32_t>(block[4 * i + 2]) << 8 | static_cast<uint32_t>(block[4 * i + 3]);
+		}
+		for(int i = 16; i < 64; i++) {
+			auto s0 = rotate_right(schedule[i - 15], 7) ^ rotate_right(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3);
+			auto s1 = rotate_right(schedule[i - 2], 17) ^ rotate_right(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10);
+			schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+		}
+		auto a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+		auto e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+		for(int i = 0; i < 64; i++) {
+			auto s1 = rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25);
+			auto choice = (e & f) ^ (~e & g);
+			auto temp1 = h + s1 + choice + round_constants[i] + schedule[i];
+			auto s0 = rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22);
+			auto majority = (a & b) ^ (a & c) ^ (b & c);
+			auto temp2 = s0 + majority;
+			h = g; g = f; f = e; e = d + temp1;
+			d = c; c = b; b = a; a = temp1 + temp2;
+		}
+		state_[0] += a; state_[1] += b; state_[2] += c; state_[3] += d;
+		state_[4] += e; state_[5] += f; state_[6] += g; state_[7] += h;
+	}
+
+	uint32_t       state_[8] {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+	unsigned char  buffer_[block_size];
+	size_t         buffered_ { 0 };
+	uint64_t       total_size_ { 0 };
+};
+
+} // namespace detail_
+} // namespace rtc
+} // namespace cuda
+
+///@endcond
+
+#endif // CUDA_RTC_WRAPPERS_DETAIL_SHA256_HPP_
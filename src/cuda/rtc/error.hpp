@@ -0,0 +1,83 @@
+/**
+ * @file rtc/error.hpp
+ *
+ * @brief Facilities for exception-based handling of NVRTC errors, and of
+ * failures to compile programs at runtime.
+ */
+#pragma once
+#ifndef CUDA_RTC_WRAPPERS_ERROR_HPP_
+#define CUDA_RTC_WRAPPERS_ERROR_HPP_
+
+#include <nvrtc.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace cuda {
+namespace rtc {
+
+using status_t = nvrtcResult;
+
+inline bool is_success(status_t status) noexcept { return status == NVRTC_SUCCESS; }
+inline bool is_failure(status_t status) noexcept { return status != NVRTC_SUCCESS; }
+
+inline ::std::string describe(status_t status) { return nvrtcGetErrorString(status); }
+
+/**
+ * A class for exceptions raised by the NVRTC wrappers upon failure of an
+ * NVRTC API call
+ */
+class runtime_error : public ::std::runtime_error {
+public:
+	runtime_error(status_t error_code) :
+		::std::runtime_error(describe(error_code)),
+		code_(error_code)
+	{ }
+	runtime_error(status_t error_code, const ::std::string& what_arg) :
+		::std::runtime_error(what_arg + ": " + describe(error_code)),
+		code_(error_code)
+	{ }
+
+	/**
+	 * Obtain the NVRTC status code which resulted in this error being thrown.
+	 */
+	status_t code() const { return code_; }
+
+private:
+	status_t code_;
+};
+
+/**
+ * Thrown when a program's source fails to compile; carries the compiler's log
+ */
+class compilation_error : public runtime_error {
+public:
+	compilation_error(const ::std::string& program_name, const ::std::string& log) :
+		runtime_error(NVRTC_ERROR_COMPILATION, "Compiling program \"" + program_name + "\" failed"),
+		log_(log)
+	{ }
+
+	const ::std::string& log() const noexcept { return log_; }
+
+private:
+	::std::string log_;
+};
+
+/**
+ * Does nothing - unless the status indicates an error, in which case
+ * a @ref cuda::rtc::runtime_error exception is thrown
+ */
+inline void throw_if_error(status_t status, const ::std::string& message) noexcept(false)
+{
+	if (is_failure(status)) { throw runtime_error(status, message); }
+}
+
+inline void throw_if_error(status_t status) noexcept(false)
+{
+	if (is_failure(status)) { throw runtime_error(status); }
+}
+
+} // namespace rtc
+} // namespace cuda
+
+#endif // CUDA_RTC_WRAPPERS_ERROR_HPP_
@@ -0,0 +1,261 @@
+/**
+ * @file rtc/module.hpp
+ *
+ * @brief Loading runtime-compiled code onto a device, and launching the kernels
+ * it contains.
+ *
+ * @note The CUDA Runtime API cannot load code compiled at runtime, so this uses
+ * (a small part of) the CUDA Driver API; code including this file must be linked
+ * against the CUDA driver library.
+ */
+#pragma once
+#ifndef CUDA_RTC_WRAPPERS_MODULE_HPP_
+#define CUDA_RTC_WRAPPERS_MODULE_HPP_
+
+#include <cuda/rtc/program.hpp>
+
+#include <cuda/api/device.hpp>
+#include <cuda/api/kernel_launch.hpp>
+#include <cuda/api/stream.hpp>
+
+#include <cuda.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace cuda {
+namespace rtc {
+
+/**
+ * A class for exceptions raised upon failure of the CUDA Driver API calls
+ * made by the runtime compilation wrappers
+ */
+class driver_error : public ::std::runtime_error {
+public:
+	driver_error(CUresult error_code, const ::std::string& what_arg) :
+		::std::runtime_error(what_arg + ": " + describe(error_code)),
+		code_(error_code)
+	{ }
+
+	CUresult code() const { return code_; }
+
+	static ::std::string describe(CUresult status)
+	{
+		const char* description;
+		return (cuGetErrorString(status, &description) == CUDA_SUCCESS) ?
+			description : "unknown driver error " + ::std::to_string(status);
+	}
+
+private:
+	CUresult code_;
+};
+
+///@cond
+namespace detail_ {
+
+inline void throw_if_driver_error(CUresult status, const ::std::string& message)
+{
+	if (status != CUDA_SUCCESS) { throw driver_error(status, message); }
+}
+
+/**
+ * Makes a device's primary context - the one the Runtime API uses - current
+ * for the lifetime of the object
+ */
+class scoped_primary_context_t {
+public:
+	explicit scoped_primary_context_t(CUcontext context)
+	{
+		CUcontext current;
+		throw_if_driver_error(cuCtxGetCurrent(&current), "Failed obtaining the current context");
+		if (current != context) {
+			throw_if_driver_error(cuCtxPushCurrent(context), "Failed making a device's primary context current");
+			pushed_ = true;
+		}
+	}
+	~scoped_primary_context_t()
+	{
+		CUcontext popped;
+		if (pushed_) { cuCtxPopCurrent(&popped); }
+	}
+	scoped_primary_context_t(const scoped_primary_context_t&) = delete;
+
+protected:
+	bool pushed_ { false };
+};
+
+} // namespace detail_
+///@endcond
+
+/**
+ * @brief Compiled code loaded onto a device, within the device's primary context
+ * (i.e. the context used by the Runtime API).
+ */
+class module_t {
+public: // getters
+	cuda::device::id_t device_id() const noexcept { return device_id_; }
+	CUmodule handle() const noexcept { return handle_; }
+	CUcontext context() const noexcept { return context_; }
+
+public: // non-mutators
+
+	/**
+	 * @param mangled_name the name of a `__global__` function in the compiled
+	 * code, as obtained from @ref compiled_program_t::mangled_name
+	 */
+	CUfunction get_function(const ::std::string& mangled_name) const
+	{
+		CUfunction function;
+		detail_::throw_if_driver_error(cuModuleGetFunction(&function, handle_, mangled_name.c_str()),
+			"Failed locating kernel " + mangled_name + " in a runtime-compiled module");
+		return function;
+	}
+
+public: // constructors and destructor
+
+	/**
+	 * @param code PTX or cubin code, e.g. @ref compiled_program_t::code
+	 */
+	module_t(device_t device, const ::std::string& code) : device_id_(device.id())
+	{
+		detail_::throw_if_driver_error(cuInit(0), "Failed initializing the CUDA driver");
+		CUdevice driver_device;
+		detail_::throw_if_driver_error(cuDeviceGet(&driver_device, device_id_), "Failed obtaining a driver device handle");
+		detail_::throw_if_driver_error(cuDevicePrimaryCtxRetain(&context_, driver_device),
+			"Failed obtaining the primary context of device " + ::std::to_string(device_id_));
+		try {
+			detail_::scoped_primary_context_t context_scope(context_);
+			detail_::throw_if_driver_error(cuModuleLoadData(&handle_, code.data()),
+				"Failed loading runtime-compiled code onto device " + ::std::to_string(device_id_));
+		}
+		catch(...) {
+			cuDevicePrimaryCtxRelease(driver_device);
+			throw;
+		}
+	}
+
+	module_t(const module_t&) = delete;
+
+	~module_t()
+	{
+		try {
+			detail_::scoped_primary_context_t context_scope(context_);
+			cuModuleUnload(handle_);
+		}
+		catch(driver_error&) { }
+		CUdevice driver_device;
+		if (cuDeviceGet(&driver_device, device_id_) == CUDA_SUCCESS) { cuDevicePrimaryCtxRelease(driver_device); }
+	}
+
+public: // operators
+	module_t& operator=(const module_t&) = delete;
+
+protected: // data members
+	cuda::device::id_t  device_id_;
+	CUcontext           context_ { nullptr };
+	CUmodule            handle_ { nullptr };
+};
+
+/**
+ * @brief A kernel within a loaded @ref module_t ; keeps the module loaded for
+ * as long as it exists. Parameters passed when launching it are not type-checked
+ * - see @ref typed_kernel_t for that.
+ */
+class kernel_handle_t {
+public: // getters
+	const ::std::string& mangled_name() const noexcept { return mangled_name_; }
+	CUfunction handle() const noexcept { return function_; }
+	const ::std::shared_ptr<const module_t>& module() const noexcept { return module_; }
+	device_t device() const noexcept { return cuda::device::get(module_->device_id()); }
+
+public: // non-mutators
+
+	int get_attribute(CUfunction_attribute attribute) const
+	{
+		int value;
+		detail_::throw_if_driver_error(cuFuncGetAttribute(&value, attribute, function_),
+			"Failed obtaining an attribute of kernel " + mangled_name_);
+		return value;
+	}
+
+	grid::block_dimension_t maximum_threads_per_block() const
+	{
+		return static_cast<grid::block_dimension_t>(get_attribute(CU_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK));
+	}
+
+	/**
+	 * @param argument_ptrs addresses of the kernel's arguments, one per parameter
+	 */
+	void enqueue_launch(const stream_t& stream, launch_configuration_t launch_configuration, void** argument_ptrs) const
+	{
+		detail_::scoped_primary_context_t context_scope(module_->context());
+		const auto& grid = launch_configuration.grid_dimensions;
+		const auto& block = launch_configuration.block_dimensions;
+		auto recording_start = recording::detail_::begin();
+		detail_::throw_if_driver_error(cuLaunchKernel(function_,
+				grid.x, grid.y, grid.z, block.x, block.y, block.z,
+				launch_configuration.dynamic_shared_memory_size,
+				reinterpret_cast<CUstream>(stream.id()), argument_ptrs, nullptr),
+			"Failed launching runtime-compiled kernel " + mangled_name_);
+		recording::detail_::end(recording_start, recording::detail_::make_launch_record(
+			stream.id(), function_, grid, block, launch_configuration.dynamic_shared_memory_size));
+	}
+
+public: // constructors
+	kernel_handle_t(::std::shared_ptr<const module_t> module, ::std::string mangled_name) :
+		module_(::std::move(module)),
+		mangled_name_(::std::move(mangled_name)),
+		function_(module_->get_function(mangled_name_)) { }
+
+protected: // data members
+	::std::shared_ptr<const module_t>  module_;
+	::std::string                      mangled_name_;
+	CUfunction                         function_;
+};
+
+/**
+ * @brief A runtime-compiled kernel which is launched with arguments of specific
+ * types - those of the kernel's parameters - like a compiled-in kernel would be.
+ */
+template <typename... KernelParameters>
+class typed_kernel_t : public kernel_handle_t {
+public: // non-mutators
+
+	void enqueue_launch(const stream_t& stream, launch_configuration_t launch_configuration, KernelParameters... arguments) const
+	{
+		// Arrays of length 0 are not allowed, hence the extra element
+		void* argument_ptrs[sizeof...(KernelParameters) + 1];
+		cuda::detail_::collect_argument_addresses(argument_ptrs, arguments...);
+		kernel_handle_t::enqueue_launch(stream, launch_configuration, argument_ptrs);
+	}
+
+	/**
+	 * Launch the kernel on its device's default stream
+	 */
+	void launch(launch_configuration_t launch_configuration, KernelParameters... arguments) const
+	{
+		enqueue_launch(device().default_stream(), launch_configuration, arguments...);
+	}
+
+public: // constructors
+	explicit typed_kernel_t(kernel_handle_t untyped) : kernel_handle_t(::std::move(untyped)) { }
+};
+
+/**
+ * Launch a runtime-compiled kernel; the counterpart of @ref cuda::enqueue_launch
+ */
+template <typename... KernelParameters, typename... Arguments>
+inline void enqueue_launch(
+	const typed_kernel_t<KernelParameters...>&  kernel,
+	const stream_t&                             stream,
+	launch_configuration_t                      launch_configuration,
+	Arguments&&...                              arguments)
+{
+	kernel.enqueue_launch(stream, launch_configuration, ::std::forward<Arguments>(arguments)...);
+}
+
+} // namespace rtc
+} // namespace cuda
+
+#endif // CUDA_RTC_WRAPPERS_MODULE_HPP_
@@ -0,0 +1,423 @@
+/**
+ * @file rtc/program.hpp
+ *
+ * @brief Wrappers for compiling CUDA C++ programs at runtime, using NVRTC,
+ * into PTX or cubin code - with results kept in a persistent cache.
+ *
+ * @note NVRTC runs entirely on the host; no GPU is needed for compilation.
+ */
+#pragma once
+#ifndef CUDA_RTC_WRAPPERS_PROGRAM_HPP_
+#define CUDA_RTC_WRAPPERS_PROGRAM_HPP_
+
+#include <cuda/rtc/cache.hpp>
+#include <cuda/rtc/detail/sha256.hpp>
+#include <cuda/rtc/error.hpp>
+
+#include <cuda/api/device_properties.hpp>
+#include <cuda/api/versions.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cuda {
+namespace rtc {
+
+/**
+ * @return the version of the NVRTC library in use
+ */
+inline version_t version()
+{
+	version_t result;
+	throw_if_error(nvrtcVersion(&result.major, &result.minor), "Failed obtaining the NVRTC library version");
+	return result;
+}
+
+/**
+ * The kind of code a program is compiled into
+ */
+enum class code_kind_t {
+	/** PTX assembly, which the driver compiles further for a specific device */
+	ptx,
+	/** a binary image for a specific compute capability */
+	cubin
+};
+
+inline const char* name(code_kind_t kind) noexcept
+{
+	return (kind == code_kind_t::cubin) ? "cubin" : "ptx";
+}
+
+/**
+ * @brief The result of compiling a @ref program_t : the code, the compiler log,
+ * and the mangled (lowered) name of each of the program's name expressions.
+ */
+class compiled_program_t {
+public: // getters
+	const ::std::string& program_name() const noexcept { return program_name_; }
+	code_kind_t kind() const noexcept { return kind_; }
+
+	/**
+	 * The PTX source (null-terminated), or the cubin image
+	 */
+	const ::std::string& code() const noexcept { return code_; }
+	const ::std::string& log() const noexcept { return log_; }
+
+	/**
+	 * @return true if this result was read from the cache rather than compiled
+	 */
+	bool was_cached() const noexcept { return was_cached_; }
+
+	const ::std::map<::std::string, ::std::string>& mangled_names() const noexcept { return mangled_names_; }
+
+	/**
+	 * @param name_expression one of the name expressions added to the program
+	 * before compilation, e.g. `"my_kernel<float, 32>"`
+	 * @return the mangled name of the entity denoted by the expression, with which
+	 * it can be located in the compiled code
+	 */
+	const ::std::string& mangled_name(const ::std::string& name_expression) const
+	{
+		auto it = mangled_names_.find(name_expression);
+		if (it == mangled_names_.end()) {
+			throw ::std::out_of_range("No name expression \"" + name_expression
+				+ "\" was added to program \"" + program_name_ + "\" before compilation");
+		}
+		return it->second;
+	}
+
+public: // non-mutators
+
+	/**
+	 * A representation of the result, for storing in a @ref cache_t
+	 */
+	::std::string serialize() const
+	{
+		::std::string result { serialization_magic() };
+		append(result, name(kind_));
+		append(result, program_name_);
+		append(result, log_);
+		append(result, ::std::to_string(mangled_names_.size()));
+		for(const auto& pair : mangled_names_) {
+			append(result, pair.first);
+			append(result, pair.second);
+		}
+		append(result, code_);
+		return result;
+	}
+
+	/**
+	 * @return false if @p serialized is not a valid (or complete) serialization
+	 */
+	static bool deserialize(const ::std::string& serialized, compiled_program_t& result)
+	{
+		::std::string magic { serialization_magic() };
+		if (serialized.compare(0, magic.size(), magic) != 0) { return false; }
+		size_t pos = magic.size();
+		::std::string kind, num_names;
+		if (not (extract(serialized, pos, kind) and extract(serialized, pos, result.program_name_)
+			and extract(serialized, pos, result.log_) and extract(serialized, pos, num_names))) { return false; }
+		result.kind_ = (kind == name(code_kind_t::cubin)) ? code_kind_t::cubin : code_kind_t::ptx;
+		result.mangled_names_.clear();
+		for(auto i = ::std::strtoul(num_names.c_str(), nullptr, 10); i > 0; i--) {
+			::std::string name_expression, mangled;
+			if (not (extract(serialized, pos, name_expression) and extract(serialized, pos, mangled))) { return false; }
+			result.mangled_names_.emplace(::std::move(name_expression), ::std::move(mangled));
+		}
+		return extract(serialized, pos, result.code_) and pos == serialized.size();
+	}
+
+public: // constructors
+	compiled_program_t() = default;
+
+	compiled_program_t(
+		::std::string                               program_name,
+		code_kind_t                                 kind,
+		::std::string                               code,
+		::std::string                               log,
+		::std::map<::std::string, ::std::string>    mangled_names,
+		bool                                        was_cached = false)
+	:
+		program_name_(::std::move(program_name)), kind_(kind), code_(::std::move(code)), log_(::std::move(log)),
+		mangled_names_(::std::move(mangled_names)), was_cached_(was_cached) { }
+
+protected: // non-mutators
+	static const char* serialization_magic() noexcept { return "CAWRTC01"; }
+
+	static void append(::std::string& serialized, const ::std::string& field)
+	{
+		uint64_t size = field.size();
+		serialized.append(reinterpret_cast<const char*>(&size), sizeof(size));
+		serialized.append(field);
+	}
+
+	static bool extract(const ::std::string& serialized, size_t& pos, ::std::string& field)
+	{
+		uint64_t size;
+		if (serialized.size() - pos < sizeof(size)) { return false; }
+		::std::memcpy(&size, serialized.data() + pos, sizeof(size));
+		pos += sizeof(size);
+		if (serialized.size() - pos < size) { return false; }
+		field.assign(serialized, pos, static_cast<size_t>(size));
+		pos += static_cast<size_t>(size);
+		return true;
+	}
+
+protected: // data members
+	::std::string                               program_name_;
+	code_kind_t                                 kind_ { code_kind_t::ptx };
+	::std::string                               code_;
+	::std::string                               log_;
+	::std::map<::std::string, ::std::string>    mangled_names_;
+	bool                                        was_cached_ { false };
+
+	friend class program_t;
+};
+
+/**
+ * @brief A CUDA C++ program to be compiled at runtime: its source, the headers
+ * it may include, compilation options, and the name expressions (e.g. kernel
+ * template instantiations) whose mangled names are of interest.
+ *
+ * @note Nothing is compiled until @ref compile() is called; and if a cache is
+ * in use, and holds a result for the exact same program, compiler version, options
+ * and target, that result is read instead of invoking the compiler.
+ */
+class program_t {
+public: // getters
+	const ::std::string& name() const noexcept { return name_; }
+	const ::std::string& source() const noexcept { return source_; }
+	const ::std::vector<::std::pair<::std::string, ::std::string>>& headers() const noexcept { return headers_; }
+	const ::std::vector<::std::string>& options() const noexcept { return options_; }
+	const ::std::vector<::std::string>& name_expressions() const noexcept { return name_expressions_; }
+	bool has_target() const noexcept { return has_target_; }
+	device::compute_capability_t target() const noexcept { return target_; }
+	const cache_t* cache() const noexcept { return cache_.get(); }
+
+public: // mutators
+
+	/**
+	 * Append a fragment of source code to the program's source
+	 */
+	program_t& add_source(const ::std::string& source_fragment)
+	{
+		if (not source_.empty() and source_.back() != '\n') { source_ += '\n'; }
+		source_ += source_fragment;
+		return *this;
+	}
+
+	/**
+	 * Make a header available for inclusion by the program's source, without
+	 * it having to exist as a file
+	 *
+	 * @param include_name the name with which the source includes it, e.g. `"my/header.cuh"`
+	 */
+	program_t& add_header(::std::string include_name, ::std::string contents)
+	{
+		headers_.emplace_back(::std::move(include_name), ::std::move(contents));
+		return *this;
+	}
+
+	/**
+	 * @param option an NVRTC command-line option, e.g. `"-default-device"` or
+	 * `"-DTILE_SIZE=32"`; the target architecture should be set using @ref set_target
+	 */
+	program_t& add_option(::std::string option)
+	{
+		options_.push_back(::std::move(option));
+		return *this;
+	}
+
+	program_t& add_options(const ::std::vector<::std::string>& options)
+	{
+		options_.insert(options_.end(), options.begin(), options.end());
+		return *this;
+	}
+
+	program_t& set_target(device::compute_capability_t compute_capability) noexcept
+	{
+		target_ = compute_capability;
+		has_target_ = true;
+		return *this;
+	}
+
+	/**
+	 * @param name_expression the name of a `__global__` function or `__device__`/`__constant__`
+	 * variable, possibly a template instantiation - e.g. `"&my_kernel<float, 32>"`
+	 */
+	program_t& add_name_expression(::std::string name_expression)
+	{
+		name_expressions_.push_back(::std::move(name_expression));
+		return *this;
+	}
+
+	/**
+	 * Look up and store compilation results in the specified cache
+	 */
+	program_t& use_cache(cache_t cache)
+	{
+		cache_ = ::std::make_shared<cache_t>(::std::move(cache));
+		return *this;
+	}
+
+	program_t& use_no_cache() noexcept
+	{
+		cache_.reset();
+		return *this;
+	}
+
+public: // non-mutators
+
+	/**
+	 * The key under which the program's compilation result is cached: a hash of
+	 * everything which affects the result
+	 */
+	::std::string cache_key(code_kind_t kind) const
+	{
+		detail_::sha256_t hash;
+		auto nvrtc_version = version();
+		hash.update_field(compiled_program_t::serialization_magic());
+		hash.update_field(::std::to_string(nvrtc_version.major) + '.' + ::std::to_string(nvrtc_version.minor));
+		hash.update_field(rtc::name(kind));
+		hash.update_field(has_target_ ? ::std::to_string(target_.as_combined_number()) : "default");
+		hash.update_field(name_);
+		hash.update_field(source_);
+		hash.update_field(::std::to_string(headers_.size()));
+		for(const auto& header : headers_) {
+			hash.update_field(header.first);
+			hash.update_field(header.second);
+		}
+		hash.update_field(::std::to_string(options_.size()));
+		for(const auto& option : options_) { hash.update_field(option); }
+		hash.update_field(::std::to_string(name_expressions_.size()));
+		for(const auto& name_expression : name_expressions_) { hash.update_field(name_expression); }
+		return hash.hex_digest();
+	}
+
+	/**
+	 * @brief Compile the program - or, if a cache is in use and holds the result,
+	 * read it from there.
+	 *
+	 * @throws compilation_error if the source fails to compile
+	 * @throws runtime_error on other NVRTC failures
+	 */
+	compiled_program_t compile(code_kind_t kind = code_kind_t::ptx) const
+	{
+		::std::string key;
+		if (cache_) {
+			key = cache_key(kind);
+			::std::string serialized;
+			compiled_program_t cached;
+			if (cache_->load(key, serialized) and compiled_program_t::deserialize(serialized, cached)) {
+				cached.was_cached_ = true;
+				return cached;
+			}
+		}
+		auto result = compile_uncached(kind);
+		if (cache_) { cache_->store(key, result.serialize()); }
+		return result;
+	}
+
+public: // constructors
+
+	explicit program_t(::std::string name, ::std::string source = {}) :
+		name_(::std::move(name)), source_(::std::move(source)) { }
+
+protected: // non-mutators
+
+	::std::string target_option(code_kind_t kind) const
+	{
+		auto architecture = ::std::to_string(target_.as_combined_number());
+		return (kind == code_kind_t::cubin) ?
+			"--gpu-architecture=sm_" + architecture :
+			"--gpu-architecture=compute_" + architecture;
+	}
+
+	compiled_program_t compile_uncached(code_kind_t kind) const
+	{
+#if CUDART_VERSION < 11010
+		if (kind == code_kind_t::cubin) {
+			throw ::std::invalid_argument("Compilation into cubin requires NVRTC 11.1 or later");
+		}
+#endif
+		if (kind == code_kind_t::cubin and not has_target_) {
+			throw ::std::invalid_argument("A target compute capability must be set to compile into cubin");
+		}
+		::std::vector<const char*> header_names, header_contents;
+		for(const auto& header : headers_) {
+			header_names.push_back(header.first.c_str());
+			header_contents.push_back(header.second.c_str());
+		}
+		nvrtcProgram handle;
+		throw_if_error(nvrtcCreateProgram(&handle, source_.c_str(), name_.c_str(), static_cast<int>(headers_.size()),
+			header_contents.data(), header_names.data()), "Failed creating NVRTC program \"" + name_ + "\"");
+		struct destroyer_t {
+			nvrtcProgram& handle;
+			~destroyer_t() { nvrtcDestroyProgram(&handle); }
+		} destroyer { handle };
+
+		for(const auto& name_expression : name_expressions_) {
+			throw_if_error(nvrtcAddNameExpression(handle, name_expression.c_str()),
+				"Failed adding name expression \"" + name_expression + "\" to program \"" + name_ + "\"");
+		}
+		auto options = options_;
+		if (has_target_) { options.push_back(target_option(kind)); }
+		::std::vector<const char*> raw_options;
+		for(const auto& option : options) { raw_options.push_back(option.c_str()); }
+		auto status = nvrtcCompileProgram(handle, static_cast<int>(raw_options.size()), raw_options.data());
+
+		size_t log_size;
+		throw_if_error(nvrtcGetProgramLogSize(handle, &log_size), "Failed obtaining the compilation log size");
+		::std::string log(log_size, '\0');
+		throw_if_error(nvrtcGetProgramLog(handle, &log[0]), "Failed obtaining the compilation log");
+		if (not log.empty() and log.back() == '\0') { log.pop_back(); }
+		if (status == NVRTC_ERROR_COMPILATION) { throw compilation_error(name_, log); }
+		throw_if_error(status, "Failed compiling program \"" + name_ + "\"");
+
+		::std::string code;
+		size_t code_size;
+#if CUDART_VERSION >= 11010
+		if (kind == code_kind_t::cubin) {
+			throw_if_error(nvrtcGetCUBINSize(handle, &code_size), "Failed obtaining the compiled cubin size");
+			code.resize(code_size);
+			throw_if_error(nvrtcGetCUBIN(handle, &code[0]), "Failed obtaining the compiled cubin");
+		}
+		else
+#endif
+		{
+			throw_if_error(nvrtcGetPTXSize(handle, &code_size), "Failed obtaining the compiled PTX size");
+			code.resize(code_size);
+			throw_if_error(nvrtcGetPTX(handle, &code[0]), "Failed obtaining the compiled PTX");
+		}
+
+		::std::map<::std::string, ::std::string> mangled_names;
+		for(const auto& name_expression : name_expressions_) {
+			const char* lowered_name;
+			throw_if_error(nvrtcGetLoweredName(handle, name_expression.c_str(), &lowered_name),
+				"Failed obtaining the mangled name for \"" + name_expression + "\"");
+			mangled_names.emplace(name_expression, lowered_name);
+		}
+		return { name_, kind, ::std::move(code), ::std::move(log), ::std::move(mangled_names) };
+	}
+
+protected: // data members
+	::std::string                                               name_;
+	::std::string                                               source_;
+	::std::vector<::std::pair<::std::string, ::std::string>>    headers_;
+	::std::vector<::std::string>                                options_;
+	::std::vector<::std::string>                                name_expressions_;
+	device::compute_capability_t                                target_ {};
+	bool                                                        has_target_ { false };
+	::std::shared_ptr<const cache_t>                            cache_;
+};
+
+} // namespace rtc
+} // namespace cuda
+
+#endif // CUDA_RTC_WRAPPERS_PROGRAM_HPP_
@@ -0,0 +1,223 @@
+/**
+ * @file rtc/specialization.hpp
+ *
+ * @brief Instantiating kernel templates at runtime: compiling specializations on
+ * demand, in the background, and memoizing them - instead of compiling every
+ * possible combination of template arguments ahead of time.
+ */
+#pragma once
+#ifndef CUDA_RTC_WRAPPERS_SPECIALIZATION_HPP_
+#define CUDA_RTC_WRAPPERS_SPECIALIZATION_HPP_
+
+#include <cuda/rtc/module.hpp>
+#include <cuda/rtc/program.hpp>
+
+#include <cuda/api/detail/thread_pool.hpp>
+#include <cuda/api/device.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace cuda {
+namespace rtc {
+
+/**
+ * The spelling of a type in CUDA C++ source, for use as a template argument
+ *
+ * @note Only defined for fundamental types; for other types, spell out the
+ * template argument yourself.
+ */
+template <typename T> inline const char* type_name();
+
+///@cond
+#define CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(type) \
+template <> inline const char* type_name<type>() { return #type; }
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(bool)
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(char)
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(signed char)
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(unsigned char)
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(short)
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(unsigned short)
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(int)
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(unsigned int)
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(long)
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(unsigned long)
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(long long)
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(unsigned long long)
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(float)
+CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME(double)
+#undef CUDA_RTC_WRAPPERS_DEFINE_TYPE_NAME
+///@endcond
+
+/**
+ * The spelling of a value in CUDA C++ source, for use as a (non-type) template argument
+ */
+template <typename T>
+inline typename ::std::enable_if<::std::is_integral<T>::value and not ::std::is_same<T, bool>::value, ::std::string>::type
+template_argument(T value)
+{
+	return ::std::to_string(value);
+}
+
+inline ::std::string template_argument(bool value) { return value ? "true" : "false"; }
+
+/**
+ * @brief Compiles, loads and memoizes specializations of a single kernel template
+ * for a single device.
+ *
+ * Each specialization is compiled as a separate program - with the kernel template's
+ * source, headers and options - on a pool of background threads, and then loaded onto
+ * the device. If the base program uses a cache, so do the specializations; in that
+ * case, after the first run, obtaining a specialization requires no compilation.
+ */
+class specializer_t {
+public: // getters
+	const program_t& base_program() const noexcept { return base_program_; }
+	const ::std::string& kernel_template_name() const noexcept { return kernel_template_name_; }
+	device_t device() const noexcept { return cuda::device::get(device_id_); }
+
+	/**
+	 * The number of specializations requested so far (not all of which may have been compiled yet)
+	 */
+	size_t num_specializations() const
+	{
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		return specializations_.size();
+	}
+
+public: // non-mutators
+
+	/**
+	 * @return the name expression denoting the specialization, e.g. `"my_kernel<float, 32>"`
+	 */
+	::std::string name_expression(const ::std::vector<::std::string>& template_arguments) const
+	{
+		::std::string expression = kernel_template_name_ + '<';
+		for(size_t i = 0; i < template_arguments.size(); i++) {
+			if (i > 0) { expression += ", "; }
+			expression += template_arguments[i];
+		}
+		// Avoid ">>" for nested template arguments, which older dialects lex as a shift
+		if (expression.back() == '>') { expression += ' '; }
+		return expression + '>';
+	}
+
+public: // mutators
+
+	/**
+	 * @brief Start compiling (and loading) a specialization in the background,
+	 * unless that has already been done or begun.
+	 *
+	 * @param template_arguments the arguments of the kernel template, spelled as
+	 * they would be in the source - e.g. `{ "float", "32" }`; see @ref type_name
+	 * and @ref template_argument
+	 * @return a future which becomes ready once the specialization is ready for launching,
+	 * or holds the exception thrown by the compiler or loader
+	 */
+	::std::shared_future<kernel_handle_t> request(const ::std::vector<::std::string>& template_arguments)
+	{
+		auto expression = name_expression(template_arguments);
+		::std::lock_guard<::std::mutex> lock(mutex_);
+		auto it = specializations_.find(expression);
+		if (it != specializations_.end()) { return it->second; }
+		auto program = base_program_;
+		// The name expression denotes the kernel's address
+		auto address_expression = '&' + expression;
+		program.add_name_expression(address_expression);
+		auto device_id = device_id_;
+		auto future = pool_->submit([program, address_expression, device_id]() {
+			auto device = cuda::device::get(device_id);
+			program_t targeted_program { program };
+			targeted_program.set_target(device.compute_capability());
+#if CUDART_VERSION >= 11010
+			// Load-time PTX compilation is avoided by compiling for the exact device
+			auto compiled = targeted_program.compile(code_kind_t::cubin);
+#else
+			auto compiled = targeted_program.compile(code_kind_t::ptx);
+#endif
+			auto module = ::std::make_shared<const module_t>(device, compiled.code());
+			return kernel_handle_t { module, compiled.mangled_name(address_expression) };
+		}).share();
+		specializations_.emplace(expression, future);
+		return future;
+	}
+
+	/**
+	 * @brief Obtain a specialization, waiting for its compilation if necessary.
+	 *
+	 * @tparam KernelParameters the types of the specialization's parameters
+	 */
+	template <typename... KernelParameters>
+	typed_kernel_t<KernelParameters...> get(const ::std::vector<::std::string>& template_arguments)
+	{
+		return typed_kernel_t<KernelParameters...>{ request(template_arguments).get() };
+	}
+
+	/**
+	 * @brief Start compiling multiple specializations in the background, to be
+	 * obtained later with @ref get
+	 */
+	void prefetch(const ::std::vector<::std::vector<::std::string>>& template_argument_lists)
+	{
+		for(const auto& template_arguments : template_argument_lists) { request(template_arguments); }
+	}
+
+public: // constructors and destructor
+
+	/**
+	 * @param base_program a program whose source defines the kernel template;
+	 * any name expressions it has are ignored
+	 * @param kernel_template_name the (qualified) name of the `__global__` function template
+	 * @param num_compilation_threads the number of specializations which may be
+	 * compiled concurrently; 0 for the number of hardware threads
+	 */
+	specializer_t(
+		const program_t&  base_program,
+		::std::string     kernel_template_name,
+		device_t          device,
+		size_t            num_compilation_threads = 0)
+	:
+		base_program_(base_program.name(), base_program.source()),
+		kernel_template_name_(::std::move(kernel_template_name)),
+		device_id_(device.id()),
+		pool_(new cuda::detail_::thread_pool_t(num_compilation_threads > 0 ?
+			num_compilation_threads : ::std::max(1u, ::std::thread::hardware_concurrency())))
+	{
+		// Each specialization needs exactly one name expression: its own
+		for(const auto& header : base_program.headers()) { base_program_.add_header(header.first, header.second); }
+		base_program_.add_options(base_program.options());
+		if (base_program.cache() != nullptr) { base_program_.use_cache(*base_program.cache()); }
+	}
+
+	specializer_t(const specializer_t&) = delete;
+
+	~specializer_t()
+	{
+		// Pending compilations must not outlive the specializer
+		pool_.reset();
+	}
+
+public: // operators
+	specializer_t& operator=(const specializer_t&) = delete;
+
+protected: // data members
+	program_t                                                         base_program_;
+	::std::string                                                     kernel_template_name_;
+	cuda::device::id_t                                                device_id_;
+	mutable ::std::mutex                                              mutex_;
+	::std::map<::std::string, ::std::shared_future<kernel_handle_t>>  specializations_;
+	::std::unique_ptr<cuda::detail_::thread_pool_t>                   pool_;
+};
+
+} // namespace rtc
+} // namespace cuda
+
+#endif // CUDA_RTC_WRAPPERS_SPECIALIZATION_HPP_
@@ -33,5 +33,22 @@
 #include <cuda/api/multi_wrapper_impls.hpp>
 #include <cuda/api/kernel.hpp>
 #include <cuda/api/kernel_launch.hpp>
+#include <cuda/api/mirrored_buffer.hpp>
+#include <cuda/api/readback.hpp>
+#include <cuda/api/dirty_page_tracker.hpp>
+#include <cuda/api/host_copy_engine.hpp>
+#include <cuda/api/copy_planner.hpp>
+#include <cuda/api/transfer_scheduler.hpp>
+#include <cuda/api/event_pool.hpp>
+#include <cuda/api/chunked_copy.hpp>
+#include <cuda/api/zero_tracker.hpp>
+#include <cuda/api/deferred_destruction.hpp>
+#include <cuda/api/timing_collector.hpp>
+#include <cuda/api/staging.hpp>
+#include <cuda/api/staging_conversions.hpp>
+#include <cuda/api/affinity.hpp>
+#include <cuda/api/load_balancing.hpp>
+#include <cuda/api/warm_up.hpp>
+#include <cuda/api/recording.hpp>
 
 #endif // CUDA_RUNTIME_API_WRAPPERS_HPP_